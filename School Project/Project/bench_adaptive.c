@@ -0,0 +1,323 @@
+// bench_adaptive.c — see bench_adaptive.h
+//
+// Mean: Student-t interval, t from the normal quantile by Cornish-Fisher
+// (within 0.5% of the table from 4 degrees of freedom up).
+// Percentile q: distribution-free order-statistic interval, ranks
+// n·q ± z·sqrt(n·q·(1-q)); undefined (keep sampling) until both ranks fit.
+#include "bench_adaptive.h"
+
+#include "pico/stdlib.h"
+#include "pico/time.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flash_benchmark.h" // flash_dev_current()
+#include "sd_card.h"         // SERIES.CSV I/O
+#include "stream_stats.h"
+#include "web/http_server.h" // /events
+
+#define SERIES_HEADER "jedec_id,operation,label,block_size,iterations,statistic,estimate_us,ci_rel,target_rel,confidence,stop,elapsed_ms,device"
+
+// Series never keep more than this many samples (the benches use 100)
+#define ADAPT_SORT_MAX 256
+
+static bench_adapt_cfg_t s_cfg = {
+    .enabled = false,
+    .min_iters = BENCH_ADAPT_MIN_ITERS,
+    .max_iters = 100,
+    .rel_halfwidth = 0.02f,
+    .confidence = 0.95f,
+    .quantile = -1.0f,
+    .budget_ms = BENCH_ADAPT_BUDGET_MS,
+};
+
+static const char *const k_stop_name[] = {"fixed", "converged", "max_iters", "budget"};
+
+bench_adapt_cfg_t *bench_adapt_config(void) { return &s_cfg; }
+
+/* ------------------------------- quantiles -------------------------------- */
+// Two-sided z for the configured confidence (Abramowitz-Stegun 26.2.23)
+static double z_two_sided(double conf)
+{
+    if (conf < 0.5) conf = 0.5;
+    if (conf > 0.999) conf = 0.999;
+    double p = (1.0 - conf) / 2.0;
+    double t = sqrt(-2.0 * log(p));
+    return t - (2.515517 + 0.802853 * t + 0.010328 * t * t) /
+                   (1.0 + 1.432788 * t + 0.189269 * t * t + 0.001308 * t * t * t);
+}
+
+static double t_two_sided(double conf, int df)
+{
+    double z = z_two_sided(conf), z2 = z * z, d = (double)df;
+    return z + z * (z2 + 1.0) / (4.0 * d) +
+           z * ((5.0 * z2 + 16.0) * z2 + 3.0) / (96.0 * d * d) +
+           z * (((3.0 * z2 + 19.0) * z2 + 17.0) * z2 - 15.0) / (384.0 * d * d * d);
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    const uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x < y) ? -1 : (x > y);
+}
+
+// Estimate and relative CI half-width of the configured statistic; rel is
+// INFINITY while the interval is not defined yet.
+static void evaluate(const uint64_t *samples, int n, double *est, double *rel)
+{
+    *est = NAN;
+    *rel = INFINITY;
+    if (n < 2)
+        return;
+
+    if (s_cfg.quantile < 0.0f)
+    {
+        stream_stats_t w;
+        stream_stats_init(&w);
+        for (int i = 0; i < n; ++i)
+            stream_stats_push(&w, (double)samples[i]);
+        *est = w.mean;
+        double half = t_two_sided(s_cfg.confidence, n - 1) * stream_stats_sd(&w) / sqrt((double)n);
+        if (w.mean > 0.0)
+            *rel = half / w.mean;
+        return;
+    }
+
+    uint64_t sorted[ADAPT_SORT_MAX];
+    if (n > ADAPT_SORT_MAX)
+        n = ADAPT_SORT_MAX;
+    memcpy(sorted, samples, (size_t)n * sizeof sorted[0]);
+    qsort(sorted, (size_t)n, sizeof sorted[0], cmp_u64);
+
+    double q = s_cfg.quantile;
+    double pos = q * (n - 1);
+    int lo = (int)floor(pos), hi = (int)ceil(pos);
+    *est = sorted[lo] + (pos - lo) * ((double)sorted[hi] - (double)sorted[lo]);
+
+    double spread = z_two_sided(s_cfg.confidence) * sqrt(n * q * (1.0 - q));
+    int r_lo = (int)floor(n * q - spread); // 1-based ranks
+    int r_hi = (int)ceil(n * q + spread) + 1;
+    if (r_lo < 1 || r_hi > n || !(*est > 0.0))
+        return;
+    double half = fmax(*est - (double)sorted[r_lo - 1], (double)sorted[r_hi - 1] - *est);
+    *rel = half / *est;
+}
+
+static void stat_name(char *out, size_t n)
+{
+    if (s_cfg.quantile < 0.0f)
+        snprintf(out, n, "mean");
+    else
+        snprintf(out, n, "p%d", (int)lroundf(s_cfg.quantile * 100.0f));
+}
+
+/* ------------------------------- live view -------------------------------- */
+#if HTTP_EVENTS_LIVE
+static const char *json_num(char *buf, size_t n, const char *fmt, double v)
+{
+    if (!isfinite(v))
+        return "null";
+    snprintf(buf, n, fmt, v);
+    return buf;
+}
+
+// How the series stands, as a /events "series" message
+static void live_series(const bench_adapt_t *a, const uint64_t *samples, int n, const char *state)
+{
+    stream_summary_t st;
+    stream_summary_init(&st);
+    for (int i = 0; i < n; ++i)
+        stream_summary_push(&st, (double)samples[i]);
+    double est, rel;
+    evaluate(samples, n, &est, &rel);
+
+    char stat[8], v[7][24], json[384];
+    stat_name(stat, sizeof stat);
+    int len = snprintf(json, sizeof json,
+                       "{\"op\":\"%s\",\"label\":\"%s\",\"size\":%lu,\"n\":%d,\"mean_us\":%s,\"sd_us\":%s,"
+                       "\"min_us\":%s,\"p50_us\":%s,\"max_us\":%s,\"stat\":\"%s\",\"est_us\":%s,\"rel\":%s,"
+                       "\"target\":%.4f,\"state\":\"%s\",\"device\":%d}",
+                       a->op, a->label ? a->label : "", (unsigned long)a->size, n,
+                       json_num(v[0], sizeof v[0], "%.1f", n ? st.w.mean : NAN),
+                       json_num(v[1], sizeof v[1], "%.1f", stream_stats_sd(&st.w)),
+                       json_num(v[2], sizeof v[2], "%.0f", n ? st.w.min : NAN),
+                       json_num(v[3], sizeof v[3], "%.1f", stream_summary_quartile(&st, 2)),
+                       json_num(v[4], sizeof v[4], "%.0f", n ? st.w.max : NAN), stat,
+                       json_num(v[5], sizeof v[5], "%.1f", est), json_num(v[6], sizeof v[6], "%.4f", rel),
+                       s_cfg.enabled ? s_cfg.rel_halfwidth : 0.0f, state, flash_dev_current());
+    if (len > 0 && len < (int)sizeof json)
+        http_events_publish("series", json);
+}
+
+// Between iterations, before the next one's clock starts: let the network
+// run and, every HTTP_EVENTS_SERIES_MS, tell /events how the series stands
+static void live_update(bench_adapt_t *a, const uint64_t *samples, int n)
+{
+    uint64_t now = time_us_64();
+    if (n > 0 && http_events_wanted() && now - a->live_us >= HTTP_EVENTS_SERIES_MS * 1000ull)
+    {
+        live_series(a, samples, n, "running");
+        a->live_us = now;
+    }
+    http_server_service_busy();
+}
+#endif
+
+/* --------------------------------- API ------------------------------------ */
+bool bench_adapt_parse(const char *arg)
+{
+    while (*arg == ' ')
+        arg++;
+    if (!strcmp(arg, "off"))
+    {
+        s_cfg.enabled = false;
+        return true;
+    }
+    char *end;
+    double pct = strtod(arg, &end);
+    if (end == arg || !(pct > 0.0 && pct < 100.0))
+        return false;
+    double q = -1.0;
+    while (*end == ' ' || *end == ':')
+        end++;
+    if (*end == 'p' || *end == 'P')
+    {
+        char *qend;
+        q = strtod(end + 1, &qend) / 100.0;
+        if (qend == end + 1 || *qend || !(q > 0.0 && q < 1.0))
+            return false;
+    }
+    else if (*end)
+        return false;
+    s_cfg.enabled = true;
+    s_cfg.rel_halfwidth = (float)(pct / 100.0);
+    s_cfg.quantile = (float)q;
+    return true;
+}
+
+const char *bench_adapt_plan(int fixed_iters)
+{
+    static char buf[96];
+    if (!s_cfg.enabled)
+    {
+        snprintf(buf, sizeof buf, "%d iterations", fixed_iters);
+        return buf;
+    }
+    char stat[8];
+    stat_name(stat, sizeof stat);
+    int max = (s_cfg.max_iters < fixed_iters) ? s_cfg.max_iters : fixed_iters;
+    int n = snprintf(buf, sizeof buf, "%u..%d iterations, ±%.1f%% %.0f%% CI of %s",
+                     (unsigned)s_cfg.min_iters, max, s_cfg.rel_halfwidth * 100.0f,
+                     s_cfg.confidence * 100.0f, stat);
+    if (s_cfg.budget_ms && n > 0 && n < (int)sizeof buf)
+        snprintf(buf + n, sizeof buf - n, ", ≤%lu s",
+                 (unsigned long)(s_cfg.budget_ms / 1000u));
+    return buf;
+}
+
+void bench_adapt_begin(bench_adapt_t *a, const char *op, const char *label,
+                       uint32_t size, int fixed_iters)
+{
+    memset(a, 0, sizeof *a);
+    a->op = op;
+    a->label = label;
+    a->size = size;
+    a->fixed_iters = fixed_iters;
+    a->t0_us = time_us_64();
+    a->est = NAN;
+    a->rel = INFINITY;
+    a->stop = ADAPT_STOP_FIXED;
+}
+
+bool bench_adapt_next(bench_adapt_t *a, const uint64_t *samples, int n)
+{
+#if HTTP_EVENTS_LIVE
+    live_update(a, samples, n);
+#endif
+    if (!s_cfg.enabled)
+    {
+        if (a->iters >= a->fixed_iters)
+            return false;
+        a->iters++;
+        return true;
+    }
+
+    int min = (s_cfg.min_iters < 3) ? 3 : s_cfg.min_iters;
+    int max = (s_cfg.max_iters < a->fixed_iters) ? s_cfg.max_iters : a->fixed_iters;
+    if (min > max)
+        min = max;
+
+    if (a->iters >= min)
+    {
+        evaluate(samples, n, &a->est, &a->rel);
+        if (a->rel <= s_cfg.rel_halfwidth)
+        {
+            a->stop = ADAPT_STOP_CONVERGED;
+            return false;
+        }
+    }
+    if (a->iters >= max)
+    {
+        a->stop = ADAPT_STOP_MAX;
+        return false;
+    }
+    // Budget: stop when the next iteration (at the average pace so far) would
+    // not finish in time. The first iteration always runs.
+    if (s_cfg.budget_ms && a->iters > 0)
+    {
+        uint64_t spent = time_us_64() - a->t0_us;
+        uint64_t pace = spent / (uint64_t)a->iters;
+        if (spent + pace > (uint64_t)s_cfg.budget_ms * 1000u)
+        {
+            a->stop = ADAPT_STOP_BUDGET;
+            return false;
+        }
+    }
+    a->iters++;
+    return true;
+}
+
+void bench_adapt_end(bench_adapt_t *a, const char *jedec, const uint64_t *samples, int n)
+{
+    // The stopping check may be a few samples behind (fixed mode never ran it)
+    evaluate(samples, n, &a->est, &a->rel);
+    uint32_t elapsed_ms = (uint32_t)((time_us_64() - a->t0_us) / 1000u);
+
+    char stat[8], rel[16], est[24];
+    stat_name(stat, sizeof stat);
+    char pct[16];
+    if (isfinite(a->rel))
+    {
+        snprintf(rel, sizeof rel, "%.4f", a->rel);
+        snprintf(pct, sizeof pct, "%.2f", a->rel * 100.0);
+    }
+    else
+    {
+        snprintf(rel, sizeof rel, "NA");
+        snprintf(pct, sizeof pct, "?");
+    }
+    if (a->est == a->est)
+        snprintf(est, sizeof est, "%.1f", a->est);
+    else
+        snprintf(est, sizeof est, "NA");
+
+    printf("📏 %s %s: %d iterations, %s %s µs ±%s%% (%.0f%% CI), %s\n",
+           a->op, a->label ? a->label : "?", a->iters, stat, est,
+           pct, s_cfg.confidence * 100.0f, k_stop_name[a->stop]);
+
+    char row[192];
+    int len = snprintf(row, sizeof row, "%s,%s,%s,%lu,%d,%s,%s,%s,%.4f,%.3f,%s,%lu,%d",
+                       jedec ? jedec : "NA", a->op, a->label ? a->label : "NA",
+                       (unsigned long)a->size, a->iters, stat, est, rel,
+                       s_cfg.enabled ? s_cfg.rel_halfwidth : 0.0f, s_cfg.confidence,
+                       k_stop_name[a->stop], (unsigned long)elapsed_ms, flash_dev_current());
+    if (len > 0 && len < (int)sizeof row && !sd_append_csv_row(SERIES_FILENAME, SERIES_HEADER, row))
+        printf("❌ Failed to append %s; continuing\n", SERIES_FILENAME);
+#if HTTP_EVENTS_LIVE
+    if (http_events_wanted())
+        live_series(a, samples, n, k_stop_name[a->stop]);
+#endif
+}
@@ -0,0 +1,72 @@
+// bench_adaptive.h — adaptive iteration count for the read/write/erase benches
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Per-series log: one row per size with the iterations used and the
+// confidence interval actually reached (fixed-count runs are logged too).
+#define SERIES_FILENAME "SERIES.CSV"
+
+// Defaults for the adaptive mode (menu: "adaptive <pct> [p<q>]")
+#ifndef BENCH_ADAPT_MIN_ITERS
+#define BENCH_ADAPT_MIN_ITERS 5
+#endif
+#ifndef BENCH_ADAPT_BUDGET_MS
+#define BENCH_ADAPT_BUDGET_MS (10u * 60u * 1000u) /* per size */
+#endif
+
+typedef enum {
+    ADAPT_STOP_FIXED = 0, // adaptive mode off: ran the fixed count
+    ADAPT_STOP_CONVERGED, // CI within the target
+    ADAPT_STOP_MAX,       // hit max_iters first
+    ADAPT_STOP_BUDGET     // next iteration would overrun the time budget
+} bench_adapt_stop_t;
+
+typedef struct {
+    bool     enabled;       // false = every size runs the bench's fixed count
+    uint16_t min_iters;     // before the CI is trusted (>= 3)
+    uint16_t max_iters;     // capped by the bench's sample storage (N_ITERS)
+    float    rel_halfwidth; // target: CI half-width / estimate (0.02 = ±2 %)
+    float    confidence;    // 0.80 .. 0.999
+    float    quantile;      // < 0: CI of the mean; 0..1: CI of that percentile
+    uint32_t budget_ms;     // per size, 0 = unlimited; ends a series even below min_iters
+} bench_adapt_cfg_t;
+
+// Settings shared by all benches; edit in place (menu / host flags).
+bench_adapt_cfg_t *bench_adapt_config(void);
+
+// "off" | "<pct>[ p<q>]" (also "<pct>:p<q>"), e.g. "2" = ±2 % CI of the mean,
+// "5 p99" = ±5 % CI of the 99th percentile. false on a malformed argument.
+bool bench_adapt_parse(const char *arg);
+
+// "100 iterations" or "5..100 iterations, ±2.0% CI of mean, ≤600 s" for banners.
+const char *bench_adapt_plan(int fixed_iters);
+
+typedef struct {
+    const char *op, *label;
+    uint32_t size;
+    int fixed_iters;         // fixed count, also the sample storage size
+    int iters;               // iterations started
+    uint64_t t0_us;
+    double est, rel;         // estimate (µs) and achieved CI half-width / estimate
+    uint64_t live_us;        // last statistics sent to /events
+    bench_adapt_stop_t stop;
+} bench_adapt_t;
+
+void bench_adapt_begin(bench_adapt_t *a, const char *op, const char *label,
+                       uint32_t size, int fixed_iters);
+
+// Call at the top of every iteration with the samples (µs) so far; false
+// means stop. Iterations that store no sample still count against the bounds.
+bool bench_adapt_next(bench_adapt_t *a, const uint64_t *samples, int n);
+
+// Console line + SERIES.CSV row for the finished series.
+void bench_adapt_end(bench_adapt_t *a, const char *jedec, const uint64_t *samples, int n);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,384 @@
+#include "bench_endurance.h"
+
+#include "pico/stdlib.h"
+#include "hardware/adc.h"
+#include "pico/time.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "flash_benchmark.h" // flash_* APIs
+#include "sd_card.h"         // ENDURE.CSV
+#include "fatfs/ff.h"        // ENDURE.CHK (binary)
+#include "endurance.h"       // portable engine
+#include "wear_sched.h"      // WEAR.BIN counters for the cycled sectors
+#include "pattern.h"
+
+#ifdef ASCII_UNITS
+#define UNIT_US "us"
+#else
+#define UNIT_US "\xC2\xB5" \
+                "s" /* "µs" in UTF-8 */
+#endif
+
+// -----------------------------------------------------------------------------
+// Config
+// -----------------------------------------------------------------------------
+#define ENDURE_CSV "ENDURE.CSV"
+#define ENDURE_CHK "ENDURE.CHK"
+#define ENDURE_HEADER "jedec_id,cycle_end,cycles,base,sectors," \
+                      "erase_mean_us,erase_min_us,erase_max_us,erase_sd_us," \
+                      "prog_mean_us,prog_min_us,prog_max_us,prog_sd_us," \
+                      "verify_fail,verify_fail_total,first_fail_cycle," \
+                      "temp_C,voltage_V,timestamp,notes"
+
+#ifndef ENDURANCE_SECTORS
+#define ENDURANCE_SECTORS 2u
+#endif
+#ifndef ENDURANCE_TARGET_CYCLES
+#define ENDURANCE_TARGET_CYCLES 100000u
+#endif
+#ifndef ENDURANCE_WINDOW
+#define ENDURANCE_WINDOW 100u /* cycles per ENDURE.CSV row */
+#endif
+#ifndef ENDURANCE_CKPT_EVERY
+#define ENDURANCE_CKPT_EVERY 1u /* windows per checkpoint */
+#endif
+#ifndef ENDURANCE_BASE
+#define ENDURANCE_BASE 0u /* 0 = last ENDURANCE_SECTORS sectors of the chip */
+#endif
+#ifndef ENDURANCE_PATTERN
+#define ENDURANCE_PATTERN PAT_RANDOM
+#endif
+
+#define ENDURE_CHK_VERSION 1u
+
+typedef struct {
+    char              magic[4]; // "ENDC"
+    uint32_t          version;
+    char              jedec[16];
+    endurance_cfg_t   cfg;
+    endurance_state_t st;
+} endure_chk_t;
+
+// -----------------------------------------------------------------------------
+// Small helpers (duplicated per bench module; main.c helpers are static)
+// -----------------------------------------------------------------------------
+static inline void make_timestamp(char *buf, size_t n)
+{
+    uint64_t us = to_us_since_boot(get_absolute_time());
+    uint32_t s = (uint32_t)(us / 1000000ULL);
+    uint32_t hh = s / 3600;
+    uint32_t mm = (s % 3600) / 60;
+    uint32_t ss = s % 60;
+    snprintf(buf, n, "2025-09-28 %02lu:%02lu:%02lu",
+             (unsigned long)hh, (unsigned long)mm, (unsigned long)ss);
+}
+
+#define ADC_CONV (3.3f / (1 << 12))
+#define ADC_VSYS_DIV 3.0f
+#define ADC_TEMP_CH 4
+#define ADC_VSYS_CH 3
+#define ADC_VSYS_PIN 29
+static void env_init_once(void)
+{
+    static bool inited = false;
+    if (inited)
+        return;
+    adc_init();
+    adc_gpio_init(ADC_VSYS_PIN);
+    adc_set_temp_sensor_enabled(true);
+    inited = true;
+}
+static inline float read_temp_C(void)
+{
+    env_init_once();
+    adc_select_input(ADC_TEMP_CH);
+    uint16_t raw = adc_read();
+    float v = raw * ADC_CONV;
+    return 27.0f - (v - 0.706f) / 0.001721f; // RP2040 formula
+}
+static inline float read_vsys_V(void)
+{
+    env_init_once();
+    adc_select_input(ADC_VSYS_CH);
+    uint16_t raw = adc_read();
+    return raw * ADC_CONV * ADC_VSYS_DIV;
+}
+
+static bool ask_yes_no(const char *q)
+{
+    printf("%s (y/n): ", q);
+    fflush(stdout);
+    for (;;)
+    {
+        int ch = getchar_timeout_us(1000 * 1000);
+        if (ch < 0 || ch == '\r' || ch == '\n')
+            continue;
+        if (ch == 'y' || ch == 'Y')
+        {
+            puts("y");
+            return true;
+        }
+        if (ch == 'n' || ch == 'N')
+        {
+            puts("n");
+            return false;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Real-flash ops for the engine
+// -----------------------------------------------------------------------------
+static int ops_erase(void *ctx, uint32_t addr)
+{
+    (void)ctx;
+    return flash_sector_erase(addr);
+}
+static int ops_program(void *ctx, uint32_t addr, const uint8_t *d, uint32_t n)
+{
+    (void)ctx;
+    return flash_page_program(addr, d, n);
+}
+static int ops_read(void *ctx, uint32_t addr, uint8_t *b, uint32_t n)
+{
+    (void)ctx;
+    return flash_read_data(addr, b, n);
+}
+static uint64_t ops_now(void *ctx)
+{
+    (void)ctx;
+    return time_us_64();
+}
+
+// -----------------------------------------------------------------------------
+// Sink: ENDURE.CSV rows, ENDURE.CHK checkpoints, key-press stop
+// -----------------------------------------------------------------------------
+static char g_jedec[24];
+static endurance_cfg_t g_cfg;
+static endurance_state_t g_state;
+static bool g_have = false;
+static uint32_t g_wear_cycle; // cycles already in WEAR.BIN
+
+// Per window rather than in ops_erase/ops_program so WEAR.BIN writes never
+// land inside a timed operation
+static void note_wear(const endurance_cfg_t *cfg, const endurance_state_t *st)
+{
+    if (st->cycle > g_wear_cycle)
+        wear_sched_note_cycles(cfg->base, cfg->sectors * FLASH_SECTOR_SIZE, st->cycle - g_wear_cycle);
+    g_wear_cycle = st->cycle;
+}
+
+static void sink_window(void *ctx, const endurance_cfg_t *cfg, const endurance_state_t *st)
+{
+    (void)ctx;
+    const endurance_window_t *w = &st->win;
+    note_wear(cfg, st);
+    char ts[32];
+    make_timestamp(ts, sizeof ts);
+
+    uint32_t hz = flash_spi_get_baud_hz();
+    char note[48];
+    snprintf(note, sizeof note, "endurance_%s@%uMHz",
+             pattern_name(cfg->pattern), (unsigned)((hz + 500000u) / 1000000u));
+
+    char row[384];
+    int len = snprintf(row, sizeof row,
+                       "%s,%lu,%lu,0x%06lX,%lu,"
+                       "%.1f,%.0f,%.0f,%.1f,"
+                       "%.1f,%.0f,%.0f,%.1f,"
+                       "%lu,%lu,%lu,%.2f,%.2f,%s,%s",
+                       g_jedec, (unsigned long)st->cycle,
+                       (unsigned long)(st->cycle - w->first_cycle + 1u),
+                       (unsigned long)cfg->base, (unsigned long)cfg->sectors,
+                       w->erase_us.mean, w->erase_us.min, w->erase_us.max, stream_stats_sd(&w->erase_us),
+                       w->program_us.mean, w->program_us.min, w->program_us.max, stream_stats_sd(&w->program_us),
+                       (unsigned long)w->verify_fail, (unsigned long)st->verify_fail_total,
+                       (unsigned long)st->first_fail_cycle,
+                       read_temp_C(), read_vsys_V(), ts, note);
+    if (len > 0 && len < (int)sizeof row)
+    {
+        if (!sd_append_csv_row(ENDURE_CSV, ENDURE_HEADER, row))
+            printf("❌ Failed to append %s; continuing\n", ENDURE_CSV);
+    }
+
+    printf("[endurance] cycle %lu/%lu  erase avg %.0f %s  program avg %.0f %s  verify fails %lu (total %lu)\n",
+           (unsigned long)st->cycle, (unsigned long)cfg->target_cycles,
+           w->erase_us.mean, UNIT_US, w->program_us.mean, UNIT_US,
+           (unsigned long)w->verify_fail, (unsigned long)st->verify_fail_total);
+}
+
+static bool sink_checkpoint(void *ctx, const endurance_cfg_t *cfg, const endurance_state_t *st)
+{
+    (void)ctx;
+    endure_chk_t c;
+    memset(&c, 0, sizeof c);
+    memcpy(c.magic, "ENDC", 4);
+    c.version = ENDURE_CHK_VERSION;
+    strncpy(c.jedec, g_jedec, sizeof c.jedec - 1);
+    c.cfg = *cfg;
+    c.st = *st;
+
+    FIL f;
+    UINT bw = 0;
+    FRESULT fr = f_open(&f, ENDURE_CHK, FA_CREATE_ALWAYS | FA_WRITE);
+    if (fr == FR_OK)
+    {
+        fr = f_write(&f, &c, sizeof c, &bw);
+        if (fr == FR_OK)
+            fr = f_sync(&f);
+        f_close(&f);
+    }
+    if (fr != FR_OK || bw != sizeof c)
+        printf("⚠️  Checkpoint write failed (error: %d); continuing\n", fr);
+
+    // Keep a copy for the summary even if SD hiccups
+    g_state = *st;
+    g_have = true;
+    return true;
+}
+
+static bool sink_should_stop(void *ctx)
+{
+    (void)ctx;
+    return getchar_timeout_us(0) >= 0;
+}
+
+static bool load_checkpoint(endure_chk_t *out)
+{
+    FIL f;
+    if (f_open(&f, ENDURE_CHK, FA_READ) != FR_OK)
+        return false;
+    UINT br = 0;
+    FRESULT fr = f_read(&f, out, sizeof *out, &br);
+    f_close(&f);
+    return fr == FR_OK && br == sizeof *out && !memcmp(out->magic, "ENDC", 4) &&
+           out->version == ENDURE_CHK_VERSION;
+}
+
+// -----------------------------------------------------------------------------
+// Public API
+// -----------------------------------------------------------------------------
+void bench_endurance_run(void)
+{
+    if (!sd_is_mounted())
+    {
+        printf("⛔ SD not mounted; cannot run endurance.\n");
+        return;
+    }
+    memset(g_jedec, 0, sizeof g_jedec);
+    flash_get_jedec_str(g_jedec, sizeof g_jedec);
+    if (!g_jedec[0] || strcmp(g_jedec, "No / Unknown_Flash") == 0)
+    {
+        printf("⛔ Flash not live (JEDEC unknown). Aborting endurance.\n");
+        return;
+    }
+
+    size_t cap = flash_capacity_bytes();
+    uint32_t span = ENDURANCE_SECTORS * FLASH_SECTOR_SIZE;
+    uint32_t base = ENDURANCE_BASE ? ENDURANCE_BASE : (uint32_t)(cap - span);
+    if (!cap || cap < span || (uint64_t)base + span > cap || (base % FLASH_SECTOR_SIZE))
+    {
+        printf("⛔ Endurance region 0x%06lX+%lu does not fit this chip.\n",
+               (unsigned long)base, (unsigned long)span);
+        return;
+    }
+
+    endurance_cfg_t cfg = {
+        .base = base,
+        .sectors = ENDURANCE_SECTORS,
+        .target_cycles = ENDURANCE_TARGET_CYCLES,
+        .window = ENDURANCE_WINDOW,
+        .checkpoint_every = ENDURANCE_CKPT_EVERY,
+        .pattern = ENDURANCE_PATTERN,
+        .seed = PATTERN_DEFAULT_SEED,
+    };
+    endurance_state_t st;
+    endurance_state_init(&st);
+
+    endure_chk_t chk;
+    if (load_checkpoint(&chk) && !strncmp(chk.jedec, g_jedec, sizeof chk.jedec) &&
+        chk.cfg.base == cfg.base && chk.cfg.sectors == cfg.sectors &&
+        chk.cfg.window == cfg.window && chk.cfg.pattern == cfg.pattern &&
+        chk.st.cycle < cfg.target_cycles)
+    {
+        printf("\nFound %s at cycle %lu (%lu verify fails so far).\n",
+               ENDURE_CHK, (unsigned long)chk.st.cycle, (unsigned long)chk.st.verify_fail_total);
+        if (ask_yes_no("Resume from checkpoint?"))
+            st = chk.st;
+    }
+
+    printf("\n=== SPI Flash ENDURANCE (erase -> program -> verify) ===\n");
+    printf("⚠️  Cycles sectors 0x%06lX..0x%06lX up to %lu times. Press any key to stop.\n",
+           (unsigned long)base, (unsigned long)(base + span - 1u), (unsigned long)cfg.target_cycles);
+    printf("Window rows -> %s every %lu cycles; checkpoint -> %s\n",
+           ENDURE_CSV, (unsigned long)cfg.window, ENDURE_CHK);
+    if (!ask_yes_no("Start endurance run?"))
+    {
+        puts("↩️  Cancelled.");
+        return;
+    }
+
+    flash_unprotect_all();
+    g_cfg = cfg;
+    g_state = st;
+    g_have = true;
+    wear_sched_begin();
+    g_wear_cycle = st.cycle;
+
+    const endurance_ops_t ops = {ops_erase, ops_program, ops_read, ops_now, NULL};
+    const endurance_sink_t sink = {sink_window, sink_checkpoint, sink_should_stop, NULL};
+
+    endurance_result_t r = endurance_run(&cfg, &st, &ops, &sink);
+    g_state = st;
+    note_wear(&cfg, &st); // cycles after the last window row
+    wear_sched_end();
+
+    switch (r)
+    {
+    case ENDURANCE_DONE:
+        printf("✅ Endurance target reached (%lu cycles).\n", (unsigned long)st.cycle);
+        break;
+    case ENDURANCE_STOPPED:
+        printf("↩️  Stopped at cycle %lu; resume continues from the last checkpoint.\n",
+               (unsigned long)st.cycle);
+        break;
+    case ENDURANCE_IO_ERROR:
+        printf("❌ Flash operation failed at cycle %lu.\n", (unsigned long)(st.cycle + 1u));
+        break;
+    default:
+        printf("❌ Endurance configuration rejected.\n");
+        break;
+    }
+}
+
+void bench_endurance_print_summary(void)
+{
+    if (!g_have)
+    {
+        printf("\n(no endurance data — run 'endurance' first)\n");
+        return;
+    }
+    const endurance_state_t *st = &g_state;
+    printf("\n=== ENDURANCE summary (%s, %lu sectors @0x%06lX) ===\n",
+           g_jedec, (unsigned long)g_cfg.sectors, (unsigned long)g_cfg.base);
+    printf("Cycles completed            = %lu\n", (unsigned long)st->cycle);
+    printf("Erase   avg / min / max     = %.1f / %.0f / %.0f %s (sd %.1f)\n",
+           st->erase_all.mean, st->erase_all.min, st->erase_all.max, UNIT_US,
+           stream_stats_sd(&st->erase_all));
+    printf("Program avg / min / max     = %.1f / %.0f / %.0f %s (sd %.1f)\n",
+           st->program_all.mean, st->program_all.min, st->program_all.max, UNIT_US,
+           stream_stats_sd(&st->program_all));
+    printf("Verify failures             = %lu", (unsigned long)st->verify_fail_total);
+    if (st->first_fail_cycle)
+        printf(" (first at cycle %lu)", (unsigned long)st->first_fail_cycle);
+    printf("\n--- end of summary ---\n");
+}
+
+bool bench_endurance_has_data(void)
+{
+    return g_have;
+}
@@ -0,0 +1,11 @@
+// bench_endurance.h
+#pragma once
+#include <stdbool.h>
+
+// Long-running erase/program/verify cycling on a few sectors (top of chip by
+// default). Writes one decimated row per window to ENDURE.CSV and checkpoints
+// to ENDURE.CHK; a matching checkpoint is offered for resume. Any key stops
+// the run (progress since the last checkpoint is redone on resume).
+void bench_endurance_run(void);
+void bench_endurance_print_summary(void);
+bool bench_endurance_has_data(void);
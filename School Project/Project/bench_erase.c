@@ -11,8 +11,11 @@
 #include <stdbool.h>
 #include <math.h>
 
-#include "flash_benchmark.h" // flash_* APIs, sizes, generate_test_pattern()
+#include "flash_benchmark.h" // flash_* APIs, sizes
+#include "pattern.h"         // pattern_fill / pattern_verify
 #include "sd_card.h"         // RESULTS.CSV I/O
+#include "bench_adaptive.h"  // iteration count / CI stopping
+#include "wear_sched.h"      // least-worn region picking + WEAR.BIN
 
 /* ========================== Units (ASCII fallback) ========================== */
 #ifdef ASCII_UNITS
@@ -53,40 +56,20 @@ static inline uint32_t compute_physical_erase_bytes(uint32_t addr, uint32_t size
 }
 
 /* Verify that the span matches the pattern we *expect* after prefill.
+   Offsets are relative to base_addr, matching prefill_span(); "random" is
+   seeded and reproducible, so it is checked like any other pattern.
    Returns 1 on match, 0 on mismatch. */
 static int verify_span_pattern(uint32_t base_addr, uint32_t size, const char *pattern)
 {
 #if VERIFY_PREFILL_STRICT
-    /* Read-back in chunks to avoid big allocs */
-    uint8_t expect[256];
+    const pattern_id_t pat = pattern_from_name(pattern);
     uint8_t buf[256];
-    for (uint32_t i = 0; i < sizeof expect; ++i) expect[i] = 0xFF;
-
-    /* Prepare the expected pattern for the first chunk */
-    if (strcmp(pattern, "0xFF") == 0)      memset(expect, 0xFF, sizeof expect);
-    else if (strcmp(pattern, "0x00") == 0) memset(expect, 0x00, sizeof expect);
-    else if (strcmp(pattern, "0x55") == 0) memset(expect, 0x55, sizeof expect);
-    else if (strcmp(pattern, "incremental") == 0) {
-        for (uint32_t i = 0; i < sizeof expect; ++i) expect[i] = (uint8_t)i;
-    } else if (strcmp(pattern, "random") == 0) {
-        /* Can't deterministically verify random; just skip strict check. */
-        return 1;
-    } else {
-        memset(expect, 0xFF, sizeof expect);
-    }
-
-    uint32_t remaining = size, addr = base_addr;
-    while (remaining) {
-        uint32_t n = remaining > sizeof buf ? (uint32_t)sizeof buf : remaining;
-        if (!flash_read_data(addr, buf, n)) return 0;
-
-        /* For incremental, recompute expected window */
-        if (strcmp(pattern, "incremental") == 0) {
-            for (uint32_t i = 0; i < n; ++i) expect[i] = (uint8_t)((addr - base_addr) + i);
-        }
-
-        if (memcmp(buf, expect, n) != 0) return 0;
-        addr += n; remaining -= n;
+    uint32_t done = 0;
+    while (done < size) {
+        uint32_t n = (size - done) > sizeof buf ? (uint32_t)sizeof buf : (size - done);
+        if (!flash_read_data(base_addr + done, buf, n)) return 0;
+        if (!pattern_verify(pat, PATTERN_DEFAULT_SEED, done, buf, n, NULL)) return 0;
+        done += n;
     }
 #endif
     return 1;
@@ -94,7 +77,8 @@ static int verify_span_pattern(uint32_t base_addr, uint32_t size, const char *pa
 
 
 /* Optional: distribute wear by rotating start address within a ring (bytes).
-   0 = disabled (always erase the same span starting 0x000000). */
+   0 = disabled (always erase the same span starting 0x000000).
+   Only used when the runtime wear scheduler (wear_sched.c) is unavailable. */
 #ifndef ERASE_DISTRIBUTE_RING_BYTES
 #define ERASE_DISTRIBUTE_RING_BYTES (0) /* e.g., 256*1024 to spread over 256KiB */
 #endif
@@ -337,24 +321,39 @@ static bool ask_yes_no(const char *q)
     }
 }
 
+/* True if every byte in the span reads 0xFF (untimed; used before prefill
+   when the scheduler moved us onto a region we have not cleaned yet). */
+static bool span_is_blank(uint32_t base_addr, uint32_t size)
+{
+    uint8_t buf[256];
+    uint32_t done = 0;
+    while (done < size) {
+        uint32_t n = (size - done) > sizeof buf ? (uint32_t)sizeof buf : (size - done);
+        if (!flash_read_data(base_addr + done, buf, n)) return false;
+        for (uint32_t k = 0; k < n; ++k)
+            if (buf[k] != 0xFF) return false;
+        done += n;
+    }
+    return true;
+}
+
 /* ===================== Prefill (program) the span (untimed) ================ */
 static void prefill_span(uint32_t base_addr, uint32_t size, const char *pattern)
 {
-    uint32_t remaining = size;
-    uint32_t addr = base_addr;
+    const pattern_id_t pat = pattern_from_name(pattern);
+    uint32_t done = 0;
     uint8_t buf[FLASH_PAGE_SIZE];
 
-    while (remaining)
+    while (done < size)
     {
-        uint32_t page_off = (addr & (FLASH_PAGE_SIZE - 1));
-        uint32_t room = FLASH_PAGE_SIZE - page_off;
-        uint32_t this_len = (remaining < room) ? remaining : room;
+        uint32_t addr = base_addr + done;
+        uint32_t room = FLASH_PAGE_SIZE - (addr & (FLASH_PAGE_SIZE - 1));
+        uint32_t this_len = (size - done < room) ? (size - done) : room;
 
-        generate_test_pattern(buf, this_len, pattern);
+        pattern_fill(pat, PATTERN_DEFAULT_SEED, done, buf, this_len);
         flash_page_program(addr, buf, this_len);
 
-        addr += this_len;
-        remaining -= this_len;
+        done += this_len;
     }
 }
 
@@ -393,14 +392,22 @@ static void run_size_log_series_erase(const char *label,
     /* Pattern we write BEFORE each erase so the erase has real work to do */
     const char *prefill_pattern = "0x55"; // toggle-y, easy to see in dumps
 
-    for (int i = 0; i < N_ITERS; ++i) {
+    const bool scheduled = wear_sched_active() && !(label && !strcmp(label, "whole-chip"));
+    uint32_t prev_base = UINT32_MAX;
+
+    bench_adapt_t ad;
+    bench_adapt_begin(&ad, "erase", label, size_bytes, N_ITERS);
+    for (int i = 0; bench_adapt_next(&ad, S->samples, S->n); ++i) {
         flash_unprotect_all();
         float tempC = read_temp_C();
         float vV    = read_vsys_V();
 
         uint32_t iter_base = base_addr;
+        if (scheduled) {
+            iter_base = wear_sched_pick(size_bytes, base_addr);
+        }
 #if ERASE_DISTRIBUTE_RING_BYTES
-        {
+        else {
             const uint32_t ring = (ERASE_DISTRIBUTE_RING_BYTES / FLASH_SECTOR_SIZE) * FLASH_SECTOR_SIZE;
             if (ring && ring >= FLASH_SECTOR_SIZE) {
                 uint32_t hop = (i % (ring / FLASH_SECTOR_SIZE)) * FLASH_SECTOR_SIZE;
@@ -411,15 +418,25 @@ static void run_size_log_series_erase(const char *label,
         }
 #endif
 
-        printf("[erase] %s iter %d/%d at 0x%06X, logical=%u bytes\n",
-               label ? label : "?", i + 1, N_ITERS, iter_base, size_bytes);
+        /* Sector wear *before* this iteration touches it (logged as _w<n>) */
+        const uint32_t wear_before = wear_sched_region_erases(iter_base, size_bytes);
 
-        /* Optional clean-erase only on the first iteration to reduce wear */
+        printf("[erase] %s iter %d/%d at 0x%06X, logical=%u bytes, wear=%lu\n",
+               label ? label : "?", i + 1, N_ITERS, iter_base, size_bytes,
+               (unsigned long)wear_before);
+
+        /* Optional clean-erase only on the first iteration to reduce wear.
+           A region we moved onto is cleaned only if it is not already blank. */
 #if CLEAN_BEFORE_FIRST_ONLY
-        if (i == 0) (void)flash_erase_span(iter_base, size_bytes);
+        bool need_clean = (i == 0) || (iter_base != prev_base && !span_is_blank(iter_base, size_bytes));
 #else
-        (void)flash_erase_span(iter_base, size_bytes);
+        bool need_clean = true;
 #endif
+        if (need_clean) {
+            (void)flash_erase_span(iter_base, size_bytes);
+            wear_sched_note_erase(iter_base, compute_physical_erase_bytes(iter_base, size_bytes));
+        }
+        prev_base = iter_base;
 
         /* 1) Program prefill (either timed row, or untimed helper) */
         uint64_t us_prog = 0;
@@ -431,6 +448,7 @@ static void run_size_log_series_erase(const char *label,
 #else
         prefill_span(iter_base, size_bytes, prefill_pattern);
 #endif
+        wear_sched_note_program(iter_base, size_bytes);
 
         /* Optional read-back verify of the prefill */
 #if VERIFY_PREFILL_STRICT
@@ -454,6 +472,7 @@ if (len_bad > 0 && len_bad < (int)sizeof row_bad)
 
             /* Try to recover the region so the next iteration can proceed */
             (void)flash_erase_span(iter_base, size_bytes);
+            wear_sched_note_erase(iter_base, compute_physical_erase_bytes(iter_base, size_bytes));
             sleep_ms(10);
             continue;
         }
@@ -480,6 +499,7 @@ if (len_bad > 0 && len_bad < (int)sizeof row_bad)
         /* 2) Timed ERASE of the same region (throughput uses *physical* bytes) */
         uint32_t phys_bytes = compute_physical_erase_bytes(iter_base, size_bytes);
         uint64_t us = benchmark_flash_erase(iter_base, size_bytes);
+        wear_sched_note_erase(iter_base, phys_bytes);
         if (!us) {
             printf("⚠️  Erase returned 0 µs; size=%u bytes, addr=0x%06X (protection? unsupported opcode?)\n",
                    size_bytes, iter_base);
@@ -488,7 +508,10 @@ if (len_bad > 0 && len_bad < (int)sizeof row_bad)
         if (!us) th_erase = 0.0;
 
         char ts[32]; make_timestamp(ts, sizeof ts);
-        const char *note = notes_for_erase(label, size_bytes, /*prefilled=*/true);
+        char note[112];
+        snprintf(note, sizeof note, "%s_w%lu%s",
+                 notes_for_erase(label, size_bytes, /*prefilled=*/true),
+                 (unsigned long)wear_before, flash_dev_note_suffix());
 
         char row[256];
         int len = snprintf(row, sizeof row,
@@ -506,6 +529,7 @@ if (len_bad > 0 && len_bad < (int)sizeof row_bad)
         if (S->n < N_ITERS) S->samples[S->n++] = us;
         sleep_ms(10);
     }
+    bench_adapt_end(&ad, jedec, S->samples, S->n);
 }
 
 
@@ -539,17 +563,20 @@ void bench_erase_run_100(bool confirm_whole_chip)
 
     g_series_count = 0;
 
-    printf("\n=== SPI Flash ERASE benchmark (100 iterations per size) ===\n");
+    printf("\n=== SPI Flash ERASE benchmark (%s per size) ===\n", bench_adapt_plan(N_ITERS));
     printf("Flow per iteration: program test pattern (untimed) ➜ time ERASE only.\n");
     print_flash_sck_banner("");
     printf("Logging to %s (latency in microseconds; throughput = bytes erased per second)\n", CSV_FILENAME);
+    if (wear_sched_begin())
+        printf("Target regions rotate to the least-worn sectors (%s, gap bound %u)\n",
+               WEAR_FILENAME, (unsigned)WEAR_GAP_MAX);
 
     for (size_t i = 0; i < sizeof k_sizes / sizeof k_sizes[0]; ++i)
     {
         if (g_series_count >= MAX_SERIES)
             break;
-        printf("\n--- Running %s, %u bytes, %d iterations ---\n",
-               k_sizes[i].label, k_sizes[i].size, N_ITERS);
+        printf("\n--- Running %s, %u bytes, %s ---\n",
+               k_sizes[i].label, k_sizes[i].size, bench_adapt_plan(N_ITERS));
         if (!ask_yes_no("Proceed with prefill + ERASE for this size?"))
         {
             puts("↩️  Skipped by user.");
@@ -574,8 +601,8 @@ void bench_erase_run_100(bool confirm_whole_chip)
             size_t total_bytes = flash_capacity_bytes();
             if (total_bytes > 0 && g_series_count < MAX_SERIES)
             {
-                printf("\n--- Running whole-chip, %lu bytes, %d iterations ---\n",
-                       (unsigned long)total_bytes, N_ITERS);
+                printf("\n--- Running whole-chip, %lu bytes, %s ---\n",
+                       (unsigned long)total_bytes, bench_adapt_plan(N_ITERS));
                 run_size_log_series_erase("whole-chip", (uint32_t)total_bytes, 0x000000,
                                           &g_series[g_series_count], &run_no);
                 g_series_count++;
@@ -590,6 +617,9 @@ void bench_erase_run_100(bool confirm_whole_chip)
             printf("↩️  Whole-chip run skipped by user.\n");
         }
     }
+
+    wear_sched_end();
+    wear_sched_print_summary();
 }
 
 /* ============================ Public: summary ============================== */
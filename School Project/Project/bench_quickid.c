@@ -0,0 +1,475 @@
+// bench_quickid.c — see bench_quickid.h
+//
+// Each probe is timed QUICKID_REPEATS times in the scratch block and the
+// median is compared with the datasheet's typical value. A row scores the sum
+// of its relative errors (capped, as in report.c) and a JEDEC match divides
+// the score by 4. Weights exp(-score / tau) over all rows give the confidence.
+// An "unlisted chip" candidate scoring QUICKID_MAX_FIT per probe (with the
+// JEDEC bonus when no row has the live JEDEC) keeps a chip that is not in the
+// database from being reported as a confident match on its nearest row.
+// The database is streamed once per round, so RAM does not grow with it.
+#include "bench_quickid.h"
+
+#include "pico/stdlib.h"
+#include "pico/time.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flash_benchmark.h" // flash_* APIs, chip profile
+#include "chip_db.h"         // datasheet.cdb
+#include "erase_plan.h"      // untimed prep erase + measured costs
+#include "pattern.h"
+#include "sd_card.h"         // QUICKID.CSV
+#include "wear_sched.h"      // scratch-block wear into WEAR.BIN
+#include "stream_stats.h"
+
+#define QUICKID_DB "datasheet.csv"
+#define QUICKID_HEADER "jedec_id,guess_jedec,guess_model,guess_company,confidence,decisive,probes,probe_ms,elapsed_ms,device,fit,jedec_match"
+#define QUICKID_MIN_GAIN 0.01f // below this no remaining probe separates the top rows
+#define SCRATCH_BYTES (64u * 1024u)
+
+typedef enum
+{
+    QP_PAGE = 0, // page program, ms per page over one sector
+    QP_4K,
+    QP_32K,
+    QP_64K,
+    QP_COUNT
+} qprobe_t;
+
+static const struct
+{
+    const char *name;
+    uint32_t span;      // bytes prefilled and erased (page: programmed)
+    uint8_t erase_bit;  // FLASH_ERASE_* needed, 0 = none
+    erase_op_t cost_op; // erase_plan entry refined by the measurement
+} k_probe[QP_COUNT] = {
+    {"page", FLASH_SECTOR_SIZE, 0, ERASE_OP_COUNT},
+    {"4k", FLASH_SECTOR_SIZE, FLASH_ERASE_4K, ERASE_OP_4K},
+    {"32k", 32u * 1024u, FLASH_ERASE_32K, ERASE_OP_32K},
+    {"64k", 64u * 1024u, FLASH_ERASE_64K, ERASE_OP_64K},
+};
+
+typedef struct
+{
+    float score;
+    uint32_t idx;
+} qcand_t;
+
+typedef struct
+{
+    qcand_t top[QUICKID_TOP_K]; // best first
+    int n;
+    double weight_sum;          // sum of exp(-(score - top[0].score) / tau)
+    uint32_t rows;
+} qround_t;
+
+/* ------------------------------ scoring --------------------------------- */
+static float row_pred(const chipdb_row_t *r, qprobe_t p)
+{
+    switch (p)
+    {
+    case QP_PAGE: return r->typ_page_ms;
+    case QP_4K: return r->typ_4k_ms;
+    case QP_32K: return r->typ_32k_ms;
+    case QP_64K: return r->typ_64k_ms;
+    default: return -1.0f;
+    }
+}
+
+// Same capped relative error as report.c; a missing value costs the cap
+static float norm_diff(float meas, float ref)
+{
+    if (!(meas > 0) || !(ref > 0))
+        return 3.0f;
+    float d = fabsf(meas - ref) / ref;
+    return (d > 3.0f) ? 3.0f : d;
+}
+
+static float row_score(const chipdb_row_t *r, const float meas[QP_COUNT], const char *jedec6)
+{
+    float s = 0.0f;
+    for (int p = 0; p < QP_COUNT; ++p)
+        if (meas[p] == meas[p])
+            s += norm_diff(meas[p], row_pred(r, (qprobe_t)p));
+    if (jedec6[0] && !strcmp(jedec6, r->jedec))
+        s *= 0.25f;
+    return s;
+}
+
+static void round_push(qround_t *R, float score, uint32_t idx)
+{
+    // Running weight sum relative to the best score so far
+    if (R->n == 0)
+        R->weight_sum = 1.0;
+    else if (score < R->top[0].score)
+        R->weight_sum = R->weight_sum * exp((score - R->top[0].score) / QUICKID_TAU) + 1.0;
+    else
+        R->weight_sum += exp(-(score - R->top[0].score) / QUICKID_TAU);
+
+    // Sorted insert; equal scores keep the earlier row first
+    int i = (R->n < QUICKID_TOP_K) ? R->n++ : QUICKID_TOP_K;
+    for (; i > 0 && score < R->top[i - 1].score; --i)
+        if (i < QUICKID_TOP_K)
+            R->top[i] = R->top[i - 1];
+    if (i < QUICKID_TOP_K)
+        R->top[i] = (qcand_t){score, idx};
+}
+
+static void score_rows(chipdb_t *db, const float meas[QP_COUNT], const char *jedec6, qround_t *R)
+{
+    memset(R, 0, sizeof *R);
+    chipdb_row_t r;
+    uint32_t n = chipdb_count(db);
+    for (uint32_t i = 0; i < n && chipdb_read_row(db, i, &r); ++i)
+    {
+        round_push(R, row_score(&r, meas, jedec6), i);
+        R->rows++;
+    }
+}
+
+// Median relative error over the probes run, JEDEC bonus left out. The
+// median, so that the page probe (mostly bus time on fast chips) alone does
+// not fail a row whose erases match.
+static float row_fit(const chipdb_row_t *r, const float meas[QP_COUNT])
+{
+    float d[QP_COUNT];
+    int n = 0;
+    for (int p = 0; p < QP_COUNT; ++p)
+        if (meas[p] == meas[p])
+        {
+            float v = norm_diff(meas[p], row_pred(r, (qprobe_t)p));
+            int i = n++;
+            for (; i > 0 && d[i - 1] > v; --i)
+                d[i] = d[i - 1];
+            d[i] = v;
+        }
+    if (!n)
+        return NAN;
+    return (n & 1) ? d[n / 2] : 0.5f * (d[n / 2 - 1] + d[n / 2]);
+}
+
+// Best row's share of the weight, the unlisted candidate (score `none`) included
+static float round_confidence(const qround_t *R, float none)
+{
+    if (!R->n || !(R->weight_sum > 0.0))
+        return 0.0f;
+    return (float)(1.0 / (R->weight_sum + exp(-(none - R->top[0].score) / QUICKID_TAU)));
+}
+
+/* --------------------------- probe selection ---------------------------- */
+// Expected cost of a probe in ms: prefill + timed op, per repetition
+static float probe_cost_ms(qprobe_t p, float op_ms, float page_ms)
+{
+    float pages = (float)(k_probe[p].span / FLASH_PAGE_SIZE);
+    if (!(page_ms > 0))
+        page_ms = 1.0f;
+    if (!(op_ms > 0))
+        op_ms = (p == QP_PAGE) ? page_ms : 100.0f;
+    float ms = (p == QP_PAGE) ? pages * page_ms : pages * page_ms + op_ms;
+    return ms * QUICKID_REPEATS;
+}
+
+static bool probe_usable(qprobe_t p, const bool done[QP_COUNT], uint8_t erase_mask, size_t cap)
+{
+    return !done[p] && (!k_probe[p].erase_bit || (erase_mask & k_probe[p].erase_bit)) &&
+           cap >= SCRATCH_BYTES;
+}
+
+// First round, nothing measured yet: spread of log(typical) over the whole
+// database, times the share of rows that have a value.
+static qprobe_t pick_first(chipdb_t *db, const bool done[QP_COUNT], uint8_t mask, size_t cap)
+{
+    stream_stats_t S[QP_COUNT];
+    for (int p = 0; p < QP_COUNT; ++p)
+        stream_stats_init(&S[p]);
+
+    chipdb_row_t r;
+    uint32_t n = chipdb_count(db);
+    for (uint32_t i = 0; i < n && chipdb_read_row(db, i, &r); ++i)
+        for (int p = 0; p < QP_COUNT; ++p)
+            if (row_pred(&r, (qprobe_t)p) > 0)
+                stream_stats_push(&S[p], log(row_pred(&r, (qprobe_t)p)));
+
+    float page_ms = (S[QP_PAGE].n) ? (float)exp(S[QP_PAGE].mean) : 0.0f;
+    qprobe_t best = QP_COUNT;
+    float best_v = 0.0f;
+    for (int p = 0; p < QP_COUNT; ++p)
+    {
+        if (!probe_usable((qprobe_t)p, done, mask, cap) || S[p].n < 2)
+            continue;
+        float gain = (float)stream_stats_sd(&S[p]) * (float)S[p].n / (float)n;
+        float v = gain / probe_cost_ms((qprobe_t)p, (float)exp(S[p].mean), page_ms);
+        if (gain >= QUICKID_MIN_GAIN && v > best_v)
+        {
+            best_v = v;
+            best = (qprobe_t)p;
+        }
+    }
+    return best;
+}
+
+// Later rounds: how far each runner-up's typical is from the leader's,
+// weighted by the runner-up's current weight, per expected millisecond.
+static qprobe_t pick_next(chipdb_t *db, const qround_t *R, const bool done[QP_COUNT],
+                          uint8_t mask, size_t cap)
+{
+    chipdb_row_t lead, other;
+    if (R->n < 2 || !chipdb_read_row(db, R->top[0].idx, &lead))
+        return QP_COUNT;
+
+    float gain[QP_COUNT] = {0};
+    for (int k = 1; k < R->n; ++k)
+    {
+        if (!chipdb_read_row(db, R->top[k].idx, &other))
+            continue;
+        float w = expf(-(R->top[k].score - R->top[0].score) / QUICKID_TAU);
+        for (int p = 0; p < QP_COUNT; ++p)
+        {
+            float a = row_pred(&lead, (qprobe_t)p), b = row_pred(&other, (qprobe_t)p);
+            if (a > 0 || b > 0)
+                gain[p] += w * norm_diff(b, a);
+        }
+    }
+
+    qprobe_t best = QP_COUNT;
+    float best_v = 0.0f;
+    for (int p = 0; p < QP_COUNT; ++p)
+    {
+        if (!probe_usable((qprobe_t)p, done, mask, cap) || gain[p] < QUICKID_MIN_GAIN)
+            continue;
+        float v = gain[p] / probe_cost_ms((qprobe_t)p, row_pred(&lead, (qprobe_t)p), lead.typ_page_ms);
+        if (v > best_v)
+        {
+            best_v = v;
+            best = (qprobe_t)p;
+        }
+    }
+    return best;
+}
+
+/* ------------------------------ measuring ------------------------------- */
+static uint8_t s_page[FLASH_PAGE_SIZE];
+
+static bool prefill(uint32_t base, uint32_t span)
+{
+    for (uint32_t off = 0; off < span; off += FLASH_PAGE_SIZE)
+    {
+        pattern_fill(PAT_55, PATTERN_DEFAULT_SEED, off, s_page, FLASH_PAGE_SIZE);
+        if (!flash_page_program(base + off, s_page, FLASH_PAGE_SIZE))
+            return false;
+    }
+    wear_sched_note_program(base, span);
+    return true;
+}
+
+static int timed_erase(qprobe_t p, uint32_t addr)
+{
+    switch (p)
+    {
+    case QP_4K: return flash_sector_erase(addr);
+    case QP_32K: return flash_block32_erase(addr);
+    case QP_64K: return flash_block64_erase(addr);
+    default: return 0;
+    }
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    const uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x < y) ? -1 : (x > y);
+}
+
+// Median over QUICKID_REPEATS in ms (page: per page); NAN if an op failed
+static float measure_probe(qprobe_t p, uint32_t base)
+{
+    const uint32_t span = k_probe[p].span;
+    uint64_t us[QUICKID_REPEATS];
+
+    flash_unprotect_all();
+    erase_plan_t plan;
+    if (!erase_plan_execute(base, span, ERASE_PLAN_SKIP_BLANK | ERASE_PLAN_QUIET, &plan))
+        return NAN;
+    if (plan.end - plan.start > plan.skipped_blank * FLASH_SECTOR_SIZE)
+        wear_sched_note_erase(base, span);
+
+    for (int i = 0; i < QUICKID_REPEATS; ++i)
+    {
+        if (p == QP_PAGE)
+        {
+            if (i > 0)
+            {
+                if (!flash_sector_erase(base))
+                    return NAN;
+                wear_sched_note_erase(base, FLASH_SECTOR_SIZE);
+            }
+            us[i] = 0;
+            for (uint32_t off = 0; off < span; off += FLASH_PAGE_SIZE)
+            {
+                pattern_fill(PAT_55, PATTERN_DEFAULT_SEED, off, s_page, FLASH_PAGE_SIZE);
+                uint64_t t0 = time_us_64();
+                int ok = flash_page_program(base + off, s_page, FLASH_PAGE_SIZE);
+                us[i] += time_us_64() - t0;
+                if (!ok)
+                    return NAN;
+            }
+            wear_sched_note_program(base, span);
+            us[i] /= span / FLASH_PAGE_SIZE;
+        }
+        else
+        {
+            // Erase real data, as the erase bench does
+            if (!prefill(base, span))
+                return NAN;
+            uint64_t t0 = time_us_64();
+            int ok = timed_erase(p, base);
+            us[i] = time_us_64() - t0;
+            if (!ok)
+                return NAN;
+            wear_sched_note_erase(base, span);
+            erase_plan_note_measured(k_probe[p].cost_op, us[i]);
+        }
+    }
+    qsort(us, QUICKID_REPEATS, sizeof us[0], cmp_u64);
+    return (float)us[QUICKID_REPEATS / 2] / 1000.0f;
+}
+
+/* ---------------------------------- run ---------------------------------- */
+bool bench_quickid_run(quickid_result_t *out)
+{
+    quickid_result_t res;
+    memset(&res, 0, sizeof res);
+    if (out)
+        *out = res;
+
+    if (!sd_is_mounted())
+    {
+        printf("⛔ SD not mounted; cannot run quick-ID.\n");
+        return false;
+    }
+    char jedec[24] = {0};
+    flash_get_jedec_str(jedec, sizeof jedec);
+    if (!jedec[0] || strcmp(jedec, "No / Unknown_Flash") == 0)
+    {
+        printf("⛔ Flash not live (JEDEC unknown). Aborting quick-ID.\n");
+        return false;
+    }
+    char jedec6[8];
+    chipdb_normalize_jedec(jedec, jedec6);
+
+    const flash_profile_t *fp = flash_profile();
+    size_t cap = flash_capacity_bytes();
+    uint32_t base = QUICKID_BASE;
+    if (!base)
+        base = (cap >= 2 * SCRATCH_BYTES) ? (uint32_t)(cap - 2 * SCRATCH_BYTES)
+                                          : (uint32_t)(cap - SCRATCH_BYTES);
+    if (cap < SCRATCH_BYTES || (base % SCRATCH_BYTES) || (uint64_t)base + SCRATCH_BYTES > cap)
+    {
+        printf("⛔ Quick-ID scratch block 0x%06lX does not fit this chip.\n", (unsigned long)base);
+        return false;
+    }
+
+    wear_sched_begin();
+    chipdb_t db;
+    if (!chipdb_open(&db, QUICKID_DB) || chipdb_count(&db) == 0)
+    {
+        printf("⛔ %s unavailable; quick-ID needs the chip database.\n", QUICKID_DB);
+        return false;
+    }
+
+    printf("\n=== Quick-ID (%lu datasheet rows, scratch 0x%06lX, target %.0f%%) ===\n",
+           (unsigned long)chipdb_count(&db), (unsigned long)base, QUICKID_CONFIDENCE * 100.0f);
+    // An unlisted chip explains the live JEDEC better than any row when none has it
+    const bool jedec_listed = jedec6[0] && chipdb_find(&db, jedec6, NULL, NULL);
+
+    float meas[QP_COUNT];
+    bool done[QP_COUNT] = {false};
+    for (int p = 0; p < QP_COUNT; ++p)
+        meas[p] = NAN;
+
+    qround_t R;
+    memset(&R, 0, sizeof R);
+    const uint64_t t0 = time_us_64();
+    qprobe_t next = pick_first(&db, done, fp->erase_mask, cap);
+    while (next != QP_COUNT)
+    {
+        done[next] = true;
+        meas[next] = measure_probe(next, base);
+        if (meas[next] != meas[next])
+            printf("⚠️  %s probe failed; skipping it\n", k_probe[next].name);
+        else
+        {
+            res.probes++;
+            printf("🔬 %s: %.3f ms (median of %d)\n", k_probe[next].name, meas[next], QUICKID_REPEATS);
+        }
+
+        score_rows(&db, meas, jedec6, &R);
+        float none = QUICKID_MAX_FIT * (float)res.probes * (jedec_listed ? 1.0f : 0.25f);
+        res.confidence = round_confidence(&R, none);
+        if (res.probes && res.confidence >= QUICKID_CONFIDENCE)
+            break;
+        next = pick_next(&db, &R, done, fp->erase_mask, cap);
+    }
+    res.elapsed_ms = (uint32_t)((time_us_64() - t0) / 1000u);
+
+    chipdb_row_t best;
+    if (R.n && chipdb_read_row(&db, R.top[0].idx, &best))
+    {
+        snprintf(res.model, sizeof res.model, "%s", best.model);
+        snprintf(res.company, sizeof res.company, "%s", best.company);
+        snprintf(res.jedec, sizeof res.jedec, "%s", best.jedec);
+        res.jedec_match = jedec6[0] && !strcmp(jedec6, best.jedec);
+        res.fit = row_fit(&best, meas);
+        res.decisive = res.probes && res.confidence >= QUICKID_CONFIDENCE &&
+                       res.fit <= QUICKID_MAX_FIT && res.jedec_match;
+    }
+
+    printf("%s Quick-ID: %s %s (%s), confidence %.0f%%, %d probe%s in %.2f s\n",
+           res.decisive ? "🆔" : "⚠️ ", res.company[0] ? res.company : "?",
+           res.model[0] ? res.model : "?", res.jedec[0] ? res.jedec : "?",
+           res.confidence * 100.0f, res.probes, (res.probes == 1) ? "" : "s",
+           res.elapsed_ms / 1000.0);
+    for (int k = 1; k < R.n; ++k)
+    {
+        chipdb_row_t r;
+        if (chipdb_read_row(&db, R.top[k].idx, &r))
+            printf("   runner-up: %s %s (%s), score %.3f vs %.3f\n",
+                   r.company, r.model, r.jedec, R.top[k].score, R.top[0].score);
+    }
+    if (R.n && !res.jedec_match)
+        printf("   Live JEDEC %s is not this row's%s.\n", jedec6,
+               jedec_listed ? "" : " and not in the database");
+    if (res.fit > QUICKID_MAX_FIT)
+        printf("   Its timings are %.0f%% off the datasheet (median; limit %.0f%%).\n",
+               res.fit * 100.0f, QUICKID_MAX_FIT * 100.0f);
+    if (!res.decisive)
+        printf("   Not decisive; run the full suites and the report for a firm guess.\n");
+    chipdb_close(&db);
+
+    // probe_ms: "4k=45.358;page=0.992"
+    char probes[96] = "";
+    for (int p = 0, len = 0; p < QP_COUNT; ++p)
+        if (meas[p] == meas[p] && len >= 0 && len < (int)sizeof probes)
+            len += snprintf(probes + len, sizeof probes - len, "%s%s=%.3f",
+                            len ? ";" : "", k_probe[p].name, meas[p]);
+
+    char row[320];
+    char fit[16] = "NA";
+    if (res.fit == res.fit && res.probes)
+        snprintf(fit, sizeof fit, "%.3f", res.fit);
+    int len = snprintf(row, sizeof row, "%s,%s,\"%s\",\"%s\",%.3f,%d,%d,%s,%lu,%d,%s,%d",
+                       jedec, res.jedec[0] ? res.jedec : "NA", res.model, res.company,
+                       res.confidence, res.decisive ? 1 : 0, res.probes,
+                       probes[0] ? probes : "NA", (unsigned long)res.elapsed_ms,
+                       flash_dev_current(), fit, res.jedec_match ? 1 : 0);
+    if (len > 0 && len < (int)sizeof row && !sd_append_csv_row(QUICKID_FILENAME, QUICKID_HEADER, row))
+        printf("❌ Failed to append %s; continuing\n", QUICKID_FILENAME);
+    wear_sched_end();
+
+    if (out)
+        *out = res;
+    return res.probes > 0;
+}
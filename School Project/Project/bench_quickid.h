@@ -0,0 +1,63 @@
+// bench_quickid.h — identify a chip from a few timed operations
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// One row per quick-ID run: guess, confidence, probes and their results
+#define QUICKID_FILENAME "QUICKID.CSV"
+
+// Stop once the best datasheet row holds this share of the candidate weight
+#ifndef QUICKID_CONFIDENCE
+#define QUICKID_CONFIDENCE 0.90f
+#endif
+// Worst relative error (datasheet typ vs. measured, median over the probes,
+// no JEDEC bonus) a decisive guess may have. Per probe, it is also the score
+// of an extra "unlisted chip" candidate, so a poor best fit cannot take all
+// the weight.
+#ifndef QUICKID_MAX_FIT
+#define QUICKID_MAX_FIT 0.75f
+#endif
+// Score scale of the weights exp(-score / tau): with tau = 0.1 a candidate
+// 10 % further from the measurements carries e^-1 of the weight.
+#ifndef QUICKID_TAU
+#define QUICKID_TAU 0.10f
+#endif
+// Timed repetitions per probe (the median is used)
+#ifndef QUICKID_REPEATS
+#define QUICKID_REPEATS 3
+#endif
+// Candidates compared when choosing the next probe
+#ifndef QUICKID_TOP_K
+#define QUICKID_TOP_K 4
+#endif
+// Scratch 64 KiB block; 0 = the one below the top block (the endurance sectors)
+#ifndef QUICKID_BASE
+#define QUICKID_BASE 0u
+#endif
+
+typedef struct {
+    bool     decisive;       // confidence reached QUICKID_CONFIDENCE, fit within
+                             // QUICKID_MAX_FIT and the live JEDEC is the row's
+    char     model[64];      // best datasheet row ("" if the DB was unusable)
+    char     company[48];
+    char     jedec[8];       // that row's JEDEC, normalized
+    float    confidence;     // 0..1
+    float    fit;            // the row's median relative error over the probes
+    bool     jedec_match;    // live JEDEC equals the row's
+    int      probes;         // probe types run
+    uint32_t elapsed_ms;     // from the first probe to the decision
+} quickid_result_t;
+
+// Erases and programs the scratch block. Chooses each probe (page program,
+// 4K/32K/64K erase) by how well it separates the current top candidates per
+// expected millisecond; stops when decisive or when no probe would help.
+// Prints and logs the result. out may be NULL. False if nothing ran.
+bool bench_quickid_run(quickid_result_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -12,6 +12,7 @@
 
 #include "flash_benchmark.h" // flash_* and benchmark_* APIs
 #include "sd_card.h"         // RESULTS.CSV I/O
+#include "bench_adaptive.h"  // iteration count / CI stopping
 
 /* Use a single, consistent unit string for microseconds.
    If your terminal still garbles it, compile with -DASCII_UNITS to fall back. */
@@ -324,7 +325,9 @@ static void run_size_log_series(const char *label,
         return;
     }
 
-    for (int i = 0; i < N_ITERS; ++i)
+    bench_adapt_t ad;
+    bench_adapt_begin(&ad, "read", label, size_bytes, N_ITERS);
+    while (bench_adapt_next(&ad, S->samples, S->n))
     {
         // Per-iteration env snapshot for CSV
         float tempC = read_temp_C(); // °C
@@ -355,7 +358,8 @@ static void run_size_log_series(const char *label,
         // Timestamp + notes
         char ts[32];
         make_timestamp(ts, sizeof ts);
-        const char *note = notes_for_read(label, size_bytes);
+        char note[64];
+        snprintf(note, sizeof note, "%s%s", notes_for_read(label, size_bytes), flash_dev_note_suffix());
 
         // CSV row
         char row[256];
@@ -382,6 +386,7 @@ static void run_size_log_series(const char *label,
 
         sleep_ms(10); // tiny spacing
     }
+    bench_adapt_end(&ad, jedec, S->samples, S->n);
 
     free(buf);
 }
@@ -422,7 +427,7 @@ void bench_read_run_100(bool confirm_whole_chip)
     // Reset series list
     g_series_count = 0;
 
-    printf("\n=== SPI Flash READ-only benchmark (100 iterations per size) ===\n");
+    printf("\n=== SPI Flash READ-only benchmark (%s per size) ===\n", bench_adapt_plan(N_ITERS));
     printf("Logging to %s (latency in microseconds; throughput in MB/s)\n", CSV_FILENAME);
     print_flash_sck_banner("");
 
@@ -431,8 +436,8 @@ void bench_read_run_100(bool confirm_whole_chip)
     {
         if (g_series_count >= MAX_SERIES)
             break;
-        printf("\n--- Running %s, %u bytes, %d iterations ---\n",
-               k_sizes[i].label, k_sizes[i].size, N_ITERS);
+        printf("\n--- Running %s, %u bytes, %s ---\n",
+               k_sizes[i].label, k_sizes[i].size, bench_adapt_plan(N_ITERS));
         run_size_log_series(k_sizes[i].label, k_sizes[i].size, 0x000000,
                             &g_series[g_series_count], &run_no);
         g_series_count++;
@@ -446,8 +451,8 @@ void bench_read_run_100(bool confirm_whole_chip)
             size_t total = flash_capacity_bytes();
             if (total > 0 && g_series_count < MAX_SERIES)
             {
-                printf("\n--- Running whole-chip, %lu bytes, %d iterations ---\n",
-                       (unsigned long)total, N_ITERS);
+                printf("\n--- Running whole-chip, %lu bytes, %s ---\n",
+                       (unsigned long)total, bench_adapt_plan(N_ITERS));
                 run_size_log_series("whole-chip", (uint32_t)total, 0x000000,
                                     &g_series[g_series_count], &run_no);
                 g_series_count++;
@@ -0,0 +1,445 @@
+#include "bench_sweep.h"
+
+#include "pico/stdlib.h"
+#include "hardware/adc.h"
+#include "pico/time.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "flash_benchmark.h" // flash_* APIs
+#include "pattern.h"
+#include "erase_plan.h"
+#include "sd_card.h"         // RESULTS.CSV / SWEEP.CSV I/O
+
+#ifdef ASCII_UNITS
+#define UNIT_US "us"
+#else
+#define UNIT_US "\xC2\xB5" \
+                "s" /* "µs" in UTF-8 */
+#endif
+
+// -----------------------------------------------------------------------------
+// Config
+// -----------------------------------------------------------------------------
+#define CSV_FILENAME "RESULTS.CSV"
+#define SWEEP_FILENAME "SWEEP.CSV"
+#define SWEEP_HEADER "jedec_id,operation,offset,setup_us,per_byte_ns,asymptotic_MBps,break_even_bytes,r2,points,timestamp,notes"
+
+// Iterations per (size, offset) point; the median is logged and fitted.
+#ifndef SWEEP_ITERS
+#define SWEEP_ITERS 7
+#endif
+
+// Reads start here (non-destructive)
+#ifndef SWEEP_READ_BASE
+#define SWEEP_READ_BASE 0x000000
+#endif
+
+// Program sweep scratch region: needs 64 KiB + one page past the base.
+#ifndef SWEEP_PROG_BASE
+#define SWEEP_PROG_BASE 0x070000
+#endif
+
+// Transaction sizes: powers of two 1..64 KiB plus odd/boundary-straddling sizes
+static const uint32_t k_sweep_sizes[] = {
+    1, 2, 3, 4, 7, 8, 16, 31, 32, 64, 100, 128, 255, 256, 257,
+    512, 1000, 1024, 2048, 4095, 4096, 4097, 8192, 16384, 32768, 65535, 65536,
+};
+#define N_SIZES ((int)(sizeof k_sweep_sizes / sizeof k_sweep_sizes[0]))
+
+// Start offsets within a 256-byte page
+static const uint32_t k_sweep_offsets[] = {0, 1, 128, 255};
+#define N_OFFSETS ((int)(sizeof k_sweep_offsets / sizeof k_sweep_offsets[0]))
+
+enum
+{
+    SW_READ = 0,
+    SW_PROG = 1,
+    SW_NOPS
+};
+static const char *const k_op_csv[SW_NOPS] = {"read_sweep", "write_sweep"};
+static const char *const k_op_label[SW_NOPS] = {"READ (one 0x03 command)", "PROGRAM (page-split 0x02)"};
+
+// -----------------------------------------------------------------------------
+// Small helpers (duplicated per bench module; main.c helpers are static)
+// -----------------------------------------------------------------------------
+static inline void make_timestamp(char *buf, size_t n)
+{
+    uint64_t us = to_us_since_boot(get_absolute_time());
+    uint32_t s = (uint32_t)(us / 1000000ULL);
+    uint32_t hh = s / 3600;
+    uint32_t mm = (s % 3600) / 60;
+    uint32_t ss = s % 60;
+    snprintf(buf, n, "2025-09-28 %02lu:%02lu:%02lu",
+             (unsigned long)hh, (unsigned long)mm, (unsigned long)ss);
+}
+
+#define ADC_CONV (3.3f / (1 << 12))
+#define ADC_VSYS_DIV 3.0f
+#define ADC_TEMP_CH 4
+#define ADC_VSYS_CH 3
+#define ADC_VSYS_PIN 29
+static void env_init_once(void)
+{
+    static bool inited = false;
+    if (inited)
+        return;
+    adc_init();
+    adc_gpio_init(ADC_VSYS_PIN);
+    adc_set_temp_sensor_enabled(true);
+    inited = true;
+}
+static inline float read_temp_C(void)
+{
+    env_init_once();
+    adc_select_input(ADC_TEMP_CH);
+    uint16_t raw = adc_read();
+    float v = raw * ADC_CONV;
+    return 27.0f - (v - 0.706f) / 0.001721f; // RP2040 formula
+}
+static inline float read_vsys_V(void)
+{
+    env_init_once();
+    adc_select_input(ADC_VSYS_CH);
+    uint16_t raw = adc_read();
+    return raw * ADC_CONV * ADC_VSYS_DIV;
+}
+
+static inline double mbps(uint32_t bytes, uint64_t us)
+{
+    if (us == 0)
+        return 0.0;
+    double mb = (double)bytes / (1024.0 * 1024.0);
+    double s = (double)us / 1e6;
+    return (s > 0.0) ? (mb / s) : 0.0;
+}
+
+static int next_run_number(void)
+{
+    int total = 0, data = 0;
+    if (sd_count_csv_rows(CSV_FILENAME, &total, &data) == 0)
+        return data + 1;
+    return 1;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    const uint64_t aa = *(const uint64_t *)a, bb = *(const uint64_t *)b;
+    return (aa < bb) ? -1 : (aa > bb);
+}
+
+static uint64_t median_u64(uint64_t *v, int n)
+{
+    if (n <= 0)
+        return 0;
+    qsort(v, n, sizeof v[0], cmp_u64);
+    if (n & 1)
+        return v[n / 2];
+    return (v[n / 2 - 1] + v[n / 2] + 1) / 2;
+}
+
+// -----------------------------------------------------------------------------
+// Storage: per-point medians + per-(op, offset) fit
+// -----------------------------------------------------------------------------
+typedef struct
+{
+    double a_us;     // setup cost (intercept)
+    double b_us;     // µs per byte (slope)
+    double r2;       // weighted coefficient of determination
+    int n;           // points used
+    bool ok;
+} sweep_fit_t;
+
+static uint32_t g_median_us[SW_NOPS][N_OFFSETS][N_SIZES];
+static bool g_have[SW_NOPS][N_OFFSETS][N_SIZES];
+static sweep_fit_t g_fit[SW_NOPS][N_OFFSETS];
+static bool g_ran[SW_NOPS];
+
+/* Weighted least squares for y = a + b·x with w = 1/y².
+ * Plain OLS lets the 64 KiB points (tens of ms) swamp the µs-scale intercept;
+ * relative weighting keeps the setup cost meaningful at the small end. */
+static sweep_fit_t fit_linear(const uint32_t *x, const uint32_t *y, const bool *have, int n)
+{
+    sweep_fit_t F = {0};
+    double sw = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        if (!have[i] || y[i] == 0)
+            continue;
+        double w = 1.0 / ((double)y[i] * (double)y[i]);
+        sw += w;
+        sx += w * x[i];
+        sy += w * y[i];
+        sxx += w * (double)x[i] * x[i];
+        sxy += w * (double)x[i] * y[i];
+        F.n++;
+    }
+    double den = sw * sxx - sx * sx;
+    if (F.n < 2 || den == 0.0)
+        return F;
+
+    F.b_us = (sw * sxy - sx * sy) / den;
+    F.a_us = (sy - F.b_us * sx) / sw;
+
+    double ybar = sy / sw, ss_res = 0, ss_tot = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        if (!have[i] || y[i] == 0)
+            continue;
+        double w = 1.0 / ((double)y[i] * (double)y[i]);
+        double e = (double)y[i] - (F.a_us + F.b_us * x[i]);
+        double d = (double)y[i] - ybar;
+        ss_res += w * e * e;
+        ss_tot += w * d * d;
+    }
+    F.r2 = (ss_tot > 0) ? 1.0 - ss_res / ss_tot : 0.0;
+    F.ok = (F.b_us > 0.0);
+    return F;
+}
+
+static inline double fit_asym_mbps(const sweep_fit_t *F)
+{
+    return (F->b_us > 0) ? (1.0 / F->b_us) * 1e6 / (1024.0 * 1024.0) : 0.0;
+}
+
+// Size at which setup cost equals transfer cost (=> 50% of asymptotic MB/s)
+static inline double fit_break_even(const sweep_fit_t *F)
+{
+    return (F->b_us > 0 && F->a_us > 0) ? F->a_us / F->b_us : 0.0;
+}
+
+// -----------------------------------------------------------------------------
+// Timed primitives
+// -----------------------------------------------------------------------------
+static uint64_t time_read_once(uint32_t addr, uint32_t size, uint8_t *buf, uint32_t buf_len)
+{
+    uint64_t t0 = time_us_64();
+    flash_read_data_stream(addr, buf, buf_len, size);
+    return time_us_64() - t0;
+}
+
+static void erase_span(uint32_t base_addr, uint32_t size)
+{
+    (void)erase_plan_execute(base_addr, size, ERASE_PLAN_SKIP_BLANK | ERASE_PLAN_QUIET, NULL);
+}
+
+// Program `size` bytes from `addr`, split at page boundaries the way
+// bench_write does. Data is prepared before t0 so only SPI+busy is timed.
+static uint64_t time_program_once(uint32_t addr, uint32_t size, const uint8_t *page)
+{
+    uint32_t remaining = size;
+    uint64_t t0 = time_us_64();
+    while (remaining)
+    {
+        uint32_t room = FLASH_PAGE_SIZE - (addr & (FLASH_PAGE_SIZE - 1));
+        uint32_t n = (remaining < room) ? remaining : room;
+        flash_page_program(addr, page, n);
+        addr += n;
+        remaining -= n;
+    }
+    return time_us_64() - t0;
+}
+
+// -----------------------------------------------------------------------------
+// Logging
+// -----------------------------------------------------------------------------
+static void log_point_row(const char *jedec, int op, uint32_t size, uint32_t addr,
+                          uint32_t off, uint64_t us, int *p_run_no)
+{
+    char ts[32];
+    make_timestamp(ts, sizeof ts);
+
+    char note[48];
+    uint32_t hz = flash_spi_get_baud_hz();
+    snprintf(note, sizeof note, "sweep_off%u_med%d@%uMHz%s",
+             (unsigned)off, SWEEP_ITERS, (unsigned)((hz + 500000u) / 1000000u),
+             flash_dev_note_suffix());
+
+    char row[256];
+    int len = snprintf(row, sizeof row,
+                       "%s,%s,%u,0x%06X,%llu,%.6f,%d,%.2f,%.2f,%s,%s,%s",
+                       jedec, k_op_csv[op], (unsigned)size, (unsigned)addr,
+                       (unsigned long long)us, mbps(size, us),
+                       (*p_run_no)++, read_temp_C(), read_vsys_V(),
+                       (op == SW_PROG) ? "0x55" : "n/a", ts, note);
+    if (len > 0 && len < (int)sizeof row)
+    {
+        if (!sd_append_to_file(CSV_FILENAME, row))
+            printf("❌ Failed to append RESULTS.CSV; continuing\n");
+    }
+}
+
+static void log_fit_row(const char *jedec, int op, int oi)
+{
+    const sweep_fit_t *F = &g_fit[op][oi];
+    char ts[32];
+    make_timestamp(ts, sizeof ts);
+
+    char note[32];
+    uint32_t hz = flash_spi_get_baud_hz();
+    snprintf(note, sizeof note, "%s@%uMHz", F->ok ? "fit" : "fit_failed",
+             (unsigned)((hz + 500000u) / 1000000u));
+
+    char row[256];
+    int len = snprintf(row, sizeof row,
+                       "%s,%s,%u,%.2f,%.3f,%.4f,%.0f,%.5f,%d,%s,%s",
+                       jedec, k_op_csv[op], (unsigned)k_sweep_offsets[oi],
+                       F->a_us, F->b_us * 1000.0, fit_asym_mbps(F),
+                       fit_break_even(F), F->r2, F->n, ts, note);
+    if (len > 0 && len < (int)sizeof row)
+    {
+        if (!sd_append_csv_row(SWEEP_FILENAME, SWEEP_HEADER, row))
+            printf("❌ Failed to append %s; continuing\n", SWEEP_FILENAME);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Core: one op over all offsets × sizes
+// -----------------------------------------------------------------------------
+static void run_op_sweep(int op, const char *jedec, int *p_run_no)
+{
+    const size_t cap = flash_capacity_bytes();
+    const uint32_t base = (op == SW_PROG) ? SWEEP_PROG_BASE : SWEEP_READ_BASE;
+
+    if (cap && (uint64_t)base + 65536u + FLASH_PAGE_SIZE > cap)
+    {
+        printf("⚠️  Chip too small for %s sweep at 0x%06X; skipping.\n",
+               k_op_csv[op], (unsigned)base);
+        return;
+    }
+
+    const uint32_t buf_len = 4096;
+    uint8_t *buf = (uint8_t *)malloc(buf_len);
+    if (!buf)
+    {
+        printf("⛔ Unable to allocate %u bytes for sweep. Aborting.\n", (unsigned)buf_len);
+        return;
+    }
+    // Program source: one page of 0x55, prepared once outside any timed region
+    pattern_fill(PAT_55, PATTERN_DEFAULT_SEED, 0, buf, FLASH_PAGE_SIZE);
+
+    uint64_t samples[SWEEP_ITERS];
+
+    for (int oi = 0; oi < N_OFFSETS; ++oi)
+    {
+        const uint32_t off = k_sweep_offsets[oi];
+        const uint32_t addr = base + off;
+        printf("\n--- %s sweep, page offset %u ---\n", k_op_csv[op], (unsigned)off);
+
+        for (int si = 0; si < N_SIZES; ++si)
+        {
+            const uint32_t size = k_sweep_sizes[si];
+            int n = 0;
+
+            for (int it = 0; it < SWEEP_ITERS; ++it)
+            {
+                uint64_t us;
+                if (op == SW_READ)
+                {
+                    us = time_read_once(addr, size, buf, buf_len);
+                }
+                else
+                {
+                    erase_span(addr, size); // untimed
+                    us = time_program_once(addr, size, buf);
+                }
+                samples[n++] = us;
+            }
+
+            uint64_t med = median_u64(samples, n);
+            g_median_us[op][oi][si] = (uint32_t)med;
+            g_have[op][oi][si] = true;
+
+            printf("  %6u B @+%-3u  median %8llu %s  (%.3f MB/s)\n",
+                   (unsigned)size, (unsigned)off, (unsigned long long)med, UNIT_US,
+                   mbps(size, med));
+
+            log_point_row(jedec, op, size, addr, off, med, p_run_no);
+        }
+
+        g_fit[op][oi] = fit_linear(k_sweep_sizes, g_median_us[op][oi], g_have[op][oi], N_SIZES);
+        log_fit_row(jedec, op, oi);
+    }
+
+    free(buf);
+    g_ran[op] = true;
+}
+
+// -----------------------------------------------------------------------------
+// Public API
+// -----------------------------------------------------------------------------
+void bench_sweep_run(bool include_program)
+{
+    if (!sd_is_mounted())
+    {
+        printf("⛔ SD not mounted; cannot run sweep.\n");
+        return;
+    }
+    char jedec[24] = {0};
+    flash_get_jedec_str(jedec, sizeof jedec);
+    if (!jedec[0] || strcmp(jedec, "No / Unknown_Flash") == 0)
+    {
+        printf("⛔ Flash not live (JEDEC unknown). Aborting sweep.\n");
+        return;
+    }
+
+    memset(g_have, 0, sizeof g_have);
+    memset(g_fit, 0, sizeof g_fit);
+    memset(g_ran, 0, sizeof g_ran);
+
+    int run_no = next_run_number();
+
+    printf("\n=== SPI Flash transaction-size sweep (%d sizes x %d offsets, median of %d) ===\n",
+           N_SIZES, N_OFFSETS, SWEEP_ITERS);
+    printf("Points -> %s, fitted model -> %s\n", CSV_FILENAME, SWEEP_FILENAME);
+
+    run_op_sweep(SW_READ, jedec, &run_no);
+
+    if (include_program)
+    {
+        printf("\n⚠️  Program sweep erases 0x%06X..0x%06X\n",
+               (unsigned)SWEEP_PROG_BASE, (unsigned)(SWEEP_PROG_BASE + 65536u + FLASH_PAGE_SIZE - 1));
+        run_op_sweep(SW_PROG, jedec, &run_no);
+    }
+}
+
+void bench_sweep_print_summary(void)
+{
+    if (!bench_sweep_has_data())
+    {
+        printf("\n(no sweep data to summarize — run 'sweep' first)\n");
+        return;
+    }
+
+    printf("\n=== Sweep summary: latency = a + b*bytes ===\n");
+    for (int op = 0; op < SW_NOPS; ++op)
+    {
+        if (!g_ran[op])
+            continue;
+        printf("\n--- %s ---\n", k_op_label[op]);
+        printf(" offset |  setup a (%s) | per-byte b (ns) | asymptotic MB/s | break-even (B) |   R^2\n", UNIT_US);
+        for (int oi = 0; oi < N_OFFSETS; ++oi)
+        {
+            const sweep_fit_t *F = &g_fit[op][oi];
+            if (!F->ok)
+            {
+                printf("  %5u | (fit failed, %d points)\n", (unsigned)k_sweep_offsets[oi], F->n);
+                continue;
+            }
+            printf("  %5u | %14.2f | %15.3f | %15.3f | %14.0f | %.4f\n",
+                   (unsigned)k_sweep_offsets[oi], F->a_us, F->b_us * 1000.0,
+                   fit_asym_mbps(F), fit_break_even(F), F->r2);
+        }
+    }
+    printf("\nBreak-even = a/b: transactions at this size reach 50%% of asymptotic MB/s.\n");
+    printf("\n--- end of summary ---\n");
+}
+
+bool bench_sweep_has_data(void)
+{
+    return g_ran[SW_READ] || g_ran[SW_PROG];
+}
@@ -0,0 +1,10 @@
+// bench_sweep.h
+#pragma once
+#include <stdbool.h>
+
+// Transaction-size × start-offset sweep. Reads are always run; the program
+// sweep erases+programs a scratch region and only runs when include_program.
+// Fitted per-(op, offset) model latency = a + b·bytes goes to SWEEP.CSV.
+void bench_sweep_run(bool include_program);
+void bench_sweep_print_summary(void);
+bool bench_sweep_has_data(void);
@@ -10,8 +10,12 @@
 #include <stdint.h>
 #include <math.h>
 
-#include "flash_benchmark.h" // flash_* APIs, sizes, generate_test_pattern, etc.
+#include "flash_benchmark.h" // flash_* APIs, sizes, etc.
+#include "pattern.h"         // pattern_fill (staged outside the timer)
+#include "wear_sched.h"      // least-worn region picking + WEAR.BIN
+#include "erase_plan.h"      // cheapest erase mix for the prep step
 #include "sd_card.h"         // RESULTS.CSV I/O
+#include "bench_adaptive.h"  // iteration count / CI stopping
 
 /* ---------- Units (ASCII fallback like your read module) ---------- */
 #ifdef ASCII_UNITS
@@ -252,40 +256,50 @@ static bool ask_yes_no(const char *q)
 }
 
 /* ---------- erase a span [addr, addr+size) sector-wise (not timed) ---------- */
-static void erase_span(uint32_t base_addr, uint32_t size)
+/* Untimed prep erase. The planner picks 4K/32K/64K/chip by cost and skips
+   already-blank sectors; `verbose` prints planned vs actual for the span. */
+static void erase_span(uint32_t base_addr, uint32_t size, bool verbose)
 {
-    uint32_t start = base_addr & ~(FLASH_SECTOR_SIZE - 1);
-    uint32_t end = base_addr + size;
-    while (start < end)
-    {
-        flash_sector_erase(start);
-        start += FLASH_SECTOR_SIZE;
-    }
+    (void)erase_plan_execute(base_addr, size,
+                             ERASE_PLAN_SKIP_BLANK | (verbose ? 0u : ERASE_PLAN_QUIET), NULL);
 }
 
-/* ---------- page-program streamed (measured), pattern generated per chunk --- */
-static uint64_t program_streamed_measure(uint32_t base_addr, uint32_t size, const char *pattern)
-{
-    uint8_t buf[FLASH_PAGE_SIZE]; // 256B typical
-    uint32_t remaining = size, addr = base_addr;
+/* ---------- page-program streamed (measured), pattern staged untimed ------- */
+/* Pattern bytes for each PATTERN_STAGE_BYTES window are generated before the
+ * timer starts; only the page programs inside the window are accumulated. */
+static uint8_t s_stage[PATTERN_STAGE_BYTES];
 
-    uint64_t t0 = time_us_64();
+static uint64_t program_streamed_measure(uint32_t base_addr, uint32_t size,
+                                         pattern_id_t pat, uint32_t seed)
+{
+    uint32_t done = 0, addr = base_addr;
+    uint64_t total_us = 0;
 
-    while (remaining)
+    while (done < size)
     {
-        /* write at most to end-of-page each step */
-        uint32_t page_off = addr & (FLASH_PAGE_SIZE - 1);
-        uint32_t room = FLASH_PAGE_SIZE - page_off;
-        uint32_t this_len = (remaining < room) ? remaining : room;
+        uint32_t win = size - done;
+        if (win > sizeof s_stage)
+            win = sizeof s_stage;
+        pattern_fill(pat, seed, done, s_stage, win);
+
+        uint64_t t0 = time_us_64();
+        uint32_t off = 0;
+        while (off < win)
+        {
+            /* write at most to end-of-page each step */
+            uint32_t room = FLASH_PAGE_SIZE - (addr & (FLASH_PAGE_SIZE - 1));
+            uint32_t this_len = (win - off < room) ? (win - off) : room;
 
-        generate_test_pattern(buf, this_len, pattern);
-        flash_page_program(addr, buf, this_len);
+            flash_page_program(addr, s_stage + off, this_len);
 
-        addr += this_len;
-        remaining -= this_len;
+            addr += this_len;
+            off += this_len;
+        }
+        total_us += time_us_64() - t0;
+        done += win;
     }
 
-    return time_us_64() - t0; // elapsed µs (write only)
+    return total_us; // elapsed µs (write only)
 }
 
 /* ---------- one size × N_ITERS with CSV logging ---------- */
@@ -322,16 +336,27 @@ static void run_size_log_series_write(const char *label,
     S->size = size_bytes;
     S->n = 0;
 
-    for (int i = 0; i < N_ITERS; ++i)
+    /* Whole-chip always covers everything; other sizes rotate by wear */
+    const bool scheduled = wear_sched_active() && !(label && !strcmp(label, "whole-chip"));
+
+    bench_adapt_t ad;
+    bench_adapt_begin(&ad, "write", label, size_bytes, N_ITERS);
+    while (bench_adapt_next(&ad, S->samples, S->n))
     {
         float tempC = read_temp_C();
         float vV = read_vsys_V();
 
+        uint32_t iter_base = scheduled ? wear_sched_pick(size_bytes, base_addr) : base_addr;
+        const uint32_t wear_before = wear_sched_region_erases(iter_base, size_bytes);
+
         /* ERASE (not timed) so every iteration is fresh */
-        erase_span(base_addr, size_bytes);
+        erase_span(iter_base, size_bytes, /*verbose=*/ad.iters == 1 || ad.iters == N_ITERS);
+        wear_sched_note_erase(iter_base, size_bytes);
 
         /* WRITE (timed) */
-        uint64_t us = program_streamed_measure(base_addr, size_bytes, pattern);
+        uint64_t us = program_streamed_measure(iter_base, size_bytes,
+                                               pattern_from_name(pattern), PATTERN_DEFAULT_SEED);
+        wear_sched_note_program(iter_base, size_bytes);
 
         if (!us)
             printf("⚠️  Program returned 0 µs; logging as 0 and continuing\n");
@@ -340,12 +365,15 @@ static void run_size_log_series_write(const char *label,
 
         char ts[32];
         make_timestamp(ts, sizeof ts);
-        const char *note = notes_for_write(label, size_bytes, pattern);
+        char note[96];
+        snprintf(note, sizeof note, "%s_w%lu%s",
+                 notes_for_write(label, size_bytes, pattern), (unsigned long)wear_before,
+                 flash_dev_note_suffix());
 
         char row[256];
         int len = snprintf(row, sizeof row,
                            "%s,%s,%u,0x%06X,%llu,%.6f,%d,%.2f,%.2f,%s,%s,%s",
-                           jedec, "write", size_bytes, base_addr,
+                           jedec, "write", size_bytes, iter_base,
                            (unsigned long long)us, th,
                            (*p_run_no)++, tempC, vV,
                            pattern ? pattern : "n/a", ts, note);
@@ -363,6 +391,7 @@ static void run_size_log_series_write(const char *label,
 
         sleep_ms(10);
     }
+    bench_adapt_end(&ad, jedec, S->samples, S->n);
 }
 
 /* ---------- Public: run suite ---------- */
@@ -393,18 +422,21 @@ void bench_write_run_100(bool confirm_whole_chip, const char *pattern)
     int run_no = next_run_number();
     g_series_count = 0;
 
-    printf("\n=== SPI Flash WRITE benchmark (100 iterations per size) ===\n");
+    printf("\n=== SPI Flash WRITE benchmark (%s per size) ===\n", bench_adapt_plan(N_ITERS));
     printf("⚠️  Each iteration ERASES the affected region, then measures PROGRAM (write) time only.\n");
     printf("Pattern: %s\n", pattern ? pattern : "n/a");
     print_flash_sck_banner("");
     printf("Logging to %s (latency in microseconds; throughput in MB/s)\n", CSV_FILENAME);
+    if (wear_sched_begin())
+        printf("Target regions rotate to the least-worn sectors (%s, gap bound %u)\n",
+               WEAR_FILENAME, (unsigned)WEAR_GAP_MAX);
 
     for (size_t i = 0; i < (sizeof k_sizes / sizeof k_sizes[0]); ++i)
     {
         if (g_series_count >= MAX_SERIES)
             break;
-        printf("\n--- Running %s, %u bytes, %d iterations ---\n",
-               k_sizes[i].label, k_sizes[i].size, N_ITERS);
+        printf("\n--- Running %s, %u bytes, %s ---\n",
+               k_sizes[i].label, k_sizes[i].size, bench_adapt_plan(N_ITERS));
         if (!ask_yes_no("Proceed with ERASE+WRITE for this size?"))
         {
             puts("↩️  Skipped by user.");
@@ -426,8 +458,8 @@ void bench_write_run_100(bool confirm_whole_chip, const char *pattern)
             size_t total = flash_capacity_bytes();
             if (total > 0 && g_series_count < MAX_SERIES)
             {
-                printf("\n--- Running whole-chip, %lu bytes, %d iterations ---\n",
-                       (unsigned long)total, N_ITERS);
+                printf("\n--- Running whole-chip, %lu bytes, %s ---\n",
+                       (unsigned long)total, bench_adapt_plan(N_ITERS));
                 run_size_log_series_write("whole-chip", (uint32_t)total, 0x000000,
                                           pattern, &g_series[g_series_count], &run_no);
                 g_series_count++;
@@ -442,6 +474,9 @@ void bench_write_run_100(bool confirm_whole_chip, const char *pattern)
             printf("↩️  Whole-chip run skipped by user.\n");
         }
     }
+
+    wear_sched_end();
+    wear_sched_print_summary();
 }
 
 /* ---------- Public: print summary (split prints to avoid varargs quirk) --- */
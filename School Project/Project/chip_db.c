@@ -1,41 +1,12 @@
 #include "chip_db.h"
 #include "fatfs/ff.h"      // FatFs
 #include "sd_card.h"       // sd_is_mounted()
+#include "csv_reader.h"    // csv_read_line(), csv_split()
 #include <ctype.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 
-/* --- small line reader: compatible with FF_USE_STRFUNC==0 ------------------ */
-/* Reads a single line (up to n-1 chars) from a FIL using f_read().
- * Stops at '\n' or buffer full. Strips nothing; caller can trim.
- * Returns true if any bytes were read (line may be partial at EOF). */
-static bool ff_gets_compat(FIL *fp, char *buf, size_t n) {
-    if (!buf || n == 0) return false;
-    size_t i = 0;
-    for (;;) {
-        UINT br = 0;
-        unsigned char ch;
-        FRESULT fr = f_read(fp, &ch, 1, &br);
-        if (fr != FR_OK) {            // I/O error
-            buf[i] = '\0';
-            return (i > 0);
-        }
-        if (br == 0) {                // EOF
-            buf[i] = '\0';
-            return (i > 0);
-        }
-        if (i + 1 < n) {
-            buf[i++] = (char)ch;
-        }
-        if (ch == '\n') {             // end of line
-            break;
-        }
-    }
-    buf[i] = '\0';
-    return true;
-}
-
 /* --- helpers -------------------------------------------------------------- */
 
 static void trim(char *s) {
@@ -47,105 +18,317 @@ static void trim(char *s) {
     while (n && (s[n-1] == ' ' || s[n-1] == '\t' || s[n-1] == '\r' || s[n-1] == '\n')) s[--n] = '\0';
 }
 
-// keep only hex chars, uppercase -> "BF2641" form for robust matching
-static void normalize_jedec(const char *in, char *out, size_t out_n) {
+/* --- compiled image ------------------------------------------------------ */
+
+typedef struct {
+    char     magic[4];      // "CHDB"
+    uint32_t version;       // CHIPDB_VERSION
+    uint32_t row_size;      // sizeof(chipdb_row_t)
+    uint32_t csv_size;      // source CSV when compiled
+    uint16_t csv_fdate, csv_ftime;
+    uint32_t rows;
+    uint32_t slots;         // power of two, >= 2 * rows
+    uint32_t index_off;
+    uint32_t rows_off;
+} chipdb_hdr_t;
+
+// Index slot: 16-bit hash tag + row number; row CHIPDB_EMPTY = free slot.
+// Tags only filter probes; the row's JEDEC is compared before a match.
+typedef struct {
+    uint16_t tag;
+    uint16_t row;
+} chipdb_slot_t;
+#define CHIPDB_EMPTY 0xFFFFu
+#define CHIPDB_MAX_ROWS 0xFFFEu
+
+void chipdb_normalize_jedec(const char *in, char out[8]) {
     size_t j = 0;
-    for (size_t i = 0; in[i] && j + 1 < out_n; i++) {
+    for (size_t i = 0; in && in[i] && j < 6; i++) {
         unsigned char c = (unsigned char)in[i];
-        if (isxdigit(c)) {
-            out[j++] = (char)toupper(c);
-        }
+        if (isxdigit(c)) out[j++] = (char)toupper(c);
     }
     out[j] = '\0';
 }
 
-static int split_commas(char *line, char *fields[], int max_fields) {
-    int count = 0;
-    char *p = line;
-    while (*p && count < max_fields) {
-        fields[count++] = p;
-        char *comma = strchr(p, ',');
-        if (!comma) break;
-        *comma = '\0';
-        p = comma + 1;
+static uint32_t jedec_hash(const char *norm) {
+    uint32_t h = 2166136261u;             // FNV-1a
+    for (; *norm; ++norm) { h ^= (uint8_t)*norm; h *= 16777619u; }
+    return h;
+}
+
+// "datasheet.csv" -> "datasheet.cdb"
+static void bin_name_for(const char *csv, char *out, size_t n) {
+    snprintf(out, n, "%s", csv);
+    char *dot = strrchr(out, '.');
+    size_t base = dot ? (size_t)(dot - out) : strlen(out);
+    if (base + 5 <= n) memcpy(out + base, ".cdb", 5);
+}
+
+static float cell_float(char **f, int nf, int idx) {
+    if (idx < 0 || idx >= nf) return -1.0f;
+    char *end = NULL;
+    float v = strtof(f[idx], &end);
+    return (end == f[idx]) ? -1.0f : v;
+}
+
+static void cell_str(char **f, int nf, int idx, char *out, size_t n) {
+    out[0] = '\0';
+    if (idx < 0 || idx >= nf) return;
+    strncpy(out, f[idx], n - 1);
+    out[n - 1] = '\0';
+    trim(out);
+}
+
+typedef struct {
+    int jedec, model, company, family, capacity, typ4k, typ32k, typ64k, typprog, read50;
+} chipdb_cols_t;
+
+// Header names are matched loosely (upper case, substring), as report.c did
+static void map_columns(char *header, chipdb_cols_t *c) {
+    char *cols[64];
+    int hc = csv_split(header, strchr(header, ',') ? ',' : '\t', cols, 64);
+    memset(c, 0xFF, sizeof *c);           // all -1
+    for (int i = 0; i < hc; i++) {
+        char h[96];
+        cell_str(cols, hc, i, h, sizeof h);
+        for (char *p = h; *p; ++p) *p = (char)toupper((unsigned char)*p);
+        if (strstr(h, "CHIP_MODEL")) c->model = i;
+        else if (strstr(h, "COMPANY")) c->company = i;
+        else if (strstr(h, "CHIP_FAMILY")) c->family = i;
+        else if (strstr(h, "CAPACITY") && strstr(h, "MBIT")) c->capacity = i;
+        else if (strstr(h, "JEDEC")) c->jedec = i;
+        else if (strstr(h, "TYP_PAGE_PROGRAM")) c->typprog = i;
+        else if (strstr(h, "TYP_4KB")) c->typ4k = i;
+        else if (strstr(h, "TYP_32KB")) c->typ32k = i;
+        else if (strstr(h, "TYP_64KB")) c->typ64k = i;
+        else if (strstr(h, "50MHZ_READ") || strstr(h, "READ50")) c->read50 = i;
     }
-    return count;
 }
 
-/* --- main API ------------------------------------------------------------- */
+static bool parse_row(char *line, const chipdb_cols_t *c, chipdb_row_t *r) {
+    char *f[64];
+    int nf = csv_split(line, strchr(line, ',') ? ',' : '\t', f, 64);
+    if (nf <= 1) return false;
+    memset(r, 0, sizeof *r);
+    char j[32];
+    cell_str(f, nf, c->jedec, j, sizeof j);
+    chipdb_normalize_jedec(j, r->jedec);
+    cell_str(f, nf, c->model, r->model, sizeof r->model);
+    cell_str(f, nf, c->company, r->company, sizeof r->company);
+    cell_str(f, nf, c->family, r->family, sizeof r->family);
+    r->capacity_mbit = cell_float(f, nf, c->capacity);
+    r->typ_4k_ms     = cell_float(f, nf, c->typ4k);
+    r->typ_32k_ms    = cell_float(f, nf, c->typ32k);
+    r->typ_64k_ms    = cell_float(f, nf, c->typ64k);
+    r->typ_page_ms   = cell_float(f, nf, c->typprog);
+    r->read50_MBps   = cell_float(f, nf, c->read50);
+    return true;
+}
 
-bool chipdb_lookup_capacity_bytes(const char *csv_filename,
-                                  const char *jedec_str,
-                                  size_t *out_bytes)
-{
-    if (!out_bytes || !jedec_str || !*jedec_str) return false;
-    if (!sd_is_mounted()) {
-        // Caller should mount before calling; we fail closed.
+static bool put_at(FIL *f, uint32_t off, const void *p, UINT n) {
+    UINT bw = 0;
+    return f_lseek(f, off) == FR_OK && f_write(f, p, n, &bw) == FR_OK && bw == n;
+}
+
+static bool get_at(FIL *f, uint32_t off, void *p, UINT n) {
+    UINT br = 0;
+    return f_lseek(f, off) == FR_OK && f_read(f, p, n, &br) == FR_OK && br == n;
+}
+
+// Compile state is static: compiles are rare, single-core, and the reader,
+// two FILs and a line buffer would otherwise be ~2 KB of stack.
+static csv_reader_t s_rd;
+static FIL s_csv, s_bin;
+static char s_line[512];
+
+bool chipdb_compile(const char *csv_filename, const char *bin_filename) {
+    FILINFO fi;
+    if (f_stat(csv_filename, &fi) != FR_OK) return false;
+    if (f_open(&s_csv, csv_filename, FA_READ) != FR_OK) return false;
+
+    // Pass 1: row upper bound, to size the index
+    uint32_t lines = 0;
+    csv_reader_init(&s_rd, &s_csv);
+    if (csv_read_line(&s_rd, s_line, sizeof s_line) < 0) { f_close(&s_csv); return false; }
+    while (csv_read_line(&s_rd, s_line, sizeof s_line) >= 0)
+        if (s_line[0] && s_line[0] != '\r') lines++;
+    if (lines > CHIPDB_MAX_ROWS) lines = CHIPDB_MAX_ROWS;
+
+    chipdb_hdr_t h;
+    memset(&h, 0, sizeof h);
+    memcpy(h.magic, "CHDB", 4);
+    h.version = CHIPDB_VERSION;
+    h.row_size = sizeof(chipdb_row_t);
+    h.csv_size = (uint32_t)fi.fsize;
+    h.csv_fdate = fi.fdate;
+    h.csv_ftime = fi.ftime;
+    h.slots = 16;
+    while (h.slots < 2u * lines) h.slots <<= 1;
+    h.index_off = sizeof h;
+    h.rows_off = h.index_off + h.slots * (uint32_t)sizeof(chipdb_slot_t);
+
+    // The index is built in RAM when it fits (4 bytes/slot), else in place
+    chipdb_slot_t *idx = (chipdb_slot_t *)malloc(h.slots * sizeof(chipdb_slot_t));
+    if (f_open(&s_bin, bin_filename, FA_CREATE_ALWAYS | FA_WRITE | FA_READ) != FR_OK) {
+        free(idx);
+        f_close(&s_csv);
         return false;
     }
+    bool ok = put_at(&s_bin, 0, &h, sizeof h);
+    if (idx) {
+        memset(idx, 0xFF, h.slots * sizeof(chipdb_slot_t));
+    } else {
+        memset(s_line, 0xFF, sizeof s_line);
+        for (uint32_t o = 0; ok && o < h.slots * sizeof(chipdb_slot_t); o += sizeof s_line) {
+            uint32_t left = h.slots * (uint32_t)sizeof(chipdb_slot_t) - o;
+            ok = put_at(&s_bin, h.index_off + o, s_line, left < sizeof s_line ? left : sizeof s_line);
+        }
+    }
 
-    FIL f;
-    FRESULT fr = f_open(&f, csv_filename, FA_READ);
-    if (fr != FR_OK) {
-        return false;
+    // Pass 2: parse, append rows, insert keys (linear probing keeps CSV order
+    // among equal JEDECs)
+    chipdb_cols_t cols;
+    f_lseek(&s_csv, 0);
+    csv_reader_init(&s_rd, &s_csv);
+    csv_read_line(&s_rd, s_line, sizeof s_line);
+    trim(s_line);
+    map_columns(s_line, &cols);
+
+    uint32_t n = 0, mask = h.slots - 1u;
+    chipdb_row_t r;
+    while (ok && n < lines && csv_read_line(&s_rd, s_line, sizeof s_line) >= 0) {
+        trim(s_line);
+        if (!s_line[0] || !parse_row(s_line, &cols, &r)) continue;
+        ok = put_at(&s_bin, h.rows_off + n * (uint32_t)sizeof r, &r, sizeof r);
+        if (ok && r.jedec[0]) {
+            uint32_t hv = jedec_hash(r.jedec);
+            chipdb_slot_t sl = { (uint16_t)(hv >> 16), (uint16_t)n };
+            for (uint32_t i = hv & mask;; i = (i + 1u) & mask) {
+                if (idx) {
+                    if (idx[i].row == CHIPDB_EMPTY) { idx[i] = sl; break; }
+                } else {
+                    chipdb_slot_t cur;
+                    ok = get_at(&s_bin, h.index_off + i * (uint32_t)sizeof cur, &cur, sizeof cur);
+                    if (!ok) break;
+                    if (cur.row == CHIPDB_EMPTY) {
+                        ok = put_at(&s_bin, h.index_off + i * (uint32_t)sizeof cur, &sl, sizeof sl);
+                        break;
+                    }
+                }
+            }
+        }
+        n++;
     }
+    f_close(&s_csv);
 
-    // Normalize target JEDEC to compact hex (e.g., "BF2641")
-    char want_hex[16] = {0};
-    normalize_jedec(jedec_str, want_hex, sizeof want_hex);
-    if (!want_hex[0]) { f_close(&f); return false; }
-
-    // Read header to figure out column indexes
-    char line[256];
-    if (!ff_gets_compat(&f, line, sizeof line)) { f_close(&f); return false; }
-    trim(line);
-
-    // Tokenize header
-    char *hdr = line;
-    char *cols[32] = {0};
-    int ncols = split_commas(hdr, cols, 32);
-
-    int idx_jedec = -1;
-    int idx_mbit  = -1;
-    for (int i = 0; i < ncols; i++) {
-        char h[64]; strncpy(h, cols[i], sizeof h - 1); h[sizeof h - 1] = 0;
-        trim(h);
-        for (char *p = h; *p; ++p) *p = (char)tolower(*p);
-        if (!strcmp(h, "jedec id")) idx_jedec = i;
-        if (!strcmp(h, "capacity (mbit)")) idx_mbit = i;
+    h.rows = n;
+    if (ok && idx) ok = put_at(&s_bin, h.index_off, idx, h.slots * sizeof(chipdb_slot_t));
+    if (ok) ok = put_at(&s_bin, 0, &h, sizeof h);
+    free(idx);
+    if (f_close(&s_bin) != FR_OK) ok = false;
+    if (!ok) {
+        f_unlink(bin_filename);
+        printf("❌ Failed to compile %s -> %s\n", csv_filename, bin_filename);
+        return false;
     }
-    if (idx_jedec < 0 || idx_mbit < 0) { f_close(&f); return false; }
+    printf("🗂️  Compiled %s -> %s (%lu rows, %lu index slots)\n", csv_filename, bin_filename,
+           (unsigned long)n, (unsigned long)h.slots);
+    return true;
+}
 
-    // Scan rows
-    bool found = false;
-    while (ff_gets_compat(&f, line, sizeof line)) {
-        trim(line);
-        if (!line[0]) continue;
-
-        char *fields[32] = {0};
-        int nf = split_commas(line, fields, 32);
-        if (nf <= idx_mbit || nf <= idx_jedec) continue;
-
-        char *jedec_csv = fields[idx_jedec]; trim(jedec_csv);
-        char csv_hex[16] = {0};
-        normalize_jedec(jedec_csv, csv_hex, sizeof csv_hex);
-        if (!csv_hex[0]) continue;
-
-        if (strcmp(csv_hex, want_hex) == 0) {
-            char *mbit_s = fields[idx_mbit]; trim(mbit_s);
-            double mbit = strtod(mbit_s, NULL);       // allow decimals
-            if (mbit > 0) {
-                // 1 Mbit = 131072 bytes (1,048,576 bits)
-                unsigned long long bytes = (unsigned long long)(mbit * 131072.0);
-                if (bytes > 0) {
-                    *out_bytes = (size_t)bytes;
-                    found = true;
-                    break;
-                }
+static bool hdr_current(const chipdb_hdr_t *h, const FILINFO *fi) {
+    return !memcmp(h->magic, "CHDB", 4) && h->version == CHIPDB_VERSION &&
+           h->row_size == sizeof(chipdb_row_t) && h->csv_size == (uint32_t)fi->fsize &&
+           h->csv_fdate == fi->fdate && h->csv_ftime == fi->ftime;
+}
+
+bool chipdb_open(chipdb_t *db, const char *csv_filename) {
+    memset(db, 0, sizeof *db);
+    if (!sd_is_mounted()) return false;
+
+    char bin[FF_MAX_LFN + 1]; // host tools pass full paths
+    bin_name_for(csv_filename, bin, sizeof bin);
+
+    FILINFO fi;
+    bool have_csv = (f_stat(csv_filename, &fi) == FR_OK);
+    chipdb_hdr_t h;
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (f_open(&db->f, bin, FA_READ) == FR_OK) {
+            bool good = get_at(&db->f, 0, &h, sizeof h) && !memcmp(h.magic, "CHDB", 4) &&
+                        h.version == CHIPDB_VERSION && h.row_size == sizeof(chipdb_row_t);
+            // Without the CSV a valid image is still usable
+            if (good && (!have_csv || hdr_current(&h, &fi))) {
+                db->open = true;
+                db->rows = h.rows;
+                db->slots = h.slots;
+                db->index_off = h.index_off;
+                db->rows_off = h.rows_off;
+                return true;
             }
+            f_close(&db->f);
         }
+        if (!have_csv || attempt || !chipdb_compile(csv_filename, bin)) break;
+    }
+    return false;
+}
+
+void chipdb_close(chipdb_t *db) {
+    if (db->open) f_close(&db->f);
+    db->open = false;
+}
+
+uint32_t chipdb_count(const chipdb_t *db) {
+    return db->open ? db->rows : 0;
+}
+
+bool chipdb_read_row(chipdb_t *db, uint32_t idx, chipdb_row_t *out) {
+    if (!db->open || idx >= db->rows) return false;
+    return get_at(&db->f, db->rows_off + idx * (uint32_t)sizeof *out, out, sizeof *out);
+}
+
+bool chipdb_find(chipdb_t *db, const char *jedec_str, uint32_t *idx_out, chipdb_row_t *out) {
+    char want[8];
+    chipdb_normalize_jedec(jedec_str, want);
+    if (!db->open || !want[0] || !db->slots) return false;
+
+    uint32_t hv = jedec_hash(want), mask = db->slots - 1u;
+    for (uint32_t i = hv & mask, probes = 0; probes < db->slots; i = (i + 1u) & mask, probes++) {
+        chipdb_slot_t sl;
+        if (!get_at(&db->f, db->index_off + i * (uint32_t)sizeof sl, &sl, sizeof sl)) return false;
+        if (sl.row == CHIPDB_EMPTY) return false;
+        if (sl.tag != (uint16_t)(hv >> 16)) continue;
+        chipdb_row_t r;
+        if (!chipdb_read_row(db, sl.row, &r)) return false;
+        if (strcmp(r.jedec, want) != 0) continue;
+        if (idx_out) *idx_out = sl.row;
+        if (out) *out = r;
+        return true;
     }
+    return false;
+}
 
-    f_close(&f);
+/* --- main API ------------------------------------------------------------- */
+
+bool chipdb_lookup_capacity_bytes(const char *csv_filename,
+                                  const char *jedec_str,
+                                  size_t *out_bytes)
+{
+    if (!out_bytes || !jedec_str || !*jedec_str) return false;
+
+    // Caller should mount before calling; chipdb_open() fails closed.
+    chipdb_t db;
+    if (!chipdb_open(&db, csv_filename)) return false;
+
+    chipdb_row_t r;
+    bool found = false;
+    if (chipdb_find(&db, jedec_str, NULL, &r) && r.capacity_mbit > 0) {
+        // 1 Mbit = 131072 bytes (1,048,576 bits)
+        unsigned long long bytes = (unsigned long long)(r.capacity_mbit * 131072.0);
+        if (bytes > 0) {
+            *out_bytes = (size_t)bytes;
+            found = true;
+        }
+    }
+    chipdb_close(&db);
     return found;
 }
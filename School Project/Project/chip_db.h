@@ -1,6 +1,8 @@
 #pragma once
 #include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
+#include "fatfs/ff.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -26,6 +28,51 @@ bool chipdb_lookup_capacity_bytes(const char *csv_filename,
                                   const char *jedec_str,
                                   size_t *out_bytes);
 
+/* ---------------------- Compiled database (.cdb) -------------------------
+ * "datasheet.csv" is compiled to "datasheet.cdb" next to it:
+ *   header | open-addressed JEDEC index (4-byte slots) | fixed-size rows
+ * The image records the CSV's size and date/time and is rebuilt by
+ * chipdb_open() when they change. Lookups cost one header read, a few
+ * slot reads and one row read; nothing is kept in RAM between calls. */
+#define CHIPDB_VERSION 1u
+
+typedef struct {
+    char    jedec[8];       // normalized, "BF2641" ("" if the cell was empty)
+    char    model[64];
+    char    company[48];
+    char    family[48];
+    float   capacity_mbit;  // -1 if N/A
+    float   typ_4k_ms;      // typical 4KB sector erase, -1 if N/A
+    float   typ_32k_ms;
+    float   typ_64k_ms;
+    float   typ_page_ms;    // typical page program
+    float   read50_MBps;    // MB/s @ 50 MHz, -1 if N/A
+} chipdb_row_t;
+
+typedef struct {
+    FIL      f;
+    bool     open;
+    uint32_t rows;
+    uint32_t slots;         // power of two
+    uint32_t index_off;
+    uint32_t rows_off;
+} chipdb_t;
+
+// Open the compiled image for csv_filename, compiling it first if it is
+// missing, from another version, or older than the CSV. False if neither
+// file is usable.
+bool     chipdb_open(chipdb_t *db, const char *csv_filename);
+void     chipdb_close(chipdb_t *db);
+uint32_t chipdb_count(const chipdb_t *db);
+bool     chipdb_read_row(chipdb_t *db, uint32_t idx, chipdb_row_t *out);
+// First row (in CSV order) whose JEDEC matches; *idx_out may be NULL.
+bool     chipdb_find(chipdb_t *db, const char *jedec_str, uint32_t *idx_out, chipdb_row_t *out);
+
+// Compile csv_filename into bin_filename unconditionally.
+bool     chipdb_compile(const char *csv_filename, const char *bin_filename);
+// Hex digits only, upper case, at most 6 ("ef 40 16" -> "EF4016")
+void     chipdb_normalize_jedec(const char *in, char out[8]);
+
 #ifdef __cplusplus
 }
 #endif
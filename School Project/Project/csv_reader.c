@@ -0,0 +1,135 @@
+// csv_reader.c — see csv_reader.h
+#include "csv_reader.h"
+
+#include <string.h>
+
+void csv_reader_init(csv_reader_t *r, FIL *fp)
+{
+    r->fp = fp;
+    r->pos = r->len = 0;
+    r->eof = false;
+    r->err = FR_OK;
+}
+
+static bool refill(csv_reader_t *r)
+{
+    if (r->eof)
+        return false;
+
+    // First read after an unaligned start only tops up to the next boundary,
+    // so every later read is whole, aligned sectors.
+    UINT want = CSV_READER_BUF;
+    FSIZE_t off = f_tell(r->fp) % CSV_READER_BUF;
+    if (off)
+        want -= (UINT)off;
+
+    UINT br = 0;
+    FRESULT fr = f_read(r->fp, r->buf, want, &br);
+    if (fr != FR_OK)
+        r->err = fr;
+    if (fr != FR_OK || br == 0)
+    {
+        r->eof = true;
+        r->pos = r->len = 0;
+        return false;
+    }
+    r->pos = 0;
+    r->len = (uint16_t)br;
+    return true;
+}
+
+int csv_read_line(csv_reader_t *r, char *line, size_t n)
+{
+    if (!line || n == 0)
+        return -1;
+
+    size_t i = 0;
+    bool any = false;
+    for (;;)
+    {
+        if (r->pos >= r->len && !refill(r))
+            break;
+        any = true;
+
+        const uint8_t *p = r->buf + r->pos;
+        const uint8_t *nl = memchr(p, '\n', r->len - r->pos);
+        size_t take = nl ? (size_t)(nl - p) : (size_t)(r->len - r->pos);
+
+        if (i + 1 < n)
+        {
+            size_t room = n - 1 - i;
+            size_t c = (take < room) ? take : room;
+            memcpy(line + i, p, c);
+            i += c;
+        }
+        r->pos += (uint16_t)(take + (nl ? 1u : 0u));
+        if (nl)
+            break;
+    }
+    line[i] = 0;
+    if (!any)
+        return -1;
+    if (i && line[i - 1] == '\r')
+        line[--i] = 0;
+    return (int)i;
+}
+
+FSIZE_t csv_reader_tell(const csv_reader_t *r)
+{
+    return f_tell(r->fp) - (FSIZE_t)(r->len - r->pos);
+}
+
+int csv_split(char *line, char sep, char *fields[], int max_fields)
+{
+    int n = 0;
+    char *p = line;
+    if (!p || max_fields <= 0)
+        return 0;
+
+    for (;;)
+    {
+        char *out = p;
+        fields[n++] = out;
+
+        // Leading blanks before an opening quote are dropped
+        char *q = p;
+        while (*q == ' ' || *q == '\t')
+            ++q;
+        if (*q == '"' && sep != '"')
+        {
+            p = q + 1;
+            for (;;)
+            {
+                if (*p == 0)
+                    break;
+                if (*p == '"')
+                {
+                    if (p[1] == '"')
+                    {
+                        *out++ = '"';
+                        p += 2;
+                        continue;
+                    }
+                    ++p; // closing quote; anything up to sep is kept as-is
+                    while (*p && *p != sep)
+                        *out++ = *p++;
+                    break;
+                }
+                *out++ = *p++;
+            }
+        }
+        else
+        {
+            while (*p && *p != sep)
+                ++p;
+            out = p;
+        }
+
+        char *next = (*p == sep) ? p + 1 : NULL;
+        *out = 0;
+        if (!next || n >= max_fields)
+            break;
+        p = next;
+    }
+    return n;
+}
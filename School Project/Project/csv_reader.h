@@ -0,0 +1,49 @@
+// csv_reader.h — block-buffered line reader + in-place CSV tokenizer for FatFs
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "fatfs/ff.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Read-ahead size: a multiple of the 512-byte sector, 512..4096. Whole-sector
+// reads at sector-aligned file offsets let FatFs copy straight from the card
+// into this buffer instead of going through the FIL window.
+#ifndef CSV_READER_BUF
+#define CSV_READER_BUF 512u
+#endif
+#if (CSV_READER_BUF < 512u) || (CSV_READER_BUF > 4096u) || (CSV_READER_BUF % 512u)
+#error "CSV_READER_BUF must be 512..4096 and a multiple of 512"
+#endif
+
+typedef struct {
+    FIL     *fp;
+    uint16_t pos, len;   // unread bytes are buf[pos..len)
+    bool     eof;
+    FRESULT  err;        // first f_read error, FR_OK otherwise
+    uint8_t  buf[CSV_READER_BUF] __attribute__((aligned(4)));
+} csv_reader_t;
+
+// fp must be open for reading; reading starts at its current offset.
+void csv_reader_init(csv_reader_t *r, FIL *fp);
+
+// Next line without its "\r\n"/"\n", NUL-terminated in line[n]. Longer lines
+// are truncated to n-1 chars and the rest is skipped. Returns the stored
+// length, or -1 at end of file / on error (r->err tells which).
+int  csv_read_line(csv_reader_t *r, char *line, size_t n);
+
+// File offset of the next unread byte (start of the next line).
+FSIZE_t csv_reader_tell(const csv_reader_t *r);
+
+// Split line in place on sep. A field may be "quoted" (sep and "" inside are
+// literal); quotes are removed. Unquoted fields keep surrounding blanks and
+// empty fields are kept, so column indexes stay aligned with the header.
+// Returns the number of fields stored (at most max_fields).
+int  csv_split(char *line, char sep, char *fields[], int max_fields);
+
+#ifdef __cplusplus
+}
+#endif
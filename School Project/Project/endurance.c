@@ -0,0 +1,135 @@
+/*
+ * Endurance engine (portable)
+ * One cycle = for each sector: erase (timed) -> blank check -> program all
+ * pages (timed, data staged first) -> read-back verify. Timings go into
+ * Welford accumulators; only closed windows leave this file.
+ */
+#include "endurance.h"
+#include "flash_benchmark.h" // FLASH_PAGE_SIZE / FLASH_SECTOR_SIZE only
+#include <string.h>
+
+void endurance_state_init(endurance_state_t *st)
+{
+    memset(st, 0, sizeof *st);
+    stream_stats_init(&st->erase_all);
+    stream_stats_init(&st->program_all);
+    stream_stats_init(&st->win.erase_us);
+    stream_stats_init(&st->win.program_us);
+    st->win.first_cycle = 1;
+}
+
+static void window_reset(endurance_state_t *st)
+{
+    stream_stats_init(&st->win.erase_us);
+    stream_stats_init(&st->win.program_us);
+    st->win.verify_fail = 0;
+    st->win.first_cycle = st->cycle + 1;
+}
+
+static bool sector_is_blank(const endurance_ops_t *ops, uint32_t addr, uint8_t *buf)
+{
+    for (uint32_t off = 0; off < FLASH_SECTOR_SIZE; off += FLASH_PAGE_SIZE)
+    {
+        if (!ops->read(ops->ctx, addr + off, buf, FLASH_PAGE_SIZE))
+            return false;
+        for (uint32_t i = 0; i < FLASH_PAGE_SIZE; ++i)
+            if (buf[i] != 0xFF)
+                return false;
+    }
+    return true;
+}
+
+static void note_fail(endurance_state_t *st)
+{
+    st->win.verify_fail++;
+    st->verify_fail_total++;
+    if (!st->first_fail_cycle)
+        st->first_fail_cycle = st->cycle + 1;
+}
+
+// One sector through erase/program/verify; returns 0 on I/O error
+static int cycle_sector(const endurance_cfg_t *cfg, endurance_state_t *st,
+                        const endurance_ops_t *ops, uint32_t addr, uint32_t seed)
+{
+    static uint8_t stage[FLASH_SECTOR_SIZE];
+    uint8_t rb[FLASH_PAGE_SIZE];
+    const uint32_t sector_off = addr - cfg->base;
+
+    uint64_t t0 = ops->now_us(ops->ctx);
+    if (!ops->erase_sector(ops->ctx, addr))
+        return 0;
+    double e_us = (double)(ops->now_us(ops->ctx) - t0);
+    stream_stats_push(&st->win.erase_us, e_us);
+    stream_stats_push(&st->erase_all, e_us);
+
+    if (!sector_is_blank(ops, addr, rb))
+        note_fail(st);
+
+    pattern_fill(cfg->pattern, seed, sector_off, stage, sizeof stage);
+
+    t0 = ops->now_us(ops->ctx);
+    for (uint32_t off = 0; off < FLASH_SECTOR_SIZE; off += FLASH_PAGE_SIZE)
+    {
+        if (!ops->program_page(ops->ctx, addr + off, stage + off, FLASH_PAGE_SIZE))
+            return 0;
+    }
+    double p_us = (double)(ops->now_us(ops->ctx) - t0);
+    stream_stats_push(&st->win.program_us, p_us);
+    stream_stats_push(&st->program_all, p_us);
+
+    for (uint32_t off = 0; off < FLASH_SECTOR_SIZE; off += FLASH_PAGE_SIZE)
+    {
+        if (!ops->read(ops->ctx, addr + off, rb, FLASH_PAGE_SIZE))
+            return 0;
+        if (memcmp(rb, stage + off, FLASH_PAGE_SIZE) != 0)
+        {
+            note_fail(st);
+            break;
+        }
+    }
+    return 1;
+}
+
+endurance_result_t endurance_run(const endurance_cfg_t *cfg, endurance_state_t *st,
+                                 const endurance_ops_t *ops, const endurance_sink_t *sink)
+{
+    if (!cfg || !st || !ops || !ops->erase_sector || !ops->program_page || !ops->read ||
+        !ops->now_us || !cfg->sectors || !cfg->window || (cfg->base % FLASH_SECTOR_SIZE))
+        return ENDURANCE_BAD_CONFIG;
+
+    uint32_t windows_since_ckpt = 0;
+
+    while (st->cycle < cfg->target_cycles)
+    {
+        const uint32_t seed = cfg->seed ^ (st->cycle + 1u);
+        for (uint32_t s = 0; s < cfg->sectors; ++s)
+        {
+            if (sink && sink->should_stop && sink->should_stop(sink->ctx))
+            {
+                // Partial cycle is discarded: resume redoes it from the start
+                return ENDURANCE_STOPPED;
+            }
+            if (!cycle_sector(cfg, st, ops, cfg->base + s * FLASH_SECTOR_SIZE, seed))
+                return ENDURANCE_IO_ERROR;
+        }
+        st->cycle++;
+
+        bool window_full = (st->cycle - st->win.first_cycle + 1u) >= cfg->window;
+        bool last = (st->cycle >= cfg->target_cycles);
+        if (window_full || last)
+        {
+            if (sink && sink->on_window)
+                sink->on_window(sink->ctx, cfg, st);
+            window_reset(st);
+
+            if (cfg->checkpoint_every && sink && sink->on_checkpoint &&
+                (++windows_since_ckpt >= cfg->checkpoint_every || last))
+            {
+                windows_since_ckpt = 0;
+                if (!sink->on_checkpoint(sink->ctx, cfg, st))
+                    return ENDURANCE_STOPPED;
+            }
+        }
+    }
+    return ENDURANCE_DONE;
+}
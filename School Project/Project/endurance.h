@@ -0,0 +1,78 @@
+/*
+ * Endurance engine (portable)
+ * Cycles erase -> program -> verify over a few sectors and folds the timings
+ * into constant-memory window statistics. No Pico/FatFs dependencies: flash
+ * access and time come through endurance_ops_t, output through
+ * endurance_sink_t, so the same loop runs against real flash or a model.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "stream_stats.h"
+#include "pattern.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t     base;            // first sector address (4 KiB aligned)
+    uint32_t     sectors;         // consecutive sectors cycled together
+    uint32_t     target_cycles;   // stop after this many full cycles
+    uint32_t     window;          // cycles folded into one decimated row
+    uint32_t     checkpoint_every;// windows between checkpoints (0 = never)
+    pattern_id_t pattern;
+    uint32_t     seed;            // per-cycle seed = seed ^ cycle (data changes each cycle)
+} endurance_cfg_t;
+
+typedef struct {
+    stream_stats_t erase_us;      // per-sector erase time
+    stream_stats_t program_us;    // per-sector program time (all pages)
+    uint32_t       verify_fail;   // sectors failing program or blank verify
+    uint32_t       first_cycle;   // first cycle number in this window
+} endurance_window_t;
+
+// Whole run state; POD so a checkpoint is just these bytes.
+typedef struct {
+    uint32_t           cycle;            // cycles completed
+    uint32_t           verify_fail_total;
+    uint32_t           first_fail_cycle; // 0 = none yet (cycles are 1-based)
+    stream_stats_t     erase_all;
+    stream_stats_t     program_all;
+    endurance_window_t win;
+} endurance_state_t;
+
+typedef struct {
+    int      (*erase_sector)(void *ctx, uint32_t addr);
+    int      (*program_page)(void *ctx, uint32_t addr, const uint8_t *data, uint32_t len);
+    int      (*read)        (void *ctx, uint32_t addr, uint8_t *buf, uint32_t len);
+    uint64_t (*now_us)      (void *ctx);
+    void     *ctx;
+} endurance_ops_t;
+
+typedef struct {
+    // Called when a window closes (and once more for a partial final window)
+    void (*on_window)    (void *ctx, const endurance_cfg_t *cfg, const endurance_state_t *st);
+    // Persist progress; return false to stop the run
+    bool (*on_checkpoint)(void *ctx, const endurance_cfg_t *cfg, const endurance_state_t *st);
+    // Polled between sector cycles; return true to stop early (optional)
+    bool (*should_stop)  (void *ctx);
+    void *ctx;
+} endurance_sink_t;
+
+typedef enum {
+    ENDURANCE_DONE = 0,     // reached target_cycles
+    ENDURANCE_STOPPED,      // should_stop / on_checkpoint asked to stop
+    ENDURANCE_IO_ERROR,     // ops callback returned 0
+    ENDURANCE_BAD_CONFIG
+} endurance_result_t;
+
+void endurance_state_init(endurance_state_t *st);
+
+// Runs from st->cycle up to cfg->target_cycles (resume = pass a loaded state).
+endurance_result_t endurance_run(const endurance_cfg_t *cfg, endurance_state_t *st,
+                                 const endurance_ops_t *ops, const endurance_sink_t *sink);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,339 @@
+/*
+ * Cost-optimal erase planner
+ *
+ * Aligned erases nest (4K in 32K in 64K), so the cheapest cover is found per
+ * 64K block bottom-up:
+ *   half(h)  = min(c32 if half fully in range, n_dirty(h) * c4)
+ *   block    = min(c64 if block fully in range, half(0) + half(1))
+ * and, only when the range is the whole device, min(c_chip, sum(block)).
+ * "Dirty" = in range and (unless SKIP_BLANK) not verified all-0xFF.
+ */
+#include "erase_plan.h"
+#include "flash_benchmark.h" // flash_* erase/read, chip profile, geometry
+#include "pico/stdlib.h"
+#include "pico/time.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+/* Built-in typicals (W25Q-class) used when the datasheet has no row */
+#define DEF_4K_US  45000.0
+#define DEF_32K_US 120000.0
+#define DEF_64K_US 150000.0
+
+/* No datasheet column for chip erase: estimate as this × (blocks × c64) */
+#ifndef ERASE_CHIP_FACTOR
+#define ERASE_CHIP_FACTOR 1.0
+#endif
+
+/* flash_chip_erase() waits at most 20 s for BUSY; don't plan chip erases
+   expected to run longer than this */
+#ifndef ERASE_CHIP_MAX_US
+#define ERASE_CHIP_MAX_US 15000000.0
+#endif
+
+#define SECTORS_PER_64K (FLASH_BLOCK_SIZE_64K / FLASH_SECTOR_SIZE)
+
+static double           s_cost[ERASE_OP_COUNT];
+static bool             s_measured[ERASE_OP_COUNT];
+static bool             s_unsupported[ERASE_OP_COUNT];
+static erase_cost_src_t s_src = ERASE_COST_DEFAULT;
+static uint32_t         s_profile_gen; // flash_profile()->gen the table was built from
+
+/* ------------------------------ cost table -------------------------------- */
+static void costs_load(void)
+{
+    const flash_profile_t *p = flash_profile();
+    if (s_profile_gen && p->gen == s_profile_gen)
+        return;
+
+    memset(s_measured, 0, sizeof s_measured);
+    memset(s_unsupported, 0, sizeof s_unsupported);
+    s_cost[ERASE_OP_4K] = DEF_4K_US;
+    s_cost[ERASE_OP_32K] = DEF_32K_US;
+    s_cost[ERASE_OP_64K] = DEF_64K_US;
+    s_src = ERASE_COST_DEFAULT;
+
+    if (p->in_db)
+    {
+        if (p->typ_4k_ms > 0)  s_cost[ERASE_OP_4K] = p->typ_4k_ms * 1000.0;
+        if (p->typ_32k_ms > 0) s_cost[ERASE_OP_32K] = p->typ_32k_ms * 1000.0;
+        if (p->typ_64k_ms > 0) s_cost[ERASE_OP_64K] = p->typ_64k_ms * 1000.0;
+        s_src = ERASE_COST_DATASHEET;
+    }
+    // Block sizes the datasheet says the part lacks are never planned
+    s_unsupported[ERASE_OP_32K] = !(p->erase_mask & FLASH_ERASE_32K);
+    s_unsupported[ERASE_OP_64K] = !(p->erase_mask & FLASH_ERASE_64K);
+
+    s_cost[ERASE_OP_CHIP] = ERASE_CHIP_FACTOR * s_cost[ERASE_OP_64K] *
+                            (double)(p->capacity_bytes / FLASH_BLOCK_SIZE_64K);
+
+    s_profile_gen = p->gen;
+}
+
+void erase_plan_costs(double out_us[ERASE_OP_COUNT], erase_cost_src_t *src)
+{
+    costs_load();
+    if (out_us)
+        memcpy(out_us, s_cost, sizeof s_cost);
+    if (src)
+        *src = s_src;
+}
+
+void erase_plan_note_measured(erase_op_t op, uint64_t us)
+{
+    if ((unsigned)op >= ERASE_OP_COUNT || !us)
+        return;
+    costs_load();
+    if (!s_measured[op])
+        s_cost[op] = (double)us; // first real sample replaces the typical
+    else
+        s_cost[op] = 0.75 * s_cost[op] + 0.25 * (double)us;
+    s_measured[op] = true;
+    s_src = ERASE_COST_MEASURED;
+}
+
+/* ------------------------------- helpers ---------------------------------- */
+// Early-exits on the first non-0xFF byte, so dirty sectors cost ~one chunk
+static bool sector_blank(uint32_t addr)
+{
+    uint8_t buf[256];
+    for (uint32_t off = 0; off < FLASH_SECTOR_SIZE; off += sizeof buf)
+    {
+        if (!flash_read_data(addr + off, buf, sizeof buf))
+            return false;
+        for (uint32_t i = 0; i < sizeof buf; ++i)
+            if (buf[i] != 0xFF)
+                return false;
+    }
+    return true;
+}
+
+static inline int popcount16(uint16_t v)
+{
+    int n = 0;
+    while (v) { v &= (uint16_t)(v - 1u); ++n; }
+    return n;
+}
+
+// Sector mask of [start, end) inside the 64K block at blk
+static uint16_t in_range_mask(uint32_t blk, uint32_t start, uint32_t end)
+{
+    uint16_t m = 0;
+    for (int s = 0; s < SECTORS_PER_64K; ++s)
+    {
+        uint32_t a = blk + (uint32_t)s * FLASH_SECTOR_SIZE;
+        if (a >= start && a < end)
+            m |= (uint16_t)(1u << s);
+    }
+    return m;
+}
+
+/* Per-block decision */
+typedef struct {
+    bool   use64;
+    bool   use32[2];
+    double cost;
+} block_choice_t;
+
+static block_choice_t choose_block(uint16_t in, uint16_t dirty)
+{
+    block_choice_t c = {0};
+    double halves = 0.0;
+    for (int h = 0; h < 2; ++h)
+    {
+        const uint16_t hm = (uint16_t)(0xFFu << (8 * h));
+        double small = popcount16(dirty & hm) * s_cost[ERASE_OP_4K];
+        if ((dirty & hm) && (in & hm) == hm && !s_unsupported[ERASE_OP_32K] &&
+            s_cost[ERASE_OP_32K] < small)
+        {
+            c.use32[h] = true;
+            small = s_cost[ERASE_OP_32K];
+        }
+        halves += small;
+    }
+    c.cost = halves;
+    if (dirty && in == 0xFFFFu && !s_unsupported[ERASE_OP_64K] && s_cost[ERASE_OP_64K] < halves)
+    {
+        c.use64 = true;
+        c.use32[0] = c.use32[1] = false;
+        c.cost = s_cost[ERASE_OP_64K];
+    }
+    return c;
+}
+
+static int timed_op(erase_op_t op, uint32_t addr, erase_plan_t *p)
+{
+    uint64_t t0 = time_us_64();
+    int ok;
+    switch (op)
+    {
+    case ERASE_OP_64K:  ok = flash_block64_erase(addr); break;
+    case ERASE_OP_32K:  ok = flash_block32_erase(addr); break;
+    case ERASE_OP_CHIP: ok = flash_chip_erase(); break;
+    default:            ok = flash_sector_erase(addr); break;
+    }
+    uint64_t us = time_us_64() - t0;
+    p->actual_us += us;
+    if (ok)
+    {
+        p->count[op]++;
+        erase_plan_note_measured(op, us);
+    }
+    else if (op != ERASE_OP_4K)
+    {
+        s_unsupported[op] = true; // don't plan it again this session
+        if (op == ERASE_OP_CHIP)
+            (void)flash_wait_busy(); // a slow chip erase may still be running
+    }
+    return ok;
+}
+
+static int erase_sectors(uint32_t blk, uint16_t mask, erase_plan_t *p)
+{
+    for (int s = 0; s < SECTORS_PER_64K; ++s)
+        if (mask & (1u << s))
+            if (!timed_op(ERASE_OP_4K, blk + (uint32_t)s * FLASH_SECTOR_SIZE, p))
+                return 0;
+    return 1;
+}
+
+static int execute_block(uint32_t blk, uint16_t in, uint16_t dirty, erase_plan_t *p)
+{
+    block_choice_t c = choose_block(in, dirty);
+    if (c.use64)
+    {
+        if (timed_op(ERASE_OP_64K, blk, p))
+            return 1;
+        c = choose_block(in, dirty); // 64K now marked unsupported: re-plan halves
+    }
+    for (int h = 0; h < 2; ++h)
+    {
+        const uint16_t hm = (uint16_t)(0xFFu << (8 * h));
+        if (c.use32[h] && timed_op(ERASE_OP_32K, blk + (uint32_t)h * FLASH_BLOCK_SIZE_32K, p))
+            continue;
+        if (!erase_sectors(blk, (uint16_t)(dirty & hm), p))
+            return 0;
+    }
+    return 1;
+}
+
+/* ------------------------------- public ----------------------------------- */
+int erase_plan_execute(uint32_t address, uint32_t size, unsigned flags, erase_plan_t *out)
+{
+    erase_plan_t local;
+    erase_plan_t *p = out ? out : &local;
+    memset(p, 0, sizeof *p);
+    if (!size)
+        return 1;
+
+    costs_load();
+    p->src = s_src;
+
+    size_t cap = flash_capacity_bytes();
+    if (cap && (uint64_t)address + size > cap)
+    {
+        if (address >= cap)
+            return 0;
+        size = (uint32_t)(cap - address);
+    }
+    const uint32_t start = address & ~(FLASH_SECTOR_SIZE - 1u);
+    const uint32_t end = (uint32_t)(((uint64_t)address + size + FLASH_SECTOR_SIZE - 1u) &
+                                    ~(uint64_t)(FLASH_SECTOR_SIZE - 1u));
+    p->start = start;
+    p->end = end;
+
+    const uint32_t blk0 = start & ~(FLASH_BLOCK_SIZE_64K - 1u);
+    const uint32_t nblk = (end - blk0 + FLASH_BLOCK_SIZE_64K - 1u) / FLASH_BLOCK_SIZE_64K;
+
+    // Pass 1: dirty masks (blank scan) and planned cost
+    uint16_t *dirty = (uint16_t *)malloc(nblk * sizeof(uint16_t));
+    if (!dirty)
+    {
+        printf("⛔ erase_plan: no memory for %lu block masks\n", (unsigned long)nblk);
+        return 0;
+    }
+    double blocks_cost = 0.0;
+    for (uint32_t b = 0; b < nblk; ++b)
+    {
+        uint32_t blk = blk0 + b * FLASH_BLOCK_SIZE_64K;
+        uint16_t in = in_range_mask(blk, start, end);
+        uint16_t d = in;
+        if (flags & ERASE_PLAN_SKIP_BLANK)
+        {
+            for (int s = 0; s < SECTORS_PER_64K; ++s)
+                if ((in & (1u << s)) && sector_blank(blk + (uint32_t)s * FLASH_SECTOR_SIZE))
+                {
+                    d &= (uint16_t)~(1u << s);
+                    p->skipped_blank++;
+                }
+        }
+        dirty[b] = d;
+        blocks_cost += choose_block(in, d).cost;
+    }
+
+    const bool whole = cap && start == 0 && end == cap;
+    const bool use_chip = whole && !s_unsupported[ERASE_OP_CHIP] && blocks_cost > 0.0 &&
+                          s_cost[ERASE_OP_CHIP] <= blocks_cost &&
+                          s_cost[ERASE_OP_CHIP] <= ERASE_CHIP_MAX_US;
+    p->planned_us = use_chip ? s_cost[ERASE_OP_CHIP] : blocks_cost;
+
+    if (flags & ERASE_PLAN_DRY_RUN)
+    {
+        // Report what would be issued
+        if (use_chip)
+            p->count[ERASE_OP_CHIP] = 1;
+        else
+            for (uint32_t b = 0; b < nblk; ++b)
+            {
+                uint32_t blk = blk0 + b * FLASH_BLOCK_SIZE_64K;
+                uint16_t in = in_range_mask(blk, start, end);
+                block_choice_t c = choose_block(in, dirty[b]);
+                if (c.use64) { p->count[ERASE_OP_64K]++; continue; }
+                for (int h = 0; h < 2; ++h)
+                {
+                    const uint16_t hm = (uint16_t)(0xFFu << (8 * h));
+                    if (c.use32[h]) p->count[ERASE_OP_32K]++;
+                    else p->count[ERASE_OP_4K] += (uint32_t)popcount16(dirty[b] & hm);
+                }
+            }
+        free(dirty);
+        if (!(flags & ERASE_PLAN_QUIET))
+            erase_plan_print("plan", p);
+        return 1;
+    }
+
+    // Pass 2: issue erases (caller handles write protection)
+    int ok = 1;
+    if (use_chip && timed_op(ERASE_OP_CHIP, 0, p))
+    {
+        // done in one command
+    }
+    else
+    {
+        for (uint32_t b = 0; b < nblk && ok; ++b)
+        {
+            uint32_t blk = blk0 + b * FLASH_BLOCK_SIZE_64K;
+            if (dirty[b])
+                ok = execute_block(blk, in_range_mask(blk, start, end), dirty[b], p);
+        }
+    }
+    free(dirty);
+
+    if (!(flags & ERASE_PLAN_QUIET))
+        erase_plan_print("erase", p);
+    return ok;
+}
+
+void erase_plan_print(const char *tag, const erase_plan_t *p)
+{
+    static const char *const k_src[] = {"defaults", "datasheet", "measured"};
+    printf("[%s] 0x%06lX..0x%06lX: %lux4K %lux32K %lux64K %lux chip, %lu blank skipped | planned %.1f ms",
+           tag ? tag : "erase", (unsigned long)p->start, (unsigned long)(p->end ? p->end - 1u : 0),
+           (unsigned long)p->count[ERASE_OP_4K], (unsigned long)p->count[ERASE_OP_32K],
+           (unsigned long)p->count[ERASE_OP_64K], (unsigned long)p->count[ERASE_OP_CHIP],
+           (unsigned long)p->skipped_blank, p->planned_us / 1000.0);
+    if (p->actual_us)
+        printf(", actual %.1f ms", (double)p->actual_us / 1000.0);
+    printf(" (%s costs)\n", k_src[p->src]);
+}
@@ -0,0 +1,58 @@
+/*
+ * Cost-optimal erase planner
+ * Covers a sector-aligned range with the cheapest mix of 4K / 32K / 64K /
+ * chip erases, never touching sectors outside the range, and optionally
+ * skipping sectors that already read blank.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    ERASE_OP_4K = 0,
+    ERASE_OP_32K,
+    ERASE_OP_64K,
+    ERASE_OP_CHIP,
+    ERASE_OP_COUNT
+} erase_op_t;
+
+typedef enum {
+    ERASE_COST_DEFAULT = 0,   // built-in typicals
+    ERASE_COST_DATASHEET,     // datasheet.csv row, via flash_profile()
+    ERASE_COST_MEASURED       // refined from timed ops this session
+} erase_cost_src_t;
+
+/* Planner flags */
+#define ERASE_PLAN_SKIP_BLANK 0x01u /* read first; leave all-0xFF sectors alone */
+#define ERASE_PLAN_DRY_RUN    0x02u /* plan only, no erase opcodes issued       */
+#define ERASE_PLAN_QUIET      0x04u /* no per-call console line                  */
+
+typedef struct {
+    uint32_t start, end;         // covered range, sector aligned [start, end)
+    uint32_t count[ERASE_OP_COUNT];
+    uint32_t skipped_blank;      // sectors left alone because already blank
+    double   planned_us;         // from the cost table at plan time
+    uint64_t actual_us;          // wall time of the erase opcodes (0 for dry run)
+    erase_cost_src_t src;
+} erase_plan_t;
+
+// Current per-op cost estimates (µs). Datasheet values come from the chip
+// profile and are reloaded whenever that profile is rebuilt.
+void erase_plan_costs(double out_us[ERASE_OP_COUNT], erase_cost_src_t *src);
+
+// Feed a measured op time into the cost table (exponential average).
+void erase_plan_note_measured(erase_op_t op, uint64_t us);
+
+// Plan and (unless DRY_RUN) execute. Range is clamped to capacity and
+// widened to whole sectors. Returns 1 on success, 0 if any erase failed.
+int  erase_plan_execute(uint32_t address, uint32_t size, unsigned flags, erase_plan_t *out);
+
+void erase_plan_print(const char *tag, const erase_plan_t *p);
+
+#ifdef __cplusplus
+}
+#endif
@@ -14,6 +14,9 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include "chip_db.h"
+#include "sd_card.h" // sd_is_mounted() for the profile's datasheet lookup
+#include "pattern.h"
+#include "erase_plan.h"
 
 #define CHIP_DB_PRIMARY "datasheet.csv" // your chosen filename on SD root
 #define CHIP_DB_FALLBACK "database.csv" // optional fallback
@@ -30,6 +33,21 @@
 #define FLASH_MOSI_PIN 7
 #define FLASH_MISO_PIN 4
 
+/* ------------- Optional second chip (SPI1, shares the microSD bus) ---------*
+ *   CE# -> GP13 (CS)      SCK/SI/SO -> GP10/GP11/GP12 (same wires as the SD)
+ * The SD CSn (GP15) is held high while the chip is probed. Set
+ * FLASH_DEV_COUNT to 1 to disable the slot entirely.
+ * -------------------------------------------------------------------------- */
+#ifndef FLASH_DEV_COUNT
+#define FLASH_DEV_COUNT 2
+#endif
+#define FLASH1_SPI_INST spi1
+#define FLASH1_CS_PIN 13
+#define FLASH1_SCK_PIN 10
+#define FLASH1_MOSI_PIN 11
+#define FLASH1_MISO_PIN 12
+#define FLASH1_GUARD_CS_PIN 15 // SD CSn on the same bus
+
 /* ------------------------------- SPI speeds -------------------------------- */
 #define BAUD_INIT_HZ 100000  // very safe for bring-up
 #define BAUD_ID_HZ 1000000   // robust JEDEC reading
@@ -88,31 +106,67 @@
 
 #define ERASE_BENCH_BASE_ADDR 0x050000u
 
+/* ------------------------------- Devices ----------------------------------- */
+typedef struct
+{
+    spi_inst_t *spi;
+    uint8_t cs_pin, sck_pin, mosi_pin, miso_pin;
+    int8_t guard_cs_pin;  // another CS on the same bus to hold high, or -1
+    bool shares_sd_bus;   // bus baud belongs to the SD driver between transactions
+    bool initialized;
+    uint32_t baud_hz;     // effective run baud
+    uint32_t bus_prev_hz; // shared bus: baud restored on deselect
+    char last_jedec[16];  // cached "BF 26 41"
+    flash_profile_t profile;
+} flash_dev_t;
+
+static flash_dev_t s_devs[FLASH_DEV_COUNT] = {
+    {.spi = FLASH_SPI_INST, .cs_pin = FLASH_CS_PIN, .sck_pin = FLASH_SCK_PIN,
+     .mosi_pin = FLASH_MOSI_PIN, .miso_pin = FLASH_MISO_PIN, .guard_cs_pin = -1},
+#if FLASH_DEV_COUNT > 1
+    {.spi = FLASH1_SPI_INST, .cs_pin = FLASH1_CS_PIN, .sck_pin = FLASH1_SCK_PIN,
+     .mosi_pin = FLASH1_MOSI_PIN, .miso_pin = FLASH1_MISO_PIN,
+     .guard_cs_pin = FLASH1_GUARD_CS_PIN, .shares_sd_bus = true},
+#endif
+};
+
+/* Current device per core, so core1 can stream one chip while core0 drives
+ * another through the same API. */
+static volatile uint8_t s_cur[2] = {0, 0};
+
+static inline flash_dev_t *cur_dev(void) { return &s_devs[s_cur[get_core_num()]]; }
+#define DEV_SPI (cur_dev()->spi)
+
 /* ------------------------ SPI / CS line helpers ---------------------------- */
 static inline void flash_cs_select(void)
 {
-    gpio_put(FLASH_CS_PIN, 0);
+    flash_dev_t *d = cur_dev();
+    if (d->shares_sd_bus && d->baud_hz)
+    {
+        d->bus_prev_hz = spi_get_baudrate(d->spi);
+        if (d->bus_prev_hz != d->baud_hz)
+            spi_set_baudrate(d->spi, d->baud_hz);
+    }
+    gpio_put(d->cs_pin, 0);
     sleep_us(1);
 }
 static inline void flash_cs_deselect(void)
 {
+    flash_dev_t *d = cur_dev();
     sleep_us(1);
-    gpio_put(FLASH_CS_PIN, 1);
+    gpio_put(d->cs_pin, 1);
+    if (d->shares_sd_bus && d->bus_prev_hz && d->bus_prev_hz != d->baud_hz)
+        spi_set_baudrate(d->spi, d->bus_prev_hz);
 }
 
-static inline void flash_write_cmd(uint8_t cmd) { spi_write_blocking(FLASH_SPI_INST, &cmd, 1); }
+static inline void flash_write_cmd(uint8_t cmd) { spi_write_blocking(DEV_SPI, &cmd, 1); }
 
 static inline void flash_write_addr(uint32_t addr)
 {
     uint8_t b[3] = {(uint8_t)(addr >> 16), (uint8_t)(addr >> 8), (uint8_t)addr};
-    spi_write_blocking(FLASH_SPI_INST, b, 3);
+    spi_write_blocking(DEV_SPI, b, 3);
 }
 
-/* ------------------------------- State ------------------------------------- */
-static bool flash_initialized = false;
-static char s_last_jedec[16] = ""; // cached "BF 26 41"
-/* Track effective SPI baud for user display */
-static uint32_t g_flash_spi_baud_hz = 0;
 /* ------------------------- Small timing helper ----------------------------- */
 static inline uint64_t get_time_us(void)
 {
@@ -128,10 +182,12 @@ int flash_read_jedec_id(uint8_t *manufacturer,
                         uint8_t *device_id_2);
 
 
+// Run baud from the profile: on a shared bus the hardware divider belongs to
+// the SD driver whenever the flash is deselected.
 uint32_t flash_spi_get_baud_hz(void)
 {
-    uint32_t hw = spi_get_baudrate(FLASH_SPI_INST);
-    return hw ? hw : g_flash_spi_baud_hz;
+    uint32_t hz = flash_profile()->baud_hz;
+    return hz ? hz : spi_get_baudrate(DEV_SPI);
 }
 
 /* ===== ERASE HELPERS / PROTECTION / VERIFY ===== */
@@ -141,7 +197,7 @@ static inline uint8_t flash_read_status_once(void)
     uint8_t s = 0;
     flash_cs_select();
     flash_write_cmd(FLASH_CMD_READ_STATUS);
-    spi_read_blocking(FLASH_SPI_INST, 0xFF, &s, 1);
+    spi_read_blocking(DEV_SPI, 0xFF, &s, 1);
     flash_cs_deselect();
     return s;
 }
@@ -176,7 +232,7 @@ static void flash_write_status2(uint8_t sr1, uint8_t sr2)
 
     flash_write_enable();
     flash_cs_select();
-    spi_write_blocking(FLASH_SPI_INST, buf, 3);
+    spi_write_blocking(DEV_SPI, buf, 3);
     flash_cs_deselect();
     (void)flash_wait_busy();
 }
@@ -203,7 +259,7 @@ static void flash_global_unprotect_if_supported(void)
         flash_write_enable();
         flash_cs_select();
         uint8_t c = FLASH_CMD_GLOBAL_UNPROTECT; // 0x98 on SST26
-        spi_write_blocking(FLASH_SPI_INST, &c, 1);
+        spi_write_blocking(DEV_SPI, &c, 1);
         flash_cs_deselect();
         (void)flash_wait_busy();
         sleep_ms(1);
@@ -234,8 +290,8 @@ static inline uint8_t flash_read_status2_once(void)
     uint8_t cmd = FLASH_CMD_READ_STATUS2;
 
     flash_cs_select();
-    spi_write_blocking(FLASH_SPI_INST, &cmd, 1);
-    spi_read_blocking(FLASH_SPI_INST, 0xFF, &s, 1);
+    spi_write_blocking(DEV_SPI, &cmd, 1);
+    spi_read_blocking(DEV_SPI, 0xFF, &s, 1);
     flash_cs_deselect();
 
     return s;
@@ -275,7 +331,7 @@ static void flash_unprotect_vendor_aware(void)
     // 0x50 = "enable SR write" on many devices (no-op on others)
     uint8_t cmd = FLASH_CMD_WRITE_ENABLE_SR;
     flash_cs_select();
-    spi_write_blocking(FLASH_SPI_INST, &cmd, 1);
+    spi_write_blocking(DEV_SPI, &cmd, 1);
     flash_cs_deselect();
     sleep_us(5);
 
@@ -283,8 +339,8 @@ static void flash_unprotect_vendor_aware(void)
     flash_write_enable();
     cmd = FLASH_CMD_WRITE_STATUS;
     flash_cs_select();
-    spi_write_blocking(FLASH_SPI_INST, &cmd, 1);
-    spi_write_blocking(FLASH_SPI_INST, &sr1_after, 1);
+    spi_write_blocking(DEV_SPI, &cmd, 1);
+    spi_write_blocking(DEV_SPI, &sr1_after, 1);
     flash_cs_deselect();
     (void)flash_wait_busy();
 
@@ -292,8 +348,8 @@ static void flash_unprotect_vendor_aware(void)
     flash_write_enable();
     cmd = FLASH_CMD_WRITE_STATUS2;
     flash_cs_select();
-    spi_write_blocking(FLASH_SPI_INST, &cmd, 1);
-    spi_write_blocking(FLASH_SPI_INST, &sr2_after, 1);
+    spi_write_blocking(DEV_SPI, &cmd, 1);
+    spi_write_blocking(DEV_SPI, &sr2_after, 1);
     flash_cs_deselect();
     (void)flash_wait_busy();
 
@@ -361,47 +417,12 @@ static int flash_verify_erased(uint32_t addr, uint32_t size)
     return 1;
 }
 
-/* Erase a span using largest legal granularity (64K→32K→4K). */
+/* Erase a span with the cheapest 4K/32K/64K/chip mix (see erase_plan.c).
+   Sectors that already read blank are left alone. */
 int flash_erase_span(uint32_t address, uint32_t size)
 {
-    size_t cap = flash_capacity_bytes();
-    if (cap && (uint64_t)address + size > cap)
-    {
-        if (address >= cap)
-            return 0;
-        size = (uint32_t)(cap - address);
-    }
-    /* align start down to 4K boundary; extend size if needed to cover original range */
-    uint32_t start = address & ~(FLASH_SECTOR_SIZE - 1);
-    uint32_t end = (address + size + FLASH_SECTOR_SIZE - 1) & ~(FLASH_SECTOR_SIZE - 1);
-
     flash_global_unprotect_if_supported();
-
-    uint32_t p = start;
-    while (p < end)
-    {
-        uint32_t remain = end - p;
-
-        /* Prefer 64K when aligned & large enough */
-        if ((p % (64u * 1024u) == 0) && remain >= (64u * 1024u))
-        {
-            if (!flash_block64_erase(p))
-                return 0;
-            p += 64u * 1024u;
-            continue;
-        }
-        /* Then 32K */
-        if ((p % (32u * 1024u) == 0) && remain >= (32u * 1024u) && flash_block32_erase(p))
-        {
-            p += 32u * 1024u;
-            continue;
-        }
-        /* Fallback 4K */
-        if (!flash_sector_erase(p))
-            return 0;
-        p += FLASH_SECTOR_SIZE;
-    }
-    return 1;
+    return erase_plan_execute(address, size, ERASE_PLAN_SKIP_BLANK | ERASE_PLAN_QUIET, NULL);
 }
 
 /* ---------------------------- Soft reset / wake ---------------------------- */
@@ -412,17 +433,17 @@ int flash_soft_reset(void)
 
     flash_cs_select();
     c = FLASH_CMD_RESET_ENABLE;
-    spi_write_blocking(FLASH_SPI_INST, &c, 1);
+    spi_write_blocking(DEV_SPI, &c, 1);
     flash_cs_deselect();
     sleep_us(10);
     flash_cs_select();
     c = FLASH_CMD_RESET;
-    spi_write_blocking(FLASH_SPI_INST, &c, 1);
+    spi_write_blocking(DEV_SPI, &c, 1);
     flash_cs_deselect();
     sleep_ms(1);
     flash_cs_select();
     c = FLASH_CMD_POWER_UP;
-    spi_write_blocking(FLASH_SPI_INST, &c, 1);
+    spi_write_blocking(DEV_SPI, &c, 1);
     flash_cs_deselect();
     sleep_ms(1);
 
@@ -449,7 +470,7 @@ int flash_read_jedec_id(uint8_t *manufacturer, uint8_t *device_id_1, uint8_t *de
 
     flash_cs_select();
     flash_write_cmd(FLASH_CMD_JEDEC_ID);
-    spi_read_blocking(FLASH_SPI_INST, 0xFF, id, 3);
+    spi_read_blocking(DEV_SPI, 0xFF, id, 3);
     flash_cs_deselect();
 
     *manufacturer = id[0];
@@ -463,8 +484,12 @@ int flash_read_jedec_id(uint8_t *manufacturer, uint8_t *device_id_1, uint8_t *de
 /* -------------- Robust JEDEC read (oversample + sliding window) ------------ */
 static bool flash_read_jedec_robust(uint8_t *m, uint8_t *d1, uint8_t *d2)
 {
-    uint32_t prev = spi_get_baudrate(FLASH_SPI_INST);
-    spi_set_baudrate(FLASH_SPI_INST, BAUD_ID_HZ);
+    flash_dev_t *dev = cur_dev();
+    uint32_t prev = spi_get_baudrate(DEV_SPI);
+    uint32_t run_hz = dev->baud_hz;
+    spi_set_baudrate(DEV_SPI, BAUD_ID_HZ);
+    if (run_hz)
+        dev->baud_hz = BAUD_ID_HZ; // shared bus: keep select() from bumping it back
 
     flash_cs_deselect();
     sleep_us(5);
@@ -479,7 +504,7 @@ static bool flash_read_jedec_robust(uint8_t *m, uint8_t *d1, uint8_t *d2)
 
         flash_cs_select();
         flash_write_cmd(FLASH_CMD_JEDEC_ID);
-        spi_read_blocking(FLASH_SPI_INST, 0xFF, raw, sizeof raw);
+        spi_read_blocking(DEV_SPI, 0xFF, raw, sizeof raw);
         flash_cs_deselect();
 
         for (int i = 0; i <= (int)sizeof(raw) - 3; ++i)
@@ -499,17 +524,19 @@ static bool flash_read_jedec_robust(uint8_t *m, uint8_t *d1, uint8_t *d2)
             sleep_ms(1);
     }
 
-    spi_set_baudrate(FLASH_SPI_INST, prev);
+    dev->baud_hz = run_hz;
+    spi_set_baudrate(DEV_SPI, prev);
     return ok;
 }
 
 /* ----------------------- Public: format JEDEC as text ---------------------- */
 void flash_get_jedec_str(char *out, size_t n)
 {
+    flash_dev_t *dev = cur_dev();
     uint8_t m = 0, d1 = 0, d2 = 0;
     bool ok = false;
 
-    if (flash_initialized)
+    if (dev->initialized)
     {
         ok = flash_read_jedec_id(&m, &d1, &d2) && m != 0x00 && m != 0xFF && m != 0xFE && is_plausible_mfr(m);
 
@@ -521,12 +548,18 @@ void flash_get_jedec_str(char *out, size_t n)
     {
         (void)snprintf(out, n, "%02X %02X %02X", m, d1, d2);
         out[n - 1] = '\0';
-        (void)snprintf(s_last_jedec, sizeof s_last_jedec, "%02X %02X %02X", m, d1, d2);
-        s_last_jedec[sizeof s_last_jedec - 1] = '\0';
+        (void)snprintf(dev->last_jedec, sizeof dev->last_jedec, "%02X %02X %02X", m, d1, d2);
+        dev->last_jedec[sizeof dev->last_jedec - 1] = '\0';
+        if (dev->profile.valid && strcmp(dev->profile.jedec, dev->last_jedec) != 0)
+        {
+            printf("🔁 JEDEC changed %s -> %s; reloading chip profile\n",
+                   dev->profile.jedec, dev->last_jedec);
+            dev->profile.valid = false;
+        }
     }
-    else if (s_last_jedec[0])
+    else if (dev->last_jedec[0])
     {
-        (void)snprintf(out, n, "%s", s_last_jedec);
+        (void)snprintf(out, n, "%s", dev->last_jedec);
         out[n - 1] = '\0';
     }
     else
@@ -537,41 +570,101 @@ void flash_get_jedec_str(char *out, size_t n)
 }
 
 /* ----------------------------- Library init -------------------------------- */
-int flash_benchmark_init(void)
+/* Bring up one slot: pins, SPI instance, soft reset, JEDEC probe. Extra slots
+ * only count as present when the manufacturer byte is plausible, so an empty
+ * CS line reading bus noise is not mistaken for a chip. */
+static int flash_dev_bringup(int idx)
 {
-    printf("🔧 Initializing Flash SPI interface...\n");
+    flash_dev_t *d = &s_devs[idx];
+    uint8_t prev_cur = s_cur[get_core_num()];
+    s_cur[get_core_num()] = (uint8_t)idx;
 
-    uint32_t actual_init = spi_init(FLASH_SPI_INST, BAUD_INIT_HZ); // <— NEW (optional)
-    (void)actual_init;                                             // silence unused if you don't print it
-    spi_set_format(FLASH_SPI_INST, 8, SPI_CPOL_0, SPI_CPHA_0, SPI_MSB_FIRST);
+    if (d->guard_cs_pin >= 0 && gpio_get_function((uint)d->guard_cs_pin) != GPIO_FUNC_SIO)
+    {
+        gpio_init((uint)d->guard_cs_pin);
+        gpio_put((uint)d->guard_cs_pin, 1);
+        gpio_set_dir((uint)d->guard_cs_pin, GPIO_OUT);
+    }
 
-    gpio_set_function(FLASH_SCK_PIN, GPIO_FUNC_SPI);
-    gpio_set_function(FLASH_MOSI_PIN, GPIO_FUNC_SPI);
-    gpio_set_function(FLASH_MISO_PIN, GPIO_FUNC_SPI);
+    /* A shared bus may already be running for the SD card; don't reset it */
+    bool bus_live = (spi_get_hw(d->spi)->cr1 & SPI_SSPCR1_SSE_BITS) != 0;
+    uint32_t bus_hz = bus_live ? spi_get_baudrate(d->spi) : 0;
+    if (!d->shares_sd_bus || !bus_live)
+    {
+        uint32_t actual_init = spi_init(d->spi, BAUD_INIT_HZ); // <— NEW (optional)
+        (void)actual_init;                                     // silence unused if you don't print it
+        spi_set_format(d->spi, 8, SPI_CPOL_0, SPI_CPHA_0, SPI_MSB_FIRST);
+    }
+    else
+    {
+        spi_set_baudrate(d->spi, BAUD_INIT_HZ);
+    }
 
-    gpio_init(FLASH_CS_PIN);
-    gpio_set_dir(FLASH_CS_PIN, GPIO_OUT);
-    gpio_put(FLASH_CS_PIN, 1); // deselect
+    gpio_set_function(d->sck_pin, GPIO_FUNC_SPI);
+    gpio_set_function(d->mosi_pin, GPIO_FUNC_SPI);
+    gpio_set_function(d->miso_pin, GPIO_FUNC_SPI);
+
+    gpio_init(d->cs_pin);
+    gpio_set_dir(d->cs_pin, GPIO_OUT);
+    gpio_put(d->cs_pin, 1); // deselect
 
     sleep_ms(10);
     flash_soft_reset();
 
+    int found = 0;
     uint8_t m = 0, d1 = 0, d2 = 0;
-    if (flash_read_jedec_id(&m, &d1, &d2))
+    if (flash_read_jedec_id(&m, &d1, &d2) && (idx == 0 || is_plausible_mfr(m)))
     {
-        printf("✅ Flash detected: Mfg=0x%02X, Dev=0x%02X%02X\n", m, d1, d2);
+        printf("✅ Flash %d detected: Mfg=0x%02X, Dev=0x%02X%02X\n", idx, m, d1, d2);
 
         /* Set run speed and remember actual */
-        uint32_t actual_run = spi_set_baudrate(FLASH_SPI_INST, BAUD_RUN_HZ); // <— CHANGED
-        g_flash_spi_baud_hz = actual_run;                                    // <— NEW
+        uint32_t actual_run = spi_set_baudrate(d->spi, BAUD_RUN_HZ); // <— CHANGED
+        d->baud_hz = actual_run;                                     // <— NEW
 
-        flash_initialized = true;
+        d->initialized = true;
         // flash_global_unprotect_if_supported();
         // flash_unprotect_vendor_aware();
         flash_unprotect_all();
 
-        (void)snprintf(s_last_jedec, sizeof s_last_jedec, "%02X %02X %02X", m, d1, d2);
-        s_last_jedec[sizeof s_last_jedec - 1] = '\0';
+        (void)snprintf(d->last_jedec, sizeof d->last_jedec, "%02X %02X %02X", m, d1, d2);
+        d->last_jedec[sizeof d->last_jedec - 1] = '\0';
+        found = 1;
+    }
+
+    if (d->shares_sd_bus && bus_hz)
+        spi_set_baudrate(d->spi, bus_hz);
+
+    // Re-probe = new profile; built once the bus is back to the SD's baud
+    d->profile.valid = false;
+    if (found)
+        (void)flash_profile();
+
+    s_cur[get_core_num()] = prev_cur;
+    return found;
+}
+
+int flash_benchmark_init(void)
+{
+    printf("🔧 Initializing Flash SPI interface...\n");
+
+    int first = -1;
+    for (int i = 0; i < FLASH_DEV_COUNT; ++i)
+    {
+        if (flash_dev_bringup(i))
+        {
+            if (first < 0)
+                first = i;
+        }
+        else if (i > 0)
+        {
+            printf("ℹ️  Flash %d (%s CS GP%u): not fitted\n", i,
+                   s_devs[i].spi == spi0 ? "spi0" : "spi1", (unsigned)s_devs[i].cs_pin);
+        }
+    }
+
+    if (first >= 0)
+    {
+        s_cur[0] = s_cur[1] = (uint8_t)first;
         return 1;
     }
 
@@ -579,37 +672,164 @@ int flash_benchmark_init(void)
     return 0;
 }
 
-/* ------------------------- Capacity convenience ---------------------------- */
-size_t flash_capacity_bytes(void)
+/* ------------------------------ Device table ------------------------------- */
+int flash_dev_count(void) { return FLASH_DEV_COUNT; }
+
+bool flash_dev_present(int idx)
 {
-    if (!flash_initialized)
-        return 1 * 1024 * 1024;
+    return idx >= 0 && idx < FLASH_DEV_COUNT && s_devs[idx].initialized;
+}
+
+int flash_dev_present_count(void)
+{
+    int n = 0;
+    for (int i = 0; i < FLASH_DEV_COUNT; ++i)
+        n += s_devs[i].initialized ? 1 : 0;
+    return n;
+}
 
-    char jedec[24] = {0};
-    flash_get_jedec_str(jedec, sizeof jedec);
-    if (!jedec[0] || strcmp(jedec, "No / Unknown_Flash") == 0)
+int flash_dev_select(int idx)
+{
+    if (!flash_dev_present(idx))
+        return 0;
+    s_cur[get_core_num()] = (uint8_t)idx;
+    return 1;
+}
+
+int flash_dev_current(void) { return s_cur[get_core_num()]; }
+
+bool flash_dev_same_bus(int a, int b)
+{
+    if (a < 0 || b < 0 || a >= FLASH_DEV_COUNT || b >= FLASH_DEV_COUNT)
+        return false;
+    return s_devs[a].spi == s_devs[b].spi;
+}
+
+bool flash_dev_shares_sd_bus(int idx)
+{
+    return idx >= 0 && idx < FLASH_DEV_COUNT && s_devs[idx].shares_sd_bus;
+}
+
+void flash_dev_describe(int idx, char *out, size_t n)
+{
+    if (idx < 0 || idx >= FLASH_DEV_COUNT)
     {
-        printf("⚠️  No/Unknown JEDEC; using 1 MiB fallback\n");
-        return 1 * 1024 * 1024;
+        (void)snprintf(out, n, "?");
+        return;
+    }
+    const flash_dev_t *d = &s_devs[idx];
+    (void)snprintf(out, n, "#%d %s CS GP%u %s%s", idx, d->spi == spi0 ? "spi0" : "spi1",
+                   (unsigned)d->cs_pin, d->initialized ? d->last_jedec : "absent",
+                   d->shares_sd_bus ? " (SD bus)" : "");
+}
+
+const char *flash_dev_note_suffix(void)
+{
+    static const char *const k_tag[] = {"_d0", "_d1", "_d2", "_d3"};
+    int i = flash_dev_current();
+    return (i >= 0 && i < (int)(sizeof k_tag / sizeof k_tag[0])) ? k_tag[i] : "_d?";
+}
+
+/* ------------------------------ Chip profile ------------------------------- */
+static uint32_t s_profile_gen;
+
+// Datasheet row for jedec from the primary database, then the fallback
+static bool profile_lookup(const char *jedec, chipdb_row_t *r)
+{
+    static const char *const k_db[] = {CHIP_DB_PRIMARY, CHIP_DB_FALLBACK};
+    for (size_t i = 0; i < sizeof k_db / sizeof k_db[0]; ++i)
+    {
+        chipdb_t db;
+        if (!chipdb_open(&db, k_db[i]))
+            continue;
+        bool found = chipdb_find(&db, jedec, NULL, r);
+        chipdb_close(&db);
+        if (found)
+            return true;
     }
+    return false;
+}
 
-    size_t bytes = 0;
+static void profile_build(flash_dev_t *d)
+{
+    flash_profile_t *p = &d->profile;
+    memset(p, 0, sizeof *p);
+    p->gen = ++s_profile_gen;
+    (void)snprintf(p->jedec, sizeof p->jedec, "%s", d->last_jedec);
+    p->capacity_bytes = 1 * 1024 * 1024;
+    p->page_size = FLASH_PAGE_SIZE;
+    p->sector_size = FLASH_SECTOR_SIZE;
+    p->erase_mask = FLASH_ERASE_4K | FLASH_ERASE_32K | FLASH_ERASE_64K | FLASH_ERASE_CHIP;
+    p->op_4k = FLASH_CMD_SECTOR_ERASE;
+    p->op_32k = FLASH_CMD_BLOCK32_ERASE;
+    p->op_64k = FLASH_CMD_BLOCK64_ERASE;
+    p->op_chip = FLASH_CMD_CHIP_ERASE;
+    p->baud_hz = d->baud_hz;
+    p->valid = true;
+
+    if (!p->jedec[0])
+    {
+        printf("⚠️  No/Unknown JEDEC; using 1 MiB fallback\n");
+        return;
+    }
 
-    // Try your primary file first
-    if (chipdb_lookup_capacity_bytes(CHIP_DB_PRIMARY, jedec, &bytes))
+    chipdb_row_t r;
+    p->db_checked = sd_is_mounted();
+    p->in_db = p->db_checked && profile_lookup(p->jedec, &r);
+    if (!p->in_db)
     {
-        return bytes;
+        if (p->db_checked)
+            printf("⚠️  JEDEC %s not found in %s or %s; using 1 MiB fallback\n",
+                   p->jedec, CHIP_DB_PRIMARY, CHIP_DB_FALLBACK);
+        return;
     }
 
-    // Optional: try a fallback filename
-    if (chipdb_lookup_capacity_bytes(CHIP_DB_FALLBACK, jedec, &bytes))
+    // 1 Mbit = 131072 bytes
+    if (r.capacity_mbit > 0)
+        p->capacity_bytes = (size_t)(r.capacity_mbit * 131072.0);
+    p->typ_4k_ms = r.typ_4k_ms > 0 ? r.typ_4k_ms : 0.0f;
+    p->typ_32k_ms = r.typ_32k_ms > 0 ? r.typ_32k_ms : 0.0f;
+    p->typ_64k_ms = r.typ_64k_ms > 0 ? r.typ_64k_ms : 0.0f;
+    p->typ_page_ms = r.typ_page_ms > 0 ? r.typ_page_ms : 0.0f;
+
+    // A datasheet row that has erase timings but "-" for a block size means
+    // the part has no such opcode (e.g. S25FS064S: no 32K, IS25LP512E: no 64K)
+    if (p->typ_4k_ms > 0)
     {
-        return bytes;
+        if (!(p->typ_32k_ms > 0))
+            p->erase_mask &= (uint8_t)~FLASH_ERASE_32K;
+        if (!(p->typ_64k_ms > 0))
+            p->erase_mask &= (uint8_t)~FLASH_ERASE_64K;
     }
 
-    printf("⚠️  JEDEC %s not found in %s or %s; using 1 MiB fallback\n",
-           jedec, CHIP_DB_PRIMARY, CHIP_DB_FALLBACK);
-    return 1 * 1024 * 1024;
+    printf("📇 Chip profile: %s %s, %lu KiB, erase%s%s%s chip, %.2f MHz\n", p->jedec, r.model,
+           (unsigned long)(p->capacity_bytes / 1024),
+           (p->erase_mask & FLASH_ERASE_4K) ? " 4K" : "",
+           (p->erase_mask & FLASH_ERASE_32K) ? " 32K" : "",
+           (p->erase_mask & FLASH_ERASE_64K) ? " 64K" : "", p->baud_hz / 1e6);
+}
+
+const flash_profile_t *flash_profile(void)
+{
+    flash_dev_t *d = cur_dev();
+    // A profile built before the card was mounted is completed on first use after
+    if (d->initialized && (!d->profile.valid || (!d->profile.db_checked && sd_is_mounted())))
+        profile_build(d);
+    return &d->profile;
+}
+
+void flash_profile_invalidate(void)
+{
+    for (int i = 0; i < FLASH_DEV_COUNT; ++i)
+        s_devs[i].profile.valid = false;
+}
+
+/* ------------------------- Capacity convenience ---------------------------- */
+size_t flash_capacity_bytes(void)
+{
+    if (!cur_dev()->initialized)
+        return 1 * 1024 * 1024;
+    return flash_profile()->capacity_bytes;
 }
 
 /* ----------------------------- Status polling ------------------------------ */
@@ -623,7 +843,7 @@ int flash_wait_busy(void)
     {
         flash_cs_select();
         flash_write_cmd(FLASH_CMD_READ_STATUS);
-        spi_read_blocking(FLASH_SPI_INST, 0xFF, &status, 1);
+        spi_read_blocking(DEV_SPI, 0xFF, &status, 1);
         flash_cs_deselect();
 
         if ((status & FLASH_STATUS_BUSY) == 0)
@@ -638,7 +858,7 @@ int flash_write_enable(void)
 {
     uint8_t c = FLASH_CMD_WRITE_ENABLE;
     flash_cs_select();
-    spi_write_blocking(FLASH_SPI_INST, &c, 1);
+    spi_write_blocking(DEV_SPI, &c, 1);
     flash_cs_deselect();
     return 1;
 }
@@ -649,7 +869,27 @@ int flash_read_data(uint32_t address, uint8_t *buffer, uint32_t size)
     flash_cs_select();
     flash_write_cmd(FLASH_CMD_READ_DATA);
     flash_write_addr(address);
-    spi_read_blocking(FLASH_SPI_INST, 0xFF, buffer, size);
+    spi_read_blocking(DEV_SPI, 0xFF, buffer, size);
+    flash_cs_deselect();
+    return 1;
+}
+
+/* One READ command (single CS-low span) for `total` bytes, cycling the data
+ * through `buf` so a 64 KiB transaction doesn't need a 64 KiB buffer. */
+int flash_read_data_stream(uint32_t address, uint8_t *buf, uint32_t buf_len, uint32_t total)
+{
+    if (!buf || !buf_len)
+        return 0;
+
+    flash_cs_select();
+    flash_write_cmd(FLASH_CMD_READ_DATA);
+    flash_write_addr(address);
+    while (total)
+    {
+        uint32_t n = (total > buf_len) ? buf_len : total;
+        spi_read_blocking(DEV_SPI, 0xFF, buf, n);
+        total -= n;
+    }
     flash_cs_deselect();
     return 1;
 }
@@ -663,7 +903,7 @@ int flash_page_program(uint32_t address, const uint8_t *data, uint32_t size)
     flash_cs_select();
     flash_write_cmd(FLASH_CMD_PAGE_PROGRAM);
     flash_write_addr(address);
-    spi_write_blocking(FLASH_SPI_INST, data, size);
+    spi_write_blocking(DEV_SPI, data, size);
     flash_cs_deselect();
 
     return flash_wait_busy();
@@ -680,34 +920,11 @@ int flash_sector_erase(uint32_t address)
 }
 
 /* ------------------------- Pattern generation ------------------------------ */
+/* Thin name-based wrapper kept for existing callers; see pattern.c.
+ * "random" is now the seeded counter-based stream (reproducible) rather than rand(). */
 void generate_test_pattern(uint8_t *buffer, uint32_t size, const char *pattern_type)
 {
-    if (strcmp(pattern_type, "0xFF") == 0)
-    {
-        memset(buffer, 0xFF, size);
-    }
-    else if (strcmp(pattern_type, "0x00") == 0)
-    {
-        memset(buffer, 0x00, size);
-    }
-    else if (strcmp(pattern_type, "0x55") == 0)
-    {
-        memset(buffer, 0x55, size);
-    }
-    else if (strcmp(pattern_type, "random") == 0)
-    {
-        for (uint32_t i = 0; i < size; ++i)
-            buffer[i] = rand() & 0xFF;
-    }
-    else if (strcmp(pattern_type, "incremental") == 0)
-    {
-        for (uint32_t i = 0; i < size; ++i)
-            buffer[i] = (uint8_t)i;
-    }
-    else
-    {
-        memset(buffer, 0xFF, size);
-    }
+    pattern_fill(pattern_from_name(pattern_type), PATTERN_DEFAULT_SEED, 0, buffer, size);
 }
 
 /* ------------------------------- Utilities --------------------------------- */
@@ -748,7 +965,7 @@ int flash_dump(uint32_t address, uint32_t len)
 uint64_t benchmark_flash_read(uint32_t address, uint32_t size, const char *pattern)
 {
     (void)pattern;
-    if (!flash_initialized)
+    if (!cur_dev()->initialized)
         return 0;
 
     uint8_t *buffer = (uint8_t *)malloc(size);
@@ -782,7 +999,7 @@ uint64_t benchmark_flash_read(uint32_t address, uint32_t size, const char *patte
 
 uint64_t benchmark_flash_program(uint32_t address, uint32_t size, const char *pattern)
 {
-    if (!flash_initialized)
+    if (!cur_dev()->initialized)
         return 0;
 
     uint8_t *buffer = (uint8_t *)malloc(size);
@@ -829,7 +1046,7 @@ uint64_t benchmark_flash_program(uint32_t address, uint32_t size, const char *pa
 
 uint64_t benchmark_flash_erase(uint32_t address, uint32_t size)
 {
-    if (!flash_initialized)
+    if (!cur_dev()->initialized)
         return 0;
 
     size_t cap = flash_capacity_bytes();
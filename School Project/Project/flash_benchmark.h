@@ -32,12 +32,55 @@ typedef struct {
     char     notes[64];         // freeform
 } benchmark_result_t;
 
+/** Chip profile: what the benches need about a device, resolved once per
+ *  probe (JEDEC + one datasheet.cdb lookup) instead of per call. */
+#define FLASH_ERASE_4K   0x01u
+#define FLASH_ERASE_32K  0x02u
+#define FLASH_ERASE_64K  0x04u
+#define FLASH_ERASE_CHIP 0x08u
+
+typedef struct {
+    bool     valid;
+    bool     db_checked;        // built with the SD mounted (else retried after mount)
+    bool     in_db;             // datasheet row found for jedec
+    uint32_t gen;               // changes on every rebuild
+    char     jedec[16];         // "EF 70 16"
+    size_t   capacity_bytes;    // 1 MiB fallback when unknown
+    uint32_t page_size;         // program page (bytes)
+    uint32_t sector_size;       // smallest erase (bytes)
+    uint8_t  erase_mask;        // FLASH_ERASE_* the part accepts
+    uint8_t  op_4k, op_32k, op_64k, op_chip; // erase opcodes
+    float    typ_4k_ms, typ_32k_ms, typ_64k_ms, typ_page_ms; // 0 = no datasheet value
+    uint32_t baud_hz;           // effective run SCK
+} flash_profile_t;
+
 /* ============================== Public API =============================== */
 /* Init + identification */
 int      flash_benchmark_init(void);
 int      flash_identify_chip(char *chip_name, size_t name_size);
-void     flash_get_jedec_str(char *out, size_t n);     // "EF 40 16" etc.
-size_t   flash_capacity_bytes(void);
+void     flash_get_jedec_str(char *out, size_t n);     // "EF 40 16" etc. (live read)
+size_t   flash_capacity_bytes(void);                   // flash_profile()->capacity_bytes
+
+/* Profile of the calling core's current device. Built at probe time and
+ * rebuilt only when the slot is re-probed, flash_get_jedec_str() reads a
+ * different ID, or flash_profile_invalidate() is called (e.g. after
+ * datasheet.csv was replaced). Never touches the SPI bus or SD card
+ * otherwise, so it is safe inside timing loops. */
+const flash_profile_t *flash_profile(void);
+void     flash_profile_invalidate(void);
+
+/* Multiple chips: each slot has its own SPI instance, CS pin and baud. Every
+ * other call in this header acts on the calling core's current device
+ * (the first detected one after init), so each core can drive its own chip. */
+int      flash_dev_count(void);                  // configured slots
+int      flash_dev_present_count(void);
+bool     flash_dev_present(int idx);
+int      flash_dev_select(int idx);              // 1 if present; per core
+int      flash_dev_current(void);
+bool     flash_dev_same_bus(int a, int b);
+bool     flash_dev_shares_sd_bus(int idx);
+void     flash_dev_describe(int idx, char *out, size_t n); // "#1 spi1 CS GP13 EF 40 16"
+const char *flash_dev_note_suffix(void);         // "_d0" for CSV notes
 
 /* Timed benchmarks */
 uint64_t benchmark_flash_read   (uint32_t address, uint32_t size, const char *pattern);
@@ -55,8 +98,13 @@ int      flash_read_jedec_id (uint8_t *manufacturer, uint8_t *device_id_1, uint8
 int      flash_wait_busy     (void);
 int      flash_write_enable  (void);
 int      flash_sector_erase  (uint32_t address);
+int      flash_block32_erase (uint32_t address); // 32K-aligned; 0 if unsupported/failed
+int      flash_block64_erase (uint32_t address); // 64K-aligned
+int      flash_chip_erase    (void);
+int      flash_erase_span    (uint32_t address, uint32_t size); // via erase_plan.c
 int      flash_page_program  (uint32_t address, const uint8_t *data, uint32_t size);
 int      flash_read_data     (uint32_t address, uint8_t *buffer, uint32_t size);
+int      flash_read_data_stream(uint32_t address, uint8_t *buf, uint32_t buf_len, uint32_t total); // one READ cmd
 int      flash_soft_reset    (void);   // 0x66 -> 0x99 -> 0xAB
 int      flash_dump          (uint32_t address, uint32_t len);
 
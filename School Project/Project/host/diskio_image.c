@@ -0,0 +1,140 @@
+/*
+ * FatFs disk on a host image file
+ * Sector I/O is pread/pwrite on the image; each call is charged simulated
+ * time so the logging/report/backup pipelines show realistic SD cost.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "diskio_image.h"
+#include "sim.h"
+#include "ff.h"
+#include "diskio.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SECTOR 512u
+
+static int s_fd = -1;
+static uint64_t s_sectors;
+static uint32_t s_bus_hz = 1000000;   // fatfs/diskio.c runs the card at 1 MHz
+static uint32_t s_cmd_us = 50;
+static uint32_t s_write_busy_us = 300;
+static uint64_t s_rd_sectors, s_wr_sectors, s_rd_calls, s_wr_calls;
+
+bool diskio_image_open(const char *path, uint32_t size_mib)
+{
+    s_fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (s_fd < 0)
+    {
+        perror(path);
+        return false;
+    }
+    struct stat sb;
+    fstat(s_fd, &sb);
+    if (sb.st_size == 0 && ftruncate(s_fd, (off_t)size_mib * 1024 * 1024) != 0)
+    {
+        perror("ftruncate");
+        close(s_fd);
+        s_fd = -1;
+        return false;
+    }
+    fstat(s_fd, &sb);
+    s_sectors = (uint64_t)sb.st_size / SECTOR;
+    return true;
+}
+
+void diskio_image_close(void)
+{
+    if (s_fd >= 0)
+        close(s_fd);
+    s_fd = -1;
+}
+
+void diskio_image_set_timing(uint32_t bus_hz, uint32_t cmd_us, uint32_t write_busy_us)
+{
+    if (bus_hz)
+        s_bus_hz = bus_hz;
+    s_cmd_us = cmd_us;
+    s_write_busy_us = write_busy_us;
+}
+
+static void charge(UINT count, bool write)
+{
+    uint64_t ns = (uint64_t)s_cmd_us * 1000u +
+                  (uint64_t)count * SECTOR * 8u * 1000000000ull / s_bus_hz;
+    if (write)
+        ns += (uint64_t)count * s_write_busy_us * 1000u;
+    sim_advance_ns(ns);
+}
+
+void diskio_image_print_stats(void)
+{
+    printf("🧪 SD image: %llu sectors read in %llu calls, %llu written in %llu calls (bus %lu Hz)\n",
+           (unsigned long long)s_rd_sectors, (unsigned long long)s_rd_calls,
+           (unsigned long long)s_wr_sectors, (unsigned long long)s_wr_calls,
+           (unsigned long)s_bus_hz);
+}
+
+/* ------------------------------- FatFs glue ------------------------------ */
+DSTATUS disk_initialize(BYTE pdrv)
+{
+    return (pdrv == 0 && s_fd >= 0) ? 0 : STA_NOINIT;
+}
+
+DSTATUS disk_status(BYTE pdrv)
+{
+    return (pdrv == 0 && s_fd >= 0) ? 0 : STA_NOINIT;
+}
+
+DRESULT disk_read(BYTE pdrv, BYTE *buff, LBA_t sector, UINT count)
+{
+    if (pdrv || s_fd < 0)
+        return RES_NOTRDY;
+    if (sector + count > s_sectors)
+        return RES_PARERR;
+    ssize_t want = (ssize_t)count * SECTOR;
+    if (pread(s_fd, buff, (size_t)want, (off_t)sector * SECTOR) != want)
+        return RES_ERROR;
+    s_rd_sectors += count;
+    s_rd_calls++;
+    charge(count, false);
+    return RES_OK;
+}
+
+DRESULT disk_write(BYTE pdrv, const BYTE *buff, LBA_t sector, UINT count)
+{
+    if (pdrv || s_fd < 0)
+        return RES_NOTRDY;
+    if (sector + count > s_sectors)
+        return RES_PARERR;
+    ssize_t want = (ssize_t)count * SECTOR;
+    if (pwrite(s_fd, buff, (size_t)want, (off_t)sector * SECTOR) != want)
+        return RES_ERROR;
+    s_wr_sectors += count;
+    s_wr_calls++;
+    charge(count, true);
+    return RES_OK;
+}
+
+DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void *buff)
+{
+    if (pdrv || s_fd < 0)
+        return RES_NOTRDY;
+    switch (cmd)
+    {
+    case CTRL_SYNC:
+        return RES_OK;
+    case GET_SECTOR_COUNT:
+        *(LBA_t *)buff = (LBA_t)s_sectors;
+        return RES_OK;
+    case GET_SECTOR_SIZE:
+        *(WORD *)buff = SECTOR;
+        return RES_OK;
+    case GET_BLOCK_SIZE:
+        *(DWORD *)buff = 1;
+        return RES_OK;
+    default:
+        return RES_PARERR;
+    }
+}
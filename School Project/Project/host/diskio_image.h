@@ -0,0 +1,24 @@
+/*
+ * FatFs disk on a host image file (replaces fatfs/diskio.c on the host)
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Open (or create, sparse) the image. size_mib is used only when creating.
+bool diskio_image_open(const char *path, uint32_t size_mib);
+void diskio_image_close(void);
+
+// Modelled card cost: each sector is 512*8 bits at bus_hz, plus a fixed
+// per-command overhead and a program delay per written sector.
+void diskio_image_set_timing(uint32_t bus_hz, uint32_t cmd_us, uint32_t write_busy_us);
+
+void diskio_image_print_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
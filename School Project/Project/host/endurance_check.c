@@ -0,0 +1,279 @@
+// endurance_check.c — endurance.c against the NOR model with fast wear-out.
+//   ./endurance_check [workdir]
+// Two chips cycle the same sectors for CHECK_CYCLES: one straight through, one
+// stopped at a checkpoint, detached, re-attached from its image and .wear
+// files and resumed from the saved state bytes (what ENDURE.CHK holds). The
+// window rows must match, erase/program times must climb with the erase
+// count, and verify failures must start only past the rated cycles.
+#include "endurance.h"
+#include "flash_benchmark.h" // FLASH_PAGE_SIZE / FLASH_SECTOR_SIZE
+#include "sim.h"
+#include "spi_nor_model.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CHECK_CAPACITY (64u * 1024u)
+#define CHECK_SECTORS 2u
+#define CHECK_CYCLES 600u
+#define CHECK_WINDOW 50u
+#define CHECK_RATED 400u      // endurance_cycles of the model
+#define CHECK_STOP_WINDOWS 5u // first run stops after this many checkpoints
+#define CHECK_POLL_NS 20000u  // status poll period
+#define CHECK_CS 5u
+#define MAX_ROWS (CHECK_CYCLES / CHECK_WINDOW + 1u)
+
+typedef struct {
+    uint32_t cycle_end;
+    double erase_mean, program_mean;
+    uint32_t verify_fail;
+} row_t;
+
+typedef struct {
+    row_t rows[MAX_ROWS];
+    unsigned n;
+    unsigned checkpoints;
+    unsigned stop_after; // 0 = never
+    const char *chk_path;
+} run_t;
+
+static int s_failures;
+
+#define CHECK(cond, ...)                \
+    do                                  \
+    {                                   \
+        if (!(cond))                    \
+        {                               \
+            printf("❌ " __VA_ARGS__);  \
+            printf("\n");               \
+            s_failures++;               \
+        }                               \
+    } while (0)
+
+/* --------------------------- SPI ops on the model ------------------------ */
+static void nor_xfer(const uint8_t *tx, uint8_t *rx, size_t n)
+{
+    nor_model_cs_edge(CHECK_CS, false);
+    nor_model_transfer(0, tx, rx, n);
+    nor_model_cs_edge(CHECK_CS, true);
+}
+
+static void nor_wait_ready(void)
+{
+    const uint8_t tx[2] = {0x05, 0xFF};
+    uint8_t rx[2];
+    do
+    {
+        sim_advance_ns(CHECK_POLL_NS);
+        nor_xfer(tx, rx, 2);
+    } while (rx[1] & 0x01u);
+}
+
+static void nor_wren(void)
+{
+    const uint8_t tx = 0x06;
+    nor_xfer(&tx, NULL, 1);
+}
+
+static int ops_erase(void *ctx, uint32_t addr)
+{
+    (void)ctx;
+    const uint8_t tx[4] = {0x20, (uint8_t)(addr >> 16), (uint8_t)(addr >> 8), (uint8_t)addr};
+    nor_wren();
+    nor_xfer(tx, NULL, sizeof tx);
+    nor_wait_ready();
+    return 1;
+}
+
+static int ops_program(void *ctx, uint32_t addr, const uint8_t *d, uint32_t n)
+{
+    (void)ctx;
+    uint8_t tx[4 + FLASH_PAGE_SIZE] = {0x02, (uint8_t)(addr >> 16), (uint8_t)(addr >> 8), (uint8_t)addr};
+    if (n > FLASH_PAGE_SIZE)
+        return 0;
+    memcpy(tx + 4, d, n);
+    nor_wren();
+    nor_xfer(tx, NULL, 4 + n);
+    nor_wait_ready();
+    return 1;
+}
+
+static int ops_read(void *ctx, uint32_t addr, uint8_t *b, uint32_t n)
+{
+    (void)ctx;
+    uint8_t tx[4 + FLASH_PAGE_SIZE] = {0x03, (uint8_t)(addr >> 16), (uint8_t)(addr >> 8), (uint8_t)addr};
+    uint8_t rx[4 + FLASH_PAGE_SIZE];
+    if (n > FLASH_PAGE_SIZE)
+        return 0;
+    nor_xfer(tx, rx, 4 + n);
+    memcpy(b, rx + 4, n);
+    return 1;
+}
+
+static uint64_t ops_now(void *ctx)
+{
+    (void)ctx;
+    return sim_now_us();
+}
+
+/* ---------------------------------- sink --------------------------------- */
+static void sink_window(void *ctx, const endurance_cfg_t *cfg, const endurance_state_t *st)
+{
+    (void)cfg;
+    run_t *r = ctx;
+    if (r->n < MAX_ROWS)
+        r->rows[r->n++] = (row_t){st->cycle, st->win.erase_us.mean, st->win.program_us.mean,
+                                  st->win.verify_fail};
+}
+
+static bool sink_checkpoint(void *ctx, const endurance_cfg_t *cfg, const endurance_state_t *st)
+{
+    (void)cfg;
+    run_t *r = ctx;
+    FILE *f = fopen(r->chk_path, "wb");
+    bool ok = f && fwrite(st, sizeof *st, 1, f) == 1;
+    if (f)
+        fclose(f);
+    CHECK(ok, "cannot write %s", r->chk_path);
+    return !(r->stop_after && ++r->checkpoints >= r->stop_after);
+}
+
+/* ---------------------------------- runs --------------------------------- */
+static const endurance_cfg_t k_cfg = {
+    .base = CHECK_CAPACITY - CHECK_SECTORS * FLASH_SECTOR_SIZE,
+    .sectors = CHECK_SECTORS,
+    .target_cycles = CHECK_CYCLES,
+    .window = CHECK_WINDOW,
+    .checkpoint_every = 1,
+    .pattern = PAT_RANDOM,
+    .seed = PATTERN_DEFAULT_SEED,
+};
+
+static bool attach(const char *image)
+{
+    static const uint8_t id[3] = {0xEF, 0x70, 0x16};
+    nor_timing_t t;
+    nor_model_default_timing(&t);
+    t.erase_drift = 0.5; // +50 % per 1000 erases: visible within CHECK_CYCLES
+    t.program_drift = 0.25;
+    t.endurance_cycles = CHECK_RATED;
+    return nor_model_attach(0, CHECK_CS, image, id, CHECK_CAPACITY, &t) == 0;
+}
+
+static void fresh_chip(const char *dir, const char *name, char *image, size_t n)
+{
+    char wear[512];
+    snprintf(image, n, "%s/%s.img", dir, name);
+    snprintf(wear, sizeof wear, "%s.wear", image);
+    unlink(image);
+    unlink(wear);
+}
+
+static endurance_result_t run_once(run_t *r, endurance_state_t *st)
+{
+    const endurance_ops_t ops = {ops_erase, ops_program, ops_read, ops_now, NULL};
+    const endurance_sink_t sink = {sink_window, sink_checkpoint, NULL, r};
+    return endurance_run(&k_cfg, st, &ops, &sink);
+}
+
+int main(int argc, char **argv)
+{
+    const char *dir = (argc > 1) ? argv[1] : ".";
+    static run_t ref, res;
+    char image[512], chk[512];
+    sim_clock_init(SIM_TIME_VIRTUAL);
+
+    // 1) Straight through
+    fresh_chip(dir, "endurance_ref", image, sizeof image);
+    snprintf(chk, sizeof chk, "%s/endurance_ref.chk", dir);
+    ref.chk_path = chk;
+    if (!attach(image))
+    {
+        printf("❌ cannot attach %s\n", image);
+        return 1;
+    }
+    endurance_state_t st;
+    endurance_state_init(&st);
+    CHECK(run_once(&ref, &st) == ENDURANCE_DONE, "reference run did not finish");
+    const endurance_state_t ref_end = st;
+    nor_model_detach_all();
+
+    // 2) Stopped at a checkpoint, then resumed from the saved bytes
+    char image2[512], chk2[512];
+    fresh_chip(dir, "endurance_resume", image2, sizeof image2);
+    snprintf(chk2, sizeof chk2, "%s/endurance_resume.chk", dir);
+    res.chk_path = chk2;
+    res.stop_after = CHECK_STOP_WINDOWS;
+    if (!attach(image2))
+    {
+        printf("❌ cannot attach %s\n", image2);
+        return 1;
+    }
+    endurance_state_init(&st);
+    CHECK(run_once(&res, &st) == ENDURANCE_STOPPED, "first half did not stop at the checkpoint");
+    nor_model_detach_all();
+
+    endurance_state_t loaded;
+    FILE *f = fopen(chk2, "rb");
+    bool ok = f && fread(&loaded, sizeof loaded, 1, f) == 1;
+    if (f)
+        fclose(f);
+    CHECK(ok, "cannot read %s", chk2);
+    CHECK(loaded.cycle == CHECK_STOP_WINDOWS * CHECK_WINDOW, "checkpoint at cycle %lu, expected %u",
+          (unsigned long)loaded.cycle, CHECK_STOP_WINDOWS * CHECK_WINDOW);
+    CHECK(attach(image2), "cannot re-attach %s", image2);
+    CHECK(nor_model_erase_count(0, k_cfg.base) == loaded.cycle,
+          "wear not kept across re-attach: %lu erases, checkpoint at %lu",
+          (unsigned long)nor_model_erase_count(0, k_cfg.base), (unsigned long)loaded.cycle);
+    res.stop_after = 0;
+    CHECK(run_once(&res, &loaded) == ENDURANCE_DONE, "resumed run did not finish");
+    nor_stats_t ns;
+    nor_model_get_stats(0, &ns);
+    nor_model_detach_all();
+
+    // 3) Resume is invisible in the results
+    CHECK(res.n == ref.n, "%u windows after resume, %u straight through", res.n, ref.n);
+    for (unsigned i = 0; i < ref.n && i < res.n; ++i)
+        CHECK(ref.rows[i].cycle_end == res.rows[i].cycle_end &&
+                  fabs(ref.rows[i].erase_mean - res.rows[i].erase_mean) < 1e-6 &&
+                  fabs(ref.rows[i].program_mean - res.rows[i].program_mean) < 1e-6 &&
+                  ref.rows[i].verify_fail == res.rows[i].verify_fail,
+              "window %u differs after resume", i);
+    CHECK(loaded.verify_fail_total == ref_end.verify_fail_total &&
+              loaded.first_fail_cycle == ref_end.first_fail_cycle &&
+              loaded.erase_all.n == ref_end.erase_all.n &&
+              fabs(loaded.erase_all.mean - ref_end.erase_all.mean) < 1e-6,
+          "run totals differ after resume");
+
+    // 4) Drift and wear-out show up in the windows
+    const row_t *first = &ref.rows[0], *last = &ref.rows[ref.n ? ref.n - 1 : 0];
+    double erase_rise = last->erase_mean / first->erase_mean - 1.0;
+    double prog_rise = last->program_mean / first->program_mean - 1.0;
+    for (unsigned i = 1; i < ref.n; ++i)
+        CHECK(ref.rows[i].erase_mean > ref.rows[i - 1].erase_mean &&
+                  ref.rows[i].program_mean >= ref.rows[i - 1].program_mean,
+              "window %u did not slow down", i);
+    // Model: (cycle 575 - 25) x drift / 1000 = 27.5 % and 13.8 %; poll
+    // rounding takes a little off, so ask for 80 % of that
+    CHECK(erase_rise > 0.22, "erase drift %.1f %% too small", erase_rise * 100.0);
+    CHECK(prog_rise > 0.11, "program drift %.1f %% too small", prog_rise * 100.0);
+    CHECK(ref_end.first_fail_cycle > CHECK_RATED,
+          "verify failed at cycle %lu, before the rated %u", (unsigned long)ref_end.first_fail_cycle,
+          CHECK_RATED);
+    CHECK(ref_end.verify_fail_total > 0, "no verify failures past the rated cycles");
+
+    printf("🧪 endurance_check: %u windows, erase +%.1f %%, program +%.1f %%, "
+           "%lu verify fails from cycle %lu (rated %u), %llu bits dropped after resume\n",
+           ref.n, erase_rise * 100.0, prog_rise * 100.0, (unsigned long)ref_end.verify_fail_total,
+           (unsigned long)ref_end.first_fail_cycle, CHECK_RATED, (unsigned long long)ns.bits_dropped);
+    if (s_failures)
+    {
+        printf("❌ endurance_check: %d failed\n", s_failures);
+        return 1;
+    }
+    printf("✅ endurance_check passed (resumed at cycle %u)\n", CHECK_STOP_WINDOWS * CHECK_WINDOW);
+    return 0;
+}
@@ -0,0 +1,153 @@
+/*
+ * FatFs file API on plain host files
+ * For tools that run firmware modules (report.c, chip_db.c, csv_reader.c,
+ * results_archive.c) against ordinary paths instead of a disk image: links
+ * in place of ff.c.
+ * Paths are passed through unchanged. Only the calls those modules make are
+ * provided. The FILE* lives in obj.fs, which nothing outside ff.c reads;
+ * fptr and obj.objsize are kept current for f_tell()/f_size().
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "ff.h"
+#include "sd_card.h"
+#include <errno.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FP(f) ((FILE *)(void *)(f)->obj.fs)
+
+static FRESULT from_errno(void)
+{
+    switch (errno)
+    {
+    case ENOENT: return FR_NO_FILE;
+    case ENOTDIR: return FR_NO_PATH;
+    case EACCES:
+    case EPERM: return FR_DENIED;
+    case EEXIST: return FR_EXIST;
+    case EROFS: return FR_WRITE_PROTECTED;
+    default: return FR_DISK_ERR;
+    }
+}
+
+FRESULT f_open(FIL *fp, const TCHAR *path, BYTE mode)
+{
+    const char *m;
+    if (!(mode & FA_WRITE))
+        m = "rb";
+    else if (mode & FA_CREATE_ALWAYS)
+        m = (mode & FA_READ) ? "w+b" : "wb";
+    else if (mode & (FA_OPEN_ALWAYS | FA_OPEN_APPEND | FA_CREATE_NEW))
+    {
+        if ((mode & FA_CREATE_NEW) && access(path, F_OK) == 0)
+            return FR_EXIST;
+        FILE *t = fopen(path, "ab"); // create without truncating
+        if (!t)
+            return from_errno();
+        fclose(t);
+        m = "r+b";
+    }
+    else
+        m = "r+b";
+
+    FILE *f = fopen(path, m);
+    if (!f)
+        return from_errno();
+    fp->obj.fs = (FATFS *)(void *)f;
+    fp->flag = mode;
+    fp->err = 0;
+    fp->fptr = 0;
+    fseek(f, 0, SEEK_END);
+    fp->obj.objsize = (FSIZE_t)ftell(f);
+    if ((mode & FA_OPEN_APPEND) == FA_OPEN_APPEND) // shares the FA_OPEN_ALWAYS bit
+        fp->fptr = fp->obj.objsize;
+    fseek(f, (long)fp->fptr, SEEK_SET);
+    return FR_OK;
+}
+
+FRESULT f_close(FIL *fp)
+{
+    if (!fp->obj.fs)
+        return FR_INVALID_OBJECT;
+    int rc = fclose(FP(fp));
+    fp->obj.fs = NULL;
+    return rc ? FR_DISK_ERR : FR_OK;
+}
+
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br)
+{
+    *br = 0;
+    if (!fp->obj.fs)
+        return FR_INVALID_OBJECT;
+    size_t n = fread(buff, 1, btr, FP(fp));
+    *br = (UINT)n;
+    fp->fptr += (FSIZE_t)n;
+    return (n < btr && ferror(FP(fp))) ? FR_DISK_ERR : FR_OK;
+}
+
+FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw)
+{
+    *bw = 0;
+    if (!fp->obj.fs)
+        return FR_INVALID_OBJECT;
+    if (!(fp->flag & FA_WRITE))
+        return FR_DENIED;
+    size_t n = fwrite(buff, 1, btw, FP(fp));
+    *bw = (UINT)n;
+    fp->fptr += (FSIZE_t)n;
+    if (fp->fptr > fp->obj.objsize)
+        fp->obj.objsize = fp->fptr;
+    return (n < btw) ? FR_DISK_ERR : FR_OK;
+}
+
+FRESULT f_sync(FIL *fp)
+{
+    if (!fp->obj.fs)
+        return FR_INVALID_OBJECT;
+    return fflush(FP(fp)) ? FR_DISK_ERR : FR_OK;
+}
+
+FRESULT f_lseek(FIL *fp, FSIZE_t ofs)
+{
+    if (!fp->obj.fs)
+        return FR_INVALID_OBJECT;
+    if (!(fp->flag & FA_WRITE) && ofs > fp->obj.objsize)
+        ofs = fp->obj.objsize; // FatFs clips read-only seeks to the file size
+    if (fseek(FP(fp), (long)ofs, SEEK_SET) != 0)
+        return FR_DISK_ERR;
+    fp->fptr = ofs;
+    if (ofs > fp->obj.objsize)
+        fp->obj.objsize = ofs;
+    return FR_OK;
+}
+
+FRESULT f_unlink(const TCHAR *path)
+{
+    return unlink(path) ? from_errno() : FR_OK;
+}
+
+FRESULT f_stat(const TCHAR *path, FILINFO *fno)
+{
+    struct stat sb;
+    if (stat(path, &sb) != 0)
+        return from_errno();
+    if (!fno)
+        return FR_OK;
+    struct tm tm;
+    localtime_r(&sb.st_mtime, &tm);
+    fno->fsize = (FSIZE_t)sb.st_size;
+    fno->fdate = (WORD)(((tm.tm_year - 80) << 9) | ((tm.tm_mon + 1) << 5) | tm.tm_mday);
+    fno->ftime = (WORD)((tm.tm_hour << 11) | (tm.tm_min << 5) | (tm.tm_sec / 2));
+    fno->fattrib = S_ISDIR(sb.st_mode) ? AM_DIR : 0;
+    fno->fname[0] = 0;
+    return FR_OK;
+}
+
+// chip_db.c only opens the database while the card is mounted; plain files
+// are always available.
+bool sd_is_mounted(void)
+{
+    return true;
+}
@@ -0,0 +1,448 @@
+// fleet_report.c — report.c over many RESULTS.CSV files, in parallel.
+//   ./fleet_report [options] PATH...
+// Each PATH is a RESULTS file or a directory searched recursively for
+// RESULTS*.CSV (any case). One pass per file lists the chips in it, one per
+// (JEDEC, "_d<N>" slot). Then every (file, chip) pair gets its own report.csv
+// from report_generate_ex().
+// Work is spread over a pthread pool and report.c keeps its state thread-local.
+// A fleet summary goes to OUT/fleet_summary.csv.
+// --archive keeps a RESULTS.RCA next to each log (adds p99 rows to the
+// reports); --query EXPR only aggregates the archives, skipping the reports.
+// Files are opened through ff_posix.c, so the firmware modules run unchanged.
+#define _GNU_SOURCE
+#include "report.h"
+#include "chip_db.h"
+#include "csv_reader.h"
+#include "results_archive.h"
+
+#include <ctype.h>
+#include <ftw.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_CHIPS_PER_FILE 16
+#define SUMMARY_NAME "fleet_summary.csv"
+
+typedef struct
+{
+    char path[512];
+    char fixture[160];  // path flattened into a file-name prefix
+    unsigned long rows; // lines seen by the chip scan
+    int n_chips;
+    char jedec[MAX_CHIPS_PER_FILE][16]; // as first written in the log
+    char dev_tag[MAX_CHIPS_PER_FILE][4]; // "_d1" from the notes, "" if untagged
+    float sck_MHz[MAX_CHIPS_PER_FILE];  // from "@<n>MHz" notes, 0 if none
+    char archive[520];  // RESULTS.RCA beside it (--archive / --query)
+    ra_result_t *q;     // --query result
+} input_t;
+
+typedef struct
+{
+    const input_t *in;
+    int chip;
+    char report[700];
+    char state[700];
+    report_summary_t sum;
+    double secs;
+} device_t;
+
+static struct
+{
+    const char *datasheet;
+    const char *out_dir;
+    float sck_MHz; // overrides the notes when > 0
+    bool resume;
+    bool verbose;
+    bool archive;
+    const char *query;
+    int threads;
+} g_opt = {"datasheet.csv", "fleet_out", 0.0f, false, false, false, NULL, 0};
+static ra_filter_t g_filter;
+
+static input_t *g_in;
+static int g_n_in, g_cap_in;
+static device_t *g_dev;
+static int g_n_dev;
+static atomic_int g_next;
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage(const char *argv0)
+{
+    printf("Usage: %s [options] PATH...\n"
+           "  PATH               RESULTS file, or directory searched for RESULTS*.CSV\n"
+           "  --datasheet PATH   chip database (default datasheet.csv; .cdb compiled next to it)\n"
+           "  --out DIR          per-device reports + " SUMMARY_NAME " (default fleet_out)\n"
+           "  --threads N        worker threads (default: online CPUs)\n"
+           "  --sck-mhz F        SPI clock of the read rows (default: '@<n>MHz' in notes)\n"
+           "  --resume           keep per-device checkpoints; re-runs parse appended rows only\n"
+           "  --archive          convert each log to a columnar .RCA beside it (p99 rows)\n"
+           "  --query EXPR       aggregate the archives instead of reporting, e.g.\n"
+           "                     \"jedec=C22015,op=erase,size=4096,temp>40\" (implies --archive)\n"
+           "  -v                 print each report's console lines\n",
+           argv0);
+}
+
+/* ------------------------------ inputs ----------------------------------- */
+static void add_input(const char *path)
+{
+    if (g_n_in == g_cap_in)
+    {
+        g_cap_in = g_cap_in ? 2 * g_cap_in : 64;
+        g_in = realloc(g_in, (size_t)g_cap_in * sizeof *g_in);
+        if (!g_in)
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    input_t *in = &g_in[g_n_in++];
+    memset(in, 0, sizeof *in);
+    snprintf(in->path, sizeof in->path, "%s", path);
+
+    // "cards/fx07/RESULTS.CSV" -> "cards_fx07_RESULTS"
+    const char *p = path;
+    while (p[0] == '.' && p[1] == '/')
+        p += 2;
+    size_t w = 0;
+    const char *dot = strrchr(p, '.');
+    for (; *p && p != dot && w + 1 < sizeof in->fixture; ++p)
+        in->fixture[w++] = isalnum((unsigned char)*p) || *p == '-' ? *p : '_';
+    in->fixture[w] = 0;
+
+    // "cards/fx07/RESULTS.CSV" -> "cards/fx07/RESULTS.RCA"
+    const char *ext = strrchr(path, '.');
+    int stem = (ext && !strchr(ext, '/')) ? (int)(ext - path) : (int)strlen(path);
+    snprintf(in->archive, sizeof in->archive, "%.*s.RCA", stem, path);
+}
+
+static bool is_results_name(const char *name)
+{
+    size_t n = strlen(name);
+    return !strncasecmp(name, "RESULTS", 7) && n > 4 && !strcasecmp(name + n - 4, ".csv");
+}
+
+// <dirent.h> would clash with FatFs' DIR, hence nftw() (FTW_ACTIONRETVAL is GNU)
+static int visit(const char *path, const struct stat *sb, int type, struct FTW *ftw)
+{
+    (void)sb;
+    const char *name = path + ftw->base;
+    if (type == FTW_D && name[0] == '.' && ftw->level > 0)
+        return FTW_SKIP_SUBTREE;
+    if (type == FTW_F && is_results_name(name))
+        add_input(path);
+    return FTW_CONTINUE;
+}
+
+static void scan_dir(const char *dir)
+{
+    if (nftw(dir, visit, 16, FTW_ACTIONRETVAL) != 0)
+        perror(dir);
+}
+
+static int cmp_input(const void *a, const void *b)
+{
+    return strcmp(((const input_t *)a)->path, ((const input_t *)b)->path);
+}
+
+/* ------------------------------ chip scan -------------------------------- */
+// Slot suffix flash_dev_note_suffix() ends the notes with, "" for rows logged
+// before it existed (those stay one device over all of the JEDEC's rows)
+static void note_slot(const char *notes, char tag[4])
+{
+    size_t n = strlen(notes);
+    tag[0] = 0;
+    if (n >= 3 && notes[n - 3] == '_' && notes[n - 2] == 'd' && isdigit((unsigned char)notes[n - 1]))
+        memcpy(tag, notes + n - 3, 4);
+}
+
+// Distinct (JEDEC in column 0, slot) pairs, plus the SPI clock from notes like
+// "read_bench_1_byte@9MHz_d0" (what the benches log).
+static void scan_chips(input_t *in)
+{
+    FIL f;
+    if (f_open(&f, in->path, FA_READ) != FR_OK)
+    {
+        fprintf(stderr, "cannot open %s\n", in->path);
+        return;
+    }
+    static _Thread_local csv_reader_t rd;
+    char line[512];
+    csv_reader_init(&rd, &f);
+    while (csv_read_line(&rd, line, sizeof line) >= 0)
+    {
+        in->rows++;
+        char *flds[16];
+        int nf = csv_split(line, ',', flds, 16);
+        if (nf < 6 || !strcmp(flds[0], "jedec_id"))
+            continue;
+        char j6[8];
+        chipdb_normalize_jedec(flds[0], j6);
+        if (strlen(j6) != 6)
+            continue;
+        char tag[4];
+        note_slot(nf > 11 ? flds[11] : "", tag);
+
+        int c = 0;
+        for (; c < in->n_chips; ++c)
+        {
+            char k6[8];
+            chipdb_normalize_jedec(in->jedec[c], k6);
+            if (!strcmp(k6, j6) && !strcmp(in->dev_tag[c], tag))
+                break;
+        }
+        if (c == in->n_chips)
+        {
+            if (c == MAX_CHIPS_PER_FILE)
+                continue;
+            snprintf(in->jedec[c], sizeof in->jedec[c], "%s", flds[0]);
+            memcpy(in->dev_tag[c], tag, sizeof tag);
+            in->n_chips++;
+        }
+        const char *at = (nf > 11 && !strcmp(flds[1], "read")) ? strchr(flds[11], '@') : NULL;
+        if (at && !(in->sck_MHz[c] > 0.0f))
+            in->sck_MHz[c] = strtof(at + 1, NULL);
+    }
+    f_close(&f);
+}
+
+/* ------------------------------- workers --------------------------------- */
+// Archives are brought up to date here, once per file, so the report
+// workers (several per file) only ever read them.
+static void *scan_worker(void *arg)
+{
+    (void)arg;
+    for (int i; (i = atomic_fetch_add(&g_next, 1)) < g_n_in;)
+    {
+        input_t *in = &g_in[i];
+        if (g_opt.query)
+        {
+            if (results_archive_sync(in->path, in->archive))
+                results_archive_query(in->archive, &g_filter, in->q);
+            continue;
+        }
+        scan_chips(in);
+        if (g_opt.archive && !results_archive_sync(in->path, in->archive))
+            in->archive[0] = 0;
+    }
+    return NULL;
+}
+
+static void *report_worker(void *arg)
+{
+    (void)arg;
+    for (int i; (i = atomic_fetch_add(&g_next, 1)) < g_n_dev;)
+    {
+        device_t *d = &g_dev[i];
+        report_opts_t o;
+        memset(&o, 0, sizeof o);
+        o.results = d->in->path;
+        o.datasheet = g_opt.datasheet;
+        o.report = d->report;
+        o.state = g_opt.resume ? d->state : NULL;
+        o.archive = (g_opt.archive && d->in->archive[0]) ? d->in->archive : NULL;
+        o.jedec = d->in->jedec[d->chip];
+        o.dev_tag = d->in->dev_tag[d->chip][0] ? d->in->dev_tag[d->chip] : NULL;
+        o.sck_MHz = (g_opt.sck_MHz > 0.0f) ? g_opt.sck_MHz : d->in->sck_MHz[d->chip];
+        o.quiet = !g_opt.verbose;
+        o.out = &d->sum;
+
+        double t0 = now_s();
+        report_generate_ex(&o);
+        d->secs = now_s() - t0;
+    }
+    return NULL;
+}
+
+static void run_pool(void *(*fn)(void *), int jobs)
+{
+    int n = g_opt.threads < jobs ? g_opt.threads : jobs;
+    pthread_t th[256];
+    if (n > 256)
+        n = 256;
+    atomic_store(&g_next, 0);
+    for (int t = 0; t < n; ++t)
+        pthread_create(&th[t], NULL, fn, NULL);
+    for (int t = 0; t < n; ++t)
+        pthread_join(th[t], NULL);
+}
+
+/* ------------------------------- --query --------------------------------- */
+// Archives synced and queried in pass 1; one fleet-wide answer
+static int run_query(void)
+{
+    if (!ra_filter_parse(&g_filter, g_opt.query))
+    {
+        fprintf(stderr, "bad --query '%s'\n", g_opt.query);
+        return 2;
+    }
+    for (int i = 0; i < g_n_in; ++i)
+        if (!(g_in[i].q = calloc(1, sizeof *g_in[i].q)))
+        {
+            perror("calloc");
+            return 1;
+        }
+
+    double t0 = now_s();
+    run_pool(scan_worker, g_n_in);
+    double t = now_s() - t0;
+
+    static ra_result_t all;
+    memset(&all, 0, sizeof all);
+    stream_stats_init(&all.w);
+    for (int i = 0; i < g_n_in; ++i)
+        ra_result_merge(&all, g_in[i].q);
+    char what[32];
+    snprintf(what, sizeof what, "%d archives", g_n_in);
+    printf("\n");
+    ra_result_print(what, g_opt.query, &all);
+    printf("   sync + query: %.3f s, %d threads\n", t, g_opt.threads);
+    return 0;
+}
+
+/* -------------------------------- main ----------------------------------- */
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+#define OPT(name) (!strcmp(a, name) && v && (++i, true))
+        if (OPT("--datasheet")) g_opt.datasheet = v;
+        else if (OPT("--out")) g_opt.out_dir = v;
+        else if (OPT("--threads")) g_opt.threads = atoi(v);
+        else if (OPT("--sck-mhz")) g_opt.sck_MHz = strtof(v, NULL);
+        else if (OPT("--query")) g_opt.query = v;
+        else if (!strcmp(a, "--resume")) g_opt.resume = true;
+        else if (!strcmp(a, "--archive")) g_opt.archive = true;
+        else if (!strcmp(a, "-v")) g_opt.verbose = true;
+        else if (!strcmp(a, "-h") || !strcmp(a, "--help")) { usage(argv[0]); return 0; }
+        else if (a[0] != '-')
+        {
+            struct stat sb;
+            if (stat(a, &sb) != 0)
+                perror(a);
+            else if (S_ISDIR(sb.st_mode))
+                scan_dir(a);
+            else
+                add_input(a);
+        }
+        else { usage(argv[0]); return 2; }
+#undef OPT
+    }
+    if (!g_n_in)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    if (g_opt.threads <= 0)
+        g_opt.threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (g_opt.threads <= 0)
+        g_opt.threads = 1;
+    qsort(g_in, (size_t)g_n_in, sizeof *g_in, cmp_input);
+    ra_filter_init(&g_filter);
+    if (g_opt.query)
+        return run_query();
+    mkdir(g_opt.out_dir, 0755);
+
+    // Compile datasheet.cdb once here, so workers only ever read it
+    chipdb_t db;
+    if (chipdb_open(&db, g_opt.datasheet))
+    {
+        printf("📚 %s: %lu rows\n", g_opt.datasheet, (unsigned long)chipdb_count(&db));
+        chipdb_close(&db);
+    }
+    else
+        printf("⚠️  %s unusable; reports will have no datasheet match\n", g_opt.datasheet);
+
+    // Pass 1: which chips each file holds
+    double t0 = now_s();
+    run_pool(scan_worker, g_n_in);
+    double t_scan = now_s() - t0;
+    unsigned long scan_rows = 0;
+    for (int i = 0; i < g_n_in; ++i)
+    {
+        scan_rows += g_in[i].rows;
+        g_n_dev += g_in[i].n_chips;
+    }
+
+    // Pass 2: one report per (file, chip)
+    g_dev = calloc((size_t)(g_n_dev ? g_n_dev : 1), sizeof *g_dev);
+    if (!g_dev)
+    {
+        perror("calloc");
+        return 1;
+    }
+    int k = 0;
+    for (int i = 0; i < g_n_in; ++i)
+        for (int c = 0; c < g_in[i].n_chips; ++c, ++k)
+        {
+            device_t *d = &g_dev[k];
+            char j6[8];
+            chipdb_normalize_jedec(g_in[i].jedec[c], j6);
+            d->in = &g_in[i];
+            d->chip = c;
+            const char *tag = g_in[i].dev_tag[c];
+            snprintf(d->report, sizeof d->report, "%s/%s_%s%s.report.csv", g_opt.out_dir,
+                     g_in[i].fixture, j6, tag);
+            snprintf(d->state, sizeof d->state, "%s/%s_%s%s.sta", g_opt.out_dir, g_in[i].fixture, j6, tag);
+        }
+    t0 = now_s();
+    run_pool(report_worker, g_n_dev);
+    double t_rep = now_s() - t0;
+
+    // Fleet summary, in input order
+    char path[600];
+    snprintf(path, sizeof path, "%s/%s", g_opt.out_dir, SUMMARY_NAME);
+    FILE *sf = fopen(path, "w");
+    if (!sf)
+    {
+        perror(path);
+        return 1;
+    }
+    fprintf(sf, "fixture,results,jedec_id,slot,rows_parsed,rows_matched,spi_sck_MHz,"
+                "final_guess_jedec,final_guess_model,final_guess_company,final_score,report,seconds\n");
+    unsigned long rep_rows = 0;
+    printf("\n%-32s %-10s %-4s %9s  %-10s %-24s %7s\n", "fixture", "jedec", "slot", "rows", "guess", "model",
+           "score");
+    for (int i = 0; i < g_n_dev; ++i)
+    {
+        const device_t *d = &g_dev[i];
+        const report_summary_t *s = &d->sum;
+        rep_rows += s->rows;
+        const char *slot = d->in->dev_tag[d->chip][0] ? d->in->dev_tag[d->chip] + 2 : "NA";
+        fprintf(sf, "%s,\"%s\",%s,%s,%lu,%lu,%.2f,%s,\"%s\",\"%s\",", d->in->fixture, d->in->path,
+                d->in->jedec[d->chip], slot, s->rows, s->matched,
+                (g_opt.sck_MHz > 0.0f) ? g_opt.sck_MHz : d->in->sck_MHz[d->chip],
+                s->guess_jedec, s->guess_model, s->guess_company);
+        if (s->score == s->score)
+            fprintf(sf, "%.3f", s->score);
+        else
+            fprintf(sf, "NA");
+        fprintf(sf, ",\"%s\",%.3f\n", d->report, d->secs);
+        printf("%-32.32s %-10s %-4s %9lu  %-10s %-24.24s %7.3f\n", d->in->fixture, d->in->jedec[d->chip],
+               slot, s->matched, s->guess_jedec, s->guess_model, s->score);
+    }
+    fclose(sf);
+
+    printf("\n📦 %d files, %d devices, %d threads\n", g_n_in, g_n_dev, g_opt.threads);
+    printf("   chip scan: %lu rows in %.3f s (%.0f rows/s)\n", scan_rows, t_scan,
+           t_scan > 0 ? scan_rows / t_scan : 0.0);
+    printf("   reports:   %lu rows in %.3f s (%.0f rows/s)\n", rep_rows, t_rep,
+           t_rep > 0 ? rep_rows / t_rep : 0.0);
+    printf("📄 %s\n", path);
+    return 0;
+}
@@ -0,0 +1,475 @@
+/*
+ * Host simulation driver
+ * Runs the firmware's benchmark, backup and report modules on Linux against
+ * the SPI NOR model and a FatFs disk image. Suites print the same summaries
+ * as on the board; RESULTS.CSV / report.csv land in the image (and in
+ * --export DIR if given).
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "sim.h"
+#include "spi_nor_model.h"
+#include "diskio_image.h"
+#include "mem_probe.h"
+#include "pico/stdlib.h"
+#include "fatfs/ff.h"
+#include "flash_benchmark.h"
+#include "sd_card.h"
+#include "bench_read.h"
+#include "bench_write.h"
+#include "bench_erase.h"
+#include "bench_sweep.h"
+#include "bench_endurance.h"
+#include "bench_adaptive.h"
+#include "bench_quickid.h"
+#include "report.h"
+#include "results_archive.h"
+#include "config/config.h"
+#include "web/http_server.h"
+#include "lwip_host.h"
+#include "hardware/adc.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define HOST_DEFAULT_JEDEC "EF 70 16" // W25Q32JV, first row of the sample datasheet.csv
+#define HOST_FLASH_CS0 5
+#define HOST_FLASH_CS1 13
+
+typedef struct {
+    const char *flash[2];
+    const char *jedec[2];
+    const char *sd_path;
+    uint32_t sd_mib;
+    uint32_t sd_hz;
+    const char *datasheet;
+    const char *results;
+    const char *export_dir;
+    const char *query;
+    sim_time_mode_t time_mode;
+    bool whole;
+    bool live;
+    uint16_t http_port;
+    uint32_t serve_s;
+    uint32_t link_kBps;
+    uint32_t rtt_ms;
+} host_opts_t;
+
+static void usage(const char *argv0)
+{
+    printf("Usage: %s [options] [suite ...]\n"
+           "  --flash PATH       chip 0 image (default flash0.bin)\n"
+           "  --jedec \"EF 70 16\" chip 0 identity; timing/capacity from the datasheet row\n"
+           "  --flash1 PATH      attach a second chip (spi1, CS GP13)\n"
+           "  --jedec1 ID        second chip identity (default: same as chip 0)\n"
+           "  --sd PATH          FatFs image (default sd.img; formatted on first use)\n"
+           "  --sd-mib N         size when creating the image (default 64)\n"
+           "  --sd-hz N          modelled SD bus clock (default 1000000)\n"
+           "  --datasheet PATH   copied to datasheet.csv on the image (default datasheet.csv)\n"
+           "  --results PATH     copied to RESULTS.CSV on the image before the suites run\n"
+           "  --time virtual|real  clock source (default virtual)\n"
+           "  --answer y|n       reply to prompts once stdin is exhausted (default y)\n"
+           "  --whole            include whole-chip series\n"
+           "  --adaptive PCT[:pQ]  stop each series once the CI of the mean (or of\n"
+           "                     percentile Q) is within ±PCT %% (default: fixed 100)\n"
+           "  --export DIR       copy root files from the image to DIR when done\n"
+           "  --query EXPR       filter for the archive suite, e.g. \"op=erase,size=4096\"\n"
+           "  --http-port N      web suite listen port (default 8080)\n"
+           "  --serve S          web suite: serve for S seconds (default 30)\n"
+           "  --link-kbps N      web suite: modelled Wi-Fi rate in KiB/s (default 0 = unlimited)\n"
+           "  --rtt-ms N         web suite: modelled round-trip time (default 5)\n"
+           "  --live             start the web server before the suites, so /events and\n"
+           "                     /live follow them as they run (serviced between iterations)\n"
+           "Suites: read write erase sweep sweep-prog endurance quickid backup restore report\n"
+           "        archive (bring RESULTS.RCA up to date and query it)\n"
+           "        web (web/http_server.c on host sockets; use with --time real)\n"
+           "        dev0 dev1 (select target chip), all (= read write erase report, default)\n",
+           argv0);
+}
+
+static bool parse_jedec(const char *s, uint8_t out[3])
+{
+    char hex[7];
+    size_t w = 0;
+    for (; *s && w < 6; ++s)
+        if (isxdigit((unsigned char)*s))
+            hex[w++] = *s;
+    hex[w] = 0;
+    if (w != 6)
+        return false;
+    unsigned long v = strtoul(hex, NULL, 16);
+    out[0] = (uint8_t)(v >> 16);
+    out[1] = (uint8_t)(v >> 8);
+    out[2] = (uint8_t)v;
+    return true;
+}
+
+static bool attach_chip(int idx, const host_opts_t *o)
+{
+    uint8_t id[3];
+    if (!parse_jedec(o->jedec[idx], id))
+    {
+        fprintf(stderr, "bad JEDEC id '%s'\n", o->jedec[idx]);
+        return false;
+    }
+    nor_timing_t t;
+    nor_model_default_timing(&t);
+    uint32_t cap = 1024u * 1024u;
+    if (!nor_model_timing_from_csv(o->datasheet, o->jedec[idx], &t, &cap))
+        printf("⚠️  %s not in %s; using default timing and 1 MiB\n", o->jedec[idx], o->datasheet);
+
+    printf("🧪 Chip %d: %s, %lu KiB, PP %.0f µs, 4K %.0f µs, 32K %.0f µs, 64K %.0f µs\n", idx,
+           o->jedec[idx], (unsigned long)(cap / 1024u), t.page_program_us, t.sector_erase_us,
+           t.block32_erase_us, t.block64_erase_us);
+    return nor_model_attach(idx ? 1u : 0u, idx ? HOST_FLASH_CS1 : HOST_FLASH_CS0,
+                            o->flash[idx], id, cap, &t) >= 0;
+}
+
+/* Mount the image through sd_card.c, formatting it the first time */
+static bool mount_image(void)
+{
+    if (sd_mount())
+        return true;
+
+    printf("🧪 Formatting SD image…\n");
+    static BYTE work[FF_MAX_SS * 4];
+    MKFS_PARM opt = {FM_ANY, 0, 0, 0, 0};
+    FRESULT fr = f_mkfs("", &opt, work, sizeof work);
+    if (fr != FR_OK)
+    {
+        printf("❌ f_mkfs failed (%d)\n", fr);
+        return false;
+    }
+    return sd_mount();
+}
+
+static bool import_file(const char *host_path, const char *name)
+{
+    FILE *in = fopen(host_path, "rb");
+    if (!in)
+    {
+        printf("⚠️  %s not found; %s not imported\n", host_path, name);
+        return false;
+    }
+    FIL f;
+    if (f_open(&f, name, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+    {
+        fclose(in);
+        return false;
+    }
+    char buf[4096];
+    size_t n;
+    UINT bw;
+    while ((n = fread(buf, 1, sizeof buf, in)) > 0)
+        f_write(&f, buf, (UINT)n, &bw);
+    f_close(&f);
+    fclose(in);
+    return true;
+}
+
+static void export_root(const char *dir)
+{
+    DIR d;
+    FILINFO fi;
+    if (f_opendir(&d, "") != FR_OK)
+        return;
+    (void)mkdir(dir, 0755);
+    while (f_readdir(&d, &fi) == FR_OK && fi.fname[0])
+    {
+        if (fi.fattrib & AM_DIR)
+            continue;
+        char out[512];
+        snprintf(out, sizeof out, "%s/%s", dir, fi.fname);
+        FILE *o = fopen(out, "wb");
+        FIL f;
+        if (!o || f_open(&f, fi.fname, FA_READ) != FR_OK)
+        {
+            if (o)
+                fclose(o);
+            continue;
+        }
+        char buf[4096];
+        UINT br;
+        while (f_read(&f, buf, sizeof buf, &br) == FR_OK && br)
+            fwrite(buf, 1, br, o);
+        f_close(&f);
+        fclose(o);
+        printf("   exported %s\n", out);
+    }
+    f_closedir(&d);
+}
+
+static double wall_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Adapters used by web/http_server.c (main.c has the board versions)
+float http_get_temperature(void)
+{
+    adc_select_input(ADC_TEMP_CHANNEL);
+    float v = adc_read() * ADC_CONVERSION_FACTOR;
+    return 27.0f - (v - 0.706f) / 0.001721f;
+}
+
+float http_get_voltage(void)
+{
+    adc_select_input(3); // VSYS/3 on GPIO29
+    return adc_read() * ADC_CONVERSION_FACTOR * ADC_VOLTAGE_DIVIDER;
+}
+
+bool http_get_sd_mounted(void)
+{
+    return sd_is_mounted();
+}
+
+int http_get_file_list(sd_file_info_t *files, int max_files)
+{
+    return sd_get_file_list(files, max_files);
+}
+
+static sd_file_info_t web_files[MAX_FILES_TO_LIST];
+static int web_file_count;
+static bool web_needs_refresh;
+
+// Start the server the way main.c's web_start() does; lwip_host_poll()
+// stands in for cyw43_arch_poll()
+static bool start_web(const host_opts_t *o)
+{
+    static bool started;
+
+    web_file_count = sd_get_file_list(web_files, MAX_FILES_TO_LIST);
+    web_needs_refresh = false;
+    if (!started)
+    {
+        lwip_host_config(o->http_port, o->link_kBps, o->rtt_ms);
+        http_server_set_file_list(web_files, &web_file_count, &web_needs_refresh);
+        if (!http_server_init())
+            return false;
+        started = true;
+    }
+    return true;
+}
+
+// Serve the image's files the way main.c's web mode does
+static bool run_web(const host_opts_t *o)
+{
+    if (!start_web(o))
+        return false;
+    if (sim_clock_mode() != SIM_TIME_REAL)
+        printf("⚠️  web: virtual time; transfer times in the log are not wall time\n");
+    printf("🌐 Serving %d files on port %u for %u s\n", web_file_count, o->http_port, o->serve_s);
+    double end = wall_s() + o->serve_s;
+    while (wall_s() < end)
+        lwip_host_poll(50);
+    lwip_host_print_stats();
+    return true;
+}
+
+static bool run_suite(const char *s, const host_opts_t *o)
+{
+    if (!strcmp(s, "read"))
+    {
+        bench_read_run_100(o->whole);
+        if (bench_read_has_data())
+            bench_read_print_summary();
+    }
+    else if (!strcmp(s, "write"))
+    {
+        bench_write_run_100(o->whole, "incremental");
+        if (bench_write_has_data())
+            bench_write_print_summary();
+    }
+    else if (!strcmp(s, "erase"))
+    {
+        bench_erase_run_100(o->whole);
+        if (bench_erase_has_data())
+            bench_erase_print_summary();
+    }
+    else if (!strcmp(s, "sweep") || !strcmp(s, "sweep-prog"))
+    {
+        bench_sweep_run(!strcmp(s, "sweep-prog"));
+        if (bench_sweep_has_data())
+            bench_sweep_print_summary();
+    }
+    else if (!strcmp(s, "endurance"))
+    {
+        bench_endurance_run();
+        if (bench_endurance_has_data())
+            bench_endurance_print_summary();
+    }
+    else if (!strcmp(s, "quickid"))
+    {
+        return bench_quickid_run(NULL);
+    }
+    else if (!strcmp(s, "backup"))
+    {
+        if (flash_dev_present_count() > 1)
+            return sd_backup_flash_all("SPI_Backup");
+        char name[32];
+        sd_backup_name(flash_dev_current(), name, sizeof name);
+        return sd_backup_flash_safe("SPI_Backup", name);
+    }
+    else if (!strcmp(s, "restore"))
+    {
+        // Mirror "backup": every present chip from its own file
+        bool ok = true;
+        for (int i = 0; i < flash_dev_count(); ++i)
+            if (flash_dev_present(i))
+                ok = sd_restore_flash_dev("SPI_Backup", i) && ok;
+        return ok;
+    }
+    else if (!strcmp(s, "report"))
+    {
+        mem_probe_t m;
+        if (mem_probe_run(report_generate_csv, &m))
+            printf("🧪 report peak RAM: %zu B stack, %zu B heap\n", m.stack_bytes, m.heap_peak);
+        else
+            report_generate_csv();
+    }
+    else if (!strcmp(s, "archive"))
+    {
+        double w0 = wall_s();
+        if (!results_archive_sync("RESULTS.CSV", RESULTS_ARCHIVE_FILENAME))
+            return false;
+        double w1 = wall_s();
+        bool ok = results_archive_print_query(RESULTS_ARCHIVE_FILENAME, o->query ? o->query : "");
+        printf("🧪 archive: sync %.3f s, query %.3f s wall\n", w1 - w0, wall_s() - w1);
+        return ok;
+    }
+    else if (!strcmp(s, "web"))
+    {
+        return run_web(o);
+    }
+    else if (!strncmp(s, "dev", 3) && isdigit((unsigned char)s[3]))
+    {
+        int idx = atoi(s + 3);
+        if (!flash_dev_select(idx))
+        {
+            printf("❌ Flash %d is not present\n", idx);
+            return false;
+        }
+        printf("✅ Target is now flash %d\n", idx);
+    }
+    else
+    {
+        printf("❓ Unknown suite: %s\n", s);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    host_opts_t o = {
+        .flash = {"flash0.bin", NULL},
+        .jedec = {HOST_DEFAULT_JEDEC, NULL},
+        .sd_path = "sd.img",
+        .sd_mib = 64,
+        .sd_hz = 1000000,
+        .datasheet = "datasheet.csv",
+        .time_mode = SIM_TIME_VIRTUAL,
+        .http_port = 8080,
+        .serve_s = 30,
+        .rtt_ms = 5,
+    };
+    static const char *const k_all[] = {"read", "write", "erase", "report"};
+    const char *suites[32];
+    int n_suites = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+#define OPT(name) (!strcmp(a, name) && v && (++i, true))
+        if (OPT("--flash")) o.flash[0] = v;
+        else if (OPT("--jedec")) o.jedec[0] = v;
+        else if (OPT("--flash1")) o.flash[1] = v;
+        else if (OPT("--jedec1")) o.jedec[1] = v;
+        else if (OPT("--sd")) o.sd_path = v;
+        else if (OPT("--sd-mib")) o.sd_mib = (uint32_t)atoi(v);
+        else if (OPT("--sd-hz")) o.sd_hz = (uint32_t)atoi(v);
+        else if (OPT("--datasheet")) o.datasheet = v;
+        else if (OPT("--results")) o.results = v;
+        else if (OPT("--export")) o.export_dir = v;
+        else if (OPT("--query")) o.query = v;
+        else if (OPT("--http-port")) o.http_port = (uint16_t)atoi(v);
+        else if (OPT("--serve")) o.serve_s = (uint32_t)atoi(v);
+        else if (OPT("--link-kbps")) o.link_kBps = (uint32_t)atoi(v);
+        else if (OPT("--rtt-ms")) o.rtt_ms = (uint32_t)atoi(v);
+        else if (OPT("--time")) o.time_mode = !strcmp(v, "real") ? SIM_TIME_REAL : SIM_TIME_VIRTUAL;
+        else if (OPT("--answer")) sim_stdin_set_default(tolower((unsigned char)v[0]));
+        else if (OPT("--adaptive"))
+        {
+            if (!bench_adapt_parse(v)) { usage(argv[0]); return 2; }
+        }
+        else if (!strcmp(a, "--whole")) o.whole = true;
+        else if (!strcmp(a, "--live")) o.live = true;
+        else if (!strcmp(a, "-h") || !strcmp(a, "--help")) { usage(argv[0]); return 0; }
+        else if (!strcmp(a, "all"))
+            for (size_t k = 0; k < sizeof k_all / sizeof k_all[0] && n_suites < 32; ++k)
+                suites[n_suites++] = k_all[k];
+        else if (a[0] != '-' && n_suites < 32) suites[n_suites++] = a;
+        else { usage(argv[0]); return 2; }
+#undef OPT
+    }
+    if (!o.jedec[1])
+        o.jedec[1] = o.jedec[0];
+
+    stdio_init_all();
+    sim_clock_init(o.time_mode);
+    diskio_image_set_timing(o.sd_hz, 50, 300);
+
+    if (!attach_chip(0, &o) || (o.flash[1] && !attach_chip(1, &o)))
+        return 1;
+    if (!diskio_image_open(o.sd_path, o.sd_mib) || !mount_image())
+        return 1;
+    import_file(o.datasheet, "datasheet.csv");
+    if (o.results)
+        import_file(o.results, "RESULTS.CSV");
+
+    if (!flash_benchmark_init())
+        return 1;
+
+    if (o.live)
+    {
+        if (!start_web(&o))
+            return 1;
+        printf("📡 Live: http://localhost:%u/live follows the suites\n", o.http_port);
+    }
+
+    if (n_suites == 0)
+        for (size_t k = 0; k < sizeof k_all / sizeof k_all[0]; ++k)
+            suites[n_suites++] = k_all[k];
+
+    int failures = 0;
+    for (int k = 0; k < n_suites; ++k)
+    {
+        uint64_t t0 = sim_now_us();
+        double w0 = wall_s();
+        printf("\n🧪 ===== suite: %s =====\n", suites[k]);
+        failures += run_suite(suites[k], &o) ? 0 : 1;
+        (void)results_archive_flush(); // as main.c does on return to the menu
+        printf("🧪 suite %s: %.3f s %s time, %.3f s wall\n", suites[k],
+               (sim_now_us() - t0) / 1e6, o.time_mode == SIM_TIME_REAL ? "real" : "simulated",
+               wall_s() - w0);
+    }
+
+    printf("\n");
+    nor_model_print_stats();
+    diskio_image_print_stats();
+    printf("🧪 total %s time %.3f s\n", o.time_mode == SIM_TIME_REAL ? "real" : "simulated",
+           sim_now_us() / 1e6);
+
+    if (o.export_dir)
+        export_root(o.export_dir);
+
+    sd_unmount();
+    diskio_image_close();
+    nor_model_detach_all();
+    return failures ? 1 : 0;
+}
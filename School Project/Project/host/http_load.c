@@ -0,0 +1,488 @@
+// http_load.c — concurrent download load test for web/http_server.c.
+//   ./http_load [options] PATH
+// N client threads each fetch PATH (e.g. "/file?name=RESULTS.CSV") R times
+// over fresh connections, or one persistent connection each with
+// --keep-alive, optionally checking the body against a local copy.
+// A further thread can load the dashboard page every few ms meanwhile.
+// With --gzip it asks for compressed bodies, undoes the chunked framing and
+// (when built with zlib) inflates them for --verify.
+// Prints per-client throughput, Jain's fairness index over the clients
+// (1.0 = equal shares), 503 refusals, errors, download time, compression
+// ratio and dashboard latency.
+// Point it at `flashsim --time real web` or at the board itself.
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef HTTP_LOAD_ZLIB
+#include <zlib.h>
+#endif
+
+#define MAX_CLIENTS 64
+#define MAX_PAGE_SAMPLES 4096
+
+typedef struct
+{
+    int id;
+    unsigned long long bytes; // body bytes of completed 200 responses (decoded)
+    unsigned long long wire;  // ...as sent, before inflating
+    double busy_s;            // time spent in those responses
+    int ok, refused, errors, mismatched;
+    int conns;                // connections opened
+} client_t;
+
+static struct
+{
+    const char *host;
+    int port;
+    const char *path;
+    int clients;
+    int requests;
+    int dashboard_ms;
+    bool keep_alive;
+    bool gzip;
+    const uint8_t *expect; // --verify file contents
+    size_t expect_len;
+} g = {"127.0.0.1", 8080, NULL, 4, 1, 0, false, false, NULL, 0};
+
+static atomic_bool s_downloads_done;
+static double s_page_ms[MAX_PAGE_SAMPLES];
+static int s_page_n, s_page_errors, s_page_conns;
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage(const char *argv0)
+{
+    printf("Usage: %s [options] PATH\n"
+           "  --host H          server address (default 127.0.0.1)\n"
+           "  --port N          server port (default 8080)\n"
+           "  --clients N       concurrent downloads (default 4, max %d)\n"
+           "  --requests R      downloads per client (default 1)\n"
+           "  --verify FILE     compare every body with this file\n"
+           "  --dashboard MS    also load \"/\" every MS ms while downloads run\n"
+           "  --keep-alive      reuse one connection per client (HTTP/1.1 persistent)\n"
+           "  --gzip            send Accept-Encoding: gzip (--verify needs a zlib build)\n"
+           "PATH is the request target, e.g. \"/file?name=RESULTS.CSV\"\n",
+           argv0, MAX_CLIENTS);
+}
+
+static int connect_to(void)
+{
+    struct addrinfo hints = {0}, *ai = NULL;
+    char port[16];
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(port, sizeof port, "%d", g.port);
+    if (getaddrinfo(g.host, port, &hints, &ai) != 0)
+        return -1;
+    int fd = socket(ai->ai_family, ai->ai_socktype, 0);
+    if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) != 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(ai);
+    return fd;
+}
+
+// A response body on its way in: chunked framing removed, gzip inflated,
+// compared with --verify's file
+enum { CH_SIZE, CH_DATA, CH_DATA_END, CH_TRAILER, CH_DONE };
+typedef struct
+{
+    bool chunked, gzip, verify, same, broken;
+    int state, line_len;
+    unsigned long long chunk_left;
+    unsigned long long wire, got; // bytes of body as sent; decoded
+#ifdef HTTP_LOAD_ZLIB
+    z_stream zs;
+    bool zs_open, zs_end;
+#endif
+} body_t;
+
+static void body_compare(body_t *b, const uint8_t *p, size_t n)
+{
+    if (b->verify && g.expect)
+        b->same = b->same && b->got + n <= g.expect_len && !memcmp(g.expect + b->got, p, n);
+    b->got += n;
+}
+
+// Payload bytes (framing removed)
+static void body_data(body_t *b, const uint8_t *p, size_t n)
+{
+    b->wire += n;
+    if (!b->gzip)
+    {
+        body_compare(b, p, n);
+        return;
+    }
+#ifdef HTTP_LOAD_ZLIB
+    if (!b->zs_open)
+    {
+        memset(&b->zs, 0, sizeof b->zs);
+        b->zs_open = inflateInit2(&b->zs, 16 + MAX_WBITS) == Z_OK;
+        b->broken |= !b->zs_open;
+    }
+    uint8_t out[16384];
+    b->zs.next_in = (Bytef *)p;
+    b->zs.avail_in = (uInt)n;
+    while (b->zs_open && !b->zs_end && !b->broken && (b->zs.avail_in || b->zs.avail_out == 0))
+    {
+        b->zs.next_out = out;
+        b->zs.avail_out = sizeof out;
+        int rc = inflate(&b->zs, Z_NO_FLUSH);
+        body_compare(b, out, sizeof out - b->zs.avail_out);
+        if (rc == Z_STREAM_END)
+            b->zs_end = true;
+        else if (rc != Z_OK && rc != Z_BUF_ERROR)
+            b->broken = true;
+        else if (rc == Z_BUF_ERROR)
+            break;
+    }
+#else
+    b->got += n; // counted as sent; cannot be checked
+#endif
+}
+
+// Bytes off the socket after the head
+static void body_feed(body_t *b, const uint8_t *p, size_t n)
+{
+    if (!b->chunked)
+    {
+        body_data(b, p, n);
+        return;
+    }
+    while (n && b->state != CH_DONE && !b->broken)
+    {
+        if (b->state == CH_DATA)
+        {
+            size_t take = n < b->chunk_left ? n : (size_t)b->chunk_left;
+            body_data(b, p, take);
+            p += take;
+            n -= take;
+            if ((b->chunk_left -= take) == 0)
+                b->state = CH_DATA_END;
+            continue;
+        }
+        char c = (char)*p++;
+        n--;
+        if (b->state == CH_SIZE)
+        {
+            if (c == '\n')
+                b->state = b->chunk_left ? CH_DATA : CH_TRAILER;
+            else if (c >= '0' && c <= '9')
+                b->chunk_left = b->chunk_left * 16 + (unsigned)(c - '0');
+            else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+                b->chunk_left = b->chunk_left * 16 + (unsigned)((c | 0x20) - 'a' + 10);
+            else if (c != '\r')
+                b->broken = true;
+        }
+        else if (b->state == CH_DATA_END)
+        {
+            if (c == '\n')
+                b->state = CH_SIZE;
+            else if (c != '\r')
+                b->broken = true;
+        }
+        else if (c == '\n') // CH_TRAILER: ends at an empty line
+        {
+            if (b->line_len == 0)
+                b->state = CH_DONE;
+            b->line_len = 0;
+        }
+        else if (c != '\r')
+            b->line_len++;
+    }
+}
+
+// One request. *fd is the connection to reuse (-1 = open one); it is left
+// open for the next request when --keep-alive is on and the server agreed.
+// Returns the HTTP status (0 on a transport error or short body, -1 on a
+// --verify mismatch); *body gets the decoded body length and *wire what
+// came over the connection for it. *opened counts new connections.
+static int fetch(const char *path, unsigned long long *body, unsigned long long *wire, bool verify, int *fd,
+                 int *opened)
+{
+    bool reused = *fd >= 0;
+    if (!reused)
+    {
+        *fd = connect_to();
+        if (*fd < 0)
+            return 0;
+        ++*opened;
+    }
+    char req[512];
+    int n = snprintf(req, sizeof req, "GET %s HTTP/1.1\r\nHost: %s\r\n%s%s\r\n", path, g.host,
+                     g.gzip ? "Accept-Encoding: gzip\r\n" : "", g.keep_alive ? "" : "Connection: close\r\n");
+    if (send(*fd, req, (size_t)n, MSG_NOSIGNAL) != n)
+    {
+        close(*fd);
+        *fd = -1;
+        return reused ? fetch(path, body, wire, verify, fd, opened) : 0;
+    }
+
+    char head[2048];
+    size_t head_len = 0;
+    long long content_length = -1;
+    int status = 0;
+    body_t b = {.verify = verify, .same = true};
+    bool in_body = false, server_close = true;
+    char buf[16384];
+    for (;;)
+    {
+        ssize_t r = recv(*fd, buf, sizeof buf, 0);
+        if (r <= 0)
+        {
+            if (r < 0)
+                status = 0;
+            break;
+        }
+        size_t off = 0;
+        if (!in_body)
+        {
+            size_t take = (size_t)r < sizeof head - 1 - head_len ? (size_t)r : sizeof head - 1 - head_len;
+            memcpy(head + head_len, buf, take);
+            head_len += take;
+            head[head_len] = 0;
+            char *eoh = strstr(head, "\r\n\r\n");
+            if (!eoh)
+                continue;
+            in_body = true;
+            sscanf(head, "HTTP/%*s %d", &status);
+            char *cl = strcasestr(head, "\r\nContent-Length:");
+            if (cl)
+                content_length = atoll(cl + 17);
+            char *te = strcasestr(head, "\r\nTransfer-Encoding:");
+            b.chunked = te && strncasecmp(te + 20 + strspn(te + 20, " "), "chunked", 7) == 0;
+            char *ce = strcasestr(head, "\r\nContent-Encoding:");
+            b.gzip = ce && strncasecmp(ce + 19 + strspn(ce + 19, " "), "gzip", 4) == 0;
+            char *conn = strcasestr(head, "\r\nConnection:");
+            server_close = !conn || !strncasecmp(conn + 13 + strspn(conn + 13, " "), "close", 5) ||
+                           strncmp(head, "HTTP/1.1", 8) != 0;
+            off = (size_t)(eoh + 4 - head) - (head_len - take);
+        }
+        body_feed(&b, (const uint8_t *)buf + off, (size_t)r - off);
+        if (b.chunked ? b.state == CH_DONE || b.broken
+                      : content_length >= 0 && b.wire >= (unsigned long long)content_length)
+            break; // the body is complete whether or not the server closes
+    }
+#ifdef HTTP_LOAD_ZLIB
+    if (b.zs_open)
+        inflateEnd(&b.zs);
+    bool inflated = !b.gzip || b.zs_end;
+#else
+    bool inflated = true;
+#endif
+    if (reused && !in_body && head_len == 0)
+    {
+        // The server closed the idle connection first: try a fresh one
+        close(*fd);
+        *fd = -1;
+        return fetch(path, body, wire, verify, fd, opened);
+    }
+    bool complete = !b.broken && (b.chunked ? b.state == CH_DONE
+                                            : content_length < 0 || b.wire == (unsigned long long)content_length);
+    if (!g.keep_alive || server_close || !in_body || !complete)
+    {
+        close(*fd);
+        *fd = -1;
+    }
+    *body = b.got;
+    *wire = b.wire;
+    if (status == 200 && (!complete || !inflated))
+        return 0; // short body: the transfer broke
+#ifndef HTTP_LOAD_ZLIB
+    if (b.gzip)
+        return status; // nothing to compare
+#endif
+    if (status == 200 && verify && g.expect && (!b.same || b.got != g.expect_len))
+        return -1;
+    return status;
+}
+
+static void *client_main(void *arg)
+{
+    client_t *c = arg;
+    int fd = -1;
+    for (int r = 0; r < g.requests; ++r)
+    {
+        unsigned long long body = 0, wire = 0;
+        double t0 = now_s();
+        int st = fetch(g.path, &body, &wire, true, &fd, &c->conns);
+        if (st == 200)
+        {
+            c->ok++;
+            c->bytes += body;
+            c->wire += wire;
+            c->busy_s += now_s() - t0;
+        }
+        else if (st == 503)
+        {
+            c->refused++;
+            usleep(200000); // Retry-After would say 1 s; come back sooner
+            r--;
+        }
+        else if (st < 0)
+            c->mismatched++;
+        else
+            c->errors++;
+        if (c->errors + c->mismatched > 10)
+            break;
+    }
+    if (fd >= 0)
+        close(fd);
+    return NULL;
+}
+
+static void *dashboard_main(void *arg)
+{
+    (void)arg;
+    int fd = -1;
+    while (!atomic_load(&s_downloads_done))
+    {
+        unsigned long long body = 0, wire = 0;
+        double t0 = now_s();
+        int st = fetch("/", &body, &wire, false, &fd, &s_page_conns);
+        if (st == 200 && s_page_n < MAX_PAGE_SAMPLES)
+            s_page_ms[s_page_n++] = (now_s() - t0) * 1e3;
+        else if (st != 200 && st != 503)
+            s_page_errors++;
+        usleep((useconds_t)g.dashboard_ms * 1000u);
+    }
+    if (fd >= 0)
+        close(fd);
+    return NULL;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static bool load_file(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        perror(path);
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *p = malloc(n > 0 ? (size_t)n : 1);
+    if (!p || fread(p, 1, (size_t)n, f) != (size_t)n)
+    {
+        fclose(f);
+        free(p);
+        return false;
+    }
+    fclose(f);
+    g.expect = p;
+    g.expect_len = (size_t)n;
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+#define OPT(name) (!strcmp(a, name) && v && (++i, true))
+        if (OPT("--host")) g.host = v;
+        else if (OPT("--port")) g.port = atoi(v);
+        else if (OPT("--clients")) g.clients = atoi(v);
+        else if (OPT("--requests")) g.requests = atoi(v);
+        else if (OPT("--dashboard")) g.dashboard_ms = atoi(v);
+        else if (OPT("--verify")) { if (!load_file(v)) return 1; }
+        else if (!strcmp(a, "--keep-alive")) g.keep_alive = true;
+        else if (!strcmp(a, "--gzip")) g.gzip = true;
+        else if (!strcmp(a, "-h") || !strcmp(a, "--help")) { usage(argv[0]); return 0; }
+        else if (a[0] != '-' && !g.path) g.path = a;
+        else { usage(argv[0]); return 2; }
+#undef OPT
+    }
+    if (!g.path || g.clients < 1 || g.clients > MAX_CLIENTS || g.requests < 1)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    static client_t c[MAX_CLIENTS];
+    pthread_t th[MAX_CLIENTS], dash;
+    double t0 = now_s();
+    if (g.dashboard_ms > 0)
+        pthread_create(&dash, NULL, dashboard_main, NULL);
+    for (int i = 0; i < g.clients; ++i)
+    {
+        c[i].id = i;
+        pthread_create(&th[i], NULL, client_main, &c[i]);
+    }
+    for (int i = 0; i < g.clients; ++i)
+        pthread_join(th[i], NULL);
+    double wall = now_s() - t0;
+    atomic_store(&s_downloads_done, true);
+    if (g.dashboard_ms > 0)
+        pthread_join(dash, NULL);
+
+    unsigned long long total = 0, wire = 0;
+    double sum = 0, sum2 = 0, lo = 1e30, hi = 0, busy = 0;
+    int ok = 0, refused = 0, errors = 0, mismatched = 0, rated = 0, conns = 0;
+    printf("client  ok  503  err   MB      KB/s\n");
+    for (int i = 0; i < g.clients; ++i)
+    {
+        double kBps = c[i].busy_s > 0 ? c[i].bytes / 1024.0 / c[i].busy_s : 0;
+        printf("%6d %3d %4d %4d %6.2f %9.1f\n", i, c[i].ok, c[i].refused, c[i].errors + c[i].mismatched,
+               c[i].bytes / 1e6, kBps);
+        total += c[i].bytes;
+        wire += c[i].wire;
+        busy += c[i].busy_s;
+        ok += c[i].ok;
+        refused += c[i].refused;
+        errors += c[i].errors;
+        mismatched += c[i].mismatched;
+        conns += c[i].conns;
+        if (c[i].ok)
+        {
+            sum += kBps;
+            sum2 += kBps * kBps;
+            lo = kBps < lo ? kBps : lo;
+            hi = kBps > hi ? kBps : hi;
+            rated++;
+        }
+    }
+    printf("%d clients x %d requests: %d ok, %d refused (503), %d errors, %d body mismatches, %d connections\n",
+           g.clients, g.requests, ok, refused, errors, mismatched, conns);
+    printf("aggregate %.1f KB/s over %.2f s; per client %.1f..%.1f KB/s, Jain fairness %.3f\n",
+           total / 1024.0 / wall, wall, rated ? lo : 0, hi, sum2 > 0 ? sum * sum / (rated * sum2) : 0);
+    if (ok)
+        printf("download time: mean %.1f ms; %.2f MB decoded from %.2f MB sent (%.1f:1)\n", busy * 1e3 / ok,
+               total / 1e6, wire / 1e6, wire ? (double)total / wire : 0);
+    if (g.dashboard_ms > 0)
+    {
+        qsort(s_page_ms, (size_t)s_page_n, sizeof s_page_ms[0], cmp_double);
+        if (s_page_n)
+            printf("dashboard: %d loads over %d connections, p50 %.1f ms, p90 %.1f ms, max %.1f ms, %d errors\n",
+                   s_page_n, s_page_conns, s_page_ms[s_page_n / 2], s_page_ms[s_page_n * 9 / 10],
+                   s_page_ms[s_page_n - 1], s_page_errors);
+        else
+            printf("dashboard: no successful loads, %d errors\n", s_page_errors);
+    }
+    return (errors || mismatched) ? 1 : 0;
+}
@@ -0,0 +1,714 @@
+/*
+ * lwIP raw TCP API on host sockets
+ * One non-blocking socket per pcb, serviced from lwip_host_poll() the way
+ * lwIP's NO_SYS loop services a netif. Send data is queued per pcb up to
+ * TCP_SND_BUF and TCP_SND_QUEUELEN segments. Copied writes are charged in
+ * full to a MEM_SIZE heap shared by every pcb, as PBUF_RAM segments are on
+ * the device. Writes without TCP_WRITE_FLAG_COPY are charged only their
+ * segment headers plus MEMP_NUM_PBUF reference pbufs, and their bytes are
+ * checked again when acked: the caller must not touch them before. The
+ * modelled link moves queued bytes
+ * to the socket at a shared rate, one segment per connection per turn, and
+ * reports them through the sent callback one RTT later, or as soon as the
+ * peer sends data, since its segments carry the ack. A new connection's
+ * first bytes are read one RTT after accept, the cost of the handshake.
+ * pcbs are only freed at the end of a poll, so callbacks may close or abort
+ * freely.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#undef TCP_MSS // <netinet/tcp.h> has the BSD 512; lwipopts.h is authoritative here
+#include "lwip_host.h"
+#include "lwip/tcp.h"
+
+#define ACK_MARKS 256
+#define MAX_PCBS 64
+#define RX_CHUNK (2 * TCP_MSS)
+#define CLOSE_DRAIN_US 1000000u // read and drop peer data this long after our FIN
+#define SEG_HEADER 72 // heap taken by the header pbuf of a segment (no-copy writes)
+
+typedef enum { PCB_NEW, PCB_LISTEN, PCB_CONN, PCB_CLOSING, PCB_DEAD } pcb_state_t;
+
+typedef struct {
+    uint64_t end;    // tx_total after this send
+    uint64_t due_us; // acknowledged from then on
+} ack_mark_t;
+
+typedef struct {
+    uint64_t end;       // bytes written after this write
+    const uint8_t *ref; // caller's bytes of a no-copy write, else NULL
+    uint32_t hash;      // ...as they were when written
+    uint16_t len, segs, charge;
+} write_rec_t;
+
+struct tcp_pcb {
+    int fd;
+    pcb_state_t state;
+    u16_t port;
+    void *arg;
+    tcp_accept_fn accept;
+    tcp_recv_fn recv;
+    tcp_sent_fn sent;
+    tcp_err_fn errf;
+    tcp_poll_fn poll;
+    u8_t poll_ticks;
+    uint64_t next_poll_us;
+    uint8_t q[TCP_SND_BUF]; // written by the app, not yet on the link
+    uint32_t q_len;
+    uint64_t tx_total;      // bytes put on the link
+    uint64_t acked;         // bytes reported through sent()
+    ack_mark_t marks[ACK_MARKS];
+    int m_head, m_n;
+    write_rec_t writes[TCP_SND_QUEUELEN]; // unacked writes, oldest first
+    int w_head, w_n;
+    uint16_t segs;          // of those writes
+    uint32_t rcv_wnd;
+    uint64_t rx_from_us;    // handshake done
+    bool rx_eof;
+    bool fin_sent;
+    uint64_t drain_until_us;
+    struct tcp_pcb *next;
+};
+
+static struct tcp_pcb *s_pcbs;
+static uint16_t s_port;
+static uint64_t s_link_Bps;
+static uint64_t s_rtt_us;
+static double s_tokens;
+static uint64_t s_tokens_at_us;
+static unsigned s_link_turn; // connection the next link turn starts with
+static uint32_t s_mem_used, s_mem_peak;
+static int s_ref_pbufs, s_ref_peak;
+static struct {
+    unsigned long accepted, refused, err_mem, ref_changed, wnd_closed;
+    unsigned long long tx_bytes, rx_bytes;
+    int conns_peak;
+} s_st;
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+void lwip_host_config(uint16_t port, uint32_t link_kBps, uint32_t rtt_ms)
+{
+    s_port = port;
+    s_link_Bps = (uint64_t)link_kBps * 1024u;
+    s_rtt_us = (uint64_t)rtt_ms * 1000u;
+}
+
+/* ------------------------------- pbufs ----------------------------------- */
+u8_t pbuf_free(struct pbuf *p)
+{
+    u8_t n = 0;
+    while (p)
+    {
+        struct pbuf *next = p->next;
+        free(p);
+        p = next;
+        n++;
+    }
+    return n;
+}
+
+u16_t pbuf_copy_partial(const struct pbuf *p, void *dataptr, u16_t len, u16_t offset)
+{
+    u16_t done = 0;
+    for (; p && done < len; p = p->next)
+    {
+        if (offset >= p->len)
+        {
+            offset -= p->len;
+            continue;
+        }
+        u16_t n = p->len - offset;
+        if (n > len - done)
+            n = len - done;
+        memcpy((uint8_t *)dataptr + done, (const uint8_t *)p->payload + offset, n);
+        done += n;
+        offset = 0;
+    }
+    return done;
+}
+
+u8_t pbuf_get_at(const struct pbuf *p, u16_t offset)
+{
+    u8_t c = 0;
+    pbuf_copy_partial(p, &c, 1, offset);
+    return c;
+}
+
+void pbuf_cat(struct pbuf *head, struct pbuf *tail)
+{
+    struct pbuf *p = head;
+    for (; p->next; p = p->next)
+        p->tot_len += tail->tot_len;
+    p->tot_len += tail->tot_len;
+    p->next = tail;
+}
+
+struct pbuf *pbuf_free_header(struct pbuf *q, u16_t size)
+{
+    while (q && size >= q->len)
+    {
+        struct pbuf *next = q->next;
+        size -= q->len;
+        free(q); // payload follows the header in the same block
+        q = next;
+    }
+    if (q && size)
+    {
+        q->payload = (uint8_t *)q->payload + size;
+        q->len -= size;
+        q->tot_len -= size;
+    }
+    return q;
+}
+
+u16_t pbuf_memfind(const struct pbuf *p, const void *mem, u16_t mem_len, u16_t start_offset)
+{
+    const uint8_t *m = mem;
+    for (u32_t i = start_offset; i + mem_len <= p->tot_len; ++i)
+    {
+        u16_t k = 0;
+        while (k < mem_len && pbuf_get_at(p, (u16_t)(i + k)) == m[k])
+            k++;
+        if (k == mem_len)
+            return (u16_t)i;
+    }
+    return 0xFFFF;
+}
+
+/* -------------------------------- pcbs ----------------------------------- */
+static int conn_count(void)
+{
+    int n = 0;
+    for (struct tcp_pcb *p = s_pcbs; p; p = p->next)
+        n += (p->state == PCB_CONN || p->state == PCB_CLOSING);
+    return n;
+}
+
+static struct tcp_pcb *pcb_alloc(void)
+{
+    struct tcp_pcb *p = calloc(1, sizeof *p);
+    if (!p)
+        return NULL;
+    p->fd = -1;
+    p->rcv_wnd = TCP_WND;
+    p->next = s_pcbs;
+    s_pcbs = p;
+    return p;
+}
+
+static uint32_t pcb_unacked(const struct tcp_pcb *p)
+{
+    return p->q_len + (uint32_t)(p->tx_total - p->acked);
+}
+
+static uint32_t fnv1a(const uint8_t *d, size_t n)
+{
+    uint32_t h = 2166136261u;
+    while (n--)
+        h = (h ^ *d++) * 16777619u;
+    return h;
+}
+
+// Free the writes acked so far (all of them if everything is dropped)
+static void release_writes(struct tcp_pcb *p, bool all)
+{
+    while (p->w_n && (all || p->writes[p->w_head].end <= p->acked))
+    {
+        write_rec_t *w = &p->writes[p->w_head];
+        if (w->ref)
+        {
+            s_ref_pbufs -= w->segs;
+            if (!all && fnv1a(w->ref, w->len) != w->hash && s_st.ref_changed++ == 0)
+                printf("⚠️  host lwIP: no-copy data changed before it was acked\n");
+        }
+        s_mem_used -= w->charge;
+        p->segs -= w->segs;
+        p->w_head = (p->w_head + 1) % TCP_SND_QUEUELEN;
+        p->w_n--;
+    }
+}
+
+// Drop the pcb's share of the heap; the fd is closed and the memory freed
+// at the end of the poll
+static void pcb_kill(struct tcp_pcb *p, bool rst)
+{
+    if (p->state == PCB_DEAD)
+        return;
+    release_writes(p, true);
+    p->q_len = 0;
+    p->acked = p->tx_total;
+    if (p->fd >= 0)
+    {
+        if (rst)
+        {
+            struct linger lg = {1, 0};
+            setsockopt(p->fd, SOL_SOCKET, SO_LINGER, &lg, sizeof lg);
+        }
+        close(p->fd);
+        p->fd = -1;
+    }
+    p->state = PCB_DEAD;
+}
+
+static void pcb_error(struct tcp_pcb *p, err_t err)
+{
+    tcp_err_fn f = p->errf;
+    void *arg = p->arg;
+    pcb_kill(p, true);
+    if (f)
+        f(arg, err);
+}
+
+struct tcp_pcb *tcp_new(void)
+{
+    return pcb_alloc();
+}
+
+err_t tcp_bind(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
+{
+    (void)ipaddr;
+    pcb->port = s_port ? s_port : port;
+    return ERR_OK;
+}
+
+struct tcp_pcb *tcp_listen_with_backlog(struct tcp_pcb *pcb, u8_t backlog)
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    int one = 1;
+    struct sockaddr_in sa = {0};
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(pcb->port);
+    sa.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one) != 0 ||
+        bind(fd, (struct sockaddr *)&sa, sizeof sa) != 0 || listen(fd, backlog) != 0)
+    {
+        perror("lwip_host: listen");
+        if (fd >= 0)
+            close(fd);
+        return NULL;
+    }
+    pcb->fd = fd;
+    pcb->state = PCB_LISTEN;
+    printf("🌐 host lwIP: listening on port %u (link %s, RTT %llu ms)\n", pcb->port,
+           s_link_Bps ? "rate-limited" : "unlimited", (unsigned long long)(s_rtt_us / 1000u));
+    return pcb;
+}
+
+void tcp_arg(struct tcp_pcb *pcb, void *arg) { pcb->arg = arg; }
+void tcp_accept(struct tcp_pcb *pcb, tcp_accept_fn accept) { pcb->accept = accept; }
+void tcp_recv(struct tcp_pcb *pcb, tcp_recv_fn recv) { pcb->recv = recv; }
+void tcp_sent(struct tcp_pcb *pcb, tcp_sent_fn sent) { pcb->sent = sent; }
+void tcp_err(struct tcp_pcb *pcb, tcp_err_fn err) { pcb->errf = err; }
+void tcp_setprio(struct tcp_pcb *pcb, u8_t prio) { (void)pcb; (void)prio; }
+void tcp_nagle_disable(struct tcp_pcb *pcb) { (void)pcb; }
+u16_t tcp_mss(const struct tcp_pcb *pcb) { (void)pcb; return TCP_MSS; }
+
+void tcp_poll(struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t interval)
+{
+    pcb->poll = poll;
+    pcb->poll_ticks = interval;
+    pcb->next_poll_us = now_us() + (uint64_t)interval * 500000u;
+}
+
+u16_t tcp_sndbuf(const struct tcp_pcb *pcb)
+{
+    if (pcb->state != PCB_CONN)
+        return 0;
+    uint32_t used = pcb_unacked(pcb);
+    return (u16_t)(used >= TCP_SND_BUF ? 0 : TCP_SND_BUF - used);
+}
+
+u16_t tcp_sndqueuelen(const struct tcp_pcb *pcb)
+{
+    return pcb->segs;
+}
+
+err_t tcp_write(struct tcp_pcb *pcb, const void *dataptr, u16_t len, u8_t apiflags)
+{
+    if (pcb->state != PCB_CONN)
+        return ERR_CONN;
+    if (!len)
+        return ERR_OK;
+    bool ref = !(apiflags & TCP_WRITE_FLAG_COPY);
+    uint16_t segs = (uint16_t)((len + TCP_MSS - 1) / TCP_MSS);
+    uint32_t charge = ref ? segs * SEG_HEADER : len;
+    if (len > tcp_sndbuf(pcb) || pcb->segs + segs > TCP_SND_QUEUELEN || s_mem_used + charge > MEM_SIZE ||
+        (ref && s_ref_pbufs + segs > MEMP_NUM_PBUF))
+    {
+        s_st.err_mem++;
+        return ERR_MEM;
+    }
+    // The link sends from the copy; ref writes are checked against it on ack
+    memcpy(pcb->q + pcb->q_len, dataptr, len);
+    pcb->q_len += len;
+    pcb->writes[(pcb->w_head + pcb->w_n++) % TCP_SND_QUEUELEN] = (write_rec_t){
+        pcb->tx_total + pcb->q_len, ref ? dataptr : NULL, ref ? fnv1a(dataptr, len) : 0, len, segs,
+        (uint16_t)charge};
+    pcb->segs += segs;
+    s_mem_used += charge;
+    if (s_mem_used > s_mem_peak)
+        s_mem_peak = s_mem_used;
+    if (ref && (s_ref_pbufs += segs) > s_ref_peak)
+        s_ref_peak = s_ref_pbufs;
+    return ERR_OK;
+}
+
+err_t tcp_output(struct tcp_pcb *pcb)
+{
+    (void)pcb; // the link is serviced from lwip_host_poll()
+    return ERR_OK;
+}
+
+void tcp_recved(struct tcp_pcb *pcb, u16_t len)
+{
+    // A closed window stopped the peer: the update reaches it and its next
+    // data gets back one RTT later
+    if (!pcb->rcv_wnd && len && pcb->state == PCB_CONN)
+    {
+        pcb->rx_from_us = now_us() + s_rtt_us;
+        s_st.wnd_closed++;
+    }
+    pcb->rcv_wnd += len;
+    if (pcb->rcv_wnd > TCP_WND)
+        pcb->rcv_wnd = TCP_WND;
+}
+
+err_t tcp_close(struct tcp_pcb *pcb)
+{
+    if (pcb->state == PCB_LISTEN || pcb->state == PCB_NEW)
+    {
+        pcb_kill(pcb, false);
+        return ERR_OK;
+    }
+    // Queued data still goes out, then FIN; no more callbacks
+    pcb->state = PCB_CLOSING;
+    pcb->recv = NULL;
+    pcb->sent = NULL;
+    pcb->errf = NULL;
+    pcb->poll = NULL;
+    return ERR_OK;
+}
+
+void tcp_abort(struct tcp_pcb *pcb)
+{
+    pcb_error(pcb, ERR_ABRT);
+}
+
+/* -------------------------------- link ----------------------------------- */
+static double link_tokens(uint64_t t)
+{
+    if (!s_link_Bps)
+        return 1e18;
+    s_tokens += (double)(t - s_tokens_at_us) * s_link_Bps / 1e6;
+    s_tokens_at_us = t;
+    double burst = 4.0 * TCP_MSS;
+    if (s_tokens > burst)
+        s_tokens = burst;
+    return s_tokens;
+}
+
+static void mark_push(struct tcp_pcb *p, uint64_t end, uint64_t due)
+{
+    if (p->m_n && p->marks[(p->m_head + p->m_n - 1) % ACK_MARKS].due_us == due)
+    {
+        p->marks[(p->m_head + p->m_n - 1) % ACK_MARKS].end = end;
+        return;
+    }
+    if (p->m_n == ACK_MARKS) // coalesce into the newest mark
+    {
+        p->marks[(p->m_head + p->m_n - 1) % ACK_MARKS].end = end;
+        return;
+    }
+    p->marks[(p->m_head + p->m_n++) % ACK_MARKS] = (ack_mark_t){end, due};
+}
+
+// One segment (up to an MSS) per connection per turn while the link has
+// tokens for it. A turn cut short by the rate resumes at the connection that
+// missed out, so no connection starves behind another's queue.
+static void link_service(uint64_t t)
+{
+    struct tcp_pcb *v[MAX_PCBS];
+    int n = 0;
+    for (struct tcp_pcb *p = s_pcbs; p && n < MAX_PCBS; p = p->next)
+        if (p->state == PCB_CONN || p->state == PCB_CLOSING)
+            v[n++] = p;
+    bool progress = true;
+    while (progress && n)
+    {
+        progress = false;
+        for (int k = 0; k < n; ++k)
+        {
+            int i = (int)((s_link_turn + (unsigned)k) % (unsigned)n);
+            struct tcp_pcb *p = v[i];
+            if ((p->state != PCB_CONN && p->state != PCB_CLOSING) || !p->q_len)
+                continue;
+            uint32_t seg = p->q_len < TCP_MSS ? p->q_len : TCP_MSS;
+            if (link_tokens(t) < seg)
+            {
+                s_link_turn = (unsigned)i;
+                return;
+            }
+            ssize_t w = send(p->fd, p->q, seg, MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (w < 0)
+            {
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    pcb_error(p, ERR_RST);
+                continue;
+            }
+            memmove(p->q, p->q + w, p->q_len - (uint32_t)w);
+            p->q_len -= (uint32_t)w;
+            p->tx_total += (uint64_t)w;
+            s_st.tx_bytes += (unsigned long long)w;
+            if (s_link_Bps)
+                s_tokens -= (double)w;
+            mark_push(p, p->tx_total, t + s_rtt_us);
+            progress = progress || w > 0;
+        }
+    }
+}
+
+static void deliver_acks(struct tcp_pcb *p, uint64_t t)
+{
+    uint64_t upto = p->acked;
+    while (p->m_n && p->marks[p->m_head].due_us <= t)
+    {
+        upto = p->marks[p->m_head].end;
+        p->m_head = (p->m_head + 1) % ACK_MARKS;
+        p->m_n--;
+    }
+    while (upto > p->acked && p->state != PCB_DEAD)
+    {
+        uint64_t d = upto - p->acked;
+        u16_t n = (u16_t)(d > 0xFFFFu ? 0xFFFFu : d);
+        p->acked += n;
+        release_writes(p, false);
+        if (p->sent && p->state == PCB_CONN)
+            p->sent(p->arg, p, n);
+    }
+}
+
+/* -------------------------------- poll ----------------------------------- */
+static void on_accept(struct tcp_pcb *l)
+{
+    for (;;)
+    {
+        int fd = accept4(l->fd, NULL, NULL, SOCK_NONBLOCK);
+        if (fd < 0)
+            return;
+        // MEMP_NUM_TCP_PCB: lwIP has no pcb for the SYN, the client sees a reset
+        if (conn_count() >= MEMP_NUM_TCP_PCB)
+        {
+            struct linger lg = {1, 0};
+            setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof lg);
+            close(fd);
+            s_st.refused++;
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+        struct tcp_pcb *p = pcb_alloc();
+        if (!p)
+        {
+            close(fd);
+            continue;
+        }
+        p->fd = fd;
+        p->state = PCB_CONN;
+        p->arg = l->arg;
+        p->rx_from_us = now_us() + s_rtt_us;
+        s_st.accepted++;
+        int c = conn_count();
+        if (c > s_st.conns_peak)
+            s_st.conns_peak = c;
+        err_t r = l->accept ? l->accept(l->arg, p, ERR_OK) : ERR_VAL;
+        if (r != ERR_OK && r != ERR_ABRT && p->state != PCB_DEAD)
+            pcb_kill(p, true);
+    }
+}
+
+static void on_readable(struct tcp_pcb *p, uint64_t t)
+{
+    uint8_t buf[RX_CHUNK];
+    if (p->state == PCB_CLOSING)
+    {
+        ssize_t n = recv(p->fd, buf, sizeof buf, MSG_DONTWAIT);
+        if (n == 0 || (n < 0 && errno != EAGAIN) || (p->fin_sent && t >= p->drain_until_us))
+            pcb_kill(p, false);
+        return;
+    }
+    uint32_t want = p->rcv_wnd < sizeof buf ? p->rcv_wnd : (uint32_t)sizeof buf;
+    double tokens = link_tokens(t); // uploads share the link with downloads
+    if (tokens < want)
+        want = tokens < 1 ? 0 : (uint32_t)tokens;
+    if (!want)
+        return;
+    ssize_t n = recv(p->fd, buf, want, MSG_DONTWAIT);
+    if (n < 0)
+    {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            pcb_error(p, ERR_RST);
+        return;
+    }
+    if (n == 0)
+    {
+        p->rx_eof = true;
+        if (p->recv)
+            p->recv(p->arg, p, NULL, ERR_OK);
+        else
+            tcp_close(p);
+        return;
+    }
+    s_st.rx_bytes += (unsigned long long)n;
+    if (s_link_Bps)
+        s_tokens -= (double)n;
+    for (int i = 0; i < p->m_n; ++i) // piggybacked ack of all the peer has read
+        if (p->marks[(p->m_head + i) % ACK_MARKS].due_us > t)
+            p->marks[(p->m_head + i) % ACK_MARKS].due_us = t;
+    struct pbuf *pb = malloc(sizeof *pb + (size_t)n);
+    if (!pb)
+        return;
+    pb->next = NULL;
+    pb->payload = pb + 1;
+    pb->len = pb->tot_len = (u16_t)n;
+    memcpy(pb->payload, buf, (size_t)n);
+    p->rcv_wnd -= (uint32_t)n;
+    if (p->recv)
+        p->recv(p->arg, p, pb, ERR_OK);
+    else
+    {
+        tcp_recved(p, pb->tot_len);
+        pbuf_free(pb);
+    }
+}
+
+void lwip_host_poll(int timeout_ms)
+{
+    struct pollfd fds[MAX_PCBS];
+    struct tcp_pcb *who[MAX_PCBS];
+    uint64_t t = now_us();
+
+    // Sleep no longer than the next ack, poll tick or link token
+    uint64_t wake = t + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0) * 1000u;
+    int n = 0;
+    for (struct tcp_pcb *p = s_pcbs; p && n < MAX_PCBS; p = p->next)
+    {
+        if (p->state == PCB_DEAD || p->fd < 0)
+            continue;
+        short ev = 0;
+        if (p->state == PCB_LISTEN)
+            ev = POLLIN;
+        else
+        {
+            if (p->state == PCB_CONN && p->rx_from_us > t)
+            {
+                if (p->rx_from_us < wake)
+                    wake = p->rx_from_us;
+            }
+            else if (p->state == PCB_CONN && p->rcv_wnd && !p->rx_eof && link_tokens(t) < 1)
+            {
+                if (wake > t + 1000u)
+                    wake = t + 1000u;
+            }
+            else if ((p->state == PCB_CONN && p->rcv_wnd && !p->rx_eof) || p->state == PCB_CLOSING)
+                ev |= POLLIN;
+            if (p->q_len)
+            {
+                ev |= POLLOUT;
+                if (s_link_Bps && wake > t + 1000u)
+                    wake = t + 1000u;
+            }
+            if (p->m_n && p->marks[p->m_head].due_us < wake)
+                wake = p->marks[p->m_head].due_us;
+            if (p->poll && p->next_poll_us < wake)
+                wake = p->next_poll_us;
+            if (p->state == PCB_CLOSING && p->fin_sent && p->drain_until_us < wake)
+                wake = p->drain_until_us;
+        }
+        fds[n] = (struct pollfd){p->fd, ev, 0};
+        who[n++] = p;
+    }
+    int wait_ms = wake > t ? (int)((wake - t + 999u) / 1000u) : 0;
+    if (timeout_ms <= 0)
+        wait_ms = 0;
+    poll(fds, (nfds_t)n, wait_ms);
+
+    t = now_us();
+    for (int i = 0; i < n; ++i)
+    {
+        struct tcp_pcb *p = who[i];
+        if (p->state == PCB_DEAD)
+            continue;
+        if (p->state == PCB_LISTEN)
+        {
+            if (fds[i].revents & POLLIN)
+                on_accept(p);
+            continue;
+        }
+        if (fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+            on_readable(p, t);
+    }
+
+    link_service(t);
+
+    for (struct tcp_pcb *p = s_pcbs; p; p = p->next)
+    {
+        if (p->state != PCB_CONN && p->state != PCB_CLOSING)
+            continue;
+        deliver_acks(p, t);
+        if (p->state == PCB_CONN && p->poll && t >= p->next_poll_us)
+        {
+            p->next_poll_us = t + (uint64_t)p->poll_ticks * 500000u;
+            p->poll(p->arg, p);
+        }
+        if (p->state == PCB_CLOSING && !p->q_len && !p->fin_sent)
+        {
+            shutdown(p->fd, SHUT_WR);
+            p->fin_sent = true;
+            p->drain_until_us = t + CLOSE_DRAIN_US;
+        }
+        if (p->state == PCB_CLOSING && p->fin_sent && t >= p->drain_until_us)
+            pcb_kill(p, false);
+    }
+
+    // Free what died during this poll
+    for (struct tcp_pcb **pp = &s_pcbs; *pp;)
+    {
+        struct tcp_pcb *p = *pp;
+        if (p->state == PCB_DEAD)
+        {
+            *pp = p->next;
+            free(p);
+        }
+        else
+            pp = &p->next;
+    }
+}
+
+void lwip_host_print_stats(void)
+{
+    printf("🌐 host lwIP: %lu accepted, %lu refused (MEMP_NUM_TCP_PCB=%d), peak %d open\n",
+           s_st.accepted, s_st.refused, MEMP_NUM_TCP_PCB, s_st.conns_peak);
+    printf("   %.2f MB sent, %.2f MB received, heap peak %lu / %d B, ref pbufs peak %d / %d, %lu ERR_MEM\n",
+           s_st.tx_bytes / 1e6, s_st.rx_bytes / 1e6, (unsigned long)s_mem_peak, MEM_SIZE, s_ref_peak,
+           MEMP_NUM_PBUF, s_st.err_mem);
+    if (s_st.wnd_closed)
+        printf("   receive window closed %lu times (peer waited for tcp_recved)\n", s_st.wnd_closed);
+    if (s_st.ref_changed)
+        printf("⚠️  %lu no-copy writes changed before their ack\n", s_st.ref_changed);
+}
@@ -0,0 +1,26 @@
+/*
+ * lwIP raw TCP API on host sockets (see shim/lwip/tcp.h)
+ * Lets web/http_server.c run inside flashsim and serve real clients. The
+ * radio link is modelled by a byte rate shared by all connections and a
+ * fixed round-trip time before sent bytes are acknowledged.
+ */
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// port: listen here instead of the firmware's port (0 = as bound).
+// link_kBps: shared link rate in KiB/s (0 = unlimited). rtt_ms: ack delay.
+void lwip_host_config(uint16_t port, uint32_t link_kBps, uint32_t rtt_ms);
+
+// Run timers and socket events for up to timeout_ms (0 = only what is ready)
+void lwip_host_poll(int timeout_ms);
+
+// Connections, bytes, ERR_MEM refusals, heap peak
+void lwip_host_print_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
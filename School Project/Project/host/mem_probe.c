@@ -0,0 +1,141 @@
+/*
+ * RAM high-water probe
+ * Stack: fn runs on a pthread whose stack is an mmap'd block filled with a
+ * pattern; the lowest overwritten byte gives the depth. The same run with an
+ * empty function measures what the thread itself uses (TLS, start-up frames)
+ * and is subtracted. Heap: malloc/calloc/realloc/free are wrapped at link
+ * time (-Wl,--wrap=...) and keep a live-byte count and its peak.
+ */
+#define _GNU_SOURCE
+#include "mem_probe.h"
+#include "sim.h"
+#include "pico/stdlib.h"
+#include <malloc.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define MEM_PROBE_STACK (512u * 1024u) // well above any single call on a 264 KB part
+#define MEM_PROBE_PAINT 0xA5
+
+/* ------------------------------ Heap count ------------------------------- */
+void *__real_malloc(size_t n);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t n);
+void  __real_free(void *p);
+
+static size_t s_live, s_peak;
+
+static void heap_add(void *p)
+{
+    if (!p)
+        return;
+    size_t live = __atomic_add_fetch(&s_live, malloc_usable_size(p), __ATOMIC_RELAXED);
+    size_t peak = __atomic_load_n(&s_peak, __ATOMIC_RELAXED);
+    while (live > peak &&
+           !__atomic_compare_exchange_n(&s_peak, &peak, live, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+static void heap_sub(void *p)
+{
+    if (p)
+        __atomic_sub_fetch(&s_live, malloc_usable_size(p), __ATOMIC_RELAXED);
+}
+
+void *__wrap_malloc(size_t n)
+{
+    void *p = __real_malloc(n);
+    heap_add(p);
+    return p;
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+    void *p = __real_calloc(n, size);
+    heap_add(p);
+    return p;
+}
+
+void *__wrap_realloc(void *old, size_t n)
+{
+    size_t old_size = old ? malloc_usable_size(old) : 0;
+    void *p = __real_realloc(old, n);
+    if (p || n == 0)
+    {
+        __atomic_sub_fetch(&s_live, old_size, __ATOMIC_RELAXED);
+        heap_add(p);
+    }
+    return p;
+}
+
+void __wrap_free(void *p)
+{
+    heap_sub(p);
+    __real_free(p);
+}
+
+/* ------------------------------ Stack paint ------------------------------ */
+typedef struct {
+    void (*fn)(void);
+    unsigned core;
+    uint64_t start_us, end_us;
+} probe_arg_t;
+
+static void *probe_main(void *arg)
+{
+    probe_arg_t *a = (probe_arg_t *)arg;
+    sim_core_enter(a->core, a->start_us);
+    if (a->fn)
+        a->fn();
+    a->end_us = sim_now_us();
+    return NULL;
+}
+
+// Bytes of the painted block the call wrote into, or 0 on failure
+static size_t run_painted(void (*fn)(void), uint8_t *stack)
+{
+    memset(stack, MEM_PROBE_PAINT, MEM_PROBE_STACK);
+
+    pthread_attr_t attr;
+    pthread_t th;
+    probe_arg_t a = {fn, get_core_num(), sim_now_us(), 0};
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, stack, MEM_PROBE_STACK);
+    bool ok = pthread_create(&th, &attr, probe_main, &a) == 0;
+    pthread_attr_destroy(&attr);
+    if (!ok)
+        return 0;
+    pthread_join(th, NULL);
+    sim_clock_sync_to(a.end_us);
+
+    size_t i = 0; // stacks grow down: the lowest touched byte marks the depth
+    while (i < MEM_PROBE_STACK && stack[i] == MEM_PROBE_PAINT)
+        ++i;
+    return MEM_PROBE_STACK - i;
+}
+
+static void probe_empty(void) {}
+
+bool mem_probe_run(void (*fn)(void), mem_probe_t *out)
+{
+    uint8_t *stack = mmap(NULL, MEM_PROBE_STACK, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+    if (stack == MAP_FAILED)
+        return false;
+
+    size_t base = run_painted(probe_empty, stack);
+
+    size_t live0 = __atomic_load_n(&s_live, __ATOMIC_RELAXED);
+    __atomic_store_n(&s_peak, live0, __ATOMIC_RELAXED);
+    size_t used = run_painted(fn, stack);
+    size_t peak = __atomic_load_n(&s_peak, __ATOMIC_RELAXED);
+
+    munmap(stack, MEM_PROBE_STACK);
+    if (!base || !used)
+        return false;
+    out->stack_bytes = used > base ? used - base : 0;
+    out->heap_peak = peak > live0 ? peak - live0 : 0;
+    return true;
+}
@@ -0,0 +1,26 @@
+/*
+ * RAM high-water probe
+ * Runs one firmware call on a thread whose stack is painted beforehand and
+ * counts heap bytes through the linker-wrapped allocator, so a module's
+ * peak stack and heap use can be read off on the host.
+ */
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    size_t stack_bytes; // deepest stack use of fn, thread start-up overhead removed
+    size_t heap_peak;   // most malloc'd bytes live at once above the level at entry
+} mem_probe_t;
+
+// Runs fn on the calling core's simulated clock. False if the probe thread
+// could not be started (fn has not run then).
+bool mem_probe_run(void (*fn)(void), mem_probe_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,311 @@
+// report_bench.c — exact (store + sort) vs streaming (Welford + P²) report
+// statistics on a synthetic RESULTS.CSV-sized sample stream.
+//   ./report_bench [rows] [seed]
+// Rows are spread over the same accumulators report.c keeps (read MB/s,
+// read latency, write ms, erase ms x 6 size groups). For every field the
+// report writes (mean, p25, p50, p75, min, max, sd) it prints the worst
+// relative error and, for the quartiles, the rank error |F(est) - q|.
+#include "stream_stats.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define N_GROUPS 6
+#define N_ACC 4
+
+static const char *const ACC_NAME[N_ACC] = {"read_MBps", "read_lat_ms", "write_ms", "erase_ms"};
+static const char *const GROUP_NAME[N_GROUPS] = {"1B", "256B", "4096B", "32768B", "65536B", "WHOLE"};
+static const double GROUP_BYTES[N_GROUPS] = {1, 256, 4096, 32768, 65536, 4194304};
+
+/* ------------------------------ RNG ------------------------------------- */
+static uint64_t s_rng;
+static double urand(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 7;
+    s_rng ^= s_rng << 17;
+    return ((s_rng >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+static double nrand(void)
+{
+    return sqrt(-2.0 * log(urand())) * cos(6.283185307179586 * urand());
+}
+
+/* Roughly what the benches log: read latency ~ bytes at ~1 MB/s plus a
+   command overhead with a little jitter; program times drift up with wear;
+   erase is bimodal (most sectors fast, some retried). */
+static double sample_read_us(int g)
+{
+    double us = 40.0 + GROUP_BYTES[g] * 0.95;
+    return us * exp(0.03 * nrand()) + (urand() < 0.01 ? 500.0 * urand() : 0.0);
+}
+static double sample_write_ms(int g, double progress)
+{
+    double pages = GROUP_BYTES[g] / 256.0;
+    if (pages < 1.0)
+        pages = 1.0;
+    return pages * 0.7 * (1.0 + 0.15 * progress) * exp(0.08 * nrand());
+}
+static double sample_erase_ms(int g)
+{
+    double base = (g <= 2) ? 45.0 : (g == 3) ? 120.0 : (g == 4) ? 150.0 : 10000.0;
+    return (urand() < 0.85 ? base : base * 2.6) * exp(0.05 * nrand());
+}
+
+/* -------------------------- exact path ---------------------------------- */
+// Same shape as report.c before streaming: realloc-grown float vectors,
+// then a sorted copy per vector.
+typedef struct
+{
+    float *v;
+    int n, cap;
+} vec_t;
+
+static size_t s_exact_peak;
+static size_t s_exact_live;
+
+static void vec_push(vec_t *V, float x)
+{
+    if (V->n == V->cap)
+    {
+        int nc = V->cap ? V->cap * 2 : 32;
+        V->v = (float *)realloc(V->v, nc * sizeof(float));
+        s_exact_live += (size_t)(nc - V->cap) * sizeof(float);
+        if (s_exact_live > s_exact_peak)
+            s_exact_peak = s_exact_live;
+        V->cap = nc;
+    }
+    V->v[V->n++] = x;
+}
+
+static int cmp_float_asc(const void *a, const void *b)
+{
+    const float *x = (const float *)a, *y = (const float *)b;
+    return (*x < *y) ? -1 : (*x > *y) ? 1 : 0;
+}
+
+static float percentile_sorted(const float *v, int n, float q)
+{
+    float pos = q * (n - 1);
+    int i = (int)floorf(pos);
+    int j = (int)ceilf(pos);
+    float t = pos - i;
+    return (1.0f - t) * v[i] + t * v[j];
+}
+
+typedef struct
+{
+    double f[7]; // mean p25 p50 p75 min max sd
+} fields_t;
+static const char *const FIELD_NAME[7] = {"mean", "p25", "p50", "p75", "min", "max", "sd"};
+
+static void exact_fields(vec_t *V, fields_t *F, float **sorted_out)
+{
+    float sum = 0.0f; // float accumulation, as the original code did
+    for (int i = 0; i < V->n; ++i)
+        sum += V->v[i];
+    float mean = sum / V->n;
+
+    float *s = (float *)malloc((size_t)V->n * sizeof(float));
+    s_exact_live += (size_t)V->n * sizeof(float);
+    if (s_exact_live > s_exact_peak)
+        s_exact_peak = s_exact_live;
+    memcpy(s, V->v, (size_t)V->n * sizeof(float));
+    qsort(s, (size_t)V->n, sizeof(float), cmp_float_asc);
+
+    float var = 0.0f;
+    for (int i = 0; i < V->n; ++i)
+        var += (V->v[i] - mean) * (V->v[i] - mean);
+
+    F->f[0] = mean;
+    F->f[1] = percentile_sorted(s, V->n, 0.25f);
+    F->f[2] = percentile_sorted(s, V->n, 0.50f);
+    F->f[3] = percentile_sorted(s, V->n, 0.75f);
+    F->f[4] = s[0];
+    F->f[5] = s[V->n - 1];
+    F->f[6] = sqrtf(var / V->n);
+    *sorted_out = s;
+}
+
+// Fraction of samples <= x, from the sorted exact copy
+static double cdf_at(const float *s, int n, double x)
+{
+    int lo = 0, hi = n;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (s[mid] <= x)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return (double)lo / n;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* ------------------------------ main ------------------------------------ */
+typedef struct
+{
+    int acc, g;
+    double x;
+} sample_t;
+
+static void gen_row(long i, long rows, sample_t out[2], int *n_out)
+{
+    int g = (int)(urand() * N_GROUPS);
+    double r = urand();
+    if (r < 0.5)
+    {
+        double us = sample_read_us(g);
+        out[0] = (sample_t){0, g, (GROUP_BYTES[g] / 1048576.0) / (us / 1e6)};
+        out[1] = (sample_t){1, g, us / 1000.0};
+        *n_out = 2;
+    }
+    else if (r < 0.8)
+    {
+        out[0] = (sample_t){2, g, sample_write_ms(g, (double)i / rows)};
+        *n_out = 1;
+    }
+    else
+    {
+        out[0] = (sample_t){3, g, sample_erase_ms(g)};
+        *n_out = 1;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    long rows = (argc > 1) ? atol(argv[1]) : 1000000L;
+    uint64_t seed = (argc > 2) ? strtoull(argv[2], NULL, 0) : 0x5EEDF1A5ull;
+    if (rows <= 0)
+    {
+        fprintf(stderr, "usage: %s [rows] [seed]\n", argv[0]);
+        return 2;
+    }
+
+    static vec_t vec[N_ACC][N_GROUPS];
+    static stream_summary_t acc[N_ACC][N_GROUPS];
+
+    // Streaming pass
+    s_rng = seed;
+    for (int k = 0; k < N_ACC; ++k)
+        for (int g = 0; g < N_GROUPS; ++g)
+            stream_summary_init(&acc[k][g]);
+    double t0 = now_s();
+    for (long i = 0; i < rows; ++i)
+    {
+        sample_t s[2];
+        int n;
+        gen_row(i, rows, s, &n);
+        for (int j = 0; j < n; ++j)
+            stream_summary_push(&acc[s[j].acc][s[j].g], s[j].x);
+    }
+    double t_stream = now_s() - t0;
+
+    // Exact pass over the identical stream
+    s_rng = seed;
+    t0 = now_s();
+    for (long i = 0; i < rows; ++i)
+    {
+        sample_t s[2];
+        int n;
+        gen_row(i, rows, s, &n);
+        for (int j = 0; j < n; ++j)
+            vec_push(&vec[s[j].acc][s[j].g], (float)s[j].x);
+    }
+    fields_t exact[N_ACC][N_GROUPS];
+    float *sorted[N_ACC][N_GROUPS];
+    for (int k = 0; k < N_ACC; ++k)
+        for (int g = 0; g < N_GROUPS; ++g)
+            if (vec[k][g].n)
+                exact_fields(&vec[k][g], &exact[k][g], &sorted[k][g]);
+    double t_exact = now_s() - t0;
+
+    // Same generation cost is in both timings; measure it alone to subtract
+    s_rng = seed;
+    t0 = now_s();
+    volatile double sink = 0;
+    for (long i = 0; i < rows; ++i)
+    {
+        sample_t s[2];
+        int n;
+        gen_row(i, rows, s, &n);
+        sink += s[0].x;
+    }
+    double t_gen = now_s() - t0;
+
+    printf("📊 %ld rows, seed 0x%llX\n\n", rows, (unsigned long long)seed);
+    printf("%-12s %-7s %8s", "series", "group", "n");
+    for (int f = 0; f < 7; ++f)
+        printf(" %9s", FIELD_NAME[f]);
+    printf("   rank p25/p50/p75\n");
+
+    double worst_rel[7] = {0}, worst_rank = 0;
+    for (int k = 0; k < N_ACC; ++k)
+    {
+        for (int g = 0; g < N_GROUPS; ++g)
+        {
+            const stream_summary_t *a = &acc[k][g];
+            if (!vec[k][g].n)
+                continue;
+            double est[7] = {
+                a->w.mean,
+                stream_summary_quartile(a, 1),
+                stream_summary_quartile(a, 2),
+                stream_summary_quartile(a, 3),
+                a->w.min,
+                a->w.max,
+                stream_stats_sd_pop(&a->w),
+            };
+            printf("%-12s %-7s %8d", ACC_NAME[k], GROUP_NAME[g], vec[k][g].n);
+            for (int f = 0; f < 7; ++f)
+            {
+                double ref = exact[k][g].f[f];
+                double rel = (ref != 0.0) ? fabs(est[f] - ref) / fabs(ref) : fabs(est[f]);
+                if (rel > worst_rel[f])
+                    worst_rel[f] = rel;
+                printf(" %8.4f%%", rel * 100.0);
+            }
+            printf("  ");
+            for (int q = 1; q <= 3; ++q)
+            {
+                double rank = fabs(cdf_at(sorted[k][g], vec[k][g].n, est[q]) - 0.25 * q);
+                if (rank > worst_rank)
+                    worst_rank = rank;
+                printf(" %.4f", rank);
+            }
+            printf("\n");
+        }
+    }
+
+    printf("\nWorst relative error:");
+    for (int f = 0; f < 7; ++f)
+        printf(" %s %.4f%%", FIELD_NAME[f], worst_rel[f] * 100.0);
+    printf("\nWorst quartile rank error: %.4f (fraction of samples)\n", worst_rank);
+
+    printf("\nMemory  exact: %zu bytes peak heap (vectors + sorted copies)\n", s_exact_peak);
+    printf("        stream: %zu bytes (%d x %zu-byte stream_summary_t), independent of rows\n",
+           sizeof acc, N_ACC * N_GROUPS, sizeof(stream_summary_t));
+    printf("Time    exact: %.3f s   stream: %.3f s   (sample generation %.3f s excluded)\n",
+           t_exact - t_gen, t_stream - t_gen, t_gen);
+
+    for (int k = 0; k < N_ACC; ++k)
+        for (int g = 0; g < N_GROUPS; ++g)
+            if (vec[k][g].n)
+            {
+                free(vec[k][g].v);
+                free(sorted[k][g]);
+            }
+    (void)sink;
+    return 0;
+}
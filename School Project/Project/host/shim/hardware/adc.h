@@ -0,0 +1,23 @@
+/*
+ * Host shim: hardware/adc.h
+ * Input 4 reads a steady ~27 °C on the internal sensor, input 3 a 5.0 V
+ * VSYS/3; other inputs read mid-scale.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "hardware/gpio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void adc_init(void);
+void adc_gpio_init(uint gpio);
+void adc_select_input(uint input);
+uint16_t adc_read(void);
+void adc_set_temp_sensor_enabled(bool enable);
+
+#ifdef __cplusplus
+}
+#endif
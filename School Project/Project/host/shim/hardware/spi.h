@@ -0,0 +1,53 @@
+/*
+ * Host shim: hardware/spi.h
+ * Two SPI instances; bytes clocked while a model chip's CS is low go to the
+ * SPI NOR model, and each transfer costs bytes*8/baud of simulated time.
+ */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "hardware/gpio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SPI_SSPCR1_SSE_BITS 0x00000002u
+
+typedef struct {
+    volatile uint32_t cr0, cr1, dr, sr, cpsr;
+} spi_hw_t;
+
+typedef struct spi_inst {
+    spi_hw_t hw;
+    unsigned index;
+    unsigned baud;
+} spi_inst_t;
+
+typedef enum { SPI_CPHA_0 = 0, SPI_CPHA_1 = 1 } spi_cpha_t;
+typedef enum { SPI_CPOL_0 = 0, SPI_CPOL_1 = 1 } spi_cpol_t;
+typedef enum { SPI_LSB_FIRST = 0, SPI_MSB_FIRST = 1 } spi_order_t;
+
+extern spi_inst_t host_spi_inst[2];
+#define spi0 (&host_spi_inst[0])
+#define spi1 (&host_spi_inst[1])
+
+static inline spi_hw_t *spi_get_hw(spi_inst_t *spi) { return &spi->hw; }
+static inline const spi_hw_t *spi_get_const_hw(const spi_inst_t *spi) { return &spi->hw; }
+static inline unsigned spi_get_index(const spi_inst_t *spi) { return spi->index; }
+
+unsigned spi_init(spi_inst_t *spi, unsigned baudrate);
+void spi_deinit(spi_inst_t *spi);
+unsigned spi_set_baudrate(spi_inst_t *spi, unsigned baudrate);
+unsigned spi_get_baudrate(const spi_inst_t *spi);
+void spi_set_format(spi_inst_t *spi, unsigned data_bits, spi_cpol_t cpol, spi_cpha_t cpha,
+                    spi_order_t order);
+
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len);
+int spi_read_blocking(spi_inst_t *spi, uint8_t repeated_tx_data, uint8_t *dst, size_t len);
+int spi_write_read_blocking(spi_inst_t *spi, const uint8_t *src, uint8_t *dst, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,3 @@
+/* Host shim: hardware/timer.h (time lives in pico/time.h) */
+#pragma once
+#include "pico/time.h"
@@ -0,0 +1,10 @@
+/*
+ * Host shim: lwip/ip_addr.h
+ * Only what tcp_bind() callers name; the host stack listens on all addresses.
+ */
+#pragma once
+#include "lwip/err.h"
+
+typedef struct { u32_t addr; } ip_addr_t;
+
+#define IP_ADDR_ANY ((const ip_addr_t *)0)
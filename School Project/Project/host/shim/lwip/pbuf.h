@@ -0,0 +1,28 @@
+/*
+ * Host shim: lwip/pbuf.h
+ * Each socket read arrives as one heap pbuf; the server may chain them.
+ */
+#pragma once
+#include "lwip/err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct pbuf {
+    struct pbuf *next;
+    void *payload;
+    u16_t tot_len;
+    u16_t len;
+};
+
+u8_t  pbuf_free(struct pbuf *p);
+u16_t pbuf_copy_partial(const struct pbuf *p, void *dataptr, u16_t len, u16_t offset);
+u8_t  pbuf_get_at(const struct pbuf *p, u16_t offset);
+void  pbuf_cat(struct pbuf *head, struct pbuf *tail);
+struct pbuf *pbuf_free_header(struct pbuf *q, u16_t size);
+u16_t pbuf_memfind(const struct pbuf *p, const void *mem, u16_t mem_len, u16_t start_offset);
+
+#ifdef __cplusplus
+}
+#endif
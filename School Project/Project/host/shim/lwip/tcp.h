@@ -0,0 +1,59 @@
+/*
+ * Host shim: lwip/tcp.h
+ * The lwIP raw TCP API on host sockets (host/lwip_host.c). Callbacks run from
+ * lwip_host_poll(), like lwIP's NO_SYS main loop. tcp_write() queues per pcb
+ * within TCP_SND_BUF and TCP_SND_QUEUELEN; copied data is charged to a
+ * MEM_SIZE heap shared by all pcbs, no-copy data only its segment headers.
+ * Bytes count as acknowledged one modelled RTT after they leave the
+ * modelled link, and tcp_sent() reports them then. Receive data is only read
+ * from the socket while the TCP_WND window opened by tcp_recved() allows.
+ */
+#pragma once
+#include "lwip/err.h"
+#include "lwip/pbuf.h"
+#include "lwip/ip_addr.h"
+#include "lwipopts.h" // firmware TCP_MSS / TCP_WND / TCP_SND_BUF / MEM_SIZE
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct tcp_pcb;
+
+typedef err_t (*tcp_accept_fn)(void *arg, struct tcp_pcb *newpcb, err_t err);
+typedef err_t (*tcp_recv_fn)(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err);
+typedef err_t (*tcp_sent_fn)(void *arg, struct tcp_pcb *tpcb, u16_t len);
+typedef err_t (*tcp_poll_fn)(void *arg, struct tcp_pcb *tpcb);
+typedef void  (*tcp_err_fn)(void *arg, err_t err);
+
+#define TCP_WRITE_FLAG_COPY 0x01
+#define TCP_WRITE_FLAG_MORE 0x02
+#define TCP_PRIO_NORMAL 64
+#define TCP_DEFAULT_LISTEN_BACKLOG 0xff
+
+struct tcp_pcb *tcp_new(void);
+err_t tcp_bind(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port);
+struct tcp_pcb *tcp_listen_with_backlog(struct tcp_pcb *pcb, u8_t backlog);
+#define tcp_listen(pcb) tcp_listen_with_backlog(pcb, TCP_DEFAULT_LISTEN_BACKLOG)
+
+void  tcp_arg(struct tcp_pcb *pcb, void *arg);
+void  tcp_accept(struct tcp_pcb *pcb, tcp_accept_fn accept);
+void  tcp_recv(struct tcp_pcb *pcb, tcp_recv_fn recv);
+void  tcp_sent(struct tcp_pcb *pcb, tcp_sent_fn sent);
+void  tcp_err(struct tcp_pcb *pcb, tcp_err_fn err);
+void  tcp_poll(struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t interval); // interval in 500 ms ticks
+void  tcp_setprio(struct tcp_pcb *pcb, u8_t prio);
+
+err_t tcp_write(struct tcp_pcb *pcb, const void *dataptr, u16_t len, u8_t apiflags);
+err_t tcp_output(struct tcp_pcb *pcb);
+void  tcp_recved(struct tcp_pcb *pcb, u16_t len);
+u16_t tcp_sndbuf(const struct tcp_pcb *pcb);
+u16_t tcp_sndqueuelen(const struct tcp_pcb *pcb);
+u16_t tcp_mss(const struct tcp_pcb *pcb);
+void  tcp_nagle_disable(struct tcp_pcb *pcb);
+err_t tcp_close(struct tcp_pcb *pcb);
+void  tcp_abort(struct tcp_pcb *pcb);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,22 @@
+/*
+ * Host shim: pico/cyw43_arch.h
+ * No radio: the lwIP raw API runs on host sockets (lwip_host.c), and a poll
+ * services them once.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CYW43_WL_GPIO_LED_PIN 0
+
+void lwip_host_poll(int timeout_ms);
+
+static inline void cyw43_arch_poll(void) { lwip_host_poll(0); }
+static inline void cyw43_arch_lwip_begin(void) {}
+static inline void cyw43_arch_lwip_end(void) {}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,32 @@
+/*
+ * Host shim: pico/stdlib.h
+ * Just enough of the Pico SDK surface for the benchmark, SD and report
+ * modules to compile and run on Linux.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "pico/time.h"
+#include "hardware/gpio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PICO_OK 0
+#define PICO_ERROR_TIMEOUT (-1)
+
+void stdio_init_all(void);
+
+// Next byte from stdin, or PICO_ERROR_TIMEOUT. With stdin at EOF, prompts
+// (timeout > 0) get the configured default answer so scripted runs finish;
+// zero-timeout "any key?" polls see no key.
+int getchar_timeout_us(uint32_t timeout_us);
+
+unsigned get_core_num(void);
+void tight_loop_contents(void);
+
+#ifdef __cplusplus
+}
+#endif
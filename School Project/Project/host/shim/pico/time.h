@@ -0,0 +1,38 @@
+/*
+ * Host shim: pico/time.h
+ * Time comes from sim_clock.c (virtual per-core clock or the host monotonic
+ * clock, selected at startup).
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint64_t absolute_time_t;
+
+uint64_t time_us_64(void);
+static inline uint32_t time_us_32(void) { return (uint32_t)time_us_64(); }
+
+static inline absolute_time_t get_absolute_time(void) { return time_us_64(); }
+static inline uint64_t to_us_since_boot(absolute_time_t t) { return t; }
+static inline uint32_t to_ms_since_boot(absolute_time_t t) { return (uint32_t)(t / 1000u); }
+static inline absolute_time_t make_timeout_time_us(uint64_t us) { return time_us_64() + us; }
+static inline absolute_time_t make_timeout_time_ms(uint32_t ms) { return time_us_64() + (uint64_t)ms * 1000u; }
+static inline int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to)
+{
+    return (int64_t)(to - from);
+}
+static inline absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us) { return t + us; }
+static inline absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms) { return t + (uint64_t)ms * 1000u; }
+
+void sleep_us(uint64_t us);
+static inline void sleep_ms(uint32_t ms) { sleep_us((uint64_t)ms * 1000u); }
+static inline void busy_wait_us(uint64_t us) { sleep_us(us); }
+static inline void busy_wait_ms(uint32_t ms) { sleep_us((uint64_t)ms * 1000u); }
+
+#ifdef __cplusplus
+}
+#endif
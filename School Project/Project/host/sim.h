@@ -0,0 +1,36 @@
+/*
+ * Host simulation internals
+ * Shared by the shim implementation (sim_hal.c), the flash model, the disk
+ * image driver and host_main.c. Firmware sources never include this.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    SIM_TIME_VIRTUAL = 0, // per-core clock advanced only by modelled costs
+    SIM_TIME_REAL         // host monotonic clock; sleeps really sleep
+} sim_time_mode_t;
+
+/* ---- Clock (sim_clock.c) ---- */
+void            sim_clock_init(sim_time_mode_t mode);
+sim_time_mode_t sim_clock_mode(void);
+uint64_t        sim_now_us(void);
+void            sim_advance_ns(uint64_t ns);     // modelled cost on this core
+void            sim_clock_sync_to(uint64_t us);  // virtual: never go backwards
+void            sim_core_enter(unsigned core, uint64_t start_us); // per thread
+
+/* ---- Console (sim_hal.c) ---- */
+void sim_stdin_set_default(int ch);  // answer used when stdin hits EOF
+
+/* ---- SPI routing (sim_hal.c -> spi_nor_model.c) ---- */
+void sim_spi_transfer(unsigned spi_index, const uint8_t *tx, uint8_t *rx, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,75 @@
+/*
+ * Simulated time
+ * Virtual mode keeps one nanosecond clock per core (thread). SPI bytes, flash
+ * busy waits, SD sectors and sleeps advance it, so results are repeatable
+ * and independent of host load. Real mode reads CLOCK_MONOTONIC instead.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "sim.h"
+#include "pico/time.h"
+#include <time.h>
+
+static sim_time_mode_t s_mode = SIM_TIME_VIRTUAL;
+static uint64_t s_real_origin_ns;
+static __thread uint64_t t_virtual_ns;
+static __thread unsigned t_core;
+
+static uint64_t mono_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void sim_clock_init(sim_time_mode_t mode)
+{
+    s_mode = mode;
+    s_real_origin_ns = mono_ns();
+    t_virtual_ns = 0;
+    t_core = 0;
+}
+
+sim_time_mode_t sim_clock_mode(void) { return s_mode; }
+
+uint64_t sim_now_us(void)
+{
+    if (s_mode == SIM_TIME_REAL)
+        return (mono_ns() - s_real_origin_ns) / 1000u;
+    return t_virtual_ns / 1000u;
+}
+
+void sim_advance_ns(uint64_t ns)
+{
+    if (s_mode == SIM_TIME_VIRTUAL)
+        t_virtual_ns += ns;
+}
+
+void sim_clock_sync_to(uint64_t us)
+{
+    if (s_mode == SIM_TIME_VIRTUAL && t_virtual_ns < us * 1000u)
+        t_virtual_ns = us * 1000u;
+}
+
+void sim_core_enter(unsigned core, uint64_t start_us)
+{
+    t_core = core;
+    t_virtual_ns = start_us * 1000u;
+}
+
+unsigned get_core_num(void) { return t_core; }
+
+/* ---- pico/time.h ---- */
+uint64_t time_us_64(void) { return sim_now_us(); }
+
+void sleep_us(uint64_t us)
+{
+    if (s_mode == SIM_TIME_VIRTUAL)
+    {
+        t_virtual_ns += us * 1000u;
+        return;
+    }
+    struct timespec ts = {(time_t)(us / 1000000u), (long)((us % 1000000u) * 1000u)};
+    while (nanosleep(&ts, &ts) != 0)
+    {
+    }
+}
@@ -0,0 +1,338 @@
+/*
+ * Host HAL shim
+ * GPIO, SPI, ADC, stdio and multicore entry points the firmware modules use,
+ * implemented on top of sim_clock.c and the SPI NOR model.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "sim.h"
+#include "spi_nor_model.h"
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/gpio.h"
+#include "hardware/spi.h"
+#include "hardware/adc.h"
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SIM_GPIO_COUNT 30
+#define SIM_CLK_PERI_HZ 125000000u
+
+/* --------------------------------- GPIO ---------------------------------- */
+static enum gpio_function s_fn[SIM_GPIO_COUNT];
+static bool s_out[SIM_GPIO_COUNT];
+static bool s_level[SIM_GPIO_COUNT];
+
+void gpio_init(uint gpio)
+{
+    if (gpio >= SIM_GPIO_COUNT)
+        return;
+    s_fn[gpio] = GPIO_FUNC_SIO;
+    s_out[gpio] = false;
+    s_level[gpio] = false;
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn)
+{
+    if (gpio < SIM_GPIO_COUNT)
+        s_fn[gpio] = fn;
+}
+
+enum gpio_function gpio_get_function(uint gpio)
+{
+    return gpio < SIM_GPIO_COUNT ? s_fn[gpio] : GPIO_FUNC_NULL;
+}
+
+void gpio_set_dir(uint gpio, bool out)
+{
+    if (gpio < SIM_GPIO_COUNT)
+        s_out[gpio] = out;
+}
+
+void gpio_put(uint gpio, bool value)
+{
+    if (gpio >= SIM_GPIO_COUNT)
+        return;
+    bool was = s_level[gpio];
+    s_level[gpio] = value;
+    if (was != value)
+        nor_model_cs_edge(gpio, value);
+}
+
+bool gpio_get(uint gpio) { return gpio < SIM_GPIO_COUNT ? s_level[gpio] : false; }
+void gpio_pull_up(uint gpio) { (void)gpio; }
+void gpio_pull_down(uint gpio) { (void)gpio; }
+void gpio_disable_pulls(uint gpio) { (void)gpio; }
+
+/* ---------------------------------- SPI ---------------------------------- */
+spi_inst_t host_spi_inst[2] = {{.index = 0}, {.index = 1}};
+
+/* Same prescale/postdiv search as the SDK, so reported baud rates match the
+ * board (e.g. 10 MHz requested -> 10.42 MHz actual). */
+unsigned spi_set_baudrate(spi_inst_t *spi, unsigned baudrate)
+{
+    if (!baudrate)
+        return spi->baud;
+    uint32_t prescale, postdiv;
+    for (prescale = 2; prescale <= 254; prescale += 2)
+        if (SIM_CLK_PERI_HZ < (prescale + 2) * 256ull * baudrate)
+            break;
+    if (prescale > 254)
+        prescale = 254;
+    for (postdiv = 256; postdiv > 1; --postdiv)
+        if (SIM_CLK_PERI_HZ / (prescale * (postdiv - 1)) > baudrate)
+            break;
+    spi->hw.cpsr = prescale;
+    spi->baud = SIM_CLK_PERI_HZ / (prescale * postdiv);
+    return spi->baud;
+}
+
+unsigned spi_init(spi_inst_t *spi, unsigned baudrate)
+{
+    spi->hw.cr1 |= SPI_SSPCR1_SSE_BITS;
+    return spi_set_baudrate(spi, baudrate);
+}
+
+void spi_deinit(spi_inst_t *spi) { spi->hw.cr1 &= ~SPI_SSPCR1_SSE_BITS; }
+
+unsigned spi_get_baudrate(const spi_inst_t *spi) { return spi->baud; }
+
+void spi_set_format(spi_inst_t *spi, unsigned data_bits, spi_cpol_t cpol, spi_cpha_t cpha,
+                    spi_order_t order)
+{
+    (void)data_bits; (void)cpol; (void)cpha; (void)order;
+    spi->hw.cr0 = data_bits - 1u;
+}
+
+static void clock_bytes(spi_inst_t *spi, size_t n)
+{
+    if (spi->baud)
+        sim_advance_ns((uint64_t)n * 8u * 1000000000ull / spi->baud);
+}
+
+int spi_write_read_blocking(spi_inst_t *spi, const uint8_t *src, uint8_t *dst, size_t len)
+{
+    sim_spi_transfer(spi->index, src, dst, len);
+    clock_bytes(spi, len);
+    return (int)len;
+}
+
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len)
+{
+    sim_spi_transfer(spi->index, src, NULL, len);
+    clock_bytes(spi, len);
+    return (int)len;
+}
+
+int spi_read_blocking(spi_inst_t *spi, uint8_t repeated_tx_data, uint8_t *dst, size_t len)
+{
+    uint8_t tx[256];
+    memset(tx, repeated_tx_data, sizeof tx);
+    size_t done = 0;
+    while (done < len)
+    {
+        size_t n = (len - done) > sizeof tx ? sizeof tx : (len - done);
+        sim_spi_transfer(spi->index, tx, dst + done, n);
+        done += n;
+    }
+    clock_bytes(spi, len);
+    return (int)len;
+}
+
+void sim_spi_transfer(unsigned spi_index, const uint8_t *tx, uint8_t *rx, size_t n)
+{
+    if (!nor_model_transfer(spi_index, tx, rx, n) && rx)
+        memset(rx, 0xFF, n); // nobody selected: MISO floats high
+}
+
+/* ---------------------------------- ADC ---------------------------------- */
+static uint s_adc_input;
+
+void adc_init(void) {}
+void adc_gpio_init(uint gpio) { (void)gpio; }
+void adc_select_input(uint input) { s_adc_input = input; }
+void adc_set_temp_sensor_enabled(bool enable) { (void)enable; }
+
+uint16_t adc_read(void)
+{
+    sim_advance_ns(2000); // 2 µs conversion
+    switch (s_adc_input)
+    {
+    case 4: return 876;  // 0.706 V -> 27 °C
+    case 3: return 2068; // 5.0 V / 3
+    default: return 2048;
+    }
+}
+
+/* --------------------------------- stdio --------------------------------- */
+static int s_default_answer = 'y'; // simulated chips: let destructive suites run
+static bool s_stdin_eof;
+
+void stdio_init_all(void) { setvbuf(stdout, NULL, _IOLBF, 0); }
+void sim_stdin_set_default(int ch) { s_default_answer = ch; }
+
+int getchar_timeout_us(uint32_t timeout_us)
+{
+    if (!s_stdin_eof)
+    {
+        struct pollfd p = {.fd = STDIN_FILENO, .events = POLLIN};
+        int ms = (sim_clock_mode() == SIM_TIME_REAL || isatty(STDIN_FILENO))
+                     ? (int)(timeout_us / 1000u) : 0;
+        if (poll(&p, 1, ms) > 0)
+        {
+            unsigned char c;
+            if (read(STDIN_FILENO, &c, 1) == 1)
+                return c;
+            s_stdin_eof = true;
+        }
+        else
+        {
+            sim_advance_ns((uint64_t)timeout_us * 1000u);
+            return PICO_ERROR_TIMEOUT;
+        }
+    }
+    if (timeout_us == 0)
+        return PICO_ERROR_TIMEOUT;
+    sim_advance_ns((uint64_t)timeout_us * 1000u);
+    return s_default_answer;
+}
+
+/* ------------------------------- multicore ------------------------------- */
+#define SIM_FIFO_DEPTH 8
+
+typedef struct {
+    uint32_t v[SIM_FIFO_DEPTH];
+    uint64_t t[SIM_FIFO_DEPTH]; // sender's clock at push
+    unsigned head, count;
+} sim_fifo_t;
+
+static pthread_mutex_t s_mc_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_mc_cond = PTHREAD_COND_INITIALIZER;
+static sim_fifo_t s_fifo[2]; // [n] = words travelling to core n
+static pthread_t s_core1;
+static bool s_core1_running;
+static volatile bool s_core1_stop;
+static void (*s_core1_entry)(void);
+static uint64_t s_core1_start_us;
+
+static void core1_exit_if_stopped(void)
+{
+    if (get_core_num() == 1 && s_core1_stop)
+    {
+        pthread_mutex_unlock(&s_mc_lock);
+        pthread_exit(NULL);
+    }
+}
+
+void tight_loop_contents(void)
+{
+    if (get_core_num() == 1 && s_core1_stop)
+        pthread_exit(NULL);
+    sched_yield();
+}
+
+static void *core1_main(void *arg)
+{
+    (void)arg;
+    sim_core_enter(1, s_core1_start_us);
+    s_core1_entry();
+    return NULL;
+}
+
+void multicore_launch_core1(void (*entry)(void))
+{
+    multicore_reset_core1();
+    s_core1_entry = entry;
+    s_core1_stop = false;
+    s_core1_start_us = sim_now_us();
+    s_core1_running = pthread_create(&s_core1, NULL, core1_main, NULL) == 0;
+}
+
+void multicore_reset_core1(void)
+{
+    if (!s_core1_running)
+        return;
+    pthread_mutex_lock(&s_mc_lock);
+    s_core1_stop = true;
+    pthread_cond_broadcast(&s_mc_cond);
+    pthread_mutex_unlock(&s_mc_lock);
+    pthread_join(s_core1, NULL);
+    s_core1_running = false;
+    memset(&s_fifo[1], 0, sizeof s_fifo[1]);
+}
+
+bool multicore_fifo_rvalid(void)
+{
+    pthread_mutex_lock(&s_mc_lock);
+    bool v = s_fifo[get_core_num()].count != 0;
+    pthread_mutex_unlock(&s_mc_lock);
+    return v;
+}
+
+bool multicore_fifo_wready(void)
+{
+    pthread_mutex_lock(&s_mc_lock);
+    bool r = s_fifo[get_core_num() ^ 1u].count < SIM_FIFO_DEPTH;
+    pthread_mutex_unlock(&s_mc_lock);
+    return r;
+}
+
+void multicore_fifo_push_blocking(uint32_t data)
+{
+    sim_fifo_t *q = &s_fifo[get_core_num() ^ 1u];
+    pthread_mutex_lock(&s_mc_lock);
+    while (q->count == SIM_FIFO_DEPTH)
+    {
+        core1_exit_if_stopped();
+        pthread_cond_wait(&s_mc_cond, &s_mc_lock);
+    }
+    unsigned slot = (q->head + q->count) % SIM_FIFO_DEPTH;
+    q->v[slot] = data;
+    q->t[slot] = sim_now_us();
+    q->count++;
+    pthread_cond_broadcast(&s_mc_cond);
+    pthread_mutex_unlock(&s_mc_lock);
+}
+
+uint32_t multicore_fifo_pop_blocking(void)
+{
+    sim_fifo_t *q = &s_fifo[get_core_num()];
+    pthread_mutex_lock(&s_mc_lock);
+    while (q->count == 0)
+    {
+        core1_exit_if_stopped();
+        pthread_cond_wait(&s_mc_cond, &s_mc_lock);
+    }
+    uint32_t v = q->v[q->head];
+    uint64_t t = q->t[q->head];
+    q->head = (q->head + 1u) % SIM_FIFO_DEPTH;
+    q->count--;
+    pthread_cond_broadcast(&s_mc_cond);
+    pthread_mutex_unlock(&s_mc_lock);
+    sim_clock_sync_to(t);
+    return v;
+}
+
+bool multicore_fifo_pop_timeout_us(uint64_t timeout_us, uint32_t *out)
+{
+    uint64_t deadline = sim_now_us() + timeout_us;
+    while (!multicore_fifo_rvalid())
+    {
+        if (sim_now_us() >= deadline)
+            return false;
+        sleep_us(10);
+    }
+    *out = multicore_fifo_pop_blocking();
+    return true;
+}
+
+void multicore_fifo_drain(void)
+{
+    pthread_mutex_lock(&s_mc_lock);
+    s_fifo[get_core_num()].count = 0;
+    s_fifo[get_core_num()].head = 0;
+    pthread_cond_broadcast(&s_mc_cond);
+    pthread_mutex_unlock(&s_mc_lock);
+}
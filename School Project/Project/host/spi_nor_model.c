@@ -0,0 +1,583 @@
+/*
+ * File-backed SPI NOR flash model
+ * The image is mmap'ed, so a run leaves its final flash contents on disk and
+ * the next run starts from them (like a real chip kept between sessions). The
+ * per-sector erase counts live next to it in <image>.wear the same way.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "spi_nor_model.h"
+#include "sim.h"
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SR1_BUSY 0x01u
+#define SR1_WEL 0x02u
+#define SR1_BP_MASK 0x1Cu
+#define WEAR_SECTOR 4096u
+
+typedef struct {
+    bool used;
+    unsigned spi_index, cs_pin;
+    int fd;
+    uint8_t *mem;
+    uint32_t size;
+    int wear_fd;
+    uint32_t *wear;  // erases per 4 KiB sector (mmap of <image>.wear)
+    uint8_t jedec[3];
+    nor_timing_t t;
+
+    uint8_t sr1, sr2;
+    uint64_t busy_until_us;
+    bool powered_down, reset_enabled, sr_volatile_we;
+
+    // current transaction
+    bool selected;
+    uint32_t pos;    // bytes clocked since CS fell
+    uint8_t cmd;
+    uint32_t addr;
+    uint8_t page[256];
+    uint16_t page_len; // bytes latched for 0x02 (capped at 256)
+    uint8_t new_sr[2];
+
+    nor_stats_t st;
+} nor_chip_t;
+
+static nor_chip_t s_chip[NOR_MODEL_MAX_CHIPS];
+
+/* ------------------------------ Timing table ----------------------------- */
+void nor_model_default_timing(nor_timing_t *t)
+{
+    t->page_program_us = 700;
+    t->sector_erase_us = 45000;
+    t->block32_erase_us = 120000;
+    t->block64_erase_us = 150000;
+    t->chip_erase_us = 0;
+    t->status_write_us = 5000;
+    t->erase_drift = 0.02;
+    t->program_drift = 0.01;
+    t->endurance_cycles = 100000;
+}
+
+static void norm_jedec(const char *in, char out[7])
+{
+    size_t w = 0;
+    for (; *in && w < 6; ++in)
+        if (isxdigit((unsigned char)*in))
+            out[w++] = (char)toupper((unsigned char)*in);
+    out[w] = 0;
+}
+
+static void lower_inplace(char *s)
+{
+    for (; *s; ++s)
+        *s = (char)tolower((unsigned char)*s);
+}
+
+static int split_csv(char *line, char **f, int max)
+{
+    int n = 0;
+    char *p = line;
+    while (n < max)
+    {
+        f[n++] = p;
+        char *c = strchr(p, ',');
+        if (!c)
+            break;
+        *c = 0;
+        p = c + 1;
+    }
+    return n;
+}
+
+bool nor_model_timing_from_csv(const char *csv_path, const char *jedec,
+                               nor_timing_t *t, uint32_t *capacity_bytes)
+{
+    FILE *f = fopen(csv_path, "r");
+    if (!f)
+        return false;
+
+    char want[7];
+    norm_jedec(jedec, want);
+
+    char line[512], *fld[32];
+    int c_j = -1, c_cap = -1, c_4k = -1, c_32k = -1, c_64k = -1, c_pp = -1;
+    bool found = false;
+
+    if (fgets(line, sizeof line, f))
+    {
+        line[strcspn(line, "\r\n")] = 0;
+        lower_inplace(line);
+        int n = split_csv(line, fld, 32);
+        for (int i = 0; i < n; ++i)
+        {
+            if (strstr(fld[i], "jedec")) c_j = i;
+            else if (strstr(fld[i], "capacity")) c_cap = i;
+            else if (strstr(fld[i], "64kb")) c_64k = i; // before "4kb": substring
+            else if (strstr(fld[i], "32kb")) c_32k = i;
+            else if (strstr(fld[i], "4kb")) c_4k = i;
+            else if (strstr(fld[i], "page_program")) c_pp = i;
+        }
+    }
+
+    while (c_j >= 0 && fgets(line, sizeof line, f))
+    {
+        line[strcspn(line, "\r\n")] = 0;
+        int n = split_csv(line, fld, 32);
+        if (c_j >= n)
+            continue;
+        char got[7];
+        norm_jedec(fld[c_j], got);
+        if (strcmp(got, want) != 0)
+            continue;
+
+#define COL_MS(c, dst) do { if ((c) >= 0 && (c) < n && atof(fld[c]) > 0) (dst) = atof(fld[c]) * 1000.0; } while (0)
+        COL_MS(c_pp, t->page_program_us);
+        COL_MS(c_4k, t->sector_erase_us);
+        COL_MS(c_32k, t->block32_erase_us);
+        COL_MS(c_64k, t->block64_erase_us);
+#undef COL_MS
+        if (c_cap >= 0 && c_cap < n && atof(fld[c_cap]) > 0 && capacity_bytes)
+            *capacity_bytes = (uint32_t)(atof(fld[c_cap]) / 8.0 * 1024.0 * 1024.0);
+        found = true;
+        break;
+    }
+    fclose(f);
+    return found;
+}
+
+/* --------------------------------- Attach -------------------------------- */
+// Open path at exactly len bytes and map it; bytes past the old end are filled
+static void *map_file(const char *path, uint32_t len, int fill, int *fd_out)
+{
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        perror(path);
+        return NULL;
+    }
+    struct stat sb;
+    fstat(fd, &sb);
+    off_t old = sb.st_size;
+    if (old != (off_t)len && ftruncate(fd, len) != 0)
+    {
+        perror("ftruncate");
+        close(fd);
+        return NULL;
+    }
+    uint8_t *mem = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mem == MAP_FAILED)
+    {
+        perror("mmap");
+        close(fd);
+        return NULL;
+    }
+    if (old < (off_t)len)
+        memset(mem + old, fill, len - (uint32_t)old);
+    *fd_out = fd;
+    return mem;
+}
+
+int nor_model_attach(unsigned spi_index, unsigned cs_pin, const char *image_path,
+                     const uint8_t jedec[3], uint32_t capacity_bytes,
+                     const nor_timing_t *t)
+{
+    int slot = -1;
+    for (int i = 0; i < NOR_MODEL_MAX_CHIPS; ++i)
+        if (!s_chip[i].used) { slot = i; break; }
+    if (slot < 0 || !capacity_bytes)
+        return -1;
+
+    int fd = -1, wear_fd = -1;
+    uint8_t *mem = map_file(image_path, capacity_bytes, 0xFF, &fd); // fresh chip reads erased
+    if (!mem)
+        return -1;
+    char wear_path[512];
+    snprintf(wear_path, sizeof wear_path, "%s.wear", image_path);
+    uint32_t wear_len = (capacity_bytes + WEAR_SECTOR - 1u) / WEAR_SECTOR * sizeof(uint32_t);
+    uint32_t *wear = map_file(wear_path, wear_len, 0, &wear_fd);
+    if (!wear)
+    {
+        munmap(mem, capacity_bytes);
+        close(fd);
+        return -1;
+    }
+
+    nor_chip_t *c = &s_chip[slot];
+    memset(c, 0, sizeof *c);
+    c->used = true;
+    c->spi_index = spi_index;
+    c->cs_pin = cs_pin;
+    c->fd = fd;
+    c->mem = mem;
+    c->size = capacity_bytes;
+    c->wear_fd = wear_fd;
+    c->wear = wear;
+    memcpy(c->jedec, jedec, 3);
+    c->t = *t;
+    if (c->t.chip_erase_us <= 0)
+        c->t.chip_erase_us = c->t.block64_erase_us * (capacity_bytes / 65536u);
+    return slot;
+}
+
+void nor_model_detach_all(void)
+{
+    for (int i = 0; i < NOR_MODEL_MAX_CHIPS; ++i)
+    {
+        nor_chip_t *c = &s_chip[i];
+        if (!c->used)
+            continue;
+        msync(c->mem, c->size, MS_SYNC);
+        munmap(c->mem, c->size);
+        close(c->fd);
+        uint32_t wear_len = (c->size + WEAR_SECTOR - 1u) / WEAR_SECTOR * sizeof(uint32_t);
+        msync(c->wear, wear_len, MS_SYNC);
+        munmap(c->wear, wear_len);
+        close(c->wear_fd);
+        c->used = false;
+    }
+}
+
+/* ------------------------------- Decoding -------------------------------- */
+static bool is_busy(const nor_chip_t *c) { return sim_now_us() < c->busy_until_us; }
+
+static void start_busy(nor_chip_t *c, double us)
+{
+    c->busy_until_us = sim_now_us() + (uint64_t)us;
+    c->st.busy_us_total += (uint64_t)us;
+}
+
+static uint8_t clock_byte(nor_chip_t *c, uint8_t in)
+{
+    uint32_t p = c->pos++;
+    if (p == 0)
+    {
+        c->cmd = in;
+        c->addr = 0;
+        c->page_len = 0;
+        c->st.cmds++;
+        return 0xFF;
+    }
+    if (c->powered_down && c->cmd != 0xAB)
+        return 0xFF;
+
+    switch (c->cmd)
+    {
+    case 0x9F: // JEDEC ID
+        return (p <= 3) ? c->jedec[p - 1] : 0x00;
+    case 0x05: // SR1 (continuous)
+        return (uint8_t)(c->sr1 | (is_busy(c) ? SR1_BUSY : 0));
+    case 0x35: // SR2
+        return c->sr2;
+    case 0x03: // READ
+    case 0x0B: // FAST READ (+1 dummy)
+        if (p <= 3)
+        {
+            c->addr = (c->addr << 8) | in;
+            return 0xFF;
+        }
+        if (c->cmd == 0x0B && p == 4)
+            return 0xFF;
+        if (is_busy(c))
+            return 0xFF;
+        c->st.bytes_read++;
+        return c->mem[c->addr++ % c->size];
+    case 0x02: // PAGE PROGRAM: latch, commit on CS high
+        if (p <= 3)
+        {
+            c->addr = (c->addr << 8) | in;
+            return 0xFF;
+        }
+        {
+            uint32_t off = ((c->addr & 0xFFu) + (p - 4u)) & 0xFFu; // wraps within the page
+            if (p - 4u < 256u)
+                c->page_len++;
+            c->page[off] = in; // >256 bytes: later bytes replace earlier ones
+        }
+        return 0xFF;
+    case 0x20: case 0x52: case 0xD8:
+        if (p <= 3)
+            c->addr = (c->addr << 8) | in;
+        return 0xFF;
+    case 0x01: // WRSR: SR1 [, SR2]
+        if (p <= 2)
+            c->new_sr[p - 1] = in;
+        return 0xFF;
+    case 0x31: // WRSR2
+        if (p == 1)
+            c->new_sr[1] = in;
+        return 0xFF;
+    default:
+        return 0xFF;
+    }
+}
+
+/* --------------------------------- Wear ---------------------------------- */
+static double wear_scale(double drift, uint32_t n)
+{
+    return 1.0 + drift * (double)n / 1000.0;
+}
+
+// Erases the range and counts it on every sector it covers. Returns the
+// highest count before this erase: the most worn sector finishes last.
+static uint32_t erase_range(nor_chip_t *c, uint32_t base, uint32_t len)
+{
+    base %= c->size;
+    if (base + len > c->size)
+        len = c->size - base;
+    memset(c->mem + base, 0xFF, len);
+
+    uint32_t worst = 0;
+    for (uint32_t s = base / WEAR_SECTOR; s < (base + len + WEAR_SECTOR - 1u) / WEAR_SECTOR; ++s)
+    {
+        if (c->wear[s] > worst)
+            worst = c->wear[s];
+        if (++c->wear[s] > c->st.max_erase_count)
+            c->st.max_erase_count = c->wear[s];
+    }
+    return worst;
+}
+
+static double erase_busy_us(nor_chip_t *c, double us, uint32_t base, uint32_t len)
+{
+    return us * wear_scale(c->t.erase_drift, erase_range(c, base, len));
+}
+
+// Same page, offset and erase count, same outcome: a run stopped and resumed
+// in another process wears out exactly like one that never stopped
+static uint32_t wear_hash(uint32_t a, uint32_t b, uint32_t d)
+{
+    uint32_t h = 2166136261u;
+    h = (h ^ a) * 16777619u;
+    h = (h ^ b) * 16777619u;
+    h = (h ^ d) * 16777619u;
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    return h ^ (h >> 12);
+}
+
+// Past the rated cycles a program may leave one of its 0 bits at 1
+static void wear_drop_bit(nor_chip_t *c, uint32_t page, uint32_t start, uint32_t cnt, uint32_t n)
+{
+    const uint32_t e = c->t.endurance_cycles;
+    if (!e || n <= e || !cnt)
+        return;
+    uint32_t h = wear_hash(page, n, start);
+    if ((double)(h & 0xFFFFu) / 65536.0 >= (double)(n - e) / (double)e)
+        return;
+    uint32_t first = (h >> 16) % cnt;
+    for (uint32_t k = 0; k < cnt; ++k)
+    {
+        uint32_t o = (start + (first + k) % cnt) & 0xFFu;
+        uint8_t zeros = (uint8_t)~c->page[o];
+        if (zeros)
+        {
+            c->mem[page + o] |= (uint8_t)(zeros & -zeros); // lowest bit that should clear
+            c->st.bits_dropped++;
+            return;
+        }
+    }
+}
+
+static void commit(nor_chip_t *c)
+{
+    const uint32_t n = c->pos;
+    if (n == 0)
+        return;
+    const uint8_t cmd = c->cmd;
+
+    if (c->powered_down)
+    {
+        if (cmd == 0xAB)
+            c->powered_down = false;
+        return;
+    }
+    // Busy chips only answer status reads; everything else is dropped
+    if (is_busy(c) && cmd != 0x05 && cmd != 0x35)
+    {
+        c->st.ignored_busy++;
+        return;
+    }
+
+    const bool wel = (c->sr1 & SR1_WEL) != 0;
+    const bool protected_ = (c->sr1 & SR1_BP_MASK) != 0;
+
+    switch (cmd)
+    {
+    case 0x06: c->sr1 |= SR1_WEL; break;
+    case 0x04: c->sr1 &= (uint8_t)~SR1_WEL; break;
+    case 0x50: c->sr_volatile_we = true; break;
+    case 0x66: c->reset_enabled = true; return;
+    case 0x99:
+        if (c->reset_enabled)
+        {
+            c->sr1 &= (uint8_t)~SR1_WEL;
+            c->busy_until_us = 0;
+        }
+        break;
+    case 0xB9: c->powered_down = true; break;
+    case 0x98: // SST26 global unlock: no block-protect model, accept
+        c->sr1 &= (uint8_t)~SR1_WEL;
+        break;
+
+    case 0x02:
+        if (n < 5 || !wel || protected_)
+        {
+            if (!wel) c->st.ignored_no_wel++;
+            break;
+        }
+        {
+            uint32_t page = (c->addr % c->size) & ~0xFFu;
+            uint32_t start = c->addr & 0xFFu;
+            uint32_t cnt = c->page_len;
+            for (uint32_t i = 0; i < cnt; ++i)
+            {
+                uint32_t o = (start + i) & 0xFFu;
+                c->mem[page + o] &= c->page[o]; // NOR: bits only go 1 -> 0
+            }
+            uint32_t n = c->wear[page / WEAR_SECTOR];
+            wear_drop_bit(c, page, start, cnt, n);
+            c->st.page_programs++;
+            c->st.bytes_programmed += cnt;
+            c->sr1 &= (uint8_t)~SR1_WEL;
+            start_busy(c, c->t.page_program_us * wear_scale(c->t.program_drift, n));
+        }
+        break;
+
+    case 0x20: case 0x52: case 0xD8:
+        if (n != 4 || !wel || protected_)
+        {
+            if (!wel) c->st.ignored_no_wel++;
+            break;
+        }
+        if (cmd == 0x20)
+        {
+            c->st.erases_4k++;
+            start_busy(c, erase_busy_us(c, c->t.sector_erase_us, c->addr & ~0xFFFu, 4096u));
+        }
+        else if (cmd == 0x52)
+        {
+            c->st.erases_32k++;
+            start_busy(c, erase_busy_us(c, c->t.block32_erase_us, c->addr & ~0x7FFFu, 32768u));
+        }
+        else
+        {
+            c->st.erases_64k++;
+            start_busy(c, erase_busy_us(c, c->t.block64_erase_us, c->addr & ~0xFFFFu, 65536u));
+        }
+        c->sr1 &= (uint8_t)~SR1_WEL;
+        break;
+
+    case 0xC7: case 0x60:
+        if (n != 1 || !wel || protected_)
+        {
+            if (!wel) c->st.ignored_no_wel++;
+            break;
+        }
+        c->st.chip_erases++;
+        c->sr1 &= (uint8_t)~SR1_WEL;
+        start_busy(c, erase_busy_us(c, c->t.chip_erase_us, 0, c->size));
+        break;
+
+    case 0x01: case 0x31:
+        if (!wel && !c->sr_volatile_we)
+            break;
+        if (cmd == 0x01 && n >= 2)
+            c->sr1 = (uint8_t)((c->new_sr[0] & 0xFCu) | (c->sr1 & SR1_WEL));
+        if ((cmd == 0x01 && n >= 3) || (cmd == 0x31 && n >= 2))
+            c->sr2 = c->new_sr[1];
+        c->sr1 &= (uint8_t)~SR1_WEL;
+        c->sr_volatile_we = false;
+        start_busy(c, c->t.status_write_us);
+        break;
+    default:
+        break;
+    }
+    c->reset_enabled = false;
+}
+
+void nor_model_cs_edge(unsigned pin, bool level)
+{
+    for (int i = 0; i < NOR_MODEL_MAX_CHIPS; ++i)
+    {
+        nor_chip_t *c = &s_chip[i];
+        if (!c->used || c->cs_pin != pin)
+            continue;
+        if (!level)
+        {
+            c->selected = true;
+            c->pos = 0;
+        }
+        else if (c->selected)
+        {
+            commit(c);
+            c->selected = false;
+        }
+    }
+}
+
+bool nor_model_transfer(unsigned spi_index, const uint8_t *tx, uint8_t *rx, size_t n)
+{
+    for (int i = 0; i < NOR_MODEL_MAX_CHIPS; ++i)
+    {
+        nor_chip_t *c = &s_chip[i];
+        if (!c->used || !c->selected || c->spi_index != spi_index)
+            continue;
+        for (size_t k = 0; k < n; ++k)
+        {
+            uint8_t o = clock_byte(c, tx ? tx[k] : 0xFF);
+            if (rx)
+                rx[k] = o;
+        }
+        return true;
+    }
+    return false;
+}
+
+/* --------------------------------- Stats --------------------------------- */
+void nor_model_get_stats(int slot, nor_stats_t *out)
+{
+    if (slot >= 0 && slot < NOR_MODEL_MAX_CHIPS && s_chip[slot].used)
+        *out = s_chip[slot].st;
+    else
+        memset(out, 0, sizeof *out);
+}
+
+uint32_t nor_model_erase_count(int slot, uint32_t addr)
+{
+    if (slot < 0 || slot >= NOR_MODEL_MAX_CHIPS || !s_chip[slot].used)
+        return 0;
+    return s_chip[slot].wear[(addr % s_chip[slot].size) / WEAR_SECTOR];
+}
+
+void nor_model_print_stats(void)
+{
+    for (int i = 0; i < NOR_MODEL_MAX_CHIPS; ++i)
+    {
+        const nor_chip_t *c = &s_chip[i];
+        if (!c->used)
+            continue;
+        printf("🧪 Model chip %d (%02X %02X %02X, spi%u CS GP%u, %lu KiB)\n", i,
+               c->jedec[0], c->jedec[1], c->jedec[2], c->spi_index, c->cs_pin,
+               (unsigned long)(c->size / 1024u));
+        printf("   cmds=%llu read=%llu B programmed=%llu B (%llu pages)\n",
+               (unsigned long long)c->st.cmds, (unsigned long long)c->st.bytes_read,
+               (unsigned long long)c->st.bytes_programmed, (unsigned long long)c->st.page_programs);
+        printf("   erases 4K=%llu 32K=%llu 64K=%llu chip=%llu, busy %.3f s total\n",
+               (unsigned long long)c->st.erases_4k, (unsigned long long)c->st.erases_32k,
+               (unsigned long long)c->st.erases_64k, (unsigned long long)c->st.chip_erases,
+               c->st.busy_us_total / 1e6);
+        if (c->st.max_erase_count)
+            printf("   wear: most erased sector at %lu cycles (rated %lu), %llu bits dropped\n",
+                   (unsigned long)c->st.max_erase_count, (unsigned long)c->t.endurance_cycles,
+                   (unsigned long long)c->st.bits_dropped);
+        if (c->st.ignored_busy || c->st.ignored_no_wel)
+            printf("   ⚠️  ignored: %llu while busy, %llu without WEL\n",
+                   (unsigned long long)c->st.ignored_busy, (unsigned long long)c->st.ignored_no_wel);
+    }
+}
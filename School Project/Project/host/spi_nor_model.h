@@ -0,0 +1,71 @@
+/*
+ * File-backed SPI NOR flash model
+ * Decodes the command set the driver uses (9F/05/35/03/0B/02/20/52/D8/C7/60,
+ * WREN/WRDI, status writes, reset, power-down) on whichever chip has its CS
+ * low. Program/erase set a busy window from the timing table; status reads
+ * report WIP until the caller's clock passes it. Each 4 KiB sector counts its
+ * erases (kept in <image>.wear), and the count stretches that sector's busy
+ * times and, past the rated cycles, makes page programs drop bits.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NOR_MODEL_MAX_CHIPS 2
+
+typedef struct {
+    double page_program_us;
+    double sector_erase_us;  // 4 KiB
+    double block32_erase_us;
+    double block64_erase_us;
+    double chip_erase_us;    // 0 -> 64K time x block count
+    double status_write_us;
+    // Wear: a sector erased n times takes (1 + drift * n / 1000) x the time
+    // above to erase or program. Past endurance_cycles, a page program fails
+    // to clear one bit with probability (n - endurance) / endurance.
+    double   erase_drift;      // 0.02 = +2 % per 1000 erases of the sector
+    double   program_drift;
+    uint32_t endurance_cycles; // rated P/E cycles; 0 = never wears out
+} nor_timing_t;
+
+typedef struct {
+    uint64_t cmds, bytes_read, bytes_programmed;
+    uint64_t page_programs, erases_4k, erases_32k, erases_64k, chip_erases;
+    uint64_t ignored_busy, ignored_no_wel;
+    uint64_t busy_us_total;
+    uint64_t bits_dropped;   // worn-out programs that left a 0 bit at 1
+    uint32_t max_erase_count;
+} nor_stats_t;
+
+// Datasheet row for a JEDEC string ("EF 70 16"); fills timing and capacity.
+// Returns false if the file or row is missing (outputs left untouched).
+bool nor_model_timing_from_csv(const char *csv_path, const char *jedec,
+                               nor_timing_t *t, uint32_t *capacity_bytes);
+
+// Defaults for parts without a datasheet row (typical 25-series values).
+void nor_model_default_timing(nor_timing_t *t);
+
+// Attach a chip on (spi_index, cs_pin) backed by image_path (created/resized
+// to capacity and filled with 0xFF where new) and image_path.wear (erase
+// counts, zero where new). Returns chip slot or -1.
+int  nor_model_attach(unsigned spi_index, unsigned cs_pin, const char *image_path,
+                      const uint8_t jedec[3], uint32_t capacity_bytes,
+                      const nor_timing_t *t);
+void nor_model_detach_all(void);
+
+// Called by the GPIO / SPI shims.
+void nor_model_cs_edge(unsigned pin, bool level);
+bool nor_model_transfer(unsigned spi_index, const uint8_t *tx, uint8_t *rx, size_t n);
+
+void nor_model_get_stats(int slot, nor_stats_t *out);
+uint32_t nor_model_erase_count(int slot, uint32_t addr); // of addr's sector
+void nor_model_print_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
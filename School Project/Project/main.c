@@ -10,7 +10,12 @@
 #include "bench_read.h"
 #include "bench_write.h"
 #include "bench_erase.h"
+#include "bench_sweep.h"
+#include "bench_endurance.h"
+#include "bench_adaptive.h"
+#include "bench_quickid.h"
 #include "report.h"
+#include "results_archive.h"
 #include "web/http_server.h"
 #include "pico/cyw43_arch.h"
 #include "lwip/netif.h"
@@ -95,6 +100,79 @@ bool http_get_sd_mounted(void)
     return sd_is_mounted();
 }
 
+/* ========================= Wi-Fi AP + HTTP server ========================= */
+/* lwIP is polled (pico_cyw43_arch_lwip_poll): nothing network-side runs
+ * unless http_server_service() is called, so the server can stay up while
+ * benchmarks run without interrupting a timed section or touching FatFs
+ * behind the benchmark's back. */
+static bool web_live = false;
+static dhcp_server_t dhcp_server;
+static bool dhcp_started = false;
+
+static bool web_start(void)
+{
+    // Ensure SD file list is populated
+    sd_file_count = sd_get_file_list(sd_files, MAX_FILES_TO_LIST);
+    file_list_needs_refresh = false;
+
+    // Init WiFi (Pico W)
+    if (cyw43_arch_init()) {
+        printf("[!] Failed to initialize WiFi hardware\n");
+        return false;
+    }
+
+    // Enable AP mode (no return value) — print diagnostics before/after
+    printf("[i] Enabling AP mode: %s (WPA2)\n", AP_SSID);
+    cyw43_arch_enable_ap_mode(AP_SSID, AP_PASSWORD, CYW43_AUTH_WPA2_AES_PSK);
+    printf("[i] cyw43_arch_enable_ap_mode() completed\n");
+
+    // wait a short moment for AP to come up
+    for (int i = 0; i < 40; i++) { cyw43_arch_poll(); sleep_ms(50); }
+
+    // Diagnostic: print netif_default status
+    if (netif_default) {
+        ip4_addr_t addr = netif_default->ip_addr;
+        printf("[i] netif_default present - IP: %s\n", ip4addr_ntoa(&addr));
+    } else {
+        printf("[!] netif_default is NULL after AP enable - network interface not created\n");
+    }
+
+    // configure IP and DHCP
+    dhcp_started = false;
+    if (netif_default) {
+        ip4_addr_t ipaddr, netmask, gw;
+        IP4_ADDR(ip_2_ip4(&ipaddr), 192,168,4,1);
+        IP4_ADDR(ip_2_ip4(&netmask), 255,255,255,0);
+        IP4_ADDR(ip_2_ip4(&gw), 192,168,4,1);
+        netif_set_addr(netif_default, ip_2_ip4(&ipaddr), ip_2_ip4(&netmask), ip_2_ip4(&gw));
+        netif_set_up(netif_default);
+
+        dhcp_server_init(&dhcp_server, &ipaddr, &netmask);
+        dhcp_started = true;
+        printf("[+] DHCP server started\n");
+    } else {
+        printf("[!] netif_default is NULL - cannot configure IP/DHCP\n");
+    }
+
+    // Hook up HTTP server file list and start HTTP server
+    http_server_set_file_list(sd_files, &sd_file_count, &file_list_needs_refresh);
+    if (!http_server_init()) {
+        printf("[!] HTTP server failed to start\n");
+    } else {
+        printf("[+] HTTP server running. Connect to AP '%s' and open http://192.168.4.1\n", AP_SSID);
+    }
+    return true;
+}
+
+static void web_stop(void)
+{
+    http_server_stop();
+    if (dhcp_started) dhcp_server_deinit(&dhcp_server);
+    dhcp_started = false;
+    cyw43_arch_deinit();
+    web_live = false;
+}
+
 /* ============================ Resource Checks ============================= */
 static inline void print_menu_banner(void)
 {
@@ -102,6 +180,16 @@ static inline void print_menu_banner(void)
     printf("Type one of these commands then press Enter:\n");
     printf("   safe         - Safe analysis (read-only)\n");
     printf("   destructive  - Destructive analysis (read + write/erase)\n");
+    printf("   sweep        - Size/offset sweep + overhead fit (optional program)\n");
+    printf("   endurance    - Long erase/program/verify cycling (resumable)\n");
+    printf("   quickid      - Identify the chip from a few erase/program probes\n");
+    printf("   adaptive     - Iterations: %s ('adaptive <pct> [p<q>]' | 'off')\n",
+           bench_adapt_config()->enabled ? bench_adapt_plan(100) : "fixed 100");
+    printf("   archive [f]  - Update RESULTS.RCA and query it (e.g. 'archive op=erase,size=4096')\n");
+    printf("   live [off]   - Wi-Fi AP + web server during analysis; results stream to /live (now: %s)\n",
+           web_live ? "on" : "off");
+    if (flash_dev_present_count() > 1)
+        printf("   dev <n>      - Target flash chip n (now: %d); 'dev' lists chips\n", flash_dev_current());
     printf("   exit         - Exit and generate report\n");
     printf("=================================================\n");
 }
@@ -137,6 +225,7 @@ static bool read_command_gap_terminated(char *out, size_t out_n)
     for (;;)
     {
         int ch = getchar_timeout_us(2000); // ~2ms poll
+        http_server_service();             // web server, if 'live' is on
         if (ch >= 0)
         {
             got_any = true;
@@ -252,6 +341,18 @@ static bool flash_is_live_now(char *out, size_t n)
     return true;
 }
 
+/* List every configured flash slot, marking the current target */
+static void print_flash_devices(void)
+{
+    printf("\n🔌 Flash devices:\n");
+    for (int i = 0; i < flash_dev_count(); ++i)
+    {
+        char d[64];
+        flash_dev_describe(i, d, sizeof d);
+        printf("   %s %s\n", (i == flash_dev_current()) ? "▶" : " ", d);
+    }
+}
+
 /* Return true only if flash reports a valid JEDEC ID */
 static bool flash_has_valid_jedec(char *out, size_t n)
 {
@@ -401,9 +502,23 @@ static const char *normalize_cmd(const char *cmd)
     if (!strcmp(cmd, "erase") || !strcmp(cmd, "e"))
         return "erase";
 
+    if (!strcmp(cmd, "sweep") || !strcmp(cmd, "sw"))
+        return "sweep";
+    if (!strcmp(cmd, "endurance") || !strcmp(cmd, "en"))
+        return "endurance";
+
     if (!strcmp(cmd, "exit") || !strcmp(cmd, "quit") || !strcmp(cmd, "q"))
         return "exit";
 
+    if (!strcmp(cmd, "dev") || !strcmp(cmd, "devices"))
+        return "devices";
+    if (!strcmp(cmd, "ad"))
+        return "adaptive";
+    if (!strcmp(cmd, "qid") || !strcmp(cmd, "id"))
+        return "quickid";
+    if (!strcmp(cmd, "rca"))
+        return "archive";
+
     return cmd;
 }
 
@@ -499,6 +614,9 @@ static void run_one_test_and_log(const char *operation)
     char ts[32];
     create_timestamp(ts, sizeof ts);
 
+    char note[24];
+    snprintf(note, sizeof note, "menu_cmd%s", flash_dev_note_suffix());
+
     char row[256];
     printf("🧾 Using live JEDEC for CSV: [%s]\n", jedec);
     snprintf(row, sizeof(row),
@@ -507,7 +625,7 @@ static void run_one_test_and_log(const char *operation)
              (unsigned long long)elapsed_us, throughput_MBps,
              ++data_row_count, temp, voltage,
              (strcmp(operation, "write") == 0 ? pattern : "n/a"),
-             ts, "menu_cmd");
+             ts, note);
 
     if (sd_append_to_file(CSV_FILENAME, row))
     {
@@ -531,6 +649,8 @@ static void show_sd_menu_and_handle(void)
 
     for (;;)
     {
+        // Rows of the last suite still buffered for RESULTS.RCA
+        (void)results_archive_flush();
         print_menu_banner();
 
         printf("> ");
@@ -746,6 +866,96 @@ static void show_sd_menu_and_handle(void)
             continue;
         }
 
+        // ======================= Scenario C: SWEEP =======================
+        if (!strcmp(cmd, "sweep"))
+        {
+            printf("\n📐 SIZE/OFFSET SWEEP selected.\n");
+            bool with_prog = prompt_yes_no("Include PROGRAM sweep (erases scratch region)?");
+
+            bench_sweep_run(with_prog);
+
+            if (bench_sweep_has_data())
+                bench_sweep_print_summary();
+            else
+                printf("(no sweep data)\n");
+            continue;
+        }
+
+        // ===================== Scenario D: ENDURANCE =====================
+        if (!strcmp(cmd, "endurance"))
+        {
+            printf("\n⏳ ENDURANCE selected.\n");
+            bench_endurance_run();
+
+            if (bench_endurance_has_data())
+                bench_endurance_print_summary();
+            continue;
+        }
+
+        // ===================== Device list / select =====================
+        if (!strcmp(cmd, "devices") || !strncmp(cmd, "dev ", 4))
+        {
+            if (cmd[3] == ' ')
+            {
+                int idx = atoi(cmd + 4);
+                if (flash_dev_select(idx))
+                    printf("✅ Benchmarks, backup and report now target flash %d\n", idx);
+                else
+                    printf("❌ Flash %d is not present\n", idx);
+            }
+            print_flash_devices();
+            continue;
+        }
+
+        // ======================= Scenario E: QUICK-ID =======================
+        if (!strcmp(cmd, "quickid"))
+        {
+            printf("\n🆔 QUICK-ID selected.\n");
+            if (prompt_yes_no("Quick-ID erases and programs one 64 KiB scratch block near the top of the chip. Proceed?"))
+                bench_quickid_run(NULL);
+            else
+                printf("↩️  Quick-ID cancelled.\n");
+            continue;
+        }
+
+        // =================== Adaptive iteration count ===================
+        if (!strcmp(cmd, "adaptive") || !strncmp(cmd, "adaptive ", 9))
+        {
+            if (cmd[8] == ' ' && !bench_adapt_parse(cmd + 9))
+                printf("❓ Usage: adaptive off | adaptive <pct> [p<q>]  (e.g. 'adaptive 2 p95')\n");
+            else if (bench_adapt_config()->enabled)
+                printf("📏 Benchmarks run %s per size (SERIES.CSV logs the result)\n",
+                       bench_adapt_plan(100));
+            else
+                printf("📏 Adaptive stopping off: benchmarks run 100 iterations per size\n");
+            continue;
+        }
+
+        // ===================== Columnar results archive =====================
+        if (!strcmp(cmd, "archive") || !strncmp(cmd, "archive ", 8))
+        {
+            if (results_archive_sync("RESULTS.CSV", RESULTS_ARCHIVE_FILENAME))
+                results_archive_print_query(RESULTS_ARCHIVE_FILENAME, cmd[7] == ' ' ? cmd + 8 : "");
+            continue;
+        }
+
+        // ===================== Live results over Wi-Fi =====================
+        if (!strcmp(cmd, "live") || !strcmp(cmd, "live off"))
+        {
+            if (cmd[4] == ' ')
+            {
+                if (web_live)
+                    web_stop();
+                printf("📴 Web server off\n");
+            }
+            else if (web_live || (web_live = web_start()))
+            {
+                printf("📡 Open http://192.168.4.1/live on '%s': rows and series statistics stream while benchmarks run\n",
+                       AP_SSID);
+            }
+            continue;
+        }
+
         // ============================ EXIT ============================
         if (!strcmp(cmd, "exit"))
         {
@@ -757,7 +967,7 @@ static void show_sd_menu_and_handle(void)
         }
 
         // Fallback: unknown top-level command
-        printf("❓ Unknown command: %s (use safe | destructive | exit)\n", raw);
+        printf("❓ Unknown command: %s (use safe | destructive | sweep | endurance | quickid | adaptive | archive | live | dev | exit)\n", raw);
     }
 }
 
@@ -847,6 +1057,8 @@ void perform_forensic_analysis_and_log(void)
                         snprintf(notes, sizeof(notes), "Flash_Erase_Test_%d", data_row_count);
                         break;
                     }
+                    size_t nl = strlen(notes);
+                    snprintf(notes + nl, sizeof(notes) - nl, "%s", flash_dev_note_suffix());
 
                     if (elapsed_us > 0)
                     {
@@ -941,16 +1153,27 @@ static void handle_gp20_button_press(void)
     }
 
     // 4) Ask for backup (SAFE mode), then run processes
-    if (prompt_yes_no("\n💾 Would you like to perform a full microchip backup (Safe Mode)?"))
+    if (flash_dev_present_count() > 1 &&
+        prompt_yes_no("\n💾 Several flash chips detected. Back up ALL of them (concurrently where wiring allows)?"))
     {
+        if (!sd_backup_flash_all("SPI_Backup"))
+            printf("❌ Multi-chip backup failed. You can still use the menu.\n");
+        else
+            printf("✅ Multi-chip backup complete! Files: SPI_Backup/microchip_backup_d<N>.bin\n");
+    }
+    else if (prompt_yes_no("\n💾 Would you like to perform a full microchip backup (Safe Mode)?"))
+    {
+        // Same name the GP21 restore looks for (per chip once there are two)
+        char name[32];
+        sd_backup_name(flash_dev_current(), name, sizeof name);
         printf("📀 Starting SAFE microchip backup...\n");
-        if (!sd_backup_flash_safe("SPI_Backup", "microchip_backup_safe.bin"))
+        if (!sd_backup_flash_safe("SPI_Backup", name))
         {
             printf("❌ SAFE backup failed. You can still use the menu.\n");
         }
         else
         {
-            printf("✅ SAFE backup complete! File: SPI_Backup/microchip_backup_safe.bin\n");
+            printf("✅ SAFE backup complete! File: SPI_Backup/%s\n", name);
         }
     }
     else
@@ -993,7 +1216,9 @@ static void handle_gp21_restore_press(void)
 
     // 3) Check that backup file exists
     const char *dir = "SPI_Backup";
-    const char *fname = "microchip_backup_safe.bin";
+    const int dev = flash_dev_current();
+    char fname[32];
+    sd_backup_name(dev, fname, sizeof fname);
 
     char fullpath[64];
     snprintf(fullpath, sizeof fullpath, "%s/%s", dir, fname);
@@ -1037,7 +1262,7 @@ static void handle_gp21_restore_press(void)
             }
 
             printf("\n🔁 Starting RESTORE from backup...\n");
-            if (!sd_restore_flash_safe(dir, fname))
+            if (!sd_restore_flash_dev(dir, dev))
             {
                 printf("❌ RESTORE failed. Microchip contents may be partially updated.\n");
             }
@@ -1053,64 +1278,17 @@ static void handle_gp21_restore_press(void)
         {
             printf("[*] Starting webserver mode to download backup file...\n");
 
-            // Ensure SD file list is populated
-            sd_file_count = sd_get_file_list(sd_files, MAX_FILES_TO_LIST);
-            file_list_needs_refresh = false;
-
-            // Init WiFi (Pico W)
-            if (cyw43_arch_init()) {
-                printf("[!] Failed to initialize WiFi hardware\n");
+            bool was_live = web_live;
+            if (!web_live && !web_start()) {
                 return;
             }
 
-            // Enable AP mode (no return value) — print diagnostics before/after
-            printf("[i] Enabling AP mode: %s (WPA2)\n", AP_SSID);
-            cyw43_arch_enable_ap_mode(AP_SSID, AP_PASSWORD, CYW43_AUTH_WPA2_AES_PSK);
-            printf("[i] cyw43_arch_enable_ap_mode() completed\n");
-
-            // wait a short moment for AP to come up
-            for (int i = 0; i < 40; i++) { cyw43_arch_poll(); sleep_ms(50); }
-
-            // Diagnostic: print netif_default status
-            if (netif_default) {
-                ip4_addr_t addr = netif_default->ip_addr;
-                printf("[i] netif_default present - IP: %s\n", ip4addr_ntoa(&addr));
-            } else {
-                printf("[!] netif_default is NULL after AP enable - network interface not created\n");
-            }
-
-            // configure IP and DHCP
-            dhcp_server_t dhcp_server;
-            bool dhcp_started = false;
-            if (netif_default) {
-                ip4_addr_t ipaddr, netmask, gw;
-                IP4_ADDR(ip_2_ip4(&ipaddr), 192,168,4,1);
-                IP4_ADDR(ip_2_ip4(&netmask), 255,255,255,0);
-                IP4_ADDR(ip_2_ip4(&gw), 192,168,4,1);
-                netif_set_addr(netif_default, ip_2_ip4(&ipaddr), ip_2_ip4(&netmask), ip_2_ip4(&gw));
-                netif_set_up(netif_default);
-
-                dhcp_server_init(&dhcp_server, &ipaddr, &netmask);
-                dhcp_started = true;
-                printf("[+] DHCP server started\n");
-            } else {
-                printf("[!] netif_default is NULL - cannot configure IP/DHCP\n");
-            }
-
-            // Hook up HTTP server file list and start HTTP server
-            http_server_set_file_list(sd_files, &sd_file_count, &file_list_needs_refresh);
-            if (!http_server_init()) {
-                printf("[!] HTTP server failed to start\n");
-            } else {
-                printf("[+] HTTP server running. Connect to AP '%s' and open http://192.168.4.1\n", AP_SSID);
-            }
-
             // Wait here while serving; pressing GP21 again will exit web mode
             printf("[i] Press GP21 again to stop webserver and return.\n");
             bool last_state = gpio_get(RESTORE_BUTTON_PIN);
             for (;;)
             {
-                cyw43_arch_poll();
+                http_server_service();
                 bool cur = gpio_get(RESTORE_BUTTON_PIN);
                 uint32_t now = to_ms_since_boot(get_absolute_time());
                 if (last_state && !cur && (now - last_button_time_gp21) > DEBOUNCE_DELAY_MS) {
@@ -1119,13 +1297,16 @@ static void handle_gp21_restore_press(void)
                     break;
                 }
                 last_state = cur;
-                sleep_ms(50);
+                cyw43_arch_wait_for_work_until(make_timeout_time_ms(50));
             }
 
-            // Stop services
-            if (dhcp_started) dhcp_server_deinit(&dhcp_server);
-            cyw43_arch_deinit();
-            printf("[i] Webserver stopped. Returning to main.\n");
+            // Stop services, unless the analysis menu had them running
+            if (was_live) {
+                printf("[i] Leaving web mode; the server stays up ('live off' in the menu stops it).\n");
+            } else {
+                web_stop();
+                printf("[i] Webserver stopped. Returning to main.\n");
+            }
             return;
         }
 
@@ -1316,6 +1497,7 @@ int main(void)
             last_hb = now;
         }
 
+        http_server_service();
         sleep_ms(10);
     }
 
@@ -0,0 +1,142 @@
+/*
+ * Deterministic test-pattern engine
+ * Enum dispatch, 32-bit word fills, and a counter-based generator for
+ * "random" so the stream can be regenerated from any offset.
+ */
+
+#include "pattern.h"
+#include <string.h>
+
+static const char *const k_names[PAT_COUNT] = {
+    "0xFF", "0x00", "0x55", "random", "incremental",
+};
+
+pattern_id_t pattern_from_name(const char *name)
+{
+    if (!name)
+        return PAT_FF;
+    for (int i = 0; i < PAT_COUNT; ++i)
+    {
+        if (strcmp(name, k_names[i]) == 0)
+            return (pattern_id_t)i;
+    }
+    return PAT_FF;
+}
+
+const char *pattern_name(pattern_id_t id)
+{
+    return ((unsigned)id < PAT_COUNT) ? k_names[id] : "0xFF";
+}
+
+/* ------------------------- Word generators ---------------------------------
+ * Each returns the little-endian 32-bit word covering stream bytes
+ * [4*w, 4*w+3]. "random" is xorshift-style mixing of (seed, w) — a stateless
+ * PRNG, so word w never depends on words before it.
+ * -------------------------------------------------------------------------- */
+static inline uint32_t mix32(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+static inline uint32_t word_at(pattern_id_t id, uint32_t seed, uint32_t w)
+{
+    switch (id)
+    {
+    case PAT_00:
+        return 0x00000000u;
+    case PAT_55:
+        return 0x55555555u;
+    case PAT_RANDOM:
+        return mix32(seed ^ (w * 0x9E3779B9u));
+    case PAT_INCREMENTAL:
+        /* bytes 4w..4w+3 never straddle a 256 wrap, so no carries between lanes */
+        return 0x03020100u + 0x01010101u * ((w << 2) & 0xFFu);
+    case PAT_FF:
+    default:
+        return 0xFFFFFFFFu;
+    }
+}
+
+void pattern_fill(pattern_id_t id, uint32_t seed, uint32_t offset, uint8_t *buf, uint32_t len)
+{
+    if (!buf || !len)
+        return;
+
+    switch (id)
+    {
+    case PAT_00: memset(buf, 0x00, len); return;
+    case PAT_55: memset(buf, 0x55, len); return;
+    case PAT_RANDOM:
+    case PAT_INCREMENTAL:
+        break;
+    case PAT_FF:
+    default:     memset(buf, 0xFF, len); return;
+    }
+
+    /* Leading bytes up to the next word boundary of the stream */
+    uint32_t w = offset >> 2;
+    uint32_t lane = offset & 3u;
+    if (lane)
+    {
+        uint32_t v = word_at(id, seed, w++) >> (8u * lane);
+        while (lane < 4u && len)
+        {
+            *buf++ = (uint8_t)v;
+            v >>= 8;
+            ++lane;
+            --len;
+        }
+    }
+
+    /* Whole words (memcpy keeps this safe for unaligned buf on Cortex-M0+) */
+    while (len >= 4u)
+    {
+        uint32_t v = word_at(id, seed, w++);
+        memcpy(buf, &v, 4);
+        buf += 4;
+        len -= 4u;
+    }
+
+    /* Tail */
+    if (len)
+    {
+        uint32_t v = word_at(id, seed, w);
+        while (len--)
+        {
+            *buf++ = (uint8_t)v;
+            v >>= 8;
+        }
+    }
+}
+
+bool pattern_verify(pattern_id_t id, uint32_t seed, uint32_t offset,
+                    const uint8_t *buf, uint32_t len, uint32_t *bad_index)
+{
+    uint8_t expect[64];
+    uint32_t done = 0;
+    while (done < len)
+    {
+        uint32_t n = len - done;
+        if (n > sizeof expect)
+            n = sizeof expect;
+        pattern_fill(id, seed, offset + done, expect, n);
+        if (memcmp(buf + done, expect, n) != 0)
+        {
+            if (bad_index)
+            {
+                uint32_t i = 0;
+                while (buf[done + i] == expect[i])
+                    ++i;
+                *bad_index = done + i;
+            }
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
@@ -0,0 +1,53 @@
+/*
+ * Deterministic test-pattern engine
+ * Every pattern is a pure function of (id, seed, byte offset), so any window
+ * of a span can be regenerated for program staging or read-back verify.
+ */
+#pragma once
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    PAT_FF = 0,       // "0xFF"
+    PAT_00,           // "0x00"
+    PAT_55,           // "0x55"
+    PAT_RANDOM,       // "random"      (seeded, counter-based -> reproducible)
+    PAT_INCREMENTAL,  // "incremental" (byte = offset & 0xFF)
+    PAT_COUNT
+} pattern_id_t;
+
+/* Seed used when the caller has no better one (e.g. generate_test_pattern) */
+#ifndef PATTERN_DEFAULT_SEED
+#define PATTERN_DEFAULT_SEED 0x5EEDF1A5u
+#endif
+
+/* Staging window benches fill before starting their timer */
+#ifndef PATTERN_STAGE_BYTES
+#define PATTERN_STAGE_BYTES 4096u
+#endif
+
+/* Name <-> id. Unknown/NULL names map to PAT_FF (the historic default). */
+pattern_id_t pattern_from_name(const char *name);
+const char  *pattern_name(pattern_id_t id);
+
+/* Fill buf with bytes [offset, offset+len) of the pattern stream. */
+void pattern_fill(pattern_id_t id, uint32_t seed, uint32_t offset, uint8_t *buf, uint32_t len);
+
+/* Compare buf against bytes [offset, offset+len) of the stream.
+ * Returns true on match; on mismatch *bad_index (optional) gets the first
+ * differing index within buf. */
+bool pattern_verify(pattern_id_t id, uint32_t seed, uint32_t offset,
+                    const uint8_t *buf, uint32_t len, uint32_t *bad_index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PATTERN_H
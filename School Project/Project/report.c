@@ -5,7 +5,16 @@
 #include "pico/time.h"
 #include "fatfs/ff.h"
 
+#ifndef REPORT_LIVE_FLASH
+#define REPORT_LIVE_FLASH 1 // 0: no report_generate_csv(), no flash_* dependency (host fleet tool)
+#endif
+#if REPORT_LIVE_FLASH
 #include "flash_benchmark.h" // flash_spi_get_baud_hz(), flash_get_jedec_str()
+#endif
+#include "stream_stats.h"    // Welford + P² accumulators for the aggregation pass
+#include "csv_reader.h"      // buffered line reader + CSV tokenizer
+#include "chip_db.h"         // compiled datasheet image + JEDEC index
+#include "results_archive.h" // p99 rows from the columnar RESULTS.RCA
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
@@ -16,8 +25,17 @@
 #define RESULTS_FILENAME "RESULTS.CSV"
 #define REPORT_FILENAME "report.csv"
 
-#define MAX_DB_ROWS 512
 #define MAX_LINE 512
+
+// Per-report state below is static; the host fleet tool runs one report per
+// thread and builds with REPORT_THREAD_LOCAL=_Thread_local.
+#ifndef REPORT_THREAD_LOCAL
+#define REPORT_THREAD_LOCAL
+#endif
+
+// Inputs of the report in progress (see report_generate_ex)
+static REPORT_THREAD_LOCAL const report_opts_t *s_opt;
+#define REPORT_LOG(...) (s_opt->quiet ? 0 : printf(__VA_ARGS__))
 #define NA_STR "NA"
 #define REPORT_READ_MEAN_FROM_AVG_LATENCY 1
 
@@ -69,6 +87,26 @@ static const uint32_t GROUP_BYTES[G_COUNT] = {
     1u, 256u, 4096u, 32768u, 65536u, 0u // WHOLE=0 (computed from capacity)
 };
 
+// Report output: the report file, or opts->buf when the caller wants it in
+// memory (s_buf_o counts what it needed, also past the end)
+static size_t s_buf_o;
+
+static void report_put(FIL *rf, const void *data, UINT n, UINT *bw)
+{
+    if (!s_opt->buf)
+    {
+        f_write(rf, data, n, bw);
+        return;
+    }
+    if (s_buf_o + n < s_opt->buf_len)
+    {
+        memcpy(s_opt->buf + s_buf_o, data, n);
+        s_opt->buf[s_buf_o + n] = '\0';
+    }
+    s_buf_o += n;
+    *bw = n;
+}
+
 // Write one pivot row: title,read,write,erase
 static void write_pivot_row(FIL *rf, const char *title,
                             const char *readv, const char *writev, const char *erasev)
@@ -80,7 +118,7 @@ static void write_pivot_row(FIL *rf, const char *title,
                      writev ? writev : "NA",
                      erasev ? erasev : "NA");
     if (n > 0)
-        f_write(rf, line, (UINT)n, &bw);
+        report_put(rf, line, (UINT)n, &bw);
 }
 
 static const char *group_suffix(group_t g)
@@ -116,22 +154,10 @@ static void trim(char *s)
     if (i)
         memmove(s, s + i, strlen(s + i) + 1);
 }
-static void upper_str(char *s)
-{
-    for (; *s; ++s)
-        *s = (char)toupper((unsigned char)*s);
-}
-static int split_fields(char *line, char *out[], int max_fields)
+static bool ends_with(const char *s, const char *tail)
 {
-    char *sep = (strchr(line, ',') ? "," : "\t");
-    int n = 0;
-    char *tok = strtok(line, sep);
-    while (tok && n < max_fields)
-    {
-        out[n++] = tok;
-        tok = strtok(NULL, sep);
-    }
-    return n;
+    size_t n = strlen(s), m = strlen(tail);
+    return n >= m && memcmp(s + n - m, tail, m) == 0;
 }
 static float parse_float_or(const char *s, float fallback)
 {
@@ -167,26 +193,9 @@ static void normalize_jedec(const char *in, char out6[7])
     else
         out6[0] = 0;
 }
-static int fatfs_gets(char *buf, int len, FIL *fp)
-{
-    if (len <= 1)
-        return 0;
-    UINT br = 0;
-    int i = 0;
-    char ch;
-    for (;;)
-    {
-        FRESULT fr = f_read(fp, &ch, 1, &br);
-        if (fr != FR_OK || br == 0)
-            break;
-        if (i < len - 1)
-            buf[i++] = ch;
-        if (ch == '\n')
-            break;
-    }
-    buf[i] = 0;
-    return (i > 0);
-}
+// One read-ahead buffer for both passes (DB load, then RESULTS.CSV); the
+// report runs on one core and never has both files open.
+static REPORT_THREAD_LOCAL csv_reader_t s_csv;
 
 /* ---------------------------- Statistics -------------------------------- */
 typedef struct
@@ -195,89 +204,22 @@ typedef struct
     float mean, p25, p50, p75, minv, maxv, stddev;
 } stats_t;
 
-static int cmp_float_asc(const void *a, const void *b)
-{
-    const float *x = (const float *)a, *y = (const float *)b;
-    return (*x < *y) ? -1 : (*x > *y) ? 1
-                                      : 0;
-}
-static int safe_copy_sort(const float *src, int n, float **dst_out)
-{
-    if (n <= 0)
-    {
-        *dst_out = NULL;
-        return 0;
-    }
-    float *v = (float *)malloc(n * sizeof(float));
-    if (!v)
-    {
-        *dst_out = NULL;
-        return 0;
-    }
-    memcpy(v, src, n * sizeof(float));
-    qsort(v, n, sizeof(float), cmp_float_asc);
-    *dst_out = v;
-    return n;
-}
-static float percentile_sorted(const float *v, int n, float q)
-{
-    if (n <= 0)
-        return NAN;
-    if (q <= 0)
-        return v[0];
-    if (q >= 1)
-        return v[n - 1];
-    float pos = q * (n - 1);
-    int i = (int)floorf(pos);
-    int j = (int)ceilf(pos);
-    float t = pos - i;
-    return (1.0f - t) * v[i] + t * v[j];
-}
-static void calc_stats_from_vec(const float *src, int n, stats_t *S)
+// Fold a streaming summary into the report's stats (population stddev, as before)
+static void stats_from_summary(const stream_summary_t *acc, stats_t *S)
 {
-    S->n = n;
-    if (n <= 0)
+    S->n = (int)acc->w.n;
+    if (acc->w.n == 0)
     {
         S->mean = S->p25 = S->p50 = S->p75 = S->minv = S->maxv = S->stddev = NAN;
         return;
     }
-    float sum = 0.0f, mn = src[0], mx = src[0];
-    for (int i = 0; i < n; i++)
-    {
-        float v = src[i];
-        sum += v;
-        if (v < mn)
-            mn = v;
-        if (v > mx)
-            mx = v;
-    }
-    S->mean = sum / n;
-
-    float *sorted = NULL;
-    int m = safe_copy_sort(src, n, &sorted);
-    if (m > 0)
-    {
-        S->p25 = percentile_sorted(sorted, m, 0.25f);
-        S->p50 = percentile_sorted(sorted, m, 0.50f);
-        S->p75 = percentile_sorted(sorted, m, 0.75f);
-        free(sorted);
-    }
-    else
-    {
-        S->p25 = S->p50 = S->p75 = NAN;
-    }
-    S->minv = mn;
-    S->maxv = mx;
-
-    // population stddev
-    float var = 0.0f;
-    for (int i = 0; i < n; i++)
-    {
-        float d = src[i] - S->mean;
-        var += d * d;
-    }
-    var /= n;
-    S->stddev = sqrtf(var);
+    S->mean = (float)acc->w.mean;
+    S->p25 = (float)stream_summary_quartile(acc, 1);
+    S->p50 = (float)stream_summary_quartile(acc, 2);
+    S->p75 = (float)stream_summary_quartile(acc, 3);
+    S->minv = (float)acc->w.min;
+    S->maxv = (float)acc->w.max;
+    S->stddev = (float)stream_stats_sd_pop(&acc->w);
 }
 
 /* --------------------------- Aggregation ------------------------------- */
@@ -296,22 +238,40 @@ typedef struct
     float read_mean_us[G_COUNT]; // kept: average latency (µs) per size group
 } agg_t;
 
-typedef struct
+/* One pass over RESULTS.CSV into fixed-size accumulators: no per-sample
+   storage, so RAM use does not grow with the log (see stream_stats.h). */
+enum
 {
-    float *v;
-    int n, cap;
-} vec_t;
+    ACC_READ_MBPS = 0,
+    ACC_READ_LAT_MS,
+    ACC_WRITE_MS,
+    ACC_ERASE_MS,
+    ACC_COUNT
+};
+static REPORT_THREAD_LOCAL stream_summary_t s_acc[ACC_COUNT][G_COUNT]; // 6 KB, static: kept off the stack
+
+/* REPORT.STA = header + s_acc as of `offset` bytes of RESULTS.CSV. The next
+   report resumes from there and only parses the appended rows. Hashes of the
+   first and last REPORT_STATE_FP_BYTES before offset catch truncation,
+   rewrites and edits near the end; any mismatch means a full rebuild.
+   Delete REPORT.STA to force one. */
+#define STATE_FILENAME "REPORT.STA"
+#define REPORT_STATE_VERSION 2u
+#define REPORT_STATE_FP_BYTES 512u
 
-static void vec_push(vec_t *V, float x)
+typedef struct
 {
-    if (V->n == V->cap)
-    {
-        int nc = V->cap ? V->cap * 2 : 32;
-        V->v = (float *)realloc(V->v, nc * sizeof(float));
-        V->cap = nc;
-    }
-    V->v[V->n++] = x;
-}
+    char magic[4];           // "RPST"
+    uint32_t version;
+    uint32_t acc_bytes;      // sizeof s_acc (layout guard, e.g. P2_MARKERS)
+    char jedec[8];           // filter the rows were aggregated for
+    char dev_tag[4];         // and the slot ("_d1"; empty = all)
+    uint32_t capacity_bytes; // decides WHOLE classification
+    uint32_t offset;         // RESULTS.CSV bytes covered (whole lines)
+    uint32_t rows;           // lines parsed so far, all chips
+    uint32_t head_hash;      // FNV-1a of [0, min(offset, FP))
+    uint32_t tail_hash;      // FNV-1a of [offset - FP, offset)
+} report_state_t;
 
 static group_t classify_group(uint32_t bytes, uint32_t whole_bytes)
 {
@@ -330,53 +290,204 @@ static group_t classify_group(uint32_t bytes, uint32_t whole_bytes)
     return (group_t)(-1);
 }
 
+/* ------------------------- Aggregate checkpoint ------------------------ */
+static uint32_t fnv1a(uint32_t h, const uint8_t *p, UINT n)
+{
+    while (n--)
+    {
+        h ^= *p++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Hash [from, to) of an open file; uses the reader buffer as scratch, so only
+// call it when no csv_read_line() pass is in progress.
+static bool hash_range(FIL *f, FSIZE_t from, FSIZE_t to, uint32_t *out, uint8_t *last)
+{
+    uint32_t h = 2166136261u;
+    if (f_lseek(f, from) != FR_OK)
+        return false;
+    while (from < to)
+    {
+        UINT want = (to - from > sizeof s_csv.buf) ? (UINT)sizeof s_csv.buf : (UINT)(to - from);
+        UINT br = 0;
+        if (f_read(f, s_csv.buf, want, &br) != FR_OK || br != want)
+            return false;
+        h = fnv1a(h, s_csv.buf, br);
+        if (last)
+            *last = s_csv.buf[br - 1];
+        from += br;
+    }
+    *out = h;
+    return true;
+}
+
+static bool state_fingerprint(FIL *f, uint32_t offset, report_state_t *st, uint8_t *last)
+{
+    uint32_t head_end = offset < REPORT_STATE_FP_BYTES ? offset : REPORT_STATE_FP_BYTES;
+    uint32_t tail_beg = offset > REPORT_STATE_FP_BYTES ? offset - REPORT_STATE_FP_BYTES : 0;
+    return hash_range(f, 0, head_end, &st->head_hash, NULL) &&
+           hash_range(f, tail_beg, offset, &st->tail_hash, last);
+}
+
+// Restores s_acc and returns the resume offset, or 0 (with a reason) when
+// the checkpoint does not describe a prefix of the current RESULTS.CSV.
+static uint32_t state_load(FIL *results, const char *jedec6, uint32_t capacity_bytes,
+                           const char **why, uint32_t *rows)
+{
+    FIL sf;
+    report_state_t st;
+    UINT br = 0;
+    *why = s_opt->state ? "no checkpoint" : "checkpoint off";
+    if (!s_opt->state || f_open(&sf, s_opt->state, FA_READ) != FR_OK)
+        return 0;
+    bool ok = f_read(&sf, &st, sizeof st, &br) == FR_OK && br == sizeof st;
+    if (ok && (memcmp(st.magic, "RPST", 4) || st.version != REPORT_STATE_VERSION ||
+               st.acc_bytes != sizeof s_acc))
+    {
+        *why = "old format";
+        ok = false;
+    }
+    else if (ok && (strncmp(st.jedec, jedec6 ? jedec6 : "", sizeof st.jedec) ||
+                    strncmp(st.dev_tag, s_opt->dev_tag ? s_opt->dev_tag : "", sizeof st.dev_tag) ||
+                    st.capacity_bytes != capacity_bytes))
+    {
+        *why = "different chip";
+        ok = false;
+    }
+    else if (ok && (FSIZE_t)st.offset > f_size(results))
+    {
+        *why = "log truncated";
+        ok = false;
+    }
+    if (ok)
+    {
+        report_state_t now = st;
+        if (!state_fingerprint(results, st.offset, &now, NULL) ||
+            now.head_hash != st.head_hash || now.tail_hash != st.tail_hash)
+        {
+            *why = "log edited";
+            ok = false;
+        }
+    }
+    if (ok)
+        ok = f_read(&sf, s_acc, sizeof s_acc, &br) == FR_OK && br == sizeof s_acc;
+    f_close(&sf);
+    if (!ok)
+        return 0;
+    *rows = st.rows;
+    return st.offset;
+}
+
+static void state_save(FIL *results, const char *jedec6, uint32_t capacity_bytes,
+                       uint32_t offset, uint32_t rows)
+{
+    report_state_t st;
+    memset(&st, 0, sizeof st);
+    memcpy(st.magic, "RPST", 4);
+    st.version = REPORT_STATE_VERSION;
+    st.acc_bytes = sizeof s_acc;
+    strncpy(st.jedec, jedec6 ? jedec6 : "", sizeof st.jedec - 1);
+    strncpy(st.dev_tag, s_opt->dev_tag ? s_opt->dev_tag : "", sizeof st.dev_tag - 1);
+    st.capacity_bytes = capacity_bytes;
+    st.offset = offset;
+    st.rows = rows;
+
+    // Only checkpoint at a line boundary; a half-written last row is
+    // re-read next time
+    uint8_t last = '\n';
+    if (!state_fingerprint(results, offset, &st, &last) || last != '\n')
+    {
+        f_unlink(s_opt->state);
+        return;
+    }
+
+    FIL sf;
+    UINT bw1 = 0, bw2 = 0;
+    if (f_open(&sf, s_opt->state, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+        return;
+    FRESULT fr = f_write(&sf, &st, sizeof st, &bw1);
+    if (fr == FR_OK)
+        fr = f_write(&sf, s_acc, sizeof s_acc, &bw2);
+    f_close(&sf);
+    if (fr != FR_OK || bw1 != sizeof st || bw2 != sizeof s_acc)
+    {
+        REPORT_LOG("⚠️  %s write failed (error: %d); next report rebuilds\n", s_opt->state, fr);
+        f_unlink(s_opt->state);
+    }
+}
+
 /* RESULTS.CSV columns assumed:
    0: JEDEC, 1: op(read|program|write|erase), 2: size(bytes), 3: addr, 4: elapsed_us, 5: throughput_MBps, ...
 */
-static void collect_aggregates(agg_t *A, uint32_t capacity_bytes)
+static void collect_aggregates(agg_t *A, uint32_t capacity_bytes, const char *jedec_filter6)
 {
     memset(A, 0, sizeof(*A));
-    A->sck_MHz = flash_spi_get_baud_hz() / 1e6f;
+    A->sck_MHz = s_opt->sck_MHz;
 
-    vec_t read_v[G_COUNT] = {0};
-    vec_t write_v[G_COUNT] = {0};
-    vec_t erase_v[G_COUNT] = {0};
-    vec_t read_us[G_COUNT] = {0};     // per-sample READ latency in microseconds
-    vec_t read_lat_ms[G_COUNT] = {0}; // NEW: per-sample READ latency in milliseconds
+    for (int k = 0; k < ACC_COUNT; ++k)
+        for (int g = 0; g < G_COUNT; ++g)
+            stream_summary_init(&s_acc[k][g]);
 
     FIL f;
-    if (f_open(&f, RESULTS_FILENAME, FA_READ) != FR_OK)
+    if (f_open(&f, s_opt->results, FA_READ) != FR_OK)
     {
+        if (s_opt->state && !s_opt->state_readonly)
+            f_unlink(s_opt->state);
         for (int g = 0; g < G_COUNT; ++g)
         {
-            calc_stats_from_vec(NULL, 0, &A->read_s.s[g]);
-            calc_stats_from_vec(NULL, 0, &A->write_s.s[g]);
-            calc_stats_from_vec(NULL, 0, &A->erase_s.s[g]);
+            stats_from_summary(&s_acc[ACC_READ_MBPS][g], &A->read_s.s[g]);
+            stats_from_summary(&s_acc[ACC_WRITE_MS][g], &A->write_s.s[g]);
+            stats_from_summary(&s_acc[ACC_ERASE_MS][g], &A->erase_s.s[g]);
+            stats_from_summary(&s_acc[ACC_READ_LAT_MS][g], &A->read_lat_ms.s[g]);
+            A->read_mean_us[g] = NAN;
         }
         return;
     }
 
+    // Resume from the checkpoint when it still matches the log
+    const char *why = "";
+    uint32_t rows = 0;
+    uint32_t start = state_load(&f, jedec_filter6, capacity_bytes, &why, &rows);
+    if (!start)
+    {
+        rows = 0;
+        for (int k = 0; k < ACC_COUNT; ++k)
+            for (int g = 0; g < G_COUNT; ++g)
+                stream_summary_init(&s_acc[k][g]);
+    }
+    uint32_t rows_before = rows;
+
     char line[MAX_LINE];
-    while (fatfs_gets(line, sizeof line, &f))
+    f_lseek(&f, start);
+    csv_reader_init(&s_csv, &f);
+    unsigned long matched = 0;
+    while (csv_read_line(&s_csv, line, sizeof line) >= 0)
     {
+        rows++;
         trim(line);
         if (!line[0])
             continue;
 
-        char work[MAX_LINE];
-        strncpy(work, line, sizeof work);
-        work[sizeof work - 1] = 0;
         char *flds[16];
-        int nf = 0;
-        char *tok = strtok(work, ",");
-        while (tok && nf < 16)
+        int nf = csv_split(line, ',', flds, 16);
+        if (nf < 6)
+            continue;
+
+        // Several chips share RESULTS.CSV: keep only the one being reported
+        if (jedec_filter6 && jedec_filter6[0])
         {
-            flds[nf++] = tok;
-            tok = strtok(NULL, ",");
+            char row_j[7] = {0};
+            normalize_jedec(flds[0], row_j);
+            if (strcmp(row_j, jedec_filter6) != 0)
+                continue;
         }
-        if (nf < 6)
+        // Two identical chips differ only in the slot tag ending the notes
+        if (s_opt->dev_tag && s_opt->dev_tag[0] && !ends_with(nf > 11 ? flds[11] : "", s_opt->dev_tag))
             continue;
 
+        matched++;
         const char *op = flds[1];
         uint32_t size = (uint32_t)parse_int_or(flds[2], 0);
         float elapsed_us = parse_float_or(flds[4], -1.0f);
@@ -394,13 +505,10 @@ static void collect_aggregates(agg_t *A, uint32_t capacity_bytes)
                 float mbps = (secs > 0.0f) ? (mb / secs) : NAN;
                 if (mbps == mbps && mbps > 0.0f)
                 { // not NaN and positive
-                    vec_push(&read_v[g], mbps);
+                    stream_summary_push(&s_acc[ACC_READ_MBPS][g], mbps);
                 }
-                // keep avg-latency for console-style MB/s(avg)
-                vec_push(&read_us[g], (float)elapsed_us);
-
-                // also keep per-sample latency in ms for summary
-                vec_push(&read_lat_ms[g], (float)elapsed_us / 1000.0f);
+                // per-sample latency in ms; its mean also gives MB/s(avg)
+                stream_summary_push(&s_acc[ACC_READ_LAT_MS][g], elapsed_us / 1000.0f);
             }
             continue;
         }
@@ -410,7 +518,7 @@ static void collect_aggregates(agg_t *A, uint32_t capacity_bytes)
             if (elapsed_us > 0)
             {
                 float ms = elapsed_us / 1000.0f; // total op time (ms)
-                vec_push(&write_v[g], ms);
+                stream_summary_push(&s_acc[ACC_WRITE_MS][g], ms);
             }
         }
         else if (!strcmp(op, "erase"))
@@ -418,38 +526,38 @@ static void collect_aggregates(agg_t *A, uint32_t capacity_bytes)
             if (elapsed_us > 0)
             {
                 float ms = elapsed_us / 1000.0f; // total op time (ms)
-                vec_push(&erase_v[g], ms);
+                stream_summary_push(&s_acc[ACC_ERASE_MS][g], ms);
             }
         }
     }
+    uint32_t end = (uint32_t)csv_reader_tell(&s_csv);
+    bool read_ok = (s_csv.err == FR_OK);
+
+    if (start)
+        REPORT_LOG("📈 Report: resumed at byte %lu of %s, %lu new lines\n",
+                   (unsigned long)start, s_opt->results, (unsigned long)(rows - rows_before));
+    else
+        REPORT_LOG("📈 Report: full pass over %s (%lu lines; %s)\n",
+                   s_opt->results, (unsigned long)rows, why);
+    if (s_opt->out)
+    {
+        s_opt->out->rows = rows - rows_before;
+        s_opt->out->matched = matched;
+    }
+    if (read_ok && s_opt->state && !s_opt->state_readonly)
+        state_save(&f, jedec_filter6, capacity_bytes, end, rows);
     f_close(&f);
 
     for (int g = 0; g < G_COUNT; ++g)
     {
-        calc_stats_from_vec(read_v[g].v, read_v[g].n, &A->read_s.s[g]);
-        calc_stats_from_vec(write_v[g].v, write_v[g].n, &A->write_s.s[g]);
-        calc_stats_from_vec(erase_v[g].v, erase_v[g].n, &A->erase_s.s[g]);
-        // NEW: read latency stats (ms)
-        calc_stats_from_vec(read_lat_ms[g].v, read_lat_ms[g].n, &A->read_lat_ms.s[g]);
-
-        // Compute average latency (µs) for console-style read MB/s(avg)
-        if (read_us[g].n > 0)
-        {
-            double acc = 0.0;
-            for (int i = 0; i < read_us[g].n; ++i)
-                acc += read_us[g].v[i];
-            A->read_mean_us[g] = (float)(acc / (double)read_us[g].n);
-        }
-        else
-        {
-            A->read_mean_us[g] = NAN;
-        }
-
-        free(read_v[g].v);
-        free(write_v[g].v);
-        free(erase_v[g].v);
-        free(read_us[g].v);
-        free(read_lat_ms[g].v);
+        stats_from_summary(&s_acc[ACC_READ_MBPS][g], &A->read_s.s[g]);
+        stats_from_summary(&s_acc[ACC_WRITE_MS][g], &A->write_s.s[g]);
+        stats_from_summary(&s_acc[ACC_ERASE_MS][g], &A->erase_s.s[g]);
+        stats_from_summary(&s_acc[ACC_READ_LAT_MS][g], &A->read_lat_ms.s[g]);
+
+        // Average latency (µs) for console-style read MB/s(avg)
+        const stream_stats_t *lat = &s_acc[ACC_READ_LAT_MS][g].w;
+        A->read_mean_us[g] = lat->n ? (float)(lat->mean * 1000.0) : NAN;
     }
 }
 
@@ -467,124 +575,32 @@ static float mbps_from_avg_latency(group_t g, const agg_t *A, uint32_t capacity_
 }
 
 /* --------------------------- DB loader ---------------------------------- */
-static int load_database(FIL *fp, db_row_t *rows, int max_rows)
+// Rows come from the compiled image (datasheet.cdb, rebuilt by chip_db.c
+// when datasheet.csv changes), so the CSV is not re-parsed per report.
+static void db_row_from_chipdb(const chipdb_row_t *c, db_row_t *r)
 {
-    if (f_open(fp, DB_FILENAME, FA_READ) != FR_OK)
-        return 0;
-
-    char buf[MAX_LINE];
-    if (!fatfs_gets(buf, sizeof buf, fp))
-    {
-        f_close(fp);
-        return 0;
-    }
-    trim(buf);
-
-    char headcpy[MAX_LINE];
-    strncpy(headcpy, buf, sizeof headcpy);
-    headcpy[sizeof headcpy - 1] = 0;
-    char *cols[64];
-    int hc = split_fields(headcpy, cols, 64);
-
-    int idx_model = -1, idx_company = -1, idx_family = -1, idx_capacity = -1, idx_jedec = -1;
-    int idx_typprog = -1, idx_typ4k = -1, idx_typ32k = -1, idx_typ64k = -1, idx_read50 = -1;
-
-    for (int i = 0; i < hc; i++)
-    {
-        char name[96];
-        strncpy(name, cols[i], sizeof name);
-        name[sizeof name - 1] = 0;
-        trim(name);
-        upper_str(name);
-        if (strstr(name, "CHIP_MODEL"))
-            idx_model = i;
-        else if (strstr(name, "COMPANY"))
-            idx_company = i;
-        else if (strstr(name, "CHIP_FAMILY"))
-            idx_family = i;
-        else if (strstr(name, "CAPACITY") && strstr(name, "MBIT"))
-            idx_capacity = i;
-        else if (strstr(name, "JEDEC"))
-            idx_jedec = i;
-        else if (strstr(name, "TYP_PAGE_PROGRAM"))
-            idx_typprog = i;
-        else if (strstr(name, "TYP_4KB"))
-            idx_typ4k = i;
-        else if (strstr(name, "TYP_32KB"))
-            idx_typ32k = i;
-        else if (strstr(name, "TYP_64KB"))
-            idx_typ64k = i;
-        else if (strstr(name, "50MHZ_READ_SPEED") || strstr(name, "50MHZ_READ") || strstr(name, "READ50"))
-            idx_read50 = i;
-    }
-
-    int n = 0;
-    while (n < max_rows && fatfs_gets(buf, sizeof buf, fp))
-    {
-        trim(buf);
-        if (!buf[0])
-            continue;
-
-        char linecpy[MAX_LINE];
-        strncpy(linecpy, buf, sizeof linecpy);
-        linecpy[sizeof linecpy - 1] = 0;
-        char *f[64];
-        int c = split_fields(linecpy, f, 64);
-        if (c <= 1)
-            continue;
-
-        db_row_t *r = &rows[n];
-        memset(r, 0, sizeof *r);
-        r->capacity_mbit = -1;
-        r->typ_4k_ms = -1.0f;
-        r->typ_32k_ms = -1.0f;
-        r->typ_64k_ms = -1.0f;
-        r->typ_page_ms = -1.0f;
-        r->read50_MBps = -1.0f;
+    memset(r, 0, sizeof *r);
+    normalize_jedec(c->jedec, r->jedec_norm); // report keeps only full 6-digit IDs
+    snprintf(r->chip_model, sizeof r->chip_model, "%s", c->model);
+    snprintf(r->company, sizeof r->company, "%s", c->company);
+    snprintf(r->family, sizeof r->family, "%s", c->family);
+    r->capacity_mbit = (c->capacity_mbit >= 0.0f) ? (int)c->capacity_mbit : -1;
+    r->typ_4k_ms = c->typ_4k_ms;
+    r->typ_32k_ms = c->typ_32k_ms;
+    r->typ_64k_ms = c->typ_64k_ms;
+    r->typ_page_ms = c->typ_page_ms;
+    r->read50_MBps = c->read50_MBps;
+}
 
-        if (idx_jedec >= 0 && idx_jedec < c)
-        {
-            char j[32];
-            strncpy(j, f[idx_jedec], sizeof j);
-            j[sizeof j - 1] = 0;
-            trim(j);
-            normalize_jedec(j, r->jedec_norm);
-        }
-        if (idx_model >= 0 && idx_model < c)
-        {
-            strncpy(r->chip_model, f[idx_model], sizeof r->chip_model);
-            r->chip_model[sizeof r->chip_model - 1] = 0;
-            trim(r->chip_model);
-        }
-        if (idx_company >= 0 && idx_company < c)
-        {
-            strncpy(r->company, f[idx_company], sizeof r->company);
-            r->company[sizeof r->company - 1] = 0;
-            trim(r->company);
-        }
-        if (idx_family >= 0 && idx_family < c)
-        {
-            strncpy(r->family, f[idx_family], sizeof r->family);
-            r->family[sizeof r->family - 1] = 0;
-            trim(r->family);
-        }
-        if (idx_capacity >= 0 && idx_capacity < c)
-            r->capacity_mbit = parse_int_or(f[idx_capacity], -1);
-        if (idx_typprog >= 0 && idx_typprog < c)
-            r->typ_page_ms = parse_float_or(f[idx_typprog], -1.0f);
-        if (idx_typ4k >= 0 && idx_typ4k < c)
-            r->typ_4k_ms = parse_float_or(f[idx_typ4k], -1.0f);
-        if (idx_typ32k >= 0 && idx_typ32k < c)
-            r->typ_32k_ms = parse_float_or(f[idx_typ32k], -1.0f);
-        if (idx_typ64k >= 0 && idx_typ64k < c)
-            r->typ_64k_ms = parse_float_or(f[idx_typ64k], -1.0f);
-        if (idx_read50 >= 0 && idx_read50 < c)
-            r->read50_MBps = parse_float_or(f[idx_read50], -1.0f);
-
-        n++;
-    }
-    f_close(fp);
-    return n;
+// One row at a time: scoring never holds more than the row being looked at,
+// so report RAM does not grow with the database.
+static bool db_get_row(chipdb_t *db, uint32_t idx, db_row_t *r)
+{
+    chipdb_row_t c;
+    if (!chipdb_read_row(db, idx, &c))
+        return false;
+    db_row_from_chipdb(&c, r);
+    return true;
 }
 
 /* ---------------- Identity fill (per your exact rule) ------------------- */
@@ -717,7 +733,7 @@ static void write_three_cols(FIL *rf, const char *title, const char *R, const ch
     char row[1024];
     UINT bw;
     snprintf(row, sizeof row, "%s,%s,%s,%s\n", title, R, W, E);
-    f_write(rf, row, strlen(row), &bw);
+    report_put(rf, row, strlen(row), &bw);
 }
 static void write_three_cols_f(FIL *rf, const char *title, float R, float W, float E)
 {
@@ -750,152 +766,81 @@ static int float_almost_equal(float a, float b)
 
 
 /* ------------- DB means (closest to measured means) -------------------- */
-static void compute_db_means_closest(const db_row_t *rows, int n_rows,
-                                     const agg_t *A, uint32_t capacity_bytes,
-                                     float db_read[G_COUNT],
-                                     float db_write[G_COUNT],
-                                     float db_erase[G_COUNT],
-                                     int *out_read_winner_idx,
-                                     int read_winner_idx_by_group[G_COUNT])
+// Datasheet prediction for one row and size group, NAN when the row has no
+// value for it. The db_mean_*, possible_chips_* and final-guess code all use
+// these, so they agree on which rows have a value for a cell.
+static unsigned group_pages(group_t g, uint32_t capacity_bytes)
 {
-    for (int g = 0; g < G_COUNT; ++g)
-    {
-        db_read[g] = NAN;
-        db_write[g] = NAN;
-        db_erase[g] = NAN;
-        if (read_winner_idx_by_group)
-            read_winner_idx_by_group[g] = -1;
-    }
-    if (out_read_winner_idx)
-        *out_read_winner_idx = -1;
+    uint32_t bytes = (g == G_WHOLE) ? capacity_bytes : GROUP_BYTES[g];
+    return (unsigned)((bytes + PAGE_SIZE_BYTES - 1) / PAGE_SIZE_BYTES);
+}
 
-    /* READ: compare measured MB/s vs predicted read50 * scale */
-    float diff_sum[MAX_DB_ROWS];
-    int diff_cnt[MAX_DB_ROWS];
-    for (int i = 0; i < n_rows; i++)
-    {
-        diff_sum[i] = 0.0f;
-        diff_cnt[i] = 0;
-    }
+static float db_pred_read(const db_row_t *r, const agg_t *A)
+{
+    // MB/s @ 50 MHz scaled to the SCK the samples were taken at
+    if (!(r->read50_MBps > 0.0f) || !(A->sck_MHz > 0.0f))
+        return NAN;
+    return r->read50_MBps * (A->sck_MHz / 50.0f);
+}
 
-    if (A->sck_MHz > 0)
-    {
-        for (int g = 0; g < G_COUNT; ++g)
-        {
-            const stats_t *S = &A->read_s.s[g];
-            if (!(S->n > 0))
-                continue;
+static float db_pred_write(const db_row_t *r, group_t g, uint32_t capacity_bytes)
+{
+    unsigned pages = group_pages(g, capacity_bytes);
+    if (!(r->typ_page_ms > 0.0f) || pages == 0)
+        return NAN;
+    return r->typ_page_ms * (float)pages;
+}
 
-            float best_d = 1e9f;
-            float best_pred = NAN;
-            int best_i = -1;
-            for (int i = 0; i < n_rows; i++)
-            {
-                if (rows[i].read50_MBps > 0)
-                {
-                    float pred = rows[i].read50_MBps * (A->sck_MHz / 50.0f);
-                    float d = fabsf(pred - S->mean);
-                    if (d < best_d)
-                    {
-                        best_d = d;
-                        best_pred = pred;
-                        best_i = i;
-                    }
-                    diff_sum[i] += d;
-                    diff_cnt[i] += 1;
-                }
-            }
-            if (best_i >= 0)
-            {
-                db_read[g] = best_pred;
-                if (read_winner_idx_by_group)
-                    read_winner_idx_by_group[g] = best_i;
-            }
-        }
-    }
+static float db_ref_erase(const db_row_t *r, group_t g)
+{
+    float ref = NAN;
+    if (g == G_4K)
+        ref = r->typ_4k_ms;
+    else if (g == G_32K)
+        ref = r->typ_32k_ms;
+    else if (g == G_64K)
+        ref = r->typ_64k_ms;
+    return (ref > 0.0f) ? ref : NAN;
+}
 
-    if (out_read_winner_idx)
-    {
-        float best_avg = 1e9f;
-        int best_i = -1;
-        for (int i = 0; i < n_rows; i++)
-        {
-            if (diff_cnt[i] > 0)
-            {
-                float avg = diff_sum[i] / (float)diff_cnt[i];
-                if (avg < best_avg)
-                {
-                    best_avg = avg;
-                    best_i = i;
-                }
-            }
-        }
-        *out_read_winner_idx = best_i;
-    }
+/* Closest datasheet value to each measured mean, updated row by row.
+   read/write/erase[g] end up as the db_mean_* cells (NAN = no candidate). */
+typedef struct
+{
+    float read[G_COUNT], write[G_COUNT], erase[G_COUNT];
+    float read_d[G_COUNT], write_d[G_COUNT], erase_d[G_COUNT]; // |pred - mean| of those
+} db_means_t;
 
-    /* WRITE: compare measured ms/op vs typ_page_ms * pages */
+static void db_means_init(db_means_t *M)
+{
     for (int g = 0; g < G_COUNT; ++g)
     {
-        const stats_t *S = &A->write_s.s[g];
-        if (!(S->n > 0))
-            continue;
-
-        uint32_t bytes = (g == G_WHOLE) ? capacity_bytes : GROUP_BYTES[g];
-        if (g == G_WHOLE && bytes == 0)
-            continue;
-        unsigned pages = (unsigned)((bytes + PAGE_SIZE_BYTES - 1) / PAGE_SIZE_BYTES);
-        if (pages == 0)
-            continue;
+        M->read[g] = M->write[g] = M->erase[g] = NAN;
+        M->read_d[g] = M->write_d[g] = M->erase_d[g] = 1e9f;
+    }
+}
 
-        float best_d = 1e9f;
-        float best_pred = NAN;
-        for (int i = 0; i < n_rows; i++)
-        {
-            if (rows[i].typ_page_ms > 0)
-            {
-                float pred = rows[i].typ_page_ms * (float)pages;
-                float d = fabsf(pred - S->mean);
-                if (d < best_d)
-                {
-                    best_d = d;
-                    best_pred = pred;
-                }
-            }
-        }
-        if (best_d < 1e9f)
-            db_write[g] = best_pred;
+static void closest_push(float *best, float *best_d, float pred, const stats_t *S)
+{
+    if (!(S->n > 0) || pred != pred)
+        return;
+    float d = fabsf(pred - S->mean);
+    if (d < *best_d) // strict: the first row wins a tie
+    {
+        *best_d = d;
+        *best = pred;
     }
+}
 
-    /* ERASE: compare measured ms/op vs typ_4k/32k/64k */
+static void compute_db_means_closest(db_means_t *M, const db_row_t *r,
+                                     const agg_t *A, uint32_t capacity_bytes)
+{
     for (int g = 0; g < G_COUNT; ++g)
     {
-        const stats_t *S = &A->erase_s.s[g];
-        if (!(S->n > 0))
-            continue;
-
-        float best_d = 1e9f;
-        float best_ref = NAN;
-        for (int i = 0; i < n_rows; i++)
-        {
-            float ref = NAN;
-            if (g == G_4K)
-                ref = rows[i].typ_4k_ms;
-            else if (g == G_32K)
-                ref = rows[i].typ_32k_ms;
-            else if (g == G_64K)
-                ref = rows[i].typ_64k_ms;
-            if (ref > 0)
-            {
-                float d = fabsf(ref - S->mean);
-                if (d < best_d)
-                {
-                    best_d = d;
-                    best_ref = ref;
-                }
-            }
-        }
-        if (best_d < 1e9f)
-            db_erase[g] = best_ref;
+        closest_push(&M->read[g], &M->read_d[g], db_pred_read(r, A), &A->read_s.s[g]);
+        closest_push(&M->write[g], &M->write_d[g], db_pred_write(r, (group_t)g, capacity_bytes),
+                     &A->write_s.s[g]);
+        closest_push(&M->erase[g], &M->erase_d[g], db_ref_erase(r, (group_t)g), &A->erase_s.s[g]);
     }
 }
 
@@ -905,104 +850,55 @@ static void compute_db_means_closest(const db_row_t *rows, int n_rows,
    read  column:  match predicted MB/s = read50_MBps * (A->sck_MHz / 50)
    write column:  match typ_page_ms * pages (pages based on group size)
    erase column:  match typ_4k_ms / typ_32k_ms / typ_64k_ms (per group)
+
+   The db_mean_* values are only final after a full pass, so this is a
+   second pass over the image.
 */
 static void build_possible_chips_for_all_groups(
-    const db_row_t *rows, int n_rows,
+    chipdb_t *db,
     const agg_t *A,
     uint32_t capacity_bytes,
-    const float db_read[G_COUNT],
-    const float db_write[G_COUNT],
-    const float db_erase[G_COUNT],
+    const db_means_t *M,
     char poss_read[G_COUNT][256],
     char poss_write[G_COUNT][256],
     char poss_erase[G_COUNT][256])
 {
+    bool any = false;
     for (int g = 0; g < G_COUNT; ++g)
     {
-        poss_read[g][0]  = 0;
+        poss_read[g][0] = 0;
         poss_write[g][0] = 0;
         poss_erase[g][0] = 0;
+        any |= (M->read[g] == M->read[g]) || (M->write[g] == M->write[g]) ||
+               (M->erase[g] == M->erase[g]);
+    }
 
-        /* ---- READ candidates for this group ---- */
-        if (db_read[g] == db_read[g] && A->sck_MHz > 0.0f) // db_read[g] not NaN
-        {
-            float scale = A->sck_MHz / 50.0f;
-            for (int i = 0; i < n_rows; ++i)
-            {
-                if (!(rows[i].read50_MBps > 0.0f) || !rows[i].jedec_norm[0])
-                    continue;
-
-                // Same formula as in compute_db_means_closest()
-                float pred = rows[i].read50_MBps * scale;
-                if (float_almost_equal(pred, db_read[g]))
-                {
-                    append_token(poss_read[g], 256, rows[i].jedec_norm);
-                }
-            }
-        }
-        if (!poss_read[g][0])
+    uint32_t n_rows = any ? chipdb_count(db) : 0; // nothing to match: skip the pass
+    db_row_t r;
+    for (uint32_t i = 0; i < n_rows && db_get_row(db, i, &r); ++i)
+    {
+        if (!r.jedec_norm[0])
+            continue;
+        for (int g = 0; g < G_COUNT; ++g)
         {
-            strncpy(poss_read[g], NA_STR, 256);
-            poss_read[g][255] = 0;
+            // float_almost_equal() is false for NAN on either side
+            if (float_almost_equal(db_pred_read(&r, A), M->read[g]))
+                append_token(poss_read[g], 256, r.jedec_norm);
+            if (float_almost_equal(db_pred_write(&r, (group_t)g, capacity_bytes), M->write[g]))
+                append_token(poss_write[g], 256, r.jedec_norm);
+            if (float_almost_equal(db_ref_erase(&r, (group_t)g), M->erase[g]))
+                append_token(poss_erase[g], 256, r.jedec_norm);
         }
+    }
 
-        /* ---- WRITE candidates for this group ---- */
-        if (db_write[g] == db_write[g])
-        {
-            uint32_t bytes = (g == G_WHOLE) ? capacity_bytes : GROUP_BYTES[g];
-            if (!(g == G_WHOLE && bytes == 0) && bytes > 0)
-            {
-                unsigned pages = (unsigned)((bytes + PAGE_SIZE_BYTES - 1) / PAGE_SIZE_BYTES);
-                if (pages > 0)
-                {
-                    for (int i = 0; i < n_rows; ++i)
-                    {
-                        if (!(rows[i].typ_page_ms > 0.0f) || !rows[i].jedec_norm[0])
-                            continue;
-
-                        // Same formula as for db_write[g]
-                        float pred = rows[i].typ_page_ms * (float)pages;
-                        if (float_almost_equal(pred, db_write[g]))
-                        {
-                            append_token(poss_write[g], 256, rows[i].jedec_norm);
-                        }
-                    }
-                }
-            }
-        }
+    for (int g = 0; g < G_COUNT; ++g)
+    {
+        if (!poss_read[g][0])
+            snprintf(poss_read[g], 256, "%s", NA_STR);
         if (!poss_write[g][0])
-        {
-            strncpy(poss_write[g], NA_STR, 256);
-            poss_write[g][255] = 0;
-        }
-
-        /* ---- ERASE candidates for this group ---- */
-        if (db_erase[g] == db_erase[g])
-        {
-            for (int i = 0; i < n_rows; ++i)
-            {
-                if (!rows[i].jedec_norm[0])
-                    continue;
-
-                float ref = NAN;
-                if (g == G_4K)
-                    ref = rows[i].typ_4k_ms;
-                else if (g == G_32K)
-                    ref = rows[i].typ_32k_ms;
-                else if (g == G_64K)
-                    ref = rows[i].typ_64k_ms;
-
-                if (ref > 0.0f && float_almost_equal(ref, db_erase[g]))
-                {
-                    append_token(poss_erase[g], 256, rows[i].jedec_norm);
-                }
-            }
-        }
+            snprintf(poss_write[g], 256, "%s", NA_STR);
         if (!poss_erase[g][0])
-        {
-            strncpy(poss_erase[g], NA_STR, 256);
-            poss_erase[g][255] = 0;
-        }
+            snprintf(poss_erase[g], 256, "%s", NA_STR);
     }
 }
 
@@ -1106,6 +1002,10 @@ static void append_token(char *dst, size_t n, const char *tok)
 
 
 /* ------------------------ Final guess scoring --------------------------- */
+#ifndef REPORT_TOP_K
+#define REPORT_TOP_K 3 // best-scoring rows kept while streaming the DB
+#endif
+
 static float norm_diff(float meas, float ref)
 {
     if (!(meas > 0) || !(ref > 0))
@@ -1116,96 +1016,135 @@ static float norm_diff(float meas, float ref)
     return d;
 }
 
-static int pick_best_candidate(const db_row_t *rows, int n, const agg_t *A, const char *jedec_norm,
-                               uint32_t capacity_bytes, float *out_score, int *used_metrics_out)
+// Lower is better. *used_out = metrics that contributed; 0 = can't be scored.
+static float score_row(const db_row_t *r, const agg_t *A, const char *jedec_norm,
+                       uint32_t capacity_bytes, int *used_out)
 {
-    int best = -1;
-    float best_score = 1e9f;
-    int best_used = 0;
+    float score = 0.0f;
+    int used = 0;
 
-    for (int i = 0; i < n; i++)
+    // READ, then WRITE, then ERASE: per group measured
+    for (int g = 0; g < G_COUNT; ++g)
     {
-        float score = 0.0f;
-        int used = 0;
-
-        // READ: per group measured
-        if (rows[i].read50_MBps > 0 && A->sck_MHz > 0)
+        float pred = db_pred_read(r, A);
+        if (A->read_s.s[g].n > 0 && pred == pred)
         {
-            for (int g = 0; g < G_COUNT; ++g)
-            {
-                const stats_t *S = &A->read_s.s[g];
-                if (S->n > 0)
-                {
-                    float pred = rows[i].read50_MBps * (A->sck_MHz / 50.0f);
-                    score += norm_diff(S->mean, pred);
-                    used++;
-                }
-            }
+            score += norm_diff(A->read_s.s[g].mean, pred);
+            used++;
         }
-
-        // WRITE: per group measured
-        if (rows[i].typ_page_ms > 0)
+    }
+    for (int g = 0; g < G_COUNT; ++g)
+    {
+        float pred = db_pred_write(r, (group_t)g, capacity_bytes);
+        if (A->write_s.s[g].n > 0 && pred == pred)
         {
-            for (int g = 0; g < G_COUNT; ++g)
-            {
-                const stats_t *S = &A->write_s.s[g];
-                if (S->n > 0)
-                {
-                    uint32_t bytes = (g == G_WHOLE) ? capacity_bytes : GROUP_BYTES[g];
-                    if (g == G_WHOLE && bytes == 0)
-                        continue;
-                    unsigned pages = (unsigned)((bytes + PAGE_SIZE_BYTES - 1) / PAGE_SIZE_BYTES);
-                    if (pages == 0)
-                        continue;
-                    float pred = rows[i].typ_page_ms * (float)pages;
-                    score += norm_diff(S->mean, pred);
-                    used++;
-                }
-            }
+            score += norm_diff(A->write_s.s[g].mean, pred);
+            used++;
         }
-
-        // ERASE: per group measured
-        for (int g = 0; g < G_COUNT; ++g)
+    }
+    for (int g = 0; g < G_COUNT; ++g)
+    {
+        float ref = db_ref_erase(r, (group_t)g);
+        if (A->erase_s.s[g].n > 0 && ref == ref)
         {
-            const stats_t *S = &A->erase_s.s[g];
-            if (S->n <= 0)
-                continue;
-            float ref = NAN;
-            if (g == G_4K)
-                ref = rows[i].typ_4k_ms;
-            else if (g == G_32K)
-                ref = rows[i].typ_32k_ms;
-            else if (g == G_64K)
-                ref = rows[i].typ_64k_ms;
-            if (ref > 0)
-            {
-                score += norm_diff(S->mean, ref);
-                used++;
-            }
+            score += norm_diff(A->erase_s.s[g].mean, ref);
+            used++;
         }
+    }
 
-        if (!used)
-            continue; // this row can't be scored
+    if (used && jedec_norm && jedec_norm[0] && r->jedec_norm[0] &&
+        strcmp(jedec_norm, r->jedec_norm) == 0)
+    {
+        score *= 0.25f; // strong bias if JEDEC matches
+    }
 
-        if (jedec_norm && jedec_norm[0] && rows[i].jedec_norm[0] &&
-            strcmp(jedec_norm, rows[i].jedec_norm) == 0)
-        {
-            score *= 0.25f; // strong bias if JEDEC matches
-        }
+    *used_out = used;
+    return score;
+}
 
-        if (score < best_score)
-        {
-            best_score = score;
-            best = i;
-            best_used = used;
-        }
+/* Top-K candidates by score. A max-heap on (score, row), so the root is the
+   weakest one kept and most rows cost a single compare. Rows are referenced
+   by image index and re-read when the winners are printed. */
+typedef struct
+{
+    float score;
+    uint32_t idx;
+    int used;
+} cand_t;
+
+typedef struct
+{
+    cand_t c[REPORT_TOP_K];
+    int n;
+} cand_heap_t;
+
+static bool cand_worse(const cand_t *a, const cand_t *b)
+{
+    // Equal scores: the earlier row ranks first (matches the old linear scan)
+    return a->score > b->score || (a->score == b->score && a->idx > b->idx);
+}
+
+static void cand_heap_push(cand_heap_t *H, cand_t c)
+{
+    int i;
+    if (H->n < REPORT_TOP_K)
+    {
+        for (i = H->n++; i > 0 && cand_worse(&c, &H->c[(i - 1) / 2]); i = (i - 1) / 2)
+            H->c[i] = H->c[(i - 1) / 2];
+        H->c[i] = c;
+        return;
+    }
+    if (!cand_worse(&H->c[0], &c))
+        return;
+    for (i = 0;;)
+    {
+        int k = 2 * i + 1;
+        if (k >= H->n)
+            break;
+        if (k + 1 < H->n && cand_worse(&H->c[k + 1], &H->c[k]))
+            k++;
+        if (!cand_worse(&H->c[k], &c))
+            break;
+        H->c[i] = H->c[k];
+        i = k;
+    }
+    H->c[i] = c;
+}
+
+// Best first; K is tiny, so insertion sort
+static void cand_heap_sort(cand_heap_t *H)
+{
+    for (int i = 1; i < H->n; ++i)
+    {
+        cand_t c = H->c[i];
+        int j = i;
+        for (; j > 0 && cand_worse(&H->c[j - 1], &c); --j)
+            H->c[j] = H->c[j - 1];
+        H->c[j] = c;
     }
+}
 
-    if (out_score)
-        *out_score = (best >= 0 ? best_score : NAN);
-    if (used_metrics_out)
-        *used_metrics_out = best_used;
-    return best;
+/* First pass over the image: db_mean_* cells and the final-guess candidates
+   come out of the same sequential read. */
+static void score_db_rows(chipdb_t *db, const agg_t *A, const char *jedec_norm,
+                          uint32_t capacity_bytes, db_means_t *M, cand_heap_t *H)
+{
+    db_means_init(M);
+    H->n = 0;
+
+    uint32_t n_rows = chipdb_count(db);
+    db_row_t r;
+    for (uint32_t i = 0; i < n_rows && db_get_row(db, i, &r); ++i)
+    {
+        compute_db_means_closest(M, &r, A, capacity_bytes);
+
+        cand_t c = {0};
+        c.idx = i;
+        c.score = score_row(&r, A, jedec_norm, capacity_bytes, &c.used);
+        if (c.used)
+            cand_heap_push(H, c);
+    }
+    cand_heap_sort(H);
 }
 
 /* ------------------------------ CSV writer ----------------------------- */
@@ -1245,10 +1184,36 @@ static void write_all_stats_for_group_ex(FIL *rf, const char *suffix,
     write_three_cols_f_std(rf, name, Sr ? Sr->stddev : NAN, Sw ? Sw->stddev : NAN, Se ? Se->stddev : NAN);
 }
 
+/* --------------------------- Archive tail rows ------------------------- */
+static REPORT_THREAD_LOCAL ra_result_t s_q; // 3.6 KB histogram, static like s_acc
+
+// p99 (ms) of one op/size series from s_opt->archive. The P² sketch only
+// tracks quartiles; the archive histogram answers any quantile, and its zone
+// maps keep each query to the segments of this chip, op and size. The archive
+// has no notes column, so a one-slot report leaves these NA.
+static float archive_p99_ms(uint8_t ops, group_t g, int n, const char *jedec_norm,
+                            uint32_t capacity_bytes, uint32_t *skipped, uint32_t *segments)
+{
+    uint32_t size = (g == G_WHOLE) ? capacity_bytes : GROUP_BYTES[g];
+    if (!s_opt->archive || (s_opt->dev_tag && s_opt->dev_tag[0]) || !size || n <= 0)
+        return NAN;
+    ra_filter_t f;
+    ra_filter_init(&f);
+    f.jedec = ra_pack_jedec(jedec_norm);
+    f.ops = ops;
+    f.size_min = f.size_max = size;
+    if (!results_archive_query(s_opt->archive, &f, &s_q))
+        return NAN;
+    *skipped += s_q.segments_skipped;
+    *segments += s_q.segments;
+    return (float)(ra_result_quantile(&s_q, 0.99) / 1000.0);
+}
+
 static void write_summary_ms_for_group(FIL *rf, const char *suffix,
                                        const stats_t *Sr_lat_ms, // read latency (ms)
                                        const stats_t *Sw_ms,
-                                       const stats_t *Se_ms)
+                                       const stats_t *Se_ms,
+                                       const float p99_ms[3])    // read/write/erase, NaN = NA
 {
     char name[64];
 
@@ -1301,9 +1266,12 @@ static void write_summary_ms_for_group(FIL *rf, const char *suffix,
                            Sr_lat_ms ? Sr_lat_ms->stddev : NAN,
                            Sw_ms ? Sw_ms->stddev : NAN,
                            Se_ms ? Se_ms->stddev : NAN);
+
+    snprintf(name, sizeof name, "p99_%s_ms", suffix);
+    write_three_cols_f_std(rf, name, p99_ms[0], p99_ms[1], p99_ms[2]);
 }
 
-static void write_report_csv(const db_row_t *rows, int n_rows,
+static void write_report_csv(chipdb_t *db,
                              const agg_t *A,
                              const db_row_t *match_row,
                              const char *jedec_norm,
@@ -1320,30 +1288,39 @@ static void write_report_csv(const db_row_t *rows, int n_rows,
                          f_cap_bytes, sizeof f_cap_bytes);
 
 
-    // Pre-compute db_means per (section,size) based on measured means only
-    float db_r[G_COUNT], db_w[G_COUNT], db_e[G_COUNT];
-    int read_winner_idx = -1;
-    int read_idx_by_group[G_COUNT];
-    compute_db_means_closest(rows, n_rows, A, capacity_bytes,
-                             db_r, db_w, db_e,
-                             &read_winner_idx,
-                             read_idx_by_group);
+    // Pass 1: db_means per (section,size) from measured means + final-guess candidates
+    db_means_t M;
+    cand_heap_t H;
+    score_db_rows(db, A, jedec_norm, capacity_bytes, &M, &H);
+    const float *db_r = M.read, *db_w = M.write, *db_e = M.erase;
 
-                                 // Build JEDEC candidate lists from db_mean_* values
+    // Pass 2: JEDEC candidate lists from db_mean_* values
     char poss_read[G_COUNT][256];
     char poss_write[G_COUNT][256];
     char poss_erase[G_COUNT][256];
-    build_possible_chips_for_all_groups(rows, n_rows, A, capacity_bytes,
-                                        db_r, db_w, db_e,
+    build_possible_chips_for_all_groups(db, A, capacity_bytes, &M,
                                         poss_read, poss_write, poss_erase);
 
-
-    // Possible read chips (overall winner)
-
-    // Final guess
+    // Final guess = heap winner; runners-up go to the console only
     float final_score = NAN;
-    int used_metrics = 0;
-    int best = pick_best_candidate(rows, n_rows, A, jedec_norm, capacity_bytes, &final_score, &used_metrics);
+    db_row_t best_row;
+    int best = -1;
+    for (int k = 0; k < H.n; ++k)
+    {
+        db_row_t r;
+        if (!db_get_row(db, H.c[k].idx, &r))
+            break;
+        if (k == 0)
+        {
+            best_row = r;
+            best = 0;
+            final_score = H.c[0].score;
+            REPORT_LOG("🔎 Closest datasheet rows (of %lu):\n", (unsigned long)chipdb_count(db));
+        }
+        REPORT_LOG("   %d. %s %s  score %.3f over %d metrics\n", k + 1,
+               r.jedec_norm[0] ? r.jedec_norm : NA_STR,
+               r.chip_model[0] ? r.chip_model : NA_STR, H.c[k].score, H.c[k].used);
+    }
 
     // Special-case: no measurements at all
     int any_meas = 0;
@@ -1385,9 +1362,9 @@ static void write_report_csv(const db_row_t *rows, int n_rows,
     {
         if (best >= 0)
         {
-            final_j = rows[best].jedec_norm[0] ? rows[best].jedec_norm : NA_STR;
-            final_m = rows[best].chip_model[0] ? rows[best].chip_model : NA_STR;
-            final_c = rows[best].company[0] ? rows[best].company : NA_STR;
+            final_j = best_row.jedec_norm[0] ? best_row.jedec_norm : NA_STR;
+            final_m = best_row.chip_model[0] ? best_row.chip_model : NA_STR;
+            final_c = best_row.company[0] ? best_row.company : NA_STR;
             f3_or_na(fscore, sizeof fscore, final_score);
         }
         else if (jedec_norm && jedec_norm[0])
@@ -1416,15 +1393,18 @@ static void write_report_csv(const db_row_t *rows, int n_rows,
     // ---------------- Write CSV ----------------
     FIL rf;
     UINT bw;
-    FRESULT fr = f_open(&rf, REPORT_FILENAME, FA_CREATE_ALWAYS | FA_WRITE);
+    s_buf_o = 0;
+    if (s_opt->buf && s_opt->buf_len)
+        s_opt->buf[0] = '\0';
+    FRESULT fr = s_opt->buf ? FR_OK : f_open(&rf, s_opt->report, FA_CREATE_ALWAYS | FA_WRITE);
     if (fr != FR_OK)
     {
-        printf("⛔ Failed to open %s (FR=%d)\n", REPORT_FILENAME, fr);
+        printf("⛔ Failed to open %s (FR=%d)\n", s_opt->report, fr);
         return;
     }
 
     const char *header = "title,read,write,erase\n";
-    f_write(&rf, header, strlen(header), &bw);
+    report_put(&rf, header, strlen(header), &bw);
 
     // Identity rows
     // Identity rows — SAME values for read | write | erase
@@ -1445,14 +1425,23 @@ static void write_report_csv(const db_row_t *rows, int n_rows,
     write_three_cols(&rf, "units_summary", "ms", "ms", "ms");
 
     // Summary rows in ms (follow console summary style)
+    uint32_t q_skipped = 0, q_segments = 0;
     for (int g = 0; g < G_COUNT; ++g)
     {
         const char *suf = group_suffix((group_t)g);
         const stats_t *Sr_lat_ms = &A->read_lat_ms.s[g]; // read latency (ms)
         const stats_t *Sw = &A->write_s.s[g];            // ms/op
         const stats_t *Se = &A->erase_s.s[g];            // ms/op
-        write_summary_ms_for_group(&rf, suf, Sr_lat_ms, Sw, Se);
+        const float p99[3] = {
+            archive_p99_ms(RA_OP_READ, (group_t)g, Sr_lat_ms->n, jedec_norm, capacity_bytes, &q_skipped, &q_segments),
+            archive_p99_ms(RA_OP_WRITE, (group_t)g, Sw->n, jedec_norm, capacity_bytes, &q_skipped, &q_segments),
+            archive_p99_ms(RA_OP_ERASE, (group_t)g, Se->n, jedec_norm, capacity_bytes, &q_skipped, &q_segments),
+        };
+        write_summary_ms_for_group(&rf, suf, Sr_lat_ms, Sw, Se, p99);
     }
+    if (q_segments)
+        REPORT_LOG("🗄️  p99 rows from %s: %lu of %lu segment visits skipped by zone map\n",
+                   s_opt->archive, (unsigned long)q_skipped, (unsigned long)q_segments);
 
     // DB mean rows (NA where no measurement for that size/section)
     for (int g = 0; g < G_COUNT; ++g)
@@ -1497,47 +1486,63 @@ write_three_cols(&rf, "conclusion_possible_chips",
 
     // Blank spacer row
     const char *sp = "\n";
-    f_write(&rf, sp, strlen(sp), &bw);
+    report_put(&rf, sp, strlen(sp), &bw);
 
     // ==== REVERTED CONCLUSION FORMAT (old style): its own 4-col header + one values row ====
     const char *conc_h = "final_guess_jedec,final_guess_model,final_guess_company,final_score\n";
-    f_write(&rf, conc_h, strlen(conc_h), &bw);
+    report_put(&rf, conc_h, strlen(conc_h), &bw);
 
     char row[512];
     snprintf(row, sizeof row, "%s,%s,%s,%s\n", final_j, final_m, final_c, fscore);
-    f_write(&rf, row, strlen(row), &bw);
+    report_put(&rf, row, strlen(row), &bw);
     // =============================================================================
 
-    f_close(&rf);
-    printf("📄 report.csv written (transposed + old-style conclusion).\n");
+    if (!s_opt->buf)
+    {
+        f_close(&rf);
+        REPORT_LOG("📄 %s written (transposed + old-style conclusion).\n", s_opt->report);
+    }
+
+    if (s_opt->out)
+    {
+        report_summary_t *o = s_opt->out;
+        snprintf(o->guess_jedec, sizeof o->guess_jedec, "%s", final_j);
+        snprintf(o->guess_model, sizeof o->guess_model, "%s", final_m);
+        snprintf(o->guess_company, sizeof o->guess_company, "%s", final_c);
+        o->score = (fscore[0] >= '0' && fscore[0] <= '9') ? (float)atof(fscore) : NAN;
+        o->report_bytes = s_opt->buf ? s_buf_o : 0;
+    }
 }
 
 /* --------------------------------- PUBLIC -------------------------------- */
-void report_generate_csv(void)
+void report_generate_ex(const report_opts_t *opts)
 {
-    // 1) Load DB
-    db_row_t rows[MAX_DB_ROWS];
-    FIL dbf;
-    int n_rows = load_database(&dbf, rows, MAX_DB_ROWS);
-
-    // 2) Detect JEDEC & match DB
-    char jedec_text[24] = {0};
-    flash_get_jedec_str(jedec_text, sizeof jedec_text);
+    report_opts_t o = *opts;
+    if (!o.results)
+        o.results = RESULTS_FILENAME;
+    if (!o.datasheet)
+        o.datasheet = DB_FILENAME;
+    if (!o.report)
+        o.report = REPORT_FILENAME;
+    if (o.out)
+        memset(o.out, 0, sizeof *o.out);
+    s_opt = &o;
+
+    // 1) Open the compiled DB; its rows are streamed, never loaded
+    chipdb_t db;
+    bool have_db = chipdb_open(&db, o.datasheet);
+
+    // 2) Match the chip's JEDEC in the DB
     char jedec_norm6[7] = {0};
-    normalize_jedec(jedec_text, jedec_norm6);
+    normalize_jedec(o.jedec ? o.jedec : "", jedec_norm6);
 
+    // Exact-JEDEC row through the image's hash index
+    db_row_t match;
     const db_row_t *match_row = NULL;
-    if (jedec_norm6[0] && n_rows > 0)
-    {
-        for (int i = 0; i < n_rows; i++)
-        {
-            if (rows[i].jedec_norm[0] && strcmp(rows[i].jedec_norm, jedec_norm6) == 0)
-            {
-                match_row = &rows[i];
-                break;
-            }
-        }
-    }
+    uint32_t match_idx = 0;
+    if (have_db && jedec_norm6[0] && chipdb_find(&db, jedec_norm6, &match_idx, NULL) &&
+        db_get_row(&db, match_idx, &match))
+        match_row = &match;
 
     // Capacity in bytes (for WHOLE and write pages)
     uint32_t capacity_bytes = 0;
@@ -1546,10 +1551,52 @@ void report_generate_csv(void)
         capacity_bytes = (uint32_t)((match_row->capacity_mbit / 8.0f) * 1024.0f * 1024.0f);
     }
 
-    // 3) Aggregate RESULTS.CSV (needs capacity for WHOLE classification)
+    // 3) Aggregate this chip's RESULTS.CSV rows (needs capacity for WHOLE classification)
     agg_t A;
-    collect_aggregates(&A, capacity_bytes);
+    collect_aggregates(&A, capacity_bytes, jedec_norm6);
 
     // 4) Emit report
-    write_report_csv(rows, n_rows, &A, match_row, jedec_norm6, capacity_bytes);
+    write_report_csv(&db, &A, match_row, jedec_norm6, capacity_bytes);
+    if (have_db)
+        chipdb_close(&db);
+    s_opt = NULL;
+}
+
+#if REPORT_LIVE_FLASH
+static void generate_live(const char *jedec, int dev, char *buf, size_t len, report_summary_t *out)
+{
+    report_opts_t o;
+    memset(&o, 0, sizeof o);
+    char tag[8];
+    if (dev >= 0)
+    {
+        // as flash_dev_note_suffix(); slots are single digits (dev_tag[4])
+        snprintf(tag, sizeof tag, "_d%u", (unsigned)dev % 10u);
+        o.dev_tag = tag;
+    }
+    o.state = STATE_FILENAME;
+    if (results_archive_sync(RESULTS_FILENAME, RESULTS_ARCHIVE_FILENAME))
+        o.archive = RESULTS_ARCHIVE_FILENAME;
+    o.jedec = jedec;
+    o.sck_MHz = flash_spi_get_baud_hz() / 1e6f;
+    o.quiet = buf != NULL;
+    o.state_readonly = buf != NULL;
+    o.buf = buf;
+    o.buf_len = len;
+    o.out = out;
+    report_generate_ex(&o);
 }
+
+void report_generate_csv(void)
+{
+    char jedec_text[24] = {0};
+    flash_get_jedec_str(jedec_text, sizeof jedec_text);
+    // With several chips, identical ones would merge: report this slot only
+    generate_live(jedec_text, flash_dev_present_count() > 1 ? flash_dev_current() : -1, NULL, 0, NULL);
+}
+
+void report_generate_summary(const char *jedec, int dev, char *buf, size_t len, report_summary_t *out)
+{
+    generate_live(jedec, dev, buf, len, out);
+}
+#endif
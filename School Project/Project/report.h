@@ -2,13 +2,57 @@
 #ifndef REPORT_H
 #define REPORT_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// Generates / overwrites report.csv from datasheet.csv + RESULTS.CSV
+// Generates / overwrites report.csv from datasheet.csv + RESULTS.CSV, using
+// only the rows whose JEDEC matches the current flash device. Aggregates are
+// checkpointed to REPORT.STA, so a repeat call only parses appended rows.
 void report_generate_csv(void);
 
+// Filled by report_generate_ex() when opts->out is set
+typedef struct {
+    unsigned long rows;      // RESULTS lines parsed by this call
+    unsigned long matched;   // of those, rows for the reported chip
+    char  guess_jedec[16];   // final_guess_* of report.csv
+    char  guess_model[64];
+    char  guess_company[48];
+    float score;             // NAN when undecided
+    size_t report_bytes;     // with opts->buf: report length (more than fitted if truncated)
+} report_summary_t;
+
+// Same report with every input spelled out, for callers without a live chip
+// (host fleet tool). NULL paths take the defaults above; state NULL disables
+// the REPORT.STA checkpoint. Console lines are skipped when quiet is set.
+typedef struct {
+    const char *results;     // "RESULTS.CSV"
+    const char *datasheet;   // "datasheet.csv" (compiled next to it)
+    const char *report;      // "report.csv"
+    const char *state;       // "REPORT.STA" or NULL
+    const char *archive;     // RESULTS.RCA already synced with results, for the
+                             // p99_* rows (NULL: those rows are NA)
+    const char *jedec;       // chip to report, e.g. "EF 70 16"
+    const char *dev_tag;     // "_d1": only rows whose notes end with it, i.e. one
+                             // slot of several identical chips (NULL: all slots)
+    float       sck_MHz;     // SPI clock the reads were taken at (0 = unknown)
+    int         quiet;
+    int         state_readonly; // resume from state but never write or remove it
+    char       *buf;         // report into memory (NUL-terminated) instead of the
+    size_t      buf_len;     // report file; nothing is written to the card
+    report_summary_t *out;
+} report_opts_t;
+
+void report_generate_ex(const report_opts_t *opts);
+
+// report_generate_csv() for a given JEDEC without reading the chip or
+// printing, into buf rather than report.csv (web /api/report). dev < 0 takes
+// the rows of every flash slot, else only those of slot dev. REPORT.STA is
+// used if it fits but left as it is, so a GET changes nothing on the card.
+void report_generate_summary(const char *jedec, int dev, char *buf, size_t len, report_summary_t *out);
+
 // Optional gates you can override in another .c (non-weak there):
 // Return 1 to include that section, 0 to skip.
 int report_enable_erase(void);
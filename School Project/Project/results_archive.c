@@ -0,0 +1,775 @@
+// results_archive.c — RESULTS.RCA writer, CSV catch-up and zone-map queries
+#include "results_archive.h"
+#include "fatfs/ff.h"
+#include "csv_reader.h"   // csv_read_line(), csv_split()
+#include "chip_db.h"      // chipdb_normalize_jedec()
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RA_CSV_FILENAME "RESULTS.CSV" // live rows come from sd_append_to_file()
+#define RA_VERSION 1u
+#define RA_HEAD_FP 512u  // CSV bytes fingerprinted to notice a replaced log
+#define RA_CHUNK 64u     // rows per column read in queries
+#define RA_MAX_SEG_ROWS 4096u
+
+/* ------------------------------ File layout ------------------------------ */
+
+// Little-endian, as written by the RP2040 and x86/ARM hosts
+typedef struct
+{
+    char magic[4];         // "RCAR"
+    uint32_t version;      // RA_VERSION
+    uint32_t csv_offset;   // RESULTS.CSV bytes covered (whole lines)
+    uint32_t csv_head;     // FNV-1a of its first min(csv_offset, RA_HEAD_FP) bytes
+    uint32_t rows;
+    uint32_t segments;
+    uint32_t bytes;        // end of the last complete segment
+    uint32_t reserved;
+} ra_hdr_t;
+
+// Segment header; the column arrays follow in C_* order
+typedef struct
+{
+    char magic[4];         // "RSEG"
+    uint32_t rows;
+    uint32_t jedec_min, jedec_max;
+    uint32_t size_min, size_max;
+    uint32_t ts_min, ts_max;
+    uint32_t elapsed_min, elapsed_max;
+    float temp_min, temp_max; // over the rows with a temperature
+    uint8_t op_mask;
+    uint8_t flags;         // RA_SEG_TEMP_NAN
+    uint8_t pad[2];
+    uint32_t reserved[2];
+} ra_seg_t;
+
+#define RA_SEG_TEMP_NAN 0x01u
+
+enum
+{
+    C_JEDEC,
+    C_SIZE,
+    C_ADDR,
+    C_ELAPSED,
+    C_RUN,
+    C_TEMP,
+    C_VOLT,
+    C_TS,
+    C_OP,
+    C_COUNT
+};
+// Byte offset of each column per row of the segment; 4-byte columns first
+static const uint8_t k_col_prefix[C_COUNT + 1] = {0, 4, 8, 12, 16, 20, 24, 28, 32, 33};
+#define RA_ROW_BYTES 33u
+
+static uint32_t col_offset(uint32_t rows, int c)
+{
+    return (uint32_t)sizeof(ra_seg_t) + rows * k_col_prefix[c];
+}
+
+/* ------------------------------ Row parsing ------------------------------ */
+
+uint32_t ra_pack_jedec(const char *text)
+{
+    char n[8];
+    chipdb_normalize_jedec(text, n);
+    return n[0] ? (uint32_t)strtoul(n, NULL, 16) : 0u;
+}
+
+static uint8_t op_code(const char *op)
+{
+    if (!strcmp(op, "read"))
+        return RA_OP_READ;
+    if (!strcmp(op, "write") || !strcmp(op, "program"))
+        return RA_OP_WRITE;
+    if (!strcmp(op, "erase"))
+        return RA_OP_ERASE;
+    if (!strcmp(op, "read_sweep"))
+        return RA_OP_READ_SWEEP;
+    if (!strcmp(op, "write_sweep"))
+        return RA_OP_WRITE_SWEEP;
+    return RA_OP_OTHER;
+}
+
+static bool op_mask_parse(const char *s, uint8_t *mask)
+{
+    *mask = 0;
+    while (*s)
+    {
+        char tok[16];
+        size_t n = strcspn(s, "|");
+        if (n == 0 || n >= sizeof tok)
+            return false;
+        memcpy(tok, s, n);
+        tok[n] = '\0';
+        uint8_t c = op_code(tok);
+        if (c == RA_OP_OTHER && strcmp(tok, "other"))
+            return false;
+        *mask |= c;
+        s += n + (s[n] == '|');
+    }
+    return *mask != 0;
+}
+
+static int32_t days_from_civil(int y, int m, int d)
+{
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 730485; // 0 = 2000-01-01
+}
+
+// "YYYY-MM-DD[ HH:MM[:SS]]" -> seconds since 2000-01-01; 0 if unparsable
+static uint32_t parse_ts(const char *s)
+{
+    int y, mo, d, h = 0, mi = 0, se = 0;
+    if (sscanf(s, "%d-%d-%d %d:%d:%d", &y, &mo, &d, &h, &mi, &se) < 3 ||
+        y < 2000 || mo < 1 || mo > 12 || d < 1 || d > 31)
+        return 0;
+    return (uint32_t)days_from_civil(y, mo, d) * 86400u + (uint32_t)(h * 3600 + mi * 60 + se);
+}
+
+static float parse_f(const char *s)
+{
+    char *end;
+    float v = strtof(s, &end);
+    return (end != s) ? v : NAN;
+}
+
+bool results_archive_parse_row(const char *line, ra_row_t *out)
+{
+    char buf[256];
+    snprintf(buf, sizeof buf, "%s", line);
+    buf[strcspn(buf, "\r\n")] = '\0';
+
+    char *f[12];
+    int nf = csv_split(buf, ',', f, 12);
+    if (nf < 5 || !isdigit((unsigned char)f[2][0]))
+        return false; // header line or junk
+
+    memset(out, 0, sizeof *out);
+    out->jedec = ra_pack_jedec(f[0]);
+    out->op = op_code(f[1]);
+    out->size = (uint32_t)strtoul(f[2], NULL, 10);
+    out->addr = (uint32_t)strtoul(f[3], NULL, 0);
+    out->elapsed_us = (uint32_t)strtoul(f[4], NULL, 10);
+    out->run = nf > 6 ? (uint32_t)strtoul(f[6], NULL, 10) : 0u;
+    out->temp_C = nf > 7 ? parse_f(f[7]) : NAN;
+    out->volt_V = nf > 8 ? parse_f(f[8]) : NAN;
+    out->ts = nf > 10 ? parse_ts(f[10]) : 0u;
+    return true;
+}
+
+/* -------------------------------- Writer -------------------------------- */
+
+// One segment being built, column-wise. Shared by the live path and sync;
+// sync flushes the live rows before it reuses the buffer.
+typedef struct
+{
+    uint32_t n;
+    bool span;              // [csv_from, csv_to) is set, even with n == 0
+    uint32_t csv_from, csv_to;
+    uint32_t jedec[RESULTS_ARCHIVE_SEG_ROWS];
+    uint32_t size[RESULTS_ARCHIVE_SEG_ROWS];
+    uint32_t addr[RESULTS_ARCHIVE_SEG_ROWS];
+    uint32_t elapsed[RESULTS_ARCHIVE_SEG_ROWS];
+    uint32_t run[RESULTS_ARCHIVE_SEG_ROWS];
+    float temp[RESULTS_ARCHIVE_SEG_ROWS];
+    float volt[RESULTS_ARCHIVE_SEG_ROWS];
+    uint32_t ts[RESULTS_ARCHIVE_SEG_ROWS];
+    uint8_t op[RESULTS_ARCHIVE_SEG_ROWS];
+} ra_build_t;
+
+static RESULTS_ARCHIVE_THREAD_LOCAL ra_build_t s_b;
+static RESULTS_ARCHIVE_THREAD_LOCAL csv_reader_t s_csv;
+static bool s_warned_behind;
+
+static bool build_fits(const ra_build_t *b, const ra_row_t *r)
+{
+    return b->n == 0 ||
+           (b->n < RESULTS_ARCHIVE_SEG_ROWS && b->jedec[0] == r->jedec &&
+            b->op[0] == r->op && b->size[0] == r->size);
+}
+
+static void build_push(ra_build_t *b, const ra_row_t *r)
+{
+    uint32_t i = b->n++;
+    b->jedec[i] = r->jedec;
+    b->size[i] = r->size;
+    b->addr[i] = r->addr;
+    b->elapsed[i] = r->elapsed_us;
+    b->run[i] = r->run;
+    b->temp[i] = r->temp_C;
+    b->volt[i] = r->volt_V;
+    b->ts[i] = r->ts;
+    b->op[i] = r->op;
+}
+
+static uint32_t fnv1a(uint32_t h, const uint8_t *p, UINT n)
+{
+    for (UINT i = 0; i < n; ++i)
+    {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static bool csv_head_hash(FIL *csv, uint32_t upto, uint32_t *out)
+{
+    uint8_t buf[128];
+    uint32_t h = 2166136261u;
+    if (upto > RA_HEAD_FP)
+        upto = RA_HEAD_FP;
+    if (f_lseek(csv, 0) != FR_OK)
+        return false;
+    while (upto)
+    {
+        UINT want = upto < sizeof buf ? (UINT)upto : (UINT)sizeof buf, br = 0;
+        if (f_read(csv, buf, want, &br) != FR_OK || br != want)
+            return false;
+        h = fnv1a(h, buf, br);
+        upto -= br;
+    }
+    *out = h;
+    return true;
+}
+
+static bool hdr_valid(const ra_hdr_t *h)
+{
+    return !memcmp(h->magic, "RCAR", 4) && h->version == RA_VERSION &&
+           h->bytes >= sizeof(ra_hdr_t);
+}
+
+static void hdr_init(ra_hdr_t *h)
+{
+    memset(h, 0, sizeof *h);
+    memcpy(h->magic, "RCAR", 4);
+    h->version = RA_VERSION;
+    h->csv_head = 2166136261u; // hash of zero bytes
+    h->bytes = sizeof(ra_hdr_t);
+}
+
+static bool read_exact(FIL *f, void *p, UINT n)
+{
+    UINT br = 0;
+    return f_read(f, p, n, &br) == FR_OK && br == n;
+}
+
+static bool write_exact(FIL *f, const void *p, UINT n)
+{
+    UINT bw = 0;
+    return f_write(f, p, n, &bw) == FR_OK && bw == n;
+}
+
+// Open (creating) the archive; a missing or foreign header reads as empty
+static bool archive_open(FIL *f, const char *path, ra_hdr_t *h)
+{
+    if (f_open(f, path, FA_OPEN_ALWAYS | FA_READ | FA_WRITE) != FR_OK)
+        return false;
+    if (!(f_size(f) >= sizeof *h && read_exact(f, h, sizeof *h) && hdr_valid(h) &&
+          h->bytes <= f_size(f)))
+        hdr_init(h);
+    return true;
+}
+
+static bool hdr_write(FIL *f, const ra_hdr_t *h)
+{
+    return f_lseek(f, 0) == FR_OK && write_exact(f, h, sizeof *h) && f_sync(f) == FR_OK;
+}
+
+// Append b as one segment at h->bytes; the header is updated by the caller
+static bool segment_write(FIL *f, ra_hdr_t *h, const ra_build_t *b)
+{
+    ra_seg_t s;
+    memset(&s, 0, sizeof s);
+    memcpy(s.magic, "RSEG", 4);
+    s.rows = b->n;
+    s.jedec_min = s.size_min = s.ts_min = s.elapsed_min = UINT32_MAX;
+    s.temp_min = INFINITY;
+    s.temp_max = -INFINITY;
+    for (uint32_t i = 0; i < b->n; ++i)
+    {
+        if (b->jedec[i] < s.jedec_min) s.jedec_min = b->jedec[i];
+        if (b->jedec[i] > s.jedec_max) s.jedec_max = b->jedec[i];
+        if (b->size[i] < s.size_min) s.size_min = b->size[i];
+        if (b->size[i] > s.size_max) s.size_max = b->size[i];
+        if (b->ts[i] < s.ts_min) s.ts_min = b->ts[i];
+        if (b->ts[i] > s.ts_max) s.ts_max = b->ts[i];
+        if (b->elapsed[i] < s.elapsed_min) s.elapsed_min = b->elapsed[i];
+        if (b->elapsed[i] > s.elapsed_max) s.elapsed_max = b->elapsed[i];
+        if (b->temp[i] != b->temp[i])
+            s.flags |= RA_SEG_TEMP_NAN;
+        else
+        {
+            if (b->temp[i] < s.temp_min) s.temp_min = b->temp[i];
+            if (b->temp[i] > s.temp_max) s.temp_max = b->temp[i];
+        }
+        s.op_mask |= b->op[i];
+    }
+
+    UINT n4 = (UINT)(b->n * 4u);
+    bool ok = f_lseek(f, h->bytes) == FR_OK &&
+              write_exact(f, &s, sizeof s) &&
+              write_exact(f, b->jedec, n4) && write_exact(f, b->size, n4) &&
+              write_exact(f, b->addr, n4) && write_exact(f, b->elapsed, n4) &&
+              write_exact(f, b->run, n4) && write_exact(f, b->temp, n4) &&
+              write_exact(f, b->volt, n4) && write_exact(f, b->ts, n4) &&
+              write_exact(f, b->op, (UINT)b->n) &&
+              f_sync(f) == FR_OK; // data before the header that counts it
+    if (ok)
+    {
+        h->bytes += (uint32_t)sizeof s + b->n * RA_ROW_BYTES;
+        h->rows += b->n;
+        h->segments++;
+    }
+    return ok;
+}
+
+// Only the header line precedes `upto`: a brand-new log the archive can start on
+static bool csv_is_header_only(FIL *csv, uint32_t upto)
+{
+    char buf[256];
+    if (upto == 0 || upto > sizeof buf || f_lseek(csv, 0) != FR_OK ||
+        !read_exact(csv, buf, (UINT)upto))
+        return false;
+    return buf[upto - 1] == '\n' && memchr(buf, '\n', upto - 1) == NULL;
+}
+
+bool results_archive_flush(void)
+{
+    if (!s_b.span)
+        return true;
+
+    FIL a, csv;
+    ra_hdr_t h;
+    bool ok = false;
+    if (f_open(&csv, RA_CSV_FILENAME, FA_READ) != FR_OK)
+    {
+        s_b.n = 0;
+        s_b.span = false;
+        return false;
+    }
+    if (archive_open(&a, RESULTS_ARCHIVE_FILENAME, &h))
+    {
+        uint32_t head;
+        bool fresh = (h.segments == 0 && h.csv_offset == 0);
+        bool joins = fresh ? csv_is_header_only(&csv, s_b.csv_from)
+                           : (h.csv_offset == s_b.csv_from &&
+                              csv_head_hash(&csv, h.csv_offset, &head) && head == h.csv_head);
+        if (!joins)
+        {
+            if (!s_warned_behind)
+                printf("⚠️  %s does not end where the new rows start; run 'archive' to catch up\n",
+                       RESULTS_ARCHIVE_FILENAME);
+            s_warned_behind = true;
+        }
+        else if ((s_b.n == 0 || segment_write(&a, &h, &s_b)) &&
+                 csv_head_hash(&csv, s_b.csv_to, &h.csv_head))
+        {
+            h.csv_offset = s_b.csv_to;
+            ok = hdr_write(&a, &h);
+        }
+        f_close(&a);
+    }
+    f_close(&csv);
+    s_b.n = 0;
+    s_b.span = false;
+    return ok;
+}
+
+void results_archive_log_csv(const char *row, uint32_t start, uint32_t end)
+{
+    ra_row_t r;
+    bool parsed = results_archive_parse_row(row, &r);
+    if (s_b.span && (start != s_b.csv_to || (parsed && !build_fits(&s_b, &r))))
+        (void)results_archive_flush();
+    if (!s_b.span)
+    {
+        s_b.span = true;
+        s_b.csv_from = start;
+    }
+    s_b.csv_to = end;
+    if (parsed)
+        build_push(&s_b, &r);
+}
+
+bool results_archive_sync(const char *csv_path, const char *archive_path)
+{
+    (void)results_archive_flush();
+
+    FIL csv, a;
+    ra_hdr_t h;
+    if (f_open(&csv, csv_path, FA_READ) != FR_OK)
+        return false;
+    if (!archive_open(&a, archive_path, &h))
+    {
+        f_close(&csv);
+        return false;
+    }
+
+    // A shorter or different log than the one archived: start over
+    uint32_t head = 0;
+    if (h.csv_offset > f_size(&csv) || !csv_head_hash(&csv, h.csv_offset, &head) ||
+        head != h.csv_head)
+    {
+        if (h.csv_offset)
+            printf("🗄️  %s no longer matches %s; rebuilding\n", archive_path, csv_path);
+        hdr_init(&h);
+    }
+    if (h.csv_offset == f_size(&csv))
+    {
+        f_close(&a);
+        f_close(&csv);
+        return true;
+    }
+
+    uint32_t rows0 = h.rows, segs0 = h.segments;
+    bool ok = f_lseek(&csv, h.csv_offset) == FR_OK;
+    char line[256];
+    ra_row_t r;
+    csv_reader_init(&s_csv, &csv);
+    s_b.n = 0;
+    while (ok && csv_read_line(&s_csv, line, sizeof line) >= 0)
+    {
+        if (!results_archive_parse_row(line, &r))
+            continue;
+        if (!build_fits(&s_b, &r))
+        {
+            ok = segment_write(&a, &h, &s_b);
+            s_b.n = 0;
+        }
+        build_push(&s_b, &r);
+    }
+    if (ok && s_b.n)
+        ok = segment_write(&a, &h, &s_b);
+    s_b.n = 0;
+    ok = ok && s_csv.err == FR_OK;
+
+    uint32_t end = (uint32_t)csv_reader_tell(&s_csv);
+    if (ok && csv_head_hash(&csv, end, &h.csv_head))
+    {
+        h.csv_offset = end;
+        ok = hdr_write(&a, &h);
+    }
+    else
+        ok = false;
+    f_close(&a);
+    f_close(&csv);
+    if (ok)
+        printf("🗄️  %s: +%lu rows in %lu segments (%lu rows total)\n", archive_path,
+               (unsigned long)(h.rows - rows0), (unsigned long)(h.segments - segs0),
+               (unsigned long)h.rows);
+    else
+        printf("❌ %s: conversion from %s failed\n", archive_path, csv_path);
+    return ok;
+}
+
+/* -------------------------------- Queries ------------------------------- */
+
+void ra_filter_init(ra_filter_t *f)
+{
+    memset(f, 0, sizeof *f);
+    f->size_max = UINT32_MAX;
+    f->temp_min = -INFINITY;
+    f->temp_max = INFINITY;
+    f->ts_max = UINT32_MAX;
+}
+
+// Apply "<op><value>" to an inclusive [lo, hi] range
+static bool range_u32(const char *op, uint32_t v, uint32_t *lo, uint32_t *hi)
+{
+    if (!strcmp(op, "="))
+        *lo = *hi = v;
+    else if (!strcmp(op, ">="))
+        *lo = v;
+    else if (!strcmp(op, ">"))
+        *lo = v + 1u;
+    else if (!strcmp(op, "<="))
+        *hi = v;
+    else if (!strcmp(op, "<") && v > 0)
+        *hi = v - 1u;
+    else
+        return false;
+    return true;
+}
+
+static bool range_f(const char *op, float v, float *lo, float *hi)
+{
+    if (!strcmp(op, "="))
+        *lo = *hi = v;
+    else if (!strcmp(op, ">="))
+        *lo = v;
+    else if (!strcmp(op, ">"))
+        *lo = nextafterf(v, INFINITY);
+    else if (!strcmp(op, "<="))
+        *hi = v;
+    else if (!strcmp(op, "<"))
+        *hi = nextafterf(v, -INFINITY);
+    else
+        return false;
+    return true;
+}
+
+bool ra_filter_parse(ra_filter_t *f, const char *expr)
+{
+    char buf[160];
+    snprintf(buf, sizeof buf, "%s", expr ? expr : "");
+    for (char *t = buf, *next; *t; t = next)
+    {
+        size_t len = strcspn(t, ",");
+        next = t + len + (t[len] == ',');
+        t[len] = '\0';
+        while (*t == ' ')
+            t++;
+        size_t k = strcspn(t, "<>=");
+        size_t o = strspn(t + k, "<>=");
+        if (k == 0 || o == 0 || o > 2 || !t[k + o])
+            return false;
+        char key[8], op[3];
+        if (k >= sizeof key)
+            return false;
+        memcpy(key, t, k);
+        key[k] = '\0';
+        memcpy(op, t + k, o);
+        op[o] = '\0';
+        const char *v = t + k + o;
+
+        bool ok;
+        if (!strcmp(key, "jedec"))
+            ok = !strcmp(op, "=") && (f->jedec = ra_pack_jedec(v)) != 0;
+        else if (!strcmp(key, "op"))
+            ok = !strcmp(op, "=") && op_mask_parse(v, &f->ops);
+        else if (!strcmp(key, "size"))
+            ok = isdigit((unsigned char)*v) &&
+                 range_u32(op, (uint32_t)strtoul(v, NULL, 0), &f->size_min, &f->size_max);
+        else if (!strcmp(key, "temp"))
+            ok = parse_f(v) == parse_f(v) && range_f(op, parse_f(v), &f->temp_min, &f->temp_max);
+        else if (!strcmp(key, "ts"))
+        {
+            uint32_t ts = parse_ts(v);
+            // A bare date in "<=" / ">" covers the whole day
+            if (ts && !strchr(v, ' ') && (!strcmp(op, "<=") || !strcmp(op, ">")))
+                ts += 86399u;
+            if (ts && !strchr(v, ' ') && !strcmp(op, "="))
+            {
+                f->ts_min = ts;
+                f->ts_max = ts + 86399u;
+                ok = true;
+            }
+            else
+                ok = ts && range_u32(op, ts, &f->ts_min, &f->ts_max);
+        }
+        else
+            ok = false;
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+static uint32_t hist_bin(uint32_t v)
+{
+    if (v < 32u)
+        return v;
+    int e = 31 - __builtin_clz(v); // 5..31
+    return (uint32_t)(e - 4) * 32u + ((v >> (e - 5)) & 31u);
+}
+
+double ra_result_quantile(const ra_result_t *r, double q)
+{
+    if (r->w.n == 0)
+        return NAN;
+    if (q <= 0.0)
+        return r->w.min;
+    if (q >= 1.0)
+        return r->w.max;
+    double target = q * r->w.n, cum = 0.0;
+    for (uint32_t b = 0; b < RA_HIST_BINS; ++b)
+    {
+        if (!r->hist[b] || cum + r->hist[b] < target)
+        {
+            cum += r->hist[b];
+            continue;
+        }
+        double lo, width;
+        if (b < 32u)
+        {
+            lo = b;
+            width = 1.0;
+        }
+        else
+        {
+            int e = (int)(b / 32u) + 4;
+            lo = (double)((32u + b % 32u) << (e - 5));
+            width = (double)(1u << (e - 5));
+        }
+        // The extreme bins are only populated between min and max
+        double hi = lo + width;
+        if (lo < r->w.min)
+            lo = r->w.min;
+        if (hi > r->w.max + 1.0)
+            hi = r->w.max + 1.0;
+        double v = lo + (hi - lo) * (target - cum) / r->hist[b];
+        return v > r->w.max ? r->w.max : v;
+    }
+    return r->w.max;
+}
+
+void ra_result_merge(ra_result_t *a, const ra_result_t *b)
+{
+    stream_stats_merge(&a->w, &b->w);
+    for (uint32_t i = 0; i < RA_HIST_BINS; ++i)
+        a->hist[i] += b->hist[i];
+    a->segments += b->segments;
+    a->segments_skipped += b->segments_skipped;
+    a->rows_scanned += b->rows_scanned;
+    a->bytes_read += b->bytes_read;
+}
+
+static bool temp_bounded(const ra_filter_t *f)
+{
+    return f->temp_min > -INFINITY || f->temp_max < INFINITY;
+}
+
+// Zone map alone rules the segment out
+static bool seg_excluded(const ra_seg_t *s, const ra_filter_t *f)
+{
+    if (f->jedec && (f->jedec < s->jedec_min || f->jedec > s->jedec_max))
+        return true;
+    if (f->ops && !(s->op_mask & f->ops))
+        return true;
+    if (s->size_max < f->size_min || s->size_min > f->size_max)
+        return true;
+    if (s->ts_max < f->ts_min || s->ts_min > f->ts_max)
+        return true;
+    // Rows without a temperature never pass a temperature bound
+    if (temp_bounded(f) && (s->temp_max < f->temp_min || s->temp_min > f->temp_max))
+        return true;
+    return false;
+}
+
+// Read rows [i, i + n) of column c into dst
+static bool col_read(FIL *fp, uint32_t seg_at, uint32_t rows, int c, uint32_t i, uint32_t n,
+                     void *dst, ra_result_t *out)
+{
+    uint32_t w = (uint32_t)(k_col_prefix[c + 1] - k_col_prefix[c]);
+    if (f_lseek(fp, seg_at + col_offset(rows, c) + i * w) != FR_OK ||
+        !read_exact(fp, dst, (UINT)(n * w)))
+        return false;
+    out->bytes_read += n * w;
+    return true;
+}
+
+bool results_archive_query(const char *archive_path, const ra_filter_t *f, ra_result_t *out)
+{
+    memset(out, 0, sizeof *out);
+    stream_stats_init(&out->w);
+
+    FIL fp;
+    ra_hdr_t h;
+    if (f_open(&fp, archive_path, FA_READ) != FR_OK)
+        return false;
+    bool ok = read_exact(&fp, &h, sizeof h) && hdr_valid(&h) && h.bytes <= f_size(&fp);
+    if (ok)
+        out->segments = h.segments;
+
+    uint32_t at = sizeof h;
+    uint32_t u[RA_CHUNK], el[RA_CHUNK];
+    float tf[RA_CHUNK];
+    uint8_t o8[RA_CHUNK], keep[RA_CHUNK];
+    for (uint32_t s = 0; ok && s < h.segments; ++s)
+    {
+        ra_seg_t g;
+        ok = f_lseek(&fp, at) == FR_OK && read_exact(&fp, &g, sizeof g) &&
+             !memcmp(g.magic, "RSEG", 4) && g.rows && g.rows <= RA_MAX_SEG_ROWS &&
+             at + sizeof g + g.rows * RA_ROW_BYTES <= h.bytes;
+        if (!ok)
+            break;
+        uint32_t seg_at = at;
+        at += (uint32_t)sizeof g + g.rows * RA_ROW_BYTES;
+        if (seg_excluded(&g, f))
+        {
+            out->segments_skipped++;
+            continue;
+        }
+
+        // Columns whose predicate the zone map does not already settle
+        bool need_j = f->jedec && !(g.jedec_min == f->jedec && g.jedec_max == f->jedec);
+        bool need_o = f->ops && (g.op_mask & ~f->ops);
+        bool need_s = !(g.size_min >= f->size_min && g.size_max <= f->size_max);
+        bool need_ts = !(g.ts_min >= f->ts_min && g.ts_max <= f->ts_max);
+        bool need_t = temp_bounded(f) &&
+                      ((g.flags & RA_SEG_TEMP_NAN) ||
+                       !(g.temp_min >= f->temp_min && g.temp_max <= f->temp_max));
+
+        out->rows_scanned += g.rows;
+        for (uint32_t i = 0; ok && i < g.rows; i += RA_CHUNK)
+        {
+            uint32_t n = g.rows - i < RA_CHUNK ? g.rows - i : RA_CHUNK;
+            memset(keep, 1, n);
+            if (ok && need_j && (ok = col_read(&fp, seg_at, g.rows, C_JEDEC, i, n, u, out)))
+                for (uint32_t k = 0; k < n; ++k)
+                    keep[k] &= u[k] == f->jedec;
+            if (ok && need_o && (ok = col_read(&fp, seg_at, g.rows, C_OP, i, n, o8, out)))
+                for (uint32_t k = 0; k < n; ++k)
+                    keep[k] &= (o8[k] & f->ops) != 0;
+            if (ok && need_s && (ok = col_read(&fp, seg_at, g.rows, C_SIZE, i, n, u, out)))
+                for (uint32_t k = 0; k < n; ++k)
+                    keep[k] &= u[k] >= f->size_min && u[k] <= f->size_max;
+            if (ok && need_ts && (ok = col_read(&fp, seg_at, g.rows, C_TS, i, n, u, out)))
+                for (uint32_t k = 0; k < n; ++k)
+                    keep[k] &= u[k] >= f->ts_min && u[k] <= f->ts_max;
+            if (ok && need_t && (ok = col_read(&fp, seg_at, g.rows, C_TEMP, i, n, tf, out)))
+                for (uint32_t k = 0; k < n; ++k)
+                    keep[k] &= tf[k] >= f->temp_min && tf[k] <= f->temp_max;
+            if (ok && (ok = col_read(&fp, seg_at, g.rows, C_ELAPSED, i, n, el, out)))
+                for (uint32_t k = 0; k < n; ++k)
+                {
+                    if (!keep[k])
+                        continue;
+                    stream_stats_push(&out->w, el[k]);
+                    out->hist[hist_bin(el[k])]++;
+                }
+        }
+    }
+    f_close(&fp);
+    return ok;
+}
+
+bool results_archive_print_query(const char *archive_path, const char *expr)
+{
+    static RESULTS_ARCHIVE_THREAD_LOCAL ra_result_t r; // 3.6 KB histogram: kept off the stack
+    ra_filter_t f;
+    ra_filter_init(&f);
+    if (!ra_filter_parse(&f, expr))
+    {
+        printf("❓ Bad filter '%s' (jedec=<hex>, op=read|write|erase|read_sweep|write_sweep, "
+               "size/temp/ts with = < <= > >=)\n", expr);
+        return false;
+    }
+    if (!results_archive_query(archive_path, &f, &r))
+    {
+        printf("❌ %s missing or damaged\n", archive_path);
+        return false;
+    }
+    ra_result_print(archive_path, expr, &r);
+    return true;
+}
+
+void ra_result_print(const char *what, const char *expr, const ra_result_t *r)
+{
+    printf("🗄️  %s [%s]: %lu rows", what, (expr && expr[0]) ? expr : "all", (unsigned long)r->w.n);
+    if (r->w.n)
+        printf(", elapsed_us mean %.1f p50 %.0f p90 %.0f p99 %.0f min %.0f max %.0f",
+               r->w.mean, ra_result_quantile(r, 0.50), ra_result_quantile(r, 0.90),
+               ra_result_quantile(r, 0.99), r->w.min, r->w.max);
+    printf("\n    segments: %lu of %lu skipped by zone map; %lu rows scanned, %lu column bytes read\n",
+           (unsigned long)r->segments_skipped, (unsigned long)r->segments,
+           (unsigned long)r->rows_scanned, (unsigned long)r->bytes_read);
+}
@@ -0,0 +1,124 @@
+// results_archive.h — segmented, columnar copy of RESULTS.CSV with zone maps
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "stream_stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// RESULTS.RCA holds the numeric columns of RESULTS.CSV in segments of up to
+// RESULTS_ARCHIVE_SEG_ROWS rows. A segment is one array per column plus a
+// header with min/max of JEDEC, operation, block size, temperature, timestamp
+// and elapsed time, so a query seeks past every segment whose ranges cannot
+// match and reads only the columns it needs from the rest. A segment closes
+// when JEDEC, operation or block size changes, which keeps one benchmark
+// series per segment and the zone maps tight.
+#define RESULTS_ARCHIVE_FILENAME "RESULTS.RCA"
+
+#ifndef RESULTS_ARCHIVE_SEG_ROWS
+#define RESULTS_ARCHIVE_SEG_ROWS 128 // rows buffered in RAM per segment (33 B each)
+#endif
+
+// Append rows as sd_append_to_file() writes them to RESULTS.CSV (1) or only
+// when converted with results_archive_sync() (0).
+#ifndef RESULTS_ARCHIVE_LIVE
+#define RESULTS_ARCHIVE_LIVE 1
+#endif
+
+// Thread-local storage for the writer/reader state in multi-threaded host tools
+#ifndef RESULTS_ARCHIVE_THREAD_LOCAL
+#define RESULTS_ARCHIVE_THREAD_LOCAL
+#endif
+
+// Operation bits (op column and filter mask)
+enum {
+    RA_OP_READ        = 1u << 0,
+    RA_OP_WRITE       = 1u << 1, // "write" and "program"
+    RA_OP_ERASE       = 1u << 2,
+    RA_OP_READ_SWEEP  = 1u << 3,
+    RA_OP_WRITE_SWEEP = 1u << 4,
+    RA_OP_OTHER       = 1u << 7,
+};
+
+// One RESULTS.CSV row, numeric columns only
+typedef struct {
+    uint32_t jedec;      // 0xC22015 for "C2 20 15"; 0 if missing
+    uint8_t  op;         // RA_OP_*
+    uint32_t size;
+    uint32_t addr;
+    uint32_t elapsed_us;
+    uint32_t run;
+    float    temp_C;
+    float    volt_V;
+    uint32_t ts;         // seconds since 2000-01-01 00:00:00; 0 if missing
+} ra_row_t;
+
+// Parse a RESULTS.CSV line (header and short lines return false).
+bool results_archive_parse_row(const char *line, ra_row_t *out);
+
+// Live path, called by sd_append_to_file() after a RESULTS.CSV row landed at
+// byte offsets [start, end). Rows are buffered until the segment closes.
+void results_archive_log_csv(const char *row, uint32_t start, uint32_t end);
+
+// Write out the buffered rows (end of a suite, before queries). When the
+// archive does not end where the buffered rows start, they are dropped and
+// left for results_archive_sync().
+bool results_archive_flush(void);
+
+// Convert the RESULTS.CSV rows the archive does not cover yet (all of them the
+// first time; the archive is created if missing). Cheap when already in sync.
+bool results_archive_sync(const char *csv_path, const char *archive_path);
+
+/* ------------------------------- Queries -------------------------------- */
+
+// Row filter; ranges are inclusive. ra_filter_init() matches everything.
+typedef struct {
+    uint32_t jedec;            // 0 = any
+    uint8_t  ops;              // RA_OP_* mask, 0 = any
+    uint32_t size_min, size_max;
+    float    temp_min, temp_max;
+    uint32_t ts_min, ts_max;
+} ra_filter_t;
+
+void ra_filter_init(ra_filter_t *f);
+
+// "jedec=C22015,op=erase|write,size=4096,temp>40,ts>=2025-09-28 12:00:00"
+// Terms are comma-separated; size/temp/ts take = < <= > >=. False on a bad term.
+bool ra_filter_parse(ra_filter_t *f, const char *expr);
+
+// Log-linear histogram of elapsed_us: exact below 32 µs, then 32 bins per
+// power of two, so quantiles come back within ~1.5%.
+#define RA_HIST_BINS 896
+
+typedef struct {
+    stream_stats_t w;          // elapsed_us of the matching rows
+    uint32_t hist[RA_HIST_BINS];
+    uint32_t segments;         // in the file
+    uint32_t segments_skipped; // ruled out by their zone maps alone
+    uint32_t rows_scanned;     // rows whose columns were read
+    uint32_t bytes_read;       // column bytes read (headers excluded)
+} ra_result_t;
+
+// Aggregate elapsed_us over the rows matching f. False if the archive is
+// missing or damaged; out is still initialised.
+bool results_archive_query(const char *archive_path, const ra_filter_t *f, ra_result_t *out);
+
+// Fold b into a (several archives, one fleet-wide answer)
+void ra_result_merge(ra_result_t *a, const ra_result_t *b);
+
+// q in [0,1]; NaN when nothing matched
+double ra_result_quantile(const ra_result_t *r, double q);
+
+// Parse expr (empty = all rows), run the query and print count, mean,
+// p50/p90/p99 and min/max of elapsed_us plus how many segments were skipped.
+bool results_archive_print_query(const char *archive_path, const char *expr);
+void ra_result_print(const char *what, const char *expr, const ra_result_t *r);
+
+// Pack "C2 20 15" / "c22015" into 0xC22015 (0 if no hex digits)
+uint32_t ra_pack_jedec(const char *text);
+
+#ifdef __cplusplus
+}
+#endif
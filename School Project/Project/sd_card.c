@@ -6,8 +6,12 @@
 #include "sd_card.h"
 #include "fatfs/ff.h"
 #include "pico/stdlib.h"
+#include "pico/multicore.h"
 #include "fatfs/diskio.h"
 #include "flash_benchmark.h"
+#include "erase_plan.h"
+#include "results_archive.h"
+#include "web/http_server.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -161,6 +165,233 @@ bool sd_backup_flash_safe(const char *dir, const char *filename)
     return true;
 }
 
+// ======= MULTI-CHIP BACKUP: second chip streamed from core1 =======
+// FatFs stays on core0. Core1 only reads its chip into one of two ping-pong
+// buffers and posts "slot|len" through the inter-core FIFO; core0 writes the
+// slot out and hands it back. Between FIFO messages core0 reads and writes
+// its own chip, so both SPI instances are busy at the same time.
+#define MC_CHUNK 4096u
+#define MC_DONE 0xFFFFFFFFu
+#define MC_SYNC_EVERY (64u * 1024u)
+
+static struct
+{
+    int dev;
+    uint32_t total;
+    volatile bool abort;
+    volatile bool read_failed;    // set by core1 before it posts MC_DONE
+    volatile uint32_t fail_addr;
+} s_mc_job;
+static uint8_t s_mc_buf[2][MC_CHUNK];
+
+static void mc_core1_reader(void)
+{
+    (void)flash_dev_select(s_mc_job.dev);
+    uint32_t done = 0;
+    unsigned slot = 0, free_slots = 2;
+
+    while (done < s_mc_job.total && !s_mc_job.abort)
+    {
+        if (!free_slots)
+        {
+            (void)multicore_fifo_pop_blocking();
+            free_slots++;
+        }
+        uint32_t n = (s_mc_job.total - done) > MC_CHUNK ? MC_CHUNK : (s_mc_job.total - done);
+        if (!flash_read_data(done, s_mc_buf[slot], n))
+        {
+            s_mc_job.fail_addr = done;
+            s_mc_job.read_failed = true;
+            break;
+        }
+        multicore_fifo_push_blocking(((uint32_t)slot << 31) | n);
+        free_slots--;
+        slot ^= 1u;
+        done += n;
+    }
+    // Collect outstanding slot returns so the FIFO is empty for the next run
+    while (free_slots < 2)
+    {
+        (void)multicore_fifo_pop_blocking();
+        free_slots++;
+    }
+    multicore_fifo_push_blocking(MC_DONE);
+    for (;;)
+        tight_loop_contents();
+}
+
+static FRESULT mc_open(const char *dir, int dev, FIL *f, char *path, size_t n)
+{
+    char name[32];
+    sd_backup_name(dev, name, sizeof name);
+    snprintf(path, n, "%s/%s", dir, name);
+    return f_open(f, path, FA_CREATE_ALWAYS | FA_WRITE);
+}
+
+static bool mc_write(FIL *f, const uint8_t *buf, UINT n, uint32_t done)
+{
+    UINT bw = 0;
+    FRESULT fr = f_write(f, buf, n, &bw);
+    if (fr != FR_OK || bw != n)
+    {
+        printf("❌ f_write fr=%d bw=%u at 0x%06lX\n", fr, bw, (unsigned long)done);
+        return false;
+    }
+    if (((done + n) % MC_SYNC_EVERY) == 0)
+        (void)f_sync(f);
+    return true;
+}
+
+bool sd_backup_flash_all(const char *dir)
+{
+    if (!sd_is_mounted()) {
+        printf("❌ SD not mounted\n");
+        return false;
+    }
+    if (!dir || !*dir) dir = "SPI_Backup";
+
+    const int orig = flash_dev_current();
+    int devs[2] = {-1, -1}, ndev = 0;
+    for (int i = 0; i < flash_dev_count() && ndev < 2; ++i)
+        if (flash_dev_present(i))
+            devs[ndev++] = i;
+
+    if (ndev == 0) {
+        printf("❌ No flash chip present\n");
+        return false;
+    }
+
+    // Core1 gets a chip that is off the SD bus; core0 keeps the other one
+    int c1 = -1, c0 = -1;
+    if (ndev == 2 && !flash_dev_same_bus(devs[0], devs[1])) {
+        c1 = flash_dev_shares_sd_bus(devs[0]) ? devs[1] : devs[0];
+        c0 = (c1 == devs[0]) ? devs[1] : devs[0];
+    }
+
+    if (c1 < 0) {
+        // One chip, or both on one bus: nothing to overlap, go one by one
+        bool ok = true;
+        for (int k = 0; k < ndev; ++k) {
+            char name[32];
+            sd_backup_name(devs[k], name, sizeof name);
+            (void)flash_dev_select(devs[k]);
+            ok = sd_backup_flash_safe(dir, name) && ok;
+        }
+        (void)flash_dev_select(orig);
+        return ok;
+    }
+
+    FRESULT fr = f_mkdir(dir);
+    if (!(fr == FR_OK || fr == FR_EXIST)) {
+        printf("❌ f_mkdir(%s) failed (%d)\n", dir, fr);
+        return false;
+    }
+
+    // Capacities come from datasheet.csv, so look them up here on core0
+    (void)flash_dev_select(c1);
+    const uint32_t total1 = (uint32_t)flash_capacity_bytes();
+    (void)flash_dev_select(c0);
+    const uint32_t total0 = (uint32_t)flash_capacity_bytes();
+
+    FIL f0, f1;
+    char p0[64], p1[64];
+    if (mc_open(dir, c0, &f0, p0, sizeof p0) != FR_OK) {
+        printf("❌ f_open %s failed\n", p0);
+        (void)flash_dev_select(orig);
+        return false;
+    }
+    if (mc_open(dir, c1, &f1, p1, sizeof p1) != FR_OK) {
+        printf("❌ f_open %s failed\n", p1);
+        f_close(&f0);
+        (void)flash_dev_select(orig);
+        return false;
+    }
+
+    printf("💾 Concurrent backup: chip %d -> %s (core0), chip %d -> %s (core1)\n", c0, p0, c1, p1);
+
+    s_mc_job.dev = c1;
+    s_mc_job.total = total1;
+    s_mc_job.abort = false;
+    s_mc_job.read_failed = false;
+    multicore_fifo_drain();
+    multicore_launch_core1(mc_core1_reader);
+
+    static uint8_t buf0[MC_CHUNK];
+    uint32_t done0 = 0, done1 = 0, next_note = 256u * 1024u;
+    bool c1_finished = false, ok = true;
+    uint64_t t0 = time_us_64();
+
+    while (!c1_finished || done0 < total0)
+    {
+        if (multicore_fifo_rvalid()) {
+            uint32_t msg = multicore_fifo_pop_blocking();
+            if (msg == MC_DONE) {
+                c1_finished = true;
+                continue;
+            }
+            unsigned slot = (unsigned)(msg >> 31);
+            UINT n = (UINT)(msg & 0x7FFFFFFFu);
+            if (ok && !mc_write(&f1, s_mc_buf[slot], n, done1)) {
+                ok = false;
+                s_mc_job.abort = true;
+            }
+            done1 += n;
+            multicore_fifo_push_blocking(slot); // hand the buffer back
+            continue;
+        }
+
+        if (done0 < total0 && ok) {
+            UINT n = (total0 - done0) > MC_CHUNK ? MC_CHUNK : (UINT)(total0 - done0);
+            if (!flash_read_data(done0, buf0, n)) {
+                printf("❌ flash_read_data (chip %d) failed at 0x%06lX\n", c0, (unsigned long)done0);
+                ok = false;
+                s_mc_job.abort = true;
+            } else if (!mc_write(&f0, buf0, n, done0)) {
+                ok = false;
+                s_mc_job.abort = true;
+            }
+            done0 += n;
+        } else if (!ok) {
+            done0 = total0; // stop our side, keep draining core1
+        } else {
+            tight_loop_contents();
+        }
+
+        if (done0 + done1 >= next_note) {
+            printf("   … chip%d %lu / %lu, chip%d %lu / %lu bytes\n",
+                   c0, (unsigned long)done0, (unsigned long)total0,
+                   c1, (unsigned long)done1, (unsigned long)total1);
+            next_note += 256u * 1024u;
+        }
+    }
+
+    multicore_reset_core1();
+    uint64_t us = time_us_64() - t0;
+
+    if (s_mc_job.read_failed) {
+        printf("❌ flash_read_data (chip %d, core1) failed at 0x%06lX\n",
+               c1, (unsigned long)s_mc_job.fail_addr);
+        ok = false;
+    }
+
+    f_sync(&f0); f_close(&f0);
+    f_sync(&f1); f_close(&f1);
+    (void)flash_dev_select(orig);
+
+    if (!ok) {
+        // A partial image must not pass for a backup at restore time
+        f_unlink(p0);
+        f_unlink(p1);
+        printf("❌ Concurrent backup aborted; %s and %s removed\n", p0, p1);
+        return false;
+    }
+    double secs = us / 1e6;
+    printf("✅ Concurrent backup complete: %lu + %lu bytes in %.2f s (%.3f MB/s combined)\n",
+           (unsigned long)total0, (unsigned long)total1, secs,
+           secs > 0 ? ((total0 + total1) / (1024.0 * 1024.0)) / secs : 0.0);
+    return true;
+}
+
 // Return a list of files in the root directory (fills up to max_files entries)
 int sd_get_file_list(sd_file_info_t *files, int max_files)
 {
@@ -267,14 +498,13 @@ bool sd_restore_flash_safe(const char *dir, const char *filename)
     printf("📦 Backup size: %lu bytes, flash size: %lu bytes\n",
            (unsigned long)backup_size, (unsigned long)flash_total);
 
-    // ---- ERASE USED REGION SECTOR-BY-SECTOR ----
-    printf("🧨 Erasing used flash region sector-by-sector…\n");
-    for (uint32_t a = 0; a < (uint32_t)backup_size; a += FLASH_SECTOR_SIZE) {
-        if (!flash_sector_erase(a)) {   // int-returning, treat 0 as failure just like flash_read_data()
-            printf("❌ flash_sector_erase(0x%06lX) failed\n", (unsigned long)a);
-            f_close(&f);
-            return false;
-        }
+    // ---- ERASE USED REGION (cheapest 4K/32K/64K/chip mix, blank sectors skipped) ----
+    printf("🧨 Erasing used flash region…\n");
+    erase_plan_t plan;
+    if (!erase_plan_execute(0, (uint32_t)backup_size, ERASE_PLAN_SKIP_BLANK, &plan)) {
+        printf("❌ Erase of 0x000000..0x%06lX failed\n", (unsigned long)(backup_size ? backup_size - 1 : 0));
+        f_close(&f);
+        return false;
     }
     printf("🧨 Erase complete, restoring contents…\n");
 
@@ -337,6 +567,30 @@ bool sd_restore_flash_safe(const char *dir, const char *filename)
     return true;
 }
 
+void sd_backup_name(int dev, char *out, size_t n)
+{
+    // Same rule the backup side uses: one file per chip once there are two
+    if (flash_dev_present_count() > 1)
+        snprintf(out, n, "microchip_backup_d%d.bin", dev);
+    else
+        snprintf(out, n, "microchip_backup_safe.bin");
+}
+
+bool sd_restore_flash_dev(const char *dir, int dev)
+{
+    const int orig = flash_dev_current();
+    if (!flash_dev_select(dev)) {
+        printf("❌ Flash device %d not present\n", dev);
+        return false;
+    }
+
+    char name[32];
+    sd_backup_name(dev, name, sizeof name);
+    bool ok = sd_restore_flash_safe(dir, name);
+    (void)flash_dev_select(orig);
+    return ok;
+}
+
 
 
 
@@ -429,6 +683,10 @@ static bool csv_has_header(const char *filename)
 // Global FatFs objects
 static FATFS fatfs;
 static bool sd_mounted = false;
+static uint32_t s_results_gen = 1;
+
+uint32_t sd_results_generation(void) { return s_results_gen; }
+void sd_results_changed(void) { s_results_gen++; }
 
 bool sd_card_init(void)
 {
@@ -718,6 +976,7 @@ bool sd_mount(void)
     {
         printf("FR_OK (0) - Success!\n");
         sd_mounted = true;
+        sd_results_changed(); // the card may have been edited elsewhere
         printf("✅ 32GB FAT32 SD Card filesystem mounted successfully!\n");
         printf("📂 Ready for file operations (create/read/write/append)\n");
         printf("===========================================\n");
@@ -893,6 +1152,7 @@ bool sd_append_to_file(const char *filename, const char *content)
         f_close(&file);
         return false;
     }
+    uint32_t row_start = (uint32_t)f_tell(&file);
 
     UINT bytes_written = 0;
     size_t len = strlen(content);
@@ -918,6 +1178,7 @@ bool sd_append_to_file(const char *filename, const char *content)
         }
     }
 
+    uint32_t row_end = (uint32_t)f_tell(&file);
     fr = f_sync(&file); // push data to card
     f_close(&file);
     if (fr != FR_OK)
@@ -926,6 +1187,24 @@ bool sd_append_to_file(const char *filename, const char *content)
         return false;
     }
 
+#if RESULTS_ARCHIVE_LIVE
+    // Columnar copy for RESULTS.RCA queries (segments written as series end)
+    if (strcmp(filename, "RESULTS.CSV") == 0)
+        results_archive_log_csv(content, row_start, row_end);
+#else
+    (void)row_start;
+    (void)row_end;
+#endif
+    if (strcmp(filename, "RESULTS.CSV") == 0)
+        sd_results_changed();
+#if HTTP_EVENTS_LIVE
+    // Rows land between timed sections: push them to /events and let the
+    // network run
+    if (strcmp(filename, "RESULTS.CSV") == 0)
+        http_events_result(content);
+    http_server_service_busy();
+#endif
+
     // Short delay to help some cards settle
     sleep_ms(10);
 
@@ -940,6 +1219,53 @@ bool sd_append_to_file(const char *filename, const char *content)
     return true;
 }
 
+/* Append one CRLF-terminated row to an arbitrary CSV, writing `header` first
+ * when the file is new/empty. Unlike sd_append_to_file() this never injects
+ * the RESULTS.CSV header, so it is safe for side files with their own schema. */
+bool sd_append_csv_row(const char *filename, const char *header, const char *row)
+{
+    if (!sd_mounted)
+    {
+        printf("❌ SD card not mounted\n");
+        return false;
+    }
+
+    FIL file;
+    FRESULT fr = f_open(&file, filename, FA_OPEN_ALWAYS | FA_WRITE);
+    if (fr != FR_OK)
+    {
+        printf("❌ Failed to open %s for append (error: %d)\n", filename, fr);
+        return false;
+    }
+
+    UINT bw = 0;
+    if (f_size(&file) == 0 && header && header[0])
+    {
+        fr = f_write(&file, header, (UINT)strlen(header), &bw);
+        if (fr == FR_OK)
+            fr = f_write(&file, "\r\n", 2, &bw);
+    }
+    if (fr == FR_OK)
+        fr = f_lseek(&file, f_size(&file));
+    if (fr == FR_OK)
+        fr = f_write(&file, row, (UINT)strlen(row), &bw);
+    if (fr == FR_OK)
+        fr = f_write(&file, "\r\n", 2, &bw);
+    if (fr == FR_OK)
+        fr = f_sync(&file);
+    f_close(&file);
+
+    if (fr != FR_OK)
+    {
+        printf("❌ Failed to append row to %s (error: %d)\n", filename, fr);
+        return false;
+    }
+#if HTTP_EVENTS_LIVE
+    http_server_service_busy();
+#endif
+    return true;
+}
+
 void sd_unmount(void)
 {
     if (sd_mounted)
@@ -2,6 +2,7 @@
 #define SD_CARD_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 // File information structure used by the HTTP server to list files
@@ -15,6 +16,7 @@ bool sd_card_init(void);
 bool sd_mount(void);
 bool sd_write_file(const char *filename, const char *content);
 bool sd_append_to_file(const char *filename, const char *content);
+bool sd_append_csv_row(const char *filename, const char *header, const char *row); // any CSV schema
 bool sd_file_exists(const char *filename);
 void sd_unmount(void);
 int sd_count_csv_rows(const char *filename, int *out_total_lines, int *out_data_rows);
@@ -23,6 +25,21 @@ bool sd_backup_flash_full(const char *dir, const char *filename);
 bool sd_is_mounted(void);
 bool sd_backup_flash_safe(const char *dir, const char *filename);
 bool sd_restore_flash_safe(const char *dir, const char *filename);
+// Back up every detected flash chip to <dir>/microchip_backup_d<N>.bin. Two
+// chips on different SPI instances are read concurrently (one from core1).
+bool sd_backup_flash_all(const char *dir);
+// Backup file name for flash device <dev>: microchip_backup_d<N>.bin when
+// more than one chip is present, else microchip_backup_safe.bin. Every backup
+// and restore path names its file through this.
+void sd_backup_name(int dev, char *out, size_t n);
+// Restore flash device <dev> from <dir>/<sd_backup_name(dev)>.
+bool sd_restore_flash_dev(const char *dir, int dev);
+
+// Changes whenever RESULTS.CSV may have: rows appended by sd_append_to_file(),
+// a (re)mount, or a sd_results_changed() call. Caches of values derived from
+// it (web /api answers) compare against this.
+uint32_t sd_results_generation(void);
+void sd_results_changed(void);
 
 // Get simple file list from root directory (fills up to max_files entries)
 int sd_get_file_list(sd_file_info_t *files, int max_files);
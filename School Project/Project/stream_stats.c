@@ -0,0 +1,171 @@
+#include "stream_stats.h"
+#include <math.h>
+#include <string.h>
+
+void stream_stats_init(stream_stats_t *s)
+{
+    memset(s, 0, sizeof *s);
+}
+
+void stream_stats_push(stream_stats_t *s, double x)
+{
+    s->n++;
+    if (s->n == 1)
+    {
+        s->mean = x;
+        s->m2 = 0.0;
+        s->min = s->max = x;
+        return;
+    }
+    double d = x - s->mean;
+    s->mean += d / (double)s->n;
+    s->m2 += d * (x - s->mean);
+    if (x < s->min) s->min = x;
+    if (x > s->max) s->max = x;
+}
+
+void stream_stats_merge(stream_stats_t *a, const stream_stats_t *b)
+{
+    if (b->n == 0)
+        return;
+    if (a->n == 0)
+    {
+        *a = *b;
+        return;
+    }
+    double na = (double)a->n, nb = (double)b->n, n = na + nb;
+    double d = b->mean - a->mean;
+    a->mean += d * nb / n;
+    a->m2 += b->m2 + d * d * na * nb / n;
+    a->n += b->n;
+    if (b->min < a->min) a->min = b->min;
+    if (b->max > a->max) a->max = b->max;
+}
+
+double stream_stats_var(const stream_stats_t *s)
+{
+    return (s->n > 1) ? s->m2 / (double)(s->n - 1) : 0.0;
+}
+
+double stream_stats_sd(const stream_stats_t *s)
+{
+    return sqrt(stream_stats_var(s));
+}
+
+double stream_stats_sd_pop(const stream_stats_t *s)
+{
+    return (s->n > 0) ? sqrt(s->m2 / (double)s->n) : 0.0;
+}
+
+// ----------------------------------------------------------------------------
+// P² quartiles
+// ----------------------------------------------------------------------------
+#define P2_LAST (P2_MARKERS - 1)
+
+void p2_quartiles_init(p2_quartiles_t *p)
+{
+    memset(p, 0, sizeof *p);
+}
+
+static double p2_parabolic(const p2_quartiles_t *p, int i, int d)
+{
+    double n0 = p->pos[i - 1], n1 = p->pos[i], n2 = p->pos[i + 1];
+    return p->q[i] + (double)d / (n2 - n0) *
+                         ((n1 - n0 + d) * (p->q[i + 1] - p->q[i]) / (n2 - n1) +
+                          (n2 - n1 - d) * (p->q[i] - p->q[i - 1]) / (n1 - n0));
+}
+
+void p2_quartiles_push(p2_quartiles_t *p, double x)
+{
+    if (p->n < P2_MARKERS)
+    {
+        // insertion into the sorted head
+        int i = (int)p->n++;
+        while (i > 0 && p->q[i - 1] > x)
+        {
+            p->q[i] = p->q[i - 1];
+            --i;
+        }
+        p->q[i] = x;
+        if (p->n == P2_MARKERS)
+            for (int k = 0; k < P2_MARKERS; ++k)
+                p->pos[k] = k;
+        return;
+    }
+    p->n++;
+
+    int k;
+    if (x < p->q[0])
+    {
+        p->q[0] = x;
+        k = 0;
+    }
+    else if (x >= p->q[P2_LAST])
+    {
+        p->q[P2_LAST] = x;
+        k = P2_LAST - 1;
+    }
+    else
+    {
+        k = 0;
+        while (k < P2_LAST - 1 && x >= p->q[k + 1])
+            ++k;
+    }
+    for (int i = k + 1; i < P2_MARKERS; ++i)
+        p->pos[i]++;
+
+    for (int i = 1; i < P2_LAST; ++i)
+    {
+        double want = (double)(p->n - 1) * i / P2_LAST;
+        double d = want - p->pos[i];
+        if ((d >= 1.0 && p->pos[i + 1] - p->pos[i] > 1) ||
+            (d <= -1.0 && p->pos[i - 1] - p->pos[i] < -1))
+        {
+            int s = (d > 0) ? 1 : -1;
+            double qp = p2_parabolic(p, i, s);
+            if (!(p->q[i - 1] < qp && qp < p->q[i + 1]))
+                qp = p->q[i] + s * (p->q[i + s] - p->q[i]) / (double)(p->pos[i + s] - p->pos[i]);
+            p->q[i] = qp;
+            p->pos[i] += s;
+        }
+    }
+}
+
+// Same convention as a sorted-array percentile: position q * (n - 1)
+static double sorted_quantile_d(const double *v, uint32_t n, double q)
+{
+    double at = q * (double)(n - 1);
+    uint32_t i = (uint32_t)floor(at);
+    uint32_t j = (i + 1 < n) ? i + 1 : i;
+    double t = at - (double)i;
+    return (1.0 - t) * v[i] + t * v[j];
+}
+
+double p2_quartiles_get(const p2_quartiles_t *p, int quart)
+{
+    if (p->n == 0 || quart < 0 || quart > 4)
+        return NAN;
+    if (p->n < P2_MARKERS)
+        return sorted_quantile_d(p->q, p->n, quart * 0.25);
+    return p->q[quart * P2_LAST / 4];
+}
+
+// ----------------------------------------------------------------------------
+// Summary = Welford + P²
+// ----------------------------------------------------------------------------
+void stream_summary_init(stream_summary_t *s)
+{
+    stream_stats_init(&s->w);
+    p2_quartiles_init(&s->p2);
+}
+
+void stream_summary_push(stream_summary_t *s, double x)
+{
+    stream_stats_push(&s->w, x);
+    p2_quartiles_push(&s->p2, x);
+}
+
+double stream_summary_quartile(const stream_summary_t *s, int quart)
+{
+    return p2_quartiles_get(&s->p2, quart);
+}
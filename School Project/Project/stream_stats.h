@@ -0,0 +1,60 @@
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Constant-memory running statistics (Welford). Plain struct so it can be
+// embedded in checkpoints and copied as bytes.
+typedef struct {
+    uint32_t n;
+    double   mean;
+    double   m2;   // sum of squared deviations from the running mean
+    double   min;
+    double   max;
+} stream_stats_t;
+
+void   stream_stats_init (stream_stats_t *s);
+void   stream_stats_push (stream_stats_t *s, double x);
+// Combine b into a (parallel Welford / Chan et al.)
+void   stream_stats_merge(stream_stats_t *a, const stream_stats_t *b);
+double stream_stats_var  (const stream_stats_t *s); // sample variance (n-1)
+double stream_stats_sd   (const stream_stats_t *s);
+double stream_stats_sd_pop(const stream_stats_t *s); // population (n)
+
+// P² sketch (Jain & Chlamtac, extended to equiprobable cells): markers at
+// quantiles 0, 1/(M-1), ..., 1 where M = P2_MARKERS. O(M) memory and update.
+// Five markers are enough for stationary data but lag on series that drift
+// (e.g. program time rising with wear); 17 keeps quartile rank error ~1%.
+#ifndef P2_MARKERS
+#define P2_MARKERS 17 /* (P2_MARKERS - 1) must be a multiple of 4 */
+#endif
+
+typedef struct {
+    uint32_t n;
+    double   q[P2_MARKERS];   // marker heights (the first samples, sorted, while n <= P2_MARKERS)
+    int32_t  pos[P2_MARKERS]; // actual marker positions, 0-based; desired = (n-1)*i/(M-1)
+} p2_quartiles_t;
+
+void   p2_quartiles_init(p2_quartiles_t *p);
+void   p2_quartiles_push(p2_quartiles_t *p, double x);
+// quart = 1, 2, 3 for p25, p50, p75 (0 and 4 give min / max). NaN if empty;
+// exact while n <= P2_MARKERS.
+double p2_quartiles_get (const p2_quartiles_t *p, int quart);
+
+// Welford + P²: everything report.csv needs for one series in 256 bytes.
+// Series up to P2_MARKERS samples (the usual handful of runs per size) get
+// exact quartiles; longer logs stay bounded.
+typedef struct {
+    stream_stats_t w;
+    p2_quartiles_t p2;
+} stream_summary_t;
+
+void   stream_summary_init    (stream_summary_t *s);
+void   stream_summary_push    (stream_summary_t *s, double x);
+double stream_summary_quartile(const stream_summary_t *s, int quart); // as p2_quartiles_get
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,332 @@
+#include "wear_sched.h"
+#include "flash_benchmark.h" // flash_get_jedec_str, flash_capacity_bytes, geometry
+#include "fatfs/ff.h"        // FatFs
+#include "sd_card.h"         // sd_is_mounted()
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+/* --- on-SD layout ---------------------------------------------------------
+ * wear_file_hdr_t, then uint16 erase[sectors], then uint16 prog[sectors].
+ * Little-endian as written by the RP2040. A header mismatch (other chip,
+ * other geometry, other version) starts a fresh table.
+ * -------------------------------------------------------------------------- */
+#define WEAR_FILE_VERSION 1u
+#define WEAR_MAX_SECTORS 8192u /* 32 MiB tracked; 32 KiB of RAM */
+
+typedef struct {
+    char     magic[4];   // "WEAR"
+    uint16_t version;
+    uint16_t sector_kib; // 4
+    char     jedec[16];
+    uint32_t sectors;
+    uint32_t erase_ops;  // lifetime erase operations recorded
+} wear_file_hdr_t;
+
+static bool      s_active = false;
+static bool      s_dirty = false;
+static uint16_t *s_erase = NULL;
+static uint16_t *s_prog = NULL;
+static uint32_t  s_sectors = 0;
+static uint32_t  s_erase_ops = 0;
+static uint32_t  s_unsaved_ops = 0;
+static uint32_t  s_cursor = 0; // rotates tie-breaks across the chip
+static bool      s_gap_warned = false;
+static char      s_jedec[16] = {0};
+
+/* --- helpers -------------------------------------------------------------- */
+static inline uint32_t sec_of(uint32_t addr) { return addr / FLASH_SECTOR_SIZE; }
+
+static inline void sat_inc(uint16_t *c)
+{
+    if (*c != 0xFFFFu) (*c)++;
+}
+
+// Eligible sector window [lo, hi)
+static void eligible_window(uint32_t *lo, uint32_t *hi)
+{
+    uint32_t end = s_sectors;
+    if (WEAR_REGION_HI && sec_of(WEAR_REGION_HI) < end) end = sec_of(WEAR_REGION_HI);
+    uint32_t start = sec_of(WEAR_REGION_LO);
+    if (start > end) start = end;
+    *lo = start;
+    *hi = end;
+}
+
+// Natural alignment for a span: 4K, 32K or 64K so block opcodes still fit
+static uint32_t align_for(uint32_t size)
+{
+    if (size > (32u * 1024u)) return 64u * 1024u;
+    if (size > FLASH_SECTOR_SIZE) return 32u * 1024u;
+    return FLASH_SECTOR_SIZE;
+}
+
+static uint32_t region_max(uint32_t s0, uint32_t n)
+{
+    uint32_t m = 0;
+    for (uint32_t i = 0; i < n && s0 + i < s_sectors; ++i)
+        if (s_erase[s0 + i] > m) m = s_erase[s0 + i];
+    return m;
+}
+
+static void release(void)
+{
+    free(s_erase);
+    free(s_prog);
+    s_erase = s_prog = NULL;
+    s_sectors = 0;
+    s_active = false;
+}
+
+static bool load_file(void)
+{
+    if (!sd_is_mounted()) return false;
+
+    FIL f;
+    if (f_open(&f, WEAR_FILENAME, FA_READ) != FR_OK) return false;
+
+    wear_file_hdr_t h;
+    UINT br = 0;
+    bool ok = (f_read(&f, &h, sizeof h, &br) == FR_OK && br == sizeof h) &&
+              !memcmp(h.magic, "WEAR", 4) && h.version == WEAR_FILE_VERSION &&
+              h.sector_kib == FLASH_SECTOR_SIZE / 1024u && h.sectors == s_sectors &&
+              !strncmp(h.jedec, s_jedec, sizeof h.jedec);
+
+    UINT want = s_sectors * sizeof(uint16_t);
+    if (ok) ok = (f_read(&f, s_erase, want, &br) == FR_OK && br == want);
+    if (ok) ok = (f_read(&f, s_prog, want, &br) == FR_OK && br == want);
+    f_close(&f);
+
+    if (ok) s_erase_ops = h.erase_ops;
+    return ok;
+}
+
+/* --- public --------------------------------------------------------------- */
+bool wear_sched_begin(void)
+{
+    char jedec[24] = {0};
+    flash_get_jedec_str(jedec, sizeof jedec);
+    if (!jedec[0] || strcmp(jedec, "No / Unknown_Flash") == 0)
+    {
+        release();
+        return false;
+    }
+
+    size_t cap = flash_capacity_bytes();
+    uint32_t sectors = (uint32_t)(cap / FLASH_SECTOR_SIZE);
+    if (sectors > WEAR_MAX_SECTORS) sectors = WEAR_MAX_SECTORS;
+
+    // Already loaded for this chip -> keep in-RAM state
+    if (s_active && sectors == s_sectors && !strncmp(jedec, s_jedec, sizeof s_jedec))
+        return true;
+
+    release();
+    s_erase = (uint16_t *)calloc(sectors, sizeof(uint16_t));
+    s_prog = (uint16_t *)calloc(sectors, sizeof(uint16_t));
+    if (!sectors || !s_erase || !s_prog)
+    {
+        printf("⚠️  Wear scheduler disabled (no memory for %lu sectors)\n", (unsigned long)sectors);
+        release();
+        return false;
+    }
+    s_sectors = sectors;
+    strncpy(s_jedec, jedec, sizeof s_jedec - 1);
+    s_jedec[sizeof s_jedec - 1] = '\0';
+    s_erase_ops = 0;
+    s_unsaved_ops = 0;
+    s_cursor = 0;
+    s_gap_warned = false;
+    s_active = true;
+
+    if (load_file())
+    {
+        printf("✅ Wear table loaded from %s (%lu sectors, %lu erases logged)\n",
+               WEAR_FILENAME, (unsigned long)s_sectors, (unsigned long)s_erase_ops);
+        s_dirty = false;
+    }
+    else
+    {
+        printf("ℹ️  Starting new wear table for %s (%lu sectors)\n", s_jedec, (unsigned long)s_sectors);
+        s_dirty = true;
+    }
+    return true;
+}
+
+void wear_sched_save(void)
+{
+    if (!s_active || !s_dirty) return;
+    if (!sd_is_mounted())
+    {
+        printf("⚠️  SD not mounted; wear table kept in RAM only\n");
+        return;
+    }
+
+    wear_file_hdr_t h;
+    memset(&h, 0, sizeof h);
+    memcpy(h.magic, "WEAR", 4);
+    h.version = WEAR_FILE_VERSION;
+    h.sector_kib = FLASH_SECTOR_SIZE / 1024u;
+    strncpy(h.jedec, s_jedec, sizeof h.jedec);
+    h.sectors = s_sectors;
+    h.erase_ops = s_erase_ops;
+
+    FIL f;
+    FRESULT fr = f_open(&f, WEAR_FILENAME, FA_CREATE_ALWAYS | FA_WRITE);
+    if (fr != FR_OK)
+    {
+        printf("❌ Failed to open %s (error: %d)\n", WEAR_FILENAME, fr);
+        return;
+    }
+    UINT bw = 0, want = s_sectors * sizeof(uint16_t);
+    fr = f_write(&f, &h, sizeof h, &bw);
+    if (fr == FR_OK) fr = f_write(&f, s_erase, want, &bw);
+    if (fr == FR_OK) fr = f_write(&f, s_prog, want, &bw);
+    if (fr == FR_OK) fr = f_sync(&f);
+    f_close(&f);
+
+    if (fr != FR_OK)
+    {
+        printf("❌ Failed to write %s (error: %d)\n", WEAR_FILENAME, fr);
+        return;
+    }
+    s_dirty = false;
+    s_unsaved_ops = 0;
+}
+
+void wear_sched_end(void)
+{
+    wear_sched_save();
+}
+
+bool wear_sched_active(void)
+{
+    return s_active;
+}
+
+uint32_t wear_sched_pick(uint32_t size, uint32_t fallback)
+{
+    if (!s_active || !size) return fallback;
+
+    const uint32_t align = align_for(size);
+    const uint32_t step = align / FLASH_SECTOR_SIZE;
+    const uint32_t span = (size + FLASH_SECTOR_SIZE - 1u) / FLASH_SECTOR_SIZE;
+
+    uint32_t lo0, hi;
+    eligible_window(&lo0, &hi);
+    uint32_t lo = (lo0 + step - 1u) / step * step;
+    if (lo + span > hi) return fallback;
+
+    // Least-worn eligible sector sets the gap reference
+    uint32_t gmin = 0xFFFFu;
+    for (uint32_t s = lo0; s < hi; ++s)
+        if (s_erase[s] < gmin) gmin = s_erase[s];
+
+    const uint32_t ncand = (hi - span - lo) / step + 1u;
+    uint32_t best = UINT32_MAX, best_score = UINT32_MAX;     // within gap bound
+    uint32_t any = UINT32_MAX, any_score = UINT32_MAX;       // ignoring bound
+
+    // Scan starting at the rotating cursor so equal-wear regions take turns
+    uint32_t first = (s_cursor >= lo && s_cursor < hi) ? (s_cursor - lo) / step : 0;
+    for (uint32_t k = 0; k < ncand; ++k)
+    {
+        uint32_t s0 = lo + ((first + k) % ncand) * step;
+        uint32_t score = region_max(s0, span);
+        if (score < any_score) { any_score = score; any = s0; }
+        if (score + 1u <= gmin + WEAR_GAP_MAX && score < best_score) { best_score = score; best = s0; }
+    }
+
+    if (best == UINT32_MAX)
+    {
+        if (!s_gap_warned)
+        {
+            printf("⚠️  Wear gap bound (%u) cannot be held for %lu-byte spans; using least-worn region\n",
+                   (unsigned)WEAR_GAP_MAX, (unsigned long)size);
+            s_gap_warned = true;
+        }
+        best = any;
+    }
+    if (best == UINT32_MAX) return fallback;
+
+    s_cursor = best + step;
+    return best * FLASH_SECTOR_SIZE;
+}
+
+void wear_sched_note_erase(uint32_t addr, uint32_t size)
+{
+    if (!s_active || !size) return;
+    uint32_t s0 = sec_of(addr);
+    uint32_t s1 = sec_of(addr + size - 1u);
+    for (uint32_t s = s0; s <= s1 && s < s_sectors; ++s)
+        sat_inc(&s_erase[s]);
+    s_erase_ops++;
+    s_dirty = true;
+    if (WEAR_SAVE_EVERY && ++s_unsaved_ops >= WEAR_SAVE_EVERY)
+        wear_sched_save();
+}
+
+void wear_sched_note_program(uint32_t addr, uint32_t size)
+{
+    if (!s_active || !size) return;
+    uint32_t s0 = sec_of(addr);
+    uint32_t s1 = sec_of(addr + size - 1u);
+    for (uint32_t s = s0; s <= s1 && s < s_sectors; ++s)
+        sat_inc(&s_prog[s]);
+    s_dirty = true;
+}
+
+void wear_sched_note_cycles(uint32_t addr, uint32_t size, uint32_t cycles)
+{
+    if (!s_active || !size || !cycles) return;
+    uint32_t s0 = sec_of(addr);
+    uint32_t s1 = sec_of(addr + size - 1u);
+    uint32_t n = 0;
+    for (uint32_t s = s0; s <= s1 && s < s_sectors; ++s, ++n)
+    {
+        s_erase[s] = (uint16_t)((s_erase[s] + cycles > 0xFFFFu) ? 0xFFFFu : s_erase[s] + cycles);
+        s_prog[s] = (uint16_t)((s_prog[s] + cycles > 0xFFFFu) ? 0xFFFFu : s_prog[s] + cycles);
+    }
+    s_erase_ops += n * cycles;
+    s_dirty = true;
+    s_unsaved_ops += n * cycles;
+    if (WEAR_SAVE_EVERY && s_unsaved_ops >= WEAR_SAVE_EVERY)
+        wear_sched_save();
+}
+
+uint32_t wear_sched_region_erases(uint32_t addr, uint32_t size)
+{
+    if (!s_active || !size) return 0;
+    uint32_t s0 = sec_of(addr);
+    return region_max(s0, sec_of(addr + size - 1u) - s0 + 1u);
+}
+
+void wear_sched_print_summary(void)
+{
+    if (!s_active)
+    {
+        printf("\n(wear scheduler inactive)\n");
+        return;
+    }
+    uint32_t lo, hi;
+    eligible_window(&lo, &hi);
+
+    uint32_t emin = 0xFFFFu, emax = 0, pmax = 0;
+    uint64_t esum = 0;
+    for (uint32_t s = lo; s < hi; ++s)
+    {
+        if (s_erase[s] < emin) emin = s_erase[s];
+        if (s_erase[s] > emax) emax = s_erase[s];
+        if (s_prog[s] > pmax) pmax = s_prog[s];
+        esum += s_erase[s];
+    }
+    if (hi <= lo) emin = 0;
+
+    printf("\n=== Wear distribution (%s, sectors %lu..%lu) ===\n",
+           s_jedec, (unsigned long)lo, (unsigned long)(hi ? hi - 1u : 0));
+    printf("Erase count min / mean / max  = %lu / %.2f / %lu\n",
+           (unsigned long)emin, (hi > lo) ? (double)esum / (double)(hi - lo) : 0.0,
+           (unsigned long)emax);
+    printf("Wear gap (max - min)          = %lu (bound %u)\n",
+           (unsigned long)(emax - emin), (unsigned)WEAR_GAP_MAX);
+    printf("Max program count per sector  = %lu\n", (unsigned long)pmax);
+    printf("Erase operations recorded     = %lu\n", (unsigned long)s_erase_ops);
+}
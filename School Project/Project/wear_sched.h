@@ -0,0 +1,65 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Runtime wear-distribution scheduler.
+// Keeps per-4KiB-sector erase/program counters for the live chip in WEAR.BIN
+// (SD root) and hands benches the least-worn eligible region per iteration.
+
+#ifndef WEAR_FILENAME
+#define WEAR_FILENAME "WEAR.BIN"
+#endif
+
+// Eligible window for scheduled regions. Sector 0 region is kept out (may be
+// boot/lock-protected on some parts). WEAR_REGION_HI 0 = up to capacity.
+#ifndef WEAR_REGION_LO
+#define WEAR_REGION_LO 0x010000u
+#endif
+#ifndef WEAR_REGION_HI
+#define WEAR_REGION_HI 0u
+#endif
+
+// Max allowed (most-worn - least-worn) erase count across eligible sectors.
+// Regions whose erase would push past this are skipped while any other fits.
+#ifndef WEAR_GAP_MAX
+#define WEAR_GAP_MAX 8u
+#endif
+
+// Flush WEAR.BIN after this many recorded erase operations (0 = only on end)
+#ifndef WEAR_SAVE_EVERY
+#define WEAR_SAVE_EVERY 25u
+#endif
+
+// Load (or start) the counter table for the currently live chip.
+// Returns false if the chip is unknown or memory is short; all other calls
+// are then harmless no-ops and picks return the fallback address.
+bool     wear_sched_begin(void);
+// Persist (if dirty). Safe to call repeatedly.
+void     wear_sched_save(void);
+void     wear_sched_end(void);
+bool     wear_sched_active(void);
+
+// Least-worn eligible base for a span of `size` bytes. The base is aligned to
+// the span's natural erase granularity (4K/32K/64K) so block opcodes still
+// apply. Returns `fallback` when inactive or nothing fits.
+uint32_t wear_sched_pick(uint32_t size, uint32_t fallback);
+
+// Account for sectors touched by [addr, addr+size)
+void     wear_sched_note_erase(uint32_t addr, uint32_t size);
+void     wear_sched_note_program(uint32_t addr, uint32_t size);
+// Batch form for the endurance bench: `cycles` sector erases plus full-sector
+// programs on each sector of [addr, addr+size), noted outside its timed ops
+void     wear_sched_note_cycles(uint32_t addr, uint32_t size, uint32_t cycles);
+
+// Highest erase count among sectors in [addr, addr+size) (0 if inactive)
+uint32_t wear_sched_region_erases(uint32_t addr, uint32_t size);
+
+void     wear_sched_print_summary(void);
+
+#ifdef __cplusplus
+}
+#endif
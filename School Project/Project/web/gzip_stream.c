@@ -0,0 +1,242 @@
+#include "gzip_stream.h"
+#include <string.h>
+
+#define MIN_MATCH 3
+#define MAX_MATCH 258
+// A match source must still be in win after the next slide
+#define MAX_DIST (GZ_WINDOW - MAX_MATCH - MIN_MATCH - 1)
+// Positions inside a longer match (a run) are not indexed, only its ends
+#define INSERT_MAX 32
+
+enum { GZ_HEADER, GZ_DATA, GZ_TRAILER, GZ_FINISHED };
+
+static const uint16_t len_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t len_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+uint32_t gzip_crc32(uint32_t crc, const void *data, size_t len)
+{
+    static const uint32_t t[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+    const uint8_t *p = data;
+    crc = ~crc;
+    while (len--)
+    {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ t[crc & 15];
+        crc = (crc >> 4) ^ t[crc & 15];
+    }
+    return ~crc;
+}
+
+void gzip_stream_init(gzip_stream_t *z)
+{
+    memset(z->head, 0, sizeof z->head);
+    z->pos = z->end = 0;
+    z->bits = 0;
+    z->nbits = 0;
+    z->state = GZ_HEADER;
+    z->crc = 0;
+    z->isize = 0;
+}
+
+size_t gzip_stream_in(gzip_stream_t *z, uint8_t **p)
+{
+    if (z->pos >= GZ_WINDOW + MAX_DIST)
+    {
+        // Slide the upper half down; chain entries into the lower half die
+        memmove(z->win, z->win + GZ_WINDOW, z->end - GZ_WINDOW);
+        z->pos -= GZ_WINDOW;
+        z->end -= GZ_WINDOW;
+        for (size_t i = 0; i < sizeof z->head / sizeof z->head[0]; i++)
+            z->head[i] = z->head[i] >= GZ_WINDOW ? (uint16_t)(z->head[i] - GZ_WINDOW) : 0;
+        for (size_t i = 0; i < GZ_WINDOW; i++)
+            z->prev[i] = z->prev[i] >= GZ_WINDOW ? (uint16_t)(z->prev[i] - GZ_WINDOW) : 0;
+    }
+    *p = z->win + z->end;
+    return sizeof z->win - z->end;
+}
+
+void gzip_stream_in_done(gzip_stream_t *z, size_t n)
+{
+    z->crc = gzip_crc32(z->crc, z->win + z->end, n);
+    z->isize += (uint32_t)n;
+    z->end += (uint32_t)n;
+}
+
+bool gzip_stream_finished(const gzip_stream_t *z)
+{
+    return z->state == GZ_FINISHED;
+}
+
+static void put_bits(gzip_stream_t *z, uint32_t v, unsigned n)
+{
+    z->bits |= (uint64_t)v << z->nbits;
+    z->nbits += (uint8_t)n;
+}
+
+// Huffman codes go out most significant bit first, everything else LSB first
+static void put_code(gzip_stream_t *z, uint32_t code, unsigned n)
+{
+    uint32_t r = 0;
+    for (unsigned i = 0; i < n; i++, code >>= 1)
+        r = (r << 1) | (code & 1);
+    put_bits(z, r, n);
+}
+
+// Literal/length symbol in the fixed code (RFC 1951 3.2.6)
+static void put_sym(gzip_stream_t *z, unsigned sym)
+{
+    if (sym < 144)
+        put_code(z, 0x30 + sym, 8);
+    else if (sym < 256)
+        put_code(z, 0x190 + sym - 144, 9);
+    else if (sym < 280)
+        put_code(z, sym - 256, 7);
+    else
+        put_code(z, 0xC0 + sym - 280, 8);
+}
+
+static void put_match(gzip_stream_t *z, unsigned len, unsigned dist)
+{
+    unsigned i = 28;
+    while (len_base[i] > len)
+        i--;
+    put_sym(z, 257 + i);
+    put_bits(z, len - len_base[i], len_extra[i]);
+    i = 29;
+    while (dist_base[i] > dist)
+        i--;
+    put_code(z, i, 5);
+    put_bits(z, dist - dist_base[i], dist_extra[i]);
+}
+
+static size_t flush_bytes(gzip_stream_t *z, uint8_t *out)
+{
+    size_t n = 0;
+    while (z->nbits >= 8)
+    {
+        out[n++] = (uint8_t)z->bits;
+        z->bits >>= 8;
+        z->nbits -= 8;
+    }
+    return n;
+}
+
+static unsigned hash3(const uint8_t *p)
+{
+    uint32_t v = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+    return (v * 2654435761u) >> (32 - GZ_HASH_BITS);
+}
+
+static void insert(gzip_stream_t *z, uint32_t p)
+{
+    unsigned h = hash3(z->win + p);
+    z->prev[p & (GZ_WINDOW - 1)] = z->head[h];
+    z->head[h] = (uint16_t)p;
+}
+
+// Longest earlier match for pos within GZ_CHAIN candidates; 0 if under MIN_MATCH
+static unsigned longest_match(const gzip_stream_t *z, uint32_t cand, unsigned max_len, unsigned *dist)
+{
+    const uint8_t *s = z->win + z->pos;
+    uint32_t limit = z->pos > MAX_DIST ? z->pos - MAX_DIST : 0;
+    unsigned best = 0;
+    for (int chain = GZ_CHAIN; cand > limit && chain > 0; chain--)
+    {
+        const uint8_t *c = z->win + cand;
+        if (c[best] == s[best] && c[0] == s[0])
+        {
+            unsigned n = 1;
+            while (n < max_len && c[n] == s[n])
+                n++;
+            if (n > best)
+            {
+                best = n;
+                *dist = z->pos - cand;
+                if (n == max_len)
+                    break;
+            }
+        }
+        uint32_t next = z->prev[cand & (GZ_WINDOW - 1)];
+        if (next >= cand)
+            break; // overwritten slot: the chain ends here
+        cand = next;
+    }
+    return best >= MIN_MATCH ? best : 0;
+}
+
+size_t gzip_stream_deflate(gzip_stream_t *z, uint8_t *out, size_t out_len, bool finish)
+{
+    size_t n = 0;
+    if (out_len < GZ_MIN_OUT)
+        return 0;
+    if (z->state == GZ_HEADER)
+    {
+        // No name or mtime; XFL 4 = fastest, OS 255 = unknown
+        static const uint8_t header[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 4, 255};
+        memcpy(out, header, sizeof header);
+        n = sizeof header;
+        put_bits(z, 1, 1); // BFINAL: the one block runs to the end
+        put_bits(z, 1, 2); // BTYPE 01: fixed Huffman codes
+        z->state = GZ_DATA;
+    }
+    while (z->state == GZ_DATA && out_len - n >= GZ_MIN_OUT)
+    {
+        uint32_t avail = z->end - z->pos;
+        if (avail == 0 && finish)
+        {
+            put_sym(z, 256); // end of block
+            put_bits(z, 0, (8 - z->nbits % 8) % 8);
+            z->state = GZ_TRAILER;
+        }
+        else if (avail == 0 || (avail < MAX_MATCH + MIN_MATCH && !finish))
+        {
+            break;
+        }
+        else
+        {
+            unsigned len = 0, dist = 0;
+            if (avail >= MIN_MATCH)
+            {
+                unsigned h = hash3(z->win + z->pos);
+                len = longest_match(z, z->head[h], avail < MAX_MATCH ? avail : MAX_MATCH, &dist);
+                insert(z, z->pos);
+            }
+            if (len)
+            {
+                put_match(z, len, dist);
+                if (len <= INSERT_MAX)
+                    for (uint32_t p = z->pos + 1; p < z->pos + len && p + MIN_MATCH <= z->end; p++)
+                        insert(z, p);
+                else if (z->pos + len - 1 + MIN_MATCH <= z->end)
+                    insert(z, z->pos + len - 1); // a run continues at distance 1
+                z->pos += len;
+            }
+            else
+            {
+                put_sym(z, z->win[z->pos++]);
+            }
+        }
+        n += flush_bytes(z, out + n);
+    }
+    if (z->state == GZ_TRAILER && out_len - n >= 8)
+    {
+        for (int i = 0; i < 4; i++)
+            out[n++] = (uint8_t)(z->crc >> (8 * i));
+        for (int i = 0; i < 4; i++)
+            out[n++] = (uint8_t)(z->isize >> (8 * i));
+        z->state = GZ_FINISHED;
+    }
+    return n;
+}
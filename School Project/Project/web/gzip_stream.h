@@ -0,0 +1,63 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Streaming gzip (RFC 1952) encoder in fixed memory: LZ77 over a
+// GZ_WINDOW-byte history with hash chains, coded as one fixed-Huffman
+// deflate block (RFC 1951). Fixed codes need no per-block symbol buffers,
+// which dynamic ones would, so the whole state is the struct below. Flash
+// images (runs of 0xFF) shrink over 100:1 and CSV text several-fold.
+//
+// Input is written straight into the window:
+//   room = gzip_stream_in(z, &p); read up to room bytes to p; gzip_stream_in_done(z, n);
+//   n = gzip_stream_deflate(z, out, out_len, no_more_input);
+// until gzip_stream_finished(z).
+#ifndef GZ_WINDOW_BITS
+#define GZ_WINDOW_BITS 12       // 4 KiB of history (deflate allows up to 15)
+#endif
+#ifndef GZ_HASH_BITS
+#define GZ_HASH_BITS 10
+#endif
+#ifndef GZ_CHAIN
+#define GZ_CHAIN 8              // earlier positions tried per match
+#endif
+#define GZ_WINDOW (1u << GZ_WINDOW_BITS)
+#define GZ_MIN_OUT 16           // out_len below this makes no progress
+
+typedef struct {
+    uint8_t  win[2 * GZ_WINDOW];        // history, then input not yet coded
+    uint16_t head[1u << GZ_HASH_BITS];  // newest window position per hash (0 = none)
+    uint16_t prev[GZ_WINDOW];           // older position with the same hash
+    uint32_t pos;                       // next byte to code
+    uint32_t end;                       // end of input in win
+    uint64_t bits;                      // output bits not yet whole bytes (a match is up to 35)
+    uint8_t  nbits;
+    uint8_t  state;                     // header, data, trailer, finished
+    uint32_t crc;                       // CRC-32 of the input so far
+    uint32_t isize;                     // input length mod 2^32
+} gzip_stream_t;                        // ~18.5 KB with the defaults
+
+void gzip_stream_init(gzip_stream_t *z);
+
+// Where the next input goes and how much fits (0 = code what is buffered first)
+size_t gzip_stream_in(gzip_stream_t *z, uint8_t **p);
+void   gzip_stream_in_done(gzip_stream_t *z, size_t n);
+
+// Code buffered input into out. Without `finish`, the last 260 bytes are kept
+// back as lookahead; with it, everything is coded and the trailer follows.
+// Returns bytes written; 0 once out has less than GZ_MIN_OUT bytes or
+// nothing more can be coded yet.
+size_t gzip_stream_deflate(gzip_stream_t *z, uint8_t *out, size_t out_len, bool finish);
+bool   gzip_stream_finished(const gzip_stream_t *z);
+
+// CRC-32 as in gzip and zip (start with 0); nibble table, no 1 KiB table
+uint32_t gzip_crc32(uint32_t crc, const void *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
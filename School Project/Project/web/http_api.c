@@ -0,0 +1,361 @@
+#include "http_api.h"
+#include "csv_reader.h"
+#include "flash_benchmark.h"
+#include "pico/time.h"
+#include "report.h"
+#include "results_archive.h"
+#include "sd_card.h"
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define API_EXPR_MAX 96
+
+typedef struct
+{
+    uint32_t gen;                   // sd_results_generation() it was computed at; 0 = empty
+    char expr[API_EXPR_MAX];
+    uint16_t len;
+    char json[HTTP_API_STATS_MAX];
+} api_stats_t;
+
+static api_stats_t s_stats[HTTP_API_CACHE];
+static int s_stats_next;
+static uint32_t s_report_gen;
+static char s_report_jedec[24];
+static int s_report_dev;
+static size_t s_report_len;
+static char s_report[HTTP_API_REPORT_MAX];
+static char s_report_csv[HTTP_API_REPORT_CSV_MAX]; // built in memory: report.csv is left alone
+static ra_result_t s_res;           // 3.6 KB: off the lwIP callback's stack
+static char s_error[160];
+
+// Bounded JSON writer; once something does not fit, everything after is dropped
+typedef struct
+{
+    char *p;
+    size_t len, o;
+    bool full;
+} jbuf_t;
+
+static void jb_printf(jbuf_t *b, const char *fmt, ...)
+{
+    if (b->full)
+        return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(b->p + b->o, b->len - b->o, fmt, ap);
+    va_end(ap);
+    if (n < 0 || (size_t)n >= b->len - b->o)
+        b->full = true;
+    else
+        b->o += (size_t)n;
+}
+
+static void jb_value(jbuf_t *b, const char *v, size_t n, bool numeric)
+{
+    if (b->full)
+        return;
+    size_t w = http_json_value(b->p + b->o, b->len - b->o, v, n, numeric);
+    if (!w)
+        b->full = true;
+    b->o += w;
+}
+
+// A double, or null when NaN/infinite (JSON has neither)
+static void jb_num(jbuf_t *b, const char *key, const char *fmt, double v)
+{
+    jb_printf(b, ",\"%s\":", key);
+    if (isfinite(v))
+        jb_printf(b, fmt, v);
+    else
+        jb_printf(b, "null");
+}
+
+size_t http_json_value(char *out, size_t len, const char *v, size_t n, bool numeric)
+{
+    size_t digits = 0;
+    while (digits < n && v[digits] && strchr("0123456789+-.eE", v[digits]))
+        digits++;
+    if (numeric && n > 0 && digits == n)
+    {
+        char *end;
+        (void)strtod(v, &end);
+        if (end == v + n)
+        {
+            if (n >= len)
+                return 0;
+            memcpy(out, v, n);
+            out[n] = '\0';
+            return n;
+        }
+    }
+    size_t o = 0;
+    if (len < 3)
+        return 0;
+    out[o++] = '"';
+    for (size_t i = 0; i < n; i++)
+    {
+        char c = v[i];
+        if ((unsigned char)c < 0x20)
+            continue;
+        if (o + 4 > len)
+            return 0;
+        if (c == '"' || c == '\\')
+            out[o++] = '\\';
+        out[o++] = c;
+    }
+    out[o++] = '"';
+    out[o] = '\0';
+    return o;
+}
+
+// Query string to a filter expression: %xx and '+' decoded, '&' -> ','
+static bool query_to_expr(const char *q, size_t n, char *out, size_t len)
+{
+    size_t o = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        char c = q[i];
+        if (c == '%' && i + 2 < n)
+        {
+            char hex[3] = {q[i + 1], q[i + 2], 0};
+            c = (char)strtol(hex, NULL, 16);
+            i += 2;
+        }
+        else if (c == '+')
+            c = ' ';
+        else if (c == '&')
+            c = ',';
+        if (o + 1 >= len)
+            return false;
+        out[o++] = c;
+    }
+    out[o] = '\0';
+    return true;
+}
+
+static void reply_error(http_api_reply_t *r, const char *status, const char *what, const char *detail)
+{
+    jbuf_t b = {s_error, sizeof s_error, 0, false};
+    jb_printf(&b, "{\"error\":\"%s\"", what);
+    if (detail)
+    {
+        jb_printf(&b, ",\"detail\":");
+        jb_value(&b, detail, strlen(detail), false);
+    }
+    jb_printf(&b, "}");
+    r->status = status;
+    r->json = s_error;
+    r->len = b.full ? 0 : b.o;
+    r->cached = false;
+}
+
+static void answer_stats(const char *expr, bool busy, http_api_reply_t *r)
+{
+    uint32_t gen = sd_results_generation();
+    for (int i = 0; i < HTTP_API_CACHE; i++)
+    {
+        api_stats_t *e = &s_stats[i];
+        if (e->gen == gen && strcmp(e->expr, expr) == 0)
+        {
+            r->status = "200 OK";
+            r->json = e->json;
+            r->len = e->len;
+            r->cached = true;
+            return;
+        }
+    }
+
+    ra_filter_t f;
+    ra_filter_init(&f);
+    if (!ra_filter_parse(&f, expr))
+    {
+        reply_error(r, "400 Bad Request", "bad filter", expr);
+        return;
+    }
+    // Mid-suite the archive is queried as it stands: converting the rows
+    // appended since would run a CSV pass between timed iterations
+    uint64_t t0 = time_us_64();
+    if ((!busy && !results_archive_sync("RESULTS.CSV", RESULTS_ARCHIVE_FILENAME)) ||
+        !results_archive_query(RESULTS_ARCHIVE_FILENAME, &f, &s_res))
+    {
+        reply_error(r, "503 Service Unavailable", "RESULTS.CSV / RESULTS.RCA not readable",
+                    busy ? "no archive yet; retry after the suite" : NULL);
+        return;
+    }
+
+    api_stats_t *e = &s_stats[s_stats_next];
+    s_stats_next = (s_stats_next + 1) % HTTP_API_CACHE;
+    jbuf_t b = {e->json, sizeof e->json, 0, false};
+    bool any = s_res.w.n > 0;
+    jb_printf(&b, "{\"filter\":");
+    jb_value(&b, expr, strlen(expr), false);
+    jb_printf(&b, ",\"rows\":%lu", (unsigned long)s_res.w.n);
+    jb_num(&b, "mean_us", "%.1f", any ? s_res.w.mean : NAN);
+    jb_num(&b, "sd_us", "%.1f", s_res.w.n > 1 ? stream_stats_sd(&s_res.w) : NAN);
+    jb_num(&b, "min_us", "%.0f", any ? s_res.w.min : NAN);
+    jb_num(&b, "p50_us", "%.1f", ra_result_quantile(&s_res, 0.50));
+    jb_num(&b, "p90_us", "%.1f", ra_result_quantile(&s_res, 0.90));
+    jb_num(&b, "p99_us", "%.1f", ra_result_quantile(&s_res, 0.99));
+    jb_num(&b, "max_us", "%.0f", any ? s_res.w.max : NAN);
+    jb_printf(&b, ",\"segments\":%lu,\"skipped\":%lu,\"scanned\":%lu,\"synced\":%s,\"compute_ms\":%.1f}",
+              (unsigned long)s_res.segments, (unsigned long)s_res.segments_skipped,
+              (unsigned long)s_res.rows_scanned, busy ? "false" : "true", (time_us_64() - t0) / 1000.0);
+    if (b.full)
+    {
+        e->gen = 0;
+        reply_error(r, "500 Internal Server Error", "answer too long", NULL);
+        return;
+    }
+    e->gen = busy ? 0 : gen;        // an unsynced answer is not kept
+    snprintf(e->expr, sizeof e->expr, "%s", expr);
+    e->len = (uint16_t)b.o;
+    r->status = "200 OK";
+    r->json = e->json;
+    r->len = e->len;
+    r->cached = false;
+}
+
+// The report is "key,read,write,erase" lines up to a blank one (the final
+// guess table follows). Column col becomes an object of its non-NA values.
+static void report_column(jbuf_t *b, const char *csv, int col)
+{
+    static char line[1024];         // possible_chips_* rows run long
+    char *fld[4];
+    bool first = true, header = true;
+    for (const char *p = csv; *p && *p != '\n' && *p != '\r'; )
+    {
+        size_t len = strcspn(p, "\r\n");
+        snprintf(line, sizeof line, "%.*s", (int)len, p);
+        p += len;
+        p += *p == '\r';
+        p += *p == '\n';
+        int nf = csv_split(line, ',', fld, 4);
+        if (header)
+        {
+            jb_printf(b, ",");
+            jb_value(b, nf > col ? fld[col] : "?", strlen(nf > col ? fld[col] : "?"), false);
+            jb_printf(b, ":{");
+            header = false;
+            continue;
+        }
+        if (nf <= col || strcmp(fld[col], "NA") == 0 || strcmp(fld[0], "notes") == 0)
+            continue;
+        jb_printf(b, "%s", first ? "" : ",");
+        jb_value(b, fld[0], strlen(fld[0]), false);
+        jb_printf(b, ":");
+        jb_value(b, fld[col], strlen(fld[col]), true);
+        first = false;
+    }
+    jb_printf(b, "}");
+}
+
+static void answer_report(const char *jedec, int dev, bool busy, http_api_reply_t *r)
+{
+    uint32_t gen = sd_results_generation();
+    if (s_report_gen == gen && strcmp(s_report_jedec, jedec) == 0 && s_report_dev == dev)
+    {
+        r->status = "200 OK";
+        r->json = s_report;
+        r->len = s_report_len;
+        r->cached = true;
+        return;
+    }
+    if (busy)
+    {
+        reply_error(r, "503 Service Unavailable", "benchmark running", "retry from the menu");
+        return;
+    }
+
+    uint64_t t0 = time_us_64();
+    report_summary_t sum;
+    report_generate_summary(jedec, dev, s_report_csv, sizeof s_report_csv, &sum);
+    if (!sum.report_bytes || sum.report_bytes >= sizeof s_report_csv)
+    {
+        reply_error(r, "500 Internal Server Error", "report not built",
+                    sum.report_bytes ? "raise HTTP_API_REPORT_CSV_MAX" : NULL);
+        return;
+    }
+    jbuf_t b = {s_report, sizeof s_report, 0, false};
+    jb_printf(&b, "{\"jedec\":");
+    jb_value(&b, jedec, strlen(jedec), false);
+    jb_printf(&b, ",\"rows_parsed\":%lu,\"rows_matched\":%lu,\"guess\":{\"jedec\":",
+              sum.rows, sum.matched);
+    jb_value(&b, sum.guess_jedec, strlen(sum.guess_jedec), false);
+    jb_printf(&b, ",\"model\":");
+    jb_value(&b, sum.guess_model, strlen(sum.guess_model), false);
+    jb_printf(&b, ",\"company\":");
+    jb_value(&b, sum.guess_company, strlen(sum.guess_company), false);
+    jb_num(&b, "score", "%.3f", sum.score);
+    jb_printf(&b, "}");
+    for (int col = 1; col <= 3; col++)
+        report_column(&b, s_report_csv, col);
+    jb_printf(&b, ",\"compute_ms\":%.1f}", (time_us_64() - t0) / 1000.0);
+    if (b.full)
+    {
+        s_report_gen = 0;
+        reply_error(r, "500 Internal Server Error", "answer too long", "raise HTTP_API_REPORT_MAX");
+        return;
+    }
+    s_report_gen = gen;
+    snprintf(s_report_jedec, sizeof s_report_jedec, "%s", jedec);
+    s_report_dev = dev;
+    s_report_len = b.o;
+    r->status = "200 OK";
+    r->json = s_report;
+    r->len = s_report_len;
+    r->cached = false;
+}
+
+bool http_api_answer(const char *target, size_t len, bool busy, http_api_reply_t *r)
+{
+    if (len < 5 || strncmp(target, "/api/", 5) != 0)
+        return false;
+    const char *q = memchr(target, '?', len);
+    size_t path_len = q ? (size_t)(q - target) : len;
+    char expr[API_EXPR_MAX];
+    if (!query_to_expr(q ? q + 1 : "", q ? len - path_len - 1 : 0, expr, sizeof expr))
+    {
+        reply_error(r, "414 URI Too Long", "query too long", NULL);
+        return true;
+    }
+    if (!sd_is_mounted())
+    {
+        reply_error(r, "503 Service Unavailable", "SD card not mounted", NULL);
+        return true;
+    }
+
+    if (path_len == 10 && strncmp(target, "/api/stats", 10) == 0)
+    {
+        answer_stats(expr, busy, r);
+    }
+    else if (path_len == 11 && strncmp(target, "/api/report", 11) == 0)
+    {
+        // jedec=... or the current chip as last probed (no bus traffic); for
+        // the latter only its own slot's rows, as the menu report does
+        const char *jedec = flash_profile()->jedec;
+        int dev = flash_dev_present_count() > 1 ? flash_dev_current() : -1;
+        if (strncmp(expr, "jedec=", 6) == 0)
+        {
+            jedec = expr + 6;
+            dev = -1;
+        }
+        else if (expr[0])
+        {
+            reply_error(r, "400 Bad Request", "only jedec= is taken", expr);
+            return true;
+        }
+        if (!jedec[0])
+            reply_error(r, "400 Bad Request", "no chip probed; add ?jedec=", NULL);
+        else
+            answer_report(jedec, dev, busy, r);
+    }
+    else
+    {
+        reply_error(r, "404 Not Found", "unknown endpoint", "use /api/stats or /api/report");
+    }
+    return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// JSON answers computed on the device, so one number does not cost a
+// RESULTS.CSV download:
+//   /api/stats?op=erase&size=65536&jedec=EF7016  elapsed_us aggregates (RESULTS.RCA)
+//   /api/report[?jedec=EF7016]                  the report engine's report.csv, built
+//                                               in RAM (report.csv, REPORT.STA untouched)
+// Stats parameters are results_archive filter terms joined by '&' instead of
+// ',', so size>=4096, temp>40 and ts>=... work too. Answers are kept until
+// sd_results_generation() moves, i.e. until rows are appended.
+#ifndef HTTP_API_CACHE
+#define HTTP_API_CACHE 4            // /api/stats answers kept
+#endif
+#ifndef HTTP_API_STATS_MAX
+#define HTTP_API_STATS_MAX 448      // one /api/stats document
+#endif
+#ifndef HTTP_API_REPORT_MAX
+#define HTTP_API_REPORT_MAX 4096    // the /api/report document
+#endif
+#ifndef HTTP_API_REPORT_CSV_MAX
+#define HTTP_API_REPORT_CSV_MAX 6144 // the report it is made from, kept in RAM
+#endif
+
+typedef struct {
+    const char *status;     // "200 OK", "400 Bad Request", ...
+    const char *json;       // valid until the next call
+    size_t len;
+    bool cached;            // served from the cache
+} http_api_reply_t;
+
+// target: the request target ("/api/stats?..."), len bytes, not terminated.
+// False if it is not under /api/. With busy set (polled from inside a suite),
+// a report that is not cached is refused (503): report.c wants about 15 KB
+// of stack. Stats then come from RESULTS.RCA as it stands ("synced":false,
+// not cached) rather than after converting the rows appended since.
+bool http_api_answer(const char *target, size_t len, bool busy, http_api_reply_t *r);
+
+// One JSON value from n bytes of v: a number when `numeric` is set and all
+// of v parses as one, else a string (quotes and backslashes escaped, control
+// characters dropped). Returns bytes written, 0 if it does not fit.
+size_t http_json_value(char *out, size_t len, const char *v, size_t n, bool numeric);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,4 +1,7 @@
 #include "http_server.h"
+#include "gzip_stream.h"
+#include "http_api.h"
+#include "flash_benchmark.h"
 #include "config/config.h"
 #include "sd_card.h"
 #include "fatfs/ff.h"
@@ -6,24 +9,161 @@
 #include "lwip/pbuf.h"
 #include "lwip/err.h"
 #include "pico/cyw43_arch.h"
+#include "pico/time.h"
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
 
-// HTTP server state structure
+#ifndef HTTP_MAX_CONNS
+#define HTTP_MAX_CONNS 4        // downloads served at once; more get 503 (keep below MEMP_NUM_TCP_PCB)
+#endif
+#ifndef HTTP_BLOCK_SIZE
+#define HTTP_BLOCK_SIZE 4096    // file read unit: whole sectors, aligned in the file
+#endif
+#ifndef HTTP_POOL_BLOCKS
+#define HTTP_POOL_BLOCKS 8      // read-ahead blocks shared by all downloads (max 32)
+#endif
+#ifndef HTTP_REQUEST_MAX
+#define HTTP_REQUEST_MAX 1024   // request line + headers looked at (Range sits near the end)
+#endif
+#ifndef HTTP_CLMT_LEN
+#define HTTP_CLMT_LEN 32        // fast-seek map words: files in up to 15 fragments
+#endif
+#ifndef HTTP_LINKMAPS
+#define HTTP_LINKMAPS 2         // files whose cluster maps are kept between requests
+#endif
+#ifndef HTTP_MAX_SESSIONS
+#define HTTP_MAX_SESSIONS 7     // open connections (one pcb spare below MEMP_NUM_TCP_PCB)
+#endif
+#ifndef HTTP_IDLE_TIMEOUT_MS
+#define HTTP_IDLE_TIMEOUT_MS 7000 // keep-alive; outlasts the page's 5 s refresh
+#endif
+#ifndef HTTP_HEADER_LIMIT
+#define HTTP_HEADER_LIMIT 4096  // longer request heads get 431 (must be below TCP_WND)
+#endif
+#ifndef HTTP_GZIP_STREAMS
+#define HTTP_GZIP_STREAMS 2     // downloads compressed at once, ~18.5 KB each; more go uncompressed
+#endif
+#ifndef HTTP_GZIP_MIN
+#define HTTP_GZIP_MIN 1024      // smaller files are not worth an encoder
+#endif
+#ifndef HTTP_GZIP_STEPS
+#define HTTP_GZIP_STEPS 8       // blocks compressed per download per pump (bounds callback time)
+#endif
+#ifndef HTTP_GZIP_CHUNK_STEPS
+#define HTTP_GZIP_CHUNK_STEPS 4 // blocks compressed into one chunk at most, unless it fills first
+#endif
+#ifndef HTTP_EVENTS
+#define HTTP_EVENTS 8           // recent /events messages kept for slow or reconnecting subscribers
+#endif
+#ifndef HTTP_EVENT_MAX
+#define HTTP_EVENT_MAX 448      // one message with its id/event/data lines
+#endif
+#ifndef HTTP_EVENT_CLIENTS
+#define HTTP_EVENT_CLIENTS 2    // /events streams open at once; more get 503
+#endif
+#ifndef HTTP_EVENTS_PING_MS
+#define HTTP_EVENTS_PING_MS 15000 // comment line on a quiet stream so proxies keep it
+#endif
+#ifndef HTTP_UPLOAD_TMP
+#define HTTP_UPLOAD_TMP "UPLOAD.TMP" // an upload lands here and is renamed once its CRC checks out
+#endif
+#define HTTP_MIN_SEGMENT 512    // wait for acks rather than queue less than this
+#define HTTP_CHUNK_HEAD 6       // "%04x\r\n" in front of a gzip chunk
+#define HTTP_GZIP_PAYLOAD (HTTP_BLOCK_SIZE - HTTP_CHUNK_HEAD - 2 - 5) // room left for "\r\n" and "0\r\n\r\n"
+
+typedef struct http_session http_session_t;
+
+// A pool block held by a download
 typedef struct {
-    struct tcp_pcb *server_pcb;
-    struct tcp_pcb *client_pcb;
+    uint8_t *data;
+    uint16_t len;               // bytes read into it
+    uint16_t sent;              // ...passed to tcp_write()
+    uint16_t acked;             // ...acknowledged by the client
+} http_block_t;
+
+// One download. The file is read ahead a block at a time into blocks from
+// the shared pool, which lwIP sends from without copying. A block goes back
+// to the pool once the client has acked all of it, so backpressure never
+// loses or re-reads anything. A gzip download fills its blocks with chunks
+// of compressed data instead, framing included.
+typedef struct {
+    struct tcp_pcb *pcb;        // NULL = slot free
+    http_session_t *session;
     bool sending_file;
     FIL file;
-    uint32_t bytes_sent;
+    char name[64];
+    uint32_t bytes_read;
+    uint32_t bytes_sent;        // body bytes queued (compressed and framed for gzip)
     uint32_t total_size;
-    bool headers_sent;
-} http_server_t;
+    uint16_t header_len;
+    uint16_t header_left;       // response header bytes not written yet
+    uint16_t header_unacked;    // ...written, not acked yet
+    uint32_t started_ms;
+    uint32_t last_reported_percent;
+    uint32_t last_reported_bytes;
+    http_block_t blocks[HTTP_POOL_BLOCKS]; // oldest first
+    uint8_t block_head, block_count;
+    gzip_stream_t *gz;          // NULL = sent as stored
+    uint8_t *gz_out;            // block taking the next chunk, not queued yet
+    uint16_t gz_len;            // ...compressed bytes in it
+    uint8_t gz_steps;           // blocks left to compress this pump
+    uint8_t gz_chunk_steps;     // blocks compressed into gz_out
+    uint32_t gz_bytes;          // compressed bytes produced
+    char header[384];           // 206 with the longest name and Keep-Alive fits (380)
+    DWORD clmt[HTTP_CLMT_LEN];  // fast-seek map for Range requests
+} http_conn_t;
+
+// One TCP connection. Requests are taken from rx one at a time, in order,
+// and their bytes are only passed to tcp_recved() once taken, so pipelined
+// requests wait in the client's window rather than in our memory.
+struct http_session {
+    struct tcp_pcb *pcb;        // NULL = free
+    struct pbuf *rx;            // received, not yet consumed
+    http_conn_t *dl;            // download answering the current request
+    uint32_t body_left;         // request body bytes still to come (dropped unless uploaded)
+    uint32_t active_ms;         // last request or response
+    uint16_t requests;
+    bool http11;                // current request; chunked responses need it
+    bool keep_alive;            // after the current response
+    bool peer_closed;           // FIN seen: answer what is complete, then close
+    bool events;                // answering GET /events: the response never ends
+    bool upload;                // the request body is http_upload's
+    uint32_t ev_next;           // ...sequence number of the next message to send
+};
+
+// Cluster maps of recently resumed files. A resumed download opens the file
+// again, and building a map walks the whole FAT chain, so the map only pays
+// off when the next Range request for the same file finds it here.
+typedef struct {
+    char name[64];
+    FSIZE_t size;
+    DWORD sclust;
+    DWORD clmt[HTTP_CLMT_LEN];
+} http_linkmap_t;
 
 // Global state
 static struct tcp_pcb *http_server = NULL;
-static http_server_t *current_file_state = NULL;
+static http_conn_t http_conns[HTTP_MAX_CONNS];
+static http_session_t http_sessions[HTTP_MAX_SESSIONS];
+static int http_rr_next = 0;    // first connection the next pump serves
+static struct tcp_pcb *http_cb_pcb = NULL; // pcb whose callback is running
+static bool http_cb_aborted = false;       // ...and it was aborted: return ERR_ABRT
+static bool http_busy = false;             // polled from inside a suite (http_server_service_busy)
+static http_linkmap_t http_linkmaps[HTTP_LINKMAPS];
+static int http_linkmap_next = 0;
+static uint32_t http_pool[HTTP_POOL_BLOCKS][HTTP_BLOCK_SIZE / 4]; // words: aligned for SD DMA
+static uint32_t http_pool_used = 0;                              // bit per block
+static gzip_stream_t http_gzip[HTTP_GZIP_STREAMS];
+static http_conn_t *http_gzip_owner[HTTP_GZIP_STREAMS];
+
+// Recent /events messages, formatted whole. Subscribers keep only the
+// sequence number of the next one they need; one that falls more than
+// HTTP_EVENTS behind is told how many it missed.
+static char http_ev_text[HTTP_EVENTS][HTTP_EVENT_MAX];
+static uint16_t http_ev_len[HTTP_EVENTS];
+static uint32_t http_ev_seq = 0;    // sequence number of the next message
 
 // External references (from main.c)
 static sd_file_info_t *http_file_list = NULL;
@@ -36,199 +176,1157 @@ extern float http_get_voltage(void);
 extern bool http_get_sd_mounted(void);
 extern int http_get_file_list(sd_file_info_t *files, int max_files);
 
-// Simple HTTP response builder
-static void send_http_response(struct tcp_pcb *pcb, const char *content_type, 
+// "Connection" header for the response to the current request
+static void http_connection_header(const http_session_t *s, char *out, size_t len) {
+    if (s->keep_alive) {
+        snprintf(out, len, "Connection: keep-alive\r\nKeep-Alive: timeout=%d\r\n",
+                 HTTP_IDLE_TIMEOUT_MS / 1000);
+    } else {
+        snprintf(out, len, "Connection: close\r\n");
+    }
+}
+
+// Simple HTTP response builder; ERR_MEM if lwIP could not take all of it
+static err_t send_http_response(http_session_t *s, const char *content_type, 
                                const char *content, size_t content_len, 
                                const char *filename) {
     char headers[512];
+    char connection[64];
     int header_len;
     
+    http_connection_header(s, connection, sizeof(connection));
     if (filename) {
         header_len = snprintf(headers, sizeof(headers),
             "HTTP/1.1 200 OK\r\n"
             "Content-Type: %s\r\n"
             "Content-Disposition: attachment; filename=\"%s\"\r\n"
             "Content-Length: %zu\r\n"
-            "Connection: close\r\n"
+            "%s"
             "\r\n",
-            content_type, filename, content_len);
+            content_type, filename, content_len, connection);
     } else {
         header_len = snprintf(headers, sizeof(headers),
             "HTTP/1.1 200 OK\r\n"
             "Content-Type: %s\r\n"
             "Content-Length: %zu\r\n"
-            "Connection: close\r\n"
+            "%s"
             "\r\n",
-            content_type, content_len);
+            content_type, content_len, connection);
     }
     
-    tcp_write(pcb, headers, header_len, TCP_WRITE_FLAG_COPY);
+    err_t err = tcp_write(s->pcb, headers, header_len, TCP_WRITE_FLAG_COPY);
     
     size_t sent = 0;
-    while (sent < content_len) {
+    while (err == ERR_OK && sent < content_len) {
         size_t chunk_size = (content_len - sent) > 1024 ? 1024 : (content_len - sent);
-        tcp_write(pcb, content + sent, chunk_size, TCP_WRITE_FLAG_COPY);
+        err = tcp_write(s->pcb, content + sent, chunk_size, TCP_WRITE_FLAG_COPY);
         sent += chunk_size;
     }
     
-    tcp_output(pcb);
+    tcp_output(s->pcb);
+    return err;
 }
 
-// Progress tracking for file transfers
-static uint32_t last_reported_percent = 0;
-static uint32_t last_reported_bytes = 0;
+// Short response: status line, any extra header lines, a one-line body
+static void send_http_error(http_session_t *s, const char *status, const char *extra, const char *body) {
+    char response[320];
+    char connection[64];
+    http_connection_header(s, connection, sizeof(connection));
+    int len = snprintf(response, sizeof(response),
+                       "HTTP/1.1 %s\r\n%sContent-Length: %u\r\n%s\r\n%s",
+                       status, extra, (unsigned)strlen(body), connection, body);
+    tcp_write(s->pcb, response, len, TCP_WRITE_FLAG_COPY);
+    tcp_output(s->pcb);
+}
 
-// Send file chunk over HTTP
-static err_t http_send_file_chunk(struct tcp_pcb *pcb, http_server_t *state) {
-    if (!state || !state->sending_file) {
-        return ERR_OK;
+// Small JSON answer (/api/, uploads), never stored by the browser; extra is
+// any further header lines
+static err_t send_http_json(http_session_t *s, const char *status, const char *extra,
+                            const char *json, size_t json_len) {
+    char headers[256];
+    char connection[64];
+    http_connection_header(s, connection, sizeof(connection));
+    int header_len = snprintf(headers, sizeof(headers),
+        "HTTP/1.1 %s\r\n"
+        "Content-Type: application/json\r\n"
+        "Content-Length: %u\r\n"
+        "Cache-Control: no-cache\r\n"
+        "%s"
+        "%s"
+        "\r\n",
+        status, (unsigned)json_len, extra, connection);
+    err_t err = tcp_write(s->pcb, headers, header_len, TCP_WRITE_FLAG_COPY);
+    if (err == ERR_OK && json_len) {
+        err = tcp_write(s->pcb, json, json_len, TCP_WRITE_FLAG_COPY);
     }
-    
-    if (!state->headers_sent) {
-        state->headers_sent = true;
+    tcp_output(s->pcb);
+    return err;
+}
+
+static int http_conn_index(const http_conn_t *conn) {
+    return (int)(conn - http_conns);
+}
+
+static int http_session_index(const http_session_t *s) {
+    return (int)(s - http_sessions);
+}
+
+static uint8_t *http_block_alloc(void) {
+    for (int i = 0; i < HTTP_POOL_BLOCKS; i++) {
+        if (!(http_pool_used & (1u << i))) {
+            http_pool_used |= 1u << i;
+            return (uint8_t *)http_pool[i];
+        }
     }
-    
-    u16_t available = tcp_sndbuf(pcb);
-    if (available < 512) {
-        return ERR_OK;
+    return NULL;
+}
+
+static void http_block_free(const uint8_t *data) {
+    http_pool_used &= ~(1u << ((const uint32_t *)(const void *)data - http_pool[0]) / (HTTP_BLOCK_SIZE / 4));
+}
+
+// The upload being received, one at a time (it holds a pool block and a file
+// open for writing). Body bytes are copied into the block, written to
+// HTTP_UPLOAD_TMP a block at a time, and only then passed to tcp_recved():
+// a slow card closes the client's window instead of filling our memory.
+typedef struct {
+    http_session_t *session;    // NULL = free
+    FIL file;
+    char name[64];              // replaced once the whole body is in and its CRC matches
+    uint8_t *block;
+    uint16_t fill;              // bytes in block
+    uint32_t unacked;           // taken from rx but not committed: tcp_recved() still owed
+    uint32_t size, done;        // Content-Length, bytes written
+    uint32_t crc, crc_want;
+    bool check_crc, restore;
+    uint64_t started_us, write_us;
+    uint32_t last_reported_bytes;
+} http_upload_t;
+
+static http_upload_t http_upload;
+
+// Forget the upload; the file it was to replace is left as it was
+static void http_upload_discard(void) {
+    http_upload_t *u = &http_upload;
+    if (!u->session) {
+        return;
     }
-    
-    static uint8_t buffer[2048];
-    UINT to_read = available;
-    if (to_read > sizeof(buffer)) to_read = sizeof(buffer);
-    
-    uint32_t remaining = state->total_size - state->bytes_sent;
-    if (to_read > remaining) to_read = remaining;
-    
-    if (to_read == 0) {
-        f_close(&state->file);
-        state->sending_file = false;
-        printf("\n[+] File transfer complete: 100%% (%lu / %lu bytes)\n", 
-               (unsigned long)state->bytes_sent, (unsigned long)state->total_size);
-        last_reported_percent = 0;
-        last_reported_bytes = 0;
-        return ERR_OK;
+    f_close(&u->file);
+    f_unlink(HTTP_UPLOAD_TMP);
+    http_block_free(u->block);
+    u->session->upload = false;
+    u->session = NULL;
+}
+
+// An idle encoder for conn, or NULL: the download then goes uncompressed
+static gzip_stream_t *http_gzip_alloc(http_conn_t *conn) {
+    for (int i = 0; i < HTTP_GZIP_STREAMS; i++) {
+        if (!http_gzip_owner[i]) {
+            http_gzip_owner[i] = conn;
+            gzip_stream_init(&http_gzip[i]);
+            return &http_gzip[i];
+        }
     }
+    return NULL;
+}
+
+static http_conn_t *http_conn_alloc(http_session_t *s) {
+    for (int i = 0; i < HTTP_MAX_CONNS; i++) {
+        if (!http_conns[i].pcb) {
+            http_conn_t *conn = &http_conns[i];
+            conn->pcb = s->pcb;
+            conn->session = s;
+            conn->sending_file = false;
+            conn->block_head = conn->block_count = 0;
+            conn->gz = NULL;
+            conn->gz_out = NULL;
+            return conn;
+        }
+    }
+    return NULL;
+}
+
+// Free the slot and its blocks. lwIP may still point into blocks that were
+// sent but not acked, so this is only for a pcb that is done with them:
+// fully acked, aborted or already gone.
+static void http_conn_release(http_conn_t *conn) {
+    if (conn->sending_file) {
+        f_close(&conn->file);
+        conn->sending_file = false;
+    }
+    while (conn->block_count) {
+        http_block_free(conn->blocks[conn->block_head].data);
+        conn->block_head = (conn->block_head + 1) % HTTP_POOL_BLOCKS;
+        conn->block_count--;
+    }
+    if (conn->gz_out) {
+        http_block_free(conn->gz_out);
+        conn->gz_out = NULL;
+    }
+    if (conn->gz) {
+        http_gzip_owner[conn->gz - http_gzip] = NULL;
+        conn->gz = NULL;
+    }
+    conn->pcb = NULL;
+}
+
+// The client acked len more bytes of the response: blocks it has all of go
+// back to the pool
+static void http_conn_acked(http_conn_t *conn, uint32_t len) {
+    uint32_t n = len < conn->header_unacked ? len : conn->header_unacked;
+    conn->header_unacked -= (uint16_t)n;
+    len -= n;
+    while (len && conn->block_count) {
+        http_block_t *b = &conn->blocks[conn->block_head];
+        n = (uint32_t)(b->sent - b->acked);
+        if (n > len) n = len;
+        b->acked += (uint16_t)n;
+        len -= n;
+        if (b->acked < b->len) {
+            break;
+        }
+        http_block_free(b->data);
+        conn->block_head = (conn->block_head + 1) % HTTP_POOL_BLOCKS;
+        conn->block_count--;
+    }
+}
+
+// Abort a pcb; a callback running on it has to return ERR_ABRT
+static void http_abort(struct tcp_pcb *pcb) {
+    if (pcb == http_cb_pcb) {
+        http_cb_aborted = true;
+    }
+    tcp_abort(pcb);
+}
+
+// Forget the connection and its download; the pcb is no longer ours
+static void http_session_release(http_session_t *s) {
+    if (s->upload) {
+        printf("[!] Upload of %s cut off after %lu of %lu bytes\n", http_upload.name,
+               (unsigned long)(http_upload.done + http_upload.fill), (unsigned long)http_upload.size);
+        http_upload_discard();
+    }
+    if (s->dl) {
+        http_conn_release(s->dl);
+        s->dl = NULL;
+    }
+    if (s->rx) {
+        pbuf_free(s->rx);
+        s->rx = NULL;
+    }
+    s->pcb = NULL;
+}
+
+static void http_session_abort(http_session_t *s);
+
+// Close gracefully (queued data still goes out) and free the session
+static void http_session_close(http_session_t *s) {
+    struct tcp_pcb *pcb = s->pcb;
+    if (s->dl) {
+        // lwIP would go on sending from blocks that return to the pool
+        http_session_abort(s);
+        return;
+    }
+    if (s->rx) {
+        tcp_recved(pcb, s->rx->tot_len);  // unread data would make lwIP send RST
+    }
+    if (s->upload && http_upload.unacked) {
+        tcp_recved(pcb, (u16_t)http_upload.unacked);
+    }
+    http_session_release(s);
+    tcp_arg(pcb, NULL);
+    tcp_recv(pcb, NULL);
+    tcp_sent(pcb, NULL);
+    tcp_poll(pcb, NULL, 0);
+    tcp_err(pcb, NULL);
+    if (tcp_close(pcb) != ERR_OK) {
+        http_abort(pcb);
+    }
+}
+
+// Reset the connection and free the session
+static void http_session_abort(http_session_t *s) {
+    struct tcp_pcb *pcb = s->pcb;
+    http_session_release(s);
+    tcp_arg(pcb, NULL);
+    tcp_err(pcb, NULL);
+    http_abort(pcb);
+}
+
+// A free session, or the kept-alive one idle longest, closed to make room.
+// Connections that have not had a request answered yet are never taken.
+static http_session_t *http_session_alloc(struct tcp_pcb *pcb) {
+    http_session_t *s = NULL;
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    for (int i = 0; i < HTTP_MAX_SESSIONS && !(s && !s->pcb); i++) {
+        http_session_t *c = &http_sessions[i];
+        bool idle = c->requests && !c->dl && !c->rx && !c->events && !c->upload;
+        if (!c->pcb || (idle && (!s || now - c->active_ms > now - s->active_ms))) {
+            s = c;
+        }
+    }
+    if (!s) {
+        return NULL;
+    }
+    if (s->pcb) {
+        printf("[*] HTTP connection #%d closed for a new one (idle %lu ms)\n",
+               http_session_index(s), (unsigned long)(now - s->active_ms));
+        http_session_close(s);
+    }
+    memset(s, 0, sizeof(*s));
+    s->pcb = pcb;
+    s->active_ms = now;
+    return s;
+}
+
+static void format_size(char *out, size_t len, uint32_t bytes) {
+    if (bytes < 1024) {
+        snprintf(out, len, "%lu B", (unsigned long)bytes);
+    } else if (bytes < 1024 * 1024) {
+        snprintf(out, len, "%.2f KB", bytes / 1024.0f);
+    } else {
+        snprintf(out, len, "%.2f MB", bytes / (1024.0f * 1024.0f));
+    }
+}
+
+// File bytes delivered: sent, or for gzip compressed
+static uint32_t http_conn_done(const http_conn_t *conn) {
+    return conn->gz ? conn->bytes_read : conn->bytes_sent;
+}
+
+static void http_report_progress(http_conn_t *conn) {
+    uint32_t done = http_conn_done(conn);
+    uint32_t current_percent = (conn->total_size > 0) ? 
+        (uint32_t)(((uint64_t)done * 100) / conn->total_size) : 0;
+    uint32_t bytes_since_report = done - conn->last_reported_bytes;
     
-    UINT bytes_read = 0;
-    FRESULT fr = f_read(&state->file, buffer, to_read, &bytes_read);
-    
-    if (fr != FR_OK || bytes_read == 0) {
-        f_close(&state->file);
-        state->sending_file = false;
-        if (fr == FR_OK) {
-            printf("\n[+] File transfer complete: 100%% (%lu / %lu bytes)\n", 
-                   (unsigned long)state->bytes_sent, (unsigned long)state->total_size);
-        } else {
-            printf("\n[!] File read error: %d\n", fr);
+    if (current_percent >= conn->last_reported_percent + 5 || bytes_since_report >= 51200) {
+        char size_str[32];
+        char sent_str[32];
+        format_size(size_str, sizeof(size_str), conn->total_size);
+        format_size(sent_str, sizeof(sent_str), done);
+        printf("[*] Download #%d progress: %3lu%% (%s / %s)        \r", 
+               http_conn_index(conn), (unsigned long)current_percent, sent_str, size_str);
+        fflush(stdout);
+        conn->last_reported_percent = current_percent;
+        conn->last_reported_bytes = done;
+    }
+}
+
+// Download done (fr == FR_OK) or failed. A finished one frees its slot and
+// the connection stays open for the next request unless the client asked
+// otherwise; a failed one aborts, as the client is still owed bytes of the
+// announced Content-Length.
+static void http_finish_file(http_conn_t *conn, FRESULT fr) {
+    http_session_t *s = conn->session;
+    uint32_t done = http_conn_done(conn);
+    if (fr == FR_OK && done == conn->total_size) {
+        uint32_t ms = to_ms_since_boot(get_absolute_time()) - conn->started_ms;
+        printf("\n[+] File transfer complete: 100%% (%lu / %lu bytes) #%d %s, %lu ms, %.1f KB/s\n", 
+               (unsigned long)done, (unsigned long)conn->total_size,
+               http_conn_index(conn), conn->name, (unsigned long)ms,
+               ms ? done / 1.024f / ms : 0.0f);
+        if (conn->gz) {
+            printf("[+] gzip: %lu bytes compressed to %lu (%.1f:1)\n", (unsigned long)done,
+                   (unsigned long)conn->gz_bytes, conn->gz_bytes ? (float)done / conn->gz_bytes : 0.0f);
+        }
+        http_conn_release(conn);
+        s->dl = NULL;
+        s->active_ms = to_ms_since_boot(get_absolute_time());
+        if (!s->keep_alive) {
+            http_session_close(s);
         }
-        last_reported_percent = 0;
-        last_reported_bytes = 0;
-        return ERR_OK;
+        return;
     }
+    printf("\n[!] File read error: %d (#%d %s at %lu / %lu bytes)\n", fr, http_conn_index(conn),
+           conn->name, (unsigned long)done, (unsigned long)conn->total_size);
+    http_session_abort(s);
+}
+
+// Queue what tcp_write() will take of the header, then of the held blocks.
+// Returns 1 if bytes were queued, 0 if the window is full or nothing is
+// left, -1 if lwIP is out of memory (no connection will get further now).
+static int http_send_queued(http_conn_t *conn) {
+    struct tcp_pcb *pcb = conn->pcb;
+    err_t err;
     
-    uint32_t bytes_before = state->bytes_sent;
-    state->bytes_sent += bytes_read;
+    if (conn->header_left) {
+        // Copied: the header is small and its buffer is reused
+        if (tcp_sndbuf(pcb) < conn->header_left) {
+            return 0;
+        }
+        err = tcp_write(pcb, conn->header + conn->header_len - conn->header_left,
+                        conn->header_left, TCP_WRITE_FLAG_COPY);
+        if (err == ERR_OK) {
+            conn->header_unacked += conn->header_left;
+            conn->header_left = 0;
+            tcp_output(pcb);
+            return 1;
+        }
+    } else {
+        http_block_t *b = NULL;
+        int k = 0;
+        for (; k < conn->block_count; k++) {
+            b = &conn->blocks[(conn->block_head + k) % HTTP_POOL_BLOCKS];
+            if (b->sent < b->len) {
+                break;
+            }
+        }
+        if (k == conn->block_count) {
+            return 0;
+        }
+        uint32_t left = (uint32_t)(b->len - b->sent);
+        uint32_t len = tcp_sndbuf(pcb);
+        if (len > left) len = left;
+        if (len < HTTP_MIN_SEGMENT && len < left) {
+            return 0;
+        }
+        // No copy: the block stays ours, untouched, until it is acked
+        bool more = k + 1 < conn->block_count || conn->bytes_read < conn->total_size || conn->gz_out ||
+                    (conn->gz && !gzip_stream_finished(conn->gz));
+        err = tcp_write(pcb, b->data + b->sent, (u16_t)len, more ? TCP_WRITE_FLAG_MORE : 0);
+        if (err == ERR_OK) {
+            b->sent += (uint16_t)len;
+            conn->bytes_sent += len;
+            http_report_progress(conn);
+            tcp_output(pcb);
+            return 1;
+        }
+    }
+    if (err == ERR_MEM) {
+        return -1;
+    }
+    http_finish_file(conn, FR_INT_ERR);
+    return 0;
+}
+
+// Frame the compressed bytes in conn->gz_out as one chunk ("%04x\r\n" data
+// "\r\n", plus the last chunk once the stream ends) and queue the block
+static void http_gzip_chunk(http_conn_t *conn) {
+    uint8_t *d = conn->gz_out;
+    uint16_t len = 0;
+    if (conn->gz_len) {
+        char size[HTTP_CHUNK_HEAD + 1];
+        snprintf(size, sizeof(size), "%04x\r\n", conn->gz_len);
+        memcpy(d, size, HTTP_CHUNK_HEAD);
+        len = HTTP_CHUNK_HEAD + conn->gz_len;
+        memcpy(d + len, "\r\n", 2);
+        len += 2;
+    }
+    if (gzip_stream_finished(conn->gz)) {
+        memcpy(d + len, "0\r\n\r\n", 5);
+        len += 5;
+    }
+    http_block_t *b = &conn->blocks[(conn->block_head + conn->block_count++) % HTTP_POOL_BLOCKS];
+    b->data = d;
+    b->len = len;
+    b->sent = b->acked = 0;
+    conn->gz_bytes += conn->gz_len;
+    conn->gz_out = NULL;
+}
+
+// Compress one block of the file into conn->gz_out. Returns 1 if it did, 0
+// if it has to wait for the pool or for the next pump.
+static int http_gzip_step(http_conn_t *conn, int cap) {
+    gzip_stream_t *z = conn->gz;
+    if (gzip_stream_finished(z) || conn->gz_steps == 0) {
+        return 0;
+    }
+    if (!conn->gz_out) {
+        if (conn->block_count >= cap || !(conn->gz_out = http_block_alloc())) {
+            return 0;
+        }
+        conn->gz_len = 0;
+        conn->gz_chunk_steps = 0;
+    }
+    conn->gz_steps--;
     
-    static uint32_t last_reported_percent_static = 0;
-    static uint32_t last_reported_bytes_static = 0;
-    uint32_t current_percent = (state->total_size > 0) ? 
-        (state->bytes_sent * 100) / state->total_size : 0;
-    uint32_t bytes_since_report = state->bytes_sent - last_reported_bytes_static;
+    uint8_t *in;
+    UINT to_read = (UINT)gzip_stream_in(z, &in);
+    uint32_t remaining = conn->total_size - conn->bytes_read;
+    if (to_read > HTTP_BLOCK_SIZE) to_read = HTTP_BLOCK_SIZE;
+    if (to_read > remaining) to_read = (UINT)remaining;
+    if (to_read) {
+        UINT bytes_read = 0;
+        FRESULT fr = f_read(&conn->file, in, to_read, &bytes_read);
+        if (fr != FR_OK || bytes_read == 0) {
+            http_finish_file(conn, fr != FR_OK ? fr : FR_INT_ERR);
+            return 0;
+        }
+        gzip_stream_in_done(z, bytes_read);
+        conn->bytes_read += bytes_read;
+    }
+    conn->gz_len += (uint16_t)gzip_stream_deflate(z, conn->gz_out + HTTP_CHUNK_HEAD + conn->gz_len,
+                                                  HTTP_GZIP_PAYLOAD - conn->gz_len,
+                                                  conn->bytes_read == conn->total_size);
     
-    if (state->bytes_sent < last_reported_bytes_static) {
-        last_reported_percent_static = 0;
-        last_reported_bytes_static = 0;
+    // Queue the chunk once full or last, or every HTTP_GZIP_CHUNK_STEPS
+    // blocks: each ack brings another pump, so several chunks in flight keep
+    // a file that compresses well from being held to one pump per RTT
+    conn->gz_chunk_steps++;
+    if (HTTP_GZIP_PAYLOAD - conn->gz_len < GZ_MIN_OUT || gzip_stream_finished(z) ||
+        (conn->gz_len && (conn->gz_chunk_steps >= HTTP_GZIP_CHUNK_STEPS ||
+                          (conn->gz_steps == 0 && conn->block_count == 0)))) {
+        http_gzip_chunk(conn);
+    }
+    return 1;
+}
+
+// Move one download along: send what the window takes, else read (or
+// compress) the next block ahead if it may hold another (cap), else finish
+// once the client has acked everything. Returns as http_send_queued().
+static int http_send_file_chunk(http_conn_t *conn, int cap) {
+    int r = http_send_queued(conn);
+    if (r != 0 || !conn->pcb) {
+        return r;
     }
     
-    if (current_percent >= last_reported_percent_static + 5 || bytes_since_report >= 51200) {
-        char size_str[32];
-        char sent_str[32];
-        if (state->total_size < 1024) {
-            snprintf(size_str, sizeof(size_str), "%lu B", (unsigned long)state->total_size);
-            snprintf(sent_str, sizeof(sent_str), "%lu B", (unsigned long)state->bytes_sent);
-        } else if (state->total_size < 1024 * 1024) {
-            snprintf(size_str, sizeof(size_str), "%.2f KB", state->total_size / 1024.0f);
-            snprintf(sent_str, sizeof(sent_str), "%.2f KB", state->bytes_sent / 1024.0f);
-        } else {
-            snprintf(size_str, sizeof(size_str), "%.2f MB", state->total_size / (1024.0f * 1024.0f));
-            snprintf(sent_str, sizeof(sent_str), "%.2f MB", state->bytes_sent / (1024.0f * 1024.0f));
+    if (conn->gz) {
+        r = http_gzip_step(conn, cap);
+        if (r != 0 || !conn->pcb) {
+            return r;
         }
-        
-        printf("[*] Download progress: %3lu%% (%s / %s)        \r", 
-               (unsigned long)current_percent, sent_str, size_str);
-        fflush(stdout);
-        last_reported_percent_static = current_percent;
-        last_reported_bytes_static = state->bytes_sent;
+    } else if (conn->bytes_read < conn->total_size && conn->block_count < cap) {
+        uint8_t *data = http_block_alloc();
+        if (!data) {
+            return 0;
+        }
+        // Whole blocks at block-aligned file offsets, so FatFs reads straight
+        // into the block with multi-sector reads; after a Range seek the
+        // first read only runs up to the next boundary
+        UINT to_read = HTTP_BLOCK_SIZE - (UINT)(f_tell(&conn->file) % HTTP_BLOCK_SIZE);
+        uint32_t remaining = conn->total_size - conn->bytes_read;
+        if (to_read > remaining) to_read = (UINT)remaining;
+        UINT bytes_read = 0;
+        FRESULT fr = f_read(&conn->file, data, to_read, &bytes_read);
+        if (fr != FR_OK || bytes_read == 0) {
+            http_block_free(data);
+            http_finish_file(conn, fr != FR_OK ? fr : FR_INT_ERR);
+            return 0;
+        }
+        http_block_t *b = &conn->blocks[(conn->block_head + conn->block_count++) % HTTP_POOL_BLOCKS];
+        b->data = data;
+        b->len = (uint16_t)bytes_read;
+        b->sent = b->acked = 0;
+        conn->bytes_read += bytes_read;
+        return 1;
     }
     
-    err_t err = tcp_write(pcb, buffer, bytes_read, TCP_WRITE_FLAG_COPY);
-    if (err == ERR_OK) {
-        tcp_output(pcb);
-    } else if (err == ERR_MEM) {
-        state->bytes_sent = bytes_before;
-        uint32_t current_pos = state->file.fptr;
-        f_lseek(&state->file, current_pos - bytes_read);
+    if (conn->bytes_read == conn->total_size && conn->block_count == 0 && conn->header_unacked == 0 &&
+        conn->header_left == 0 && (!conn->gz || gzip_stream_finished(conn->gz)) && !conn->gz_out) {
+        http_finish_file(conn, FR_OK);
     }
-    
-    return err;
+    return 0;
 }
 
-// TCP sent callback
+// Write the messages s has not had yet, whole ones only, while the send
+// buffer takes them; the rest go out as acks make room
+static void http_events_send(http_session_t *s) {
+    uint32_t behind = http_ev_seq - s->ev_next;
+    bool queued = false;
+    if (behind > HTTP_EVENTS) {
+        char note[64];
+        int len = snprintf(note, sizeof(note), "event: dropped\ndata: {\"events\":%lu}\n\n",
+                           (unsigned long)(behind - HTTP_EVENTS));
+        if (tcp_sndbuf(s->pcb) < len || tcp_write(s->pcb, note, len, TCP_WRITE_FLAG_COPY) != ERR_OK) {
+            return;
+        }
+        printf("[*] /events #%d: %lu messages dropped (slow client)\n", http_session_index(s),
+               (unsigned long)(behind - HTTP_EVENTS));
+        s->ev_next = http_ev_seq - HTTP_EVENTS;
+        queued = true;
+    }
+    while (s->ev_next != http_ev_seq) {
+        int i = s->ev_next % HTTP_EVENTS;
+        if (tcp_sndbuf(s->pcb) < http_ev_len[i] ||
+            tcp_write(s->pcb, http_ev_text[i], http_ev_len[i], TCP_WRITE_FLAG_COPY) != ERR_OK) {
+            break;
+        }
+        s->ev_next++;
+        queued = true;
+    }
+    if (queued) {
+        s->active_ms = to_ms_since_boot(get_absolute_time());
+        tcp_output(s->pcb);
+    }
+}
+
+// Serve every active download in turn, one step per connection per round,
+// until none can move. The pool is split evenly so one fast client cannot
+// hold all of it, and after an ERR_MEM the next pump starts with the
+// connection that missed its turn.
+static void http_pump(void) {
+    for (int i = 0; i < HTTP_MAX_CONNS; i++) {
+        http_conns[i].gz_steps = HTTP_GZIP_STEPS;
+    }
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        int active = 0;
+        for (int i = 0; i < HTTP_MAX_CONNS; i++) {
+            active += http_conns[i].sending_file;
+        }
+        if (active == 0) {
+            return;
+        }
+        int cap = HTTP_POOL_BLOCKS / active;
+        if (cap < 1) cap = 1;
+        int first = http_rr_next;
+        for (int k = 0; k < HTTP_MAX_CONNS; k++) {
+            int i = (first + k) % HTTP_MAX_CONNS;
+            if (!http_conns[i].sending_file) {
+                continue;
+            }
+            int r = http_send_file_chunk(&http_conns[i], cap);
+            if (r < 0) {
+                http_rr_next = i;
+                return;
+            }
+            if (r > 0) {
+                progress = true;
+            }
+        }
+        http_rr_next = (first + 1) % HTTP_MAX_CONNS;
+    }
+}
+
+static bool http_session_run(http_session_t *s);
+
+// Serve downloads, then requests that were waiting behind a finished
+// download or an unacknowledged page, until nothing moves. Called from
+// every callback on tpcb; lwIP must hear ERR_ABRT if tpcb went with it.
+static err_t http_service(struct tcp_pcb *tpcb) {
+    http_cb_pcb = tpcb;
+    http_cb_aborted = false;
+    bool again = true;
+    while (again) {
+        again = false;
+        http_pump();
+        for (int i = 0; i < HTTP_MAX_SESSIONS; i++) {
+            http_session_t *s = &http_sessions[i];
+            if (s->pcb && !s->dl && (s->rx || s->peer_closed) && http_session_run(s)) {
+                again = true;
+            }
+        }
+    }
+    http_cb_pcb = NULL;
+    return http_cb_aborted ? ERR_ABRT : ERR_OK;
+}
+
+// TCP sent callback: acked blocks return to the pool for every download
 static err_t http_server_sent(void *arg, struct tcp_pcb *tpcb, u16_t len) {
-    http_server_t *state = (http_server_t *)arg;
-    if (state && state->sending_file) {
-        http_send_file_chunk(tpcb, state);
+    http_session_t *s = (http_session_t *)arg;
+    if (s->dl) {
+        http_conn_acked(s->dl, len);
     }
-    return ERR_OK;
+    if (s->events) {
+        http_events_send(s);
+    }
+    return http_service(tpcb);
+}
+
+// TCP poll callback: retry downloads and event streams stalled by ERR_MEM
+// with nothing in flight, keep quiet event streams open, and close other
+// connections idle for HTTP_IDLE_TIMEOUT_MS
+static err_t http_server_poll(void *arg, struct tcp_pcb *tpcb) {
+    http_session_t *s = (http_session_t *)arg;
+    uint32_t idle = to_ms_since_boot(get_absolute_time()) - s->active_ms;
+    if (s->events) {
+        http_events_send(s);
+        if (idle >= HTTP_EVENTS_PING_MS && tcp_write(tpcb, ":\n\n", 3, TCP_WRITE_FLAG_COPY) == ERR_OK) {
+            s->active_ms = to_ms_since_boot(get_absolute_time());
+            tcp_output(tpcb);
+        }
+    } else if (!s->dl && idle >= HTTP_IDLE_TIMEOUT_MS) {
+        printf("[*] HTTP connection #%d idle for %lu ms: closing (%u requests)\n",
+               http_session_index(s), (unsigned long)idle, s->requests);
+        http_cb_pcb = tpcb;
+        http_cb_aborted = false;
+        http_session_close(s);
+        http_cb_pcb = NULL;
+        return http_cb_aborted ? ERR_ABRT : ERR_OK;
+    }
+    return http_service(tpcb);
 }
 
-// HTTP error callback
+// HTTP error callback: the pcb is already gone
 static void http_server_err(void *arg, err_t err) {
-    http_server_t *state = (http_server_t *)arg;
-    if (state) {
-        if (state->sending_file) {
-            f_close(&state->file);
-            state->sending_file = false;
+    http_session_t *s = (http_session_t *)arg;
+    if (s) {
+        printf("[*] HTTP client #%d disconnected (error: %d)\n", http_session_index(s), err);
+        http_session_release(s);
+    }
+}
+
+// Value of request header `name` (case-insensitive), or NULL; *len gets its length
+static const char *http_header(const char *request, const char *name, size_t *len) {
+    size_t n = strlen(name);
+    for (const char *line = strstr(request, "\r\n"); line; line = strstr(line, "\r\n")) {
+        line += 2;
+        if (*line == '\r') {
+            break;  // blank line: end of headers
         }
-        state->client_pcb = NULL;
-        if (current_file_state == state) {
-            current_file_state = NULL;
+        if (strncasecmp(line, name, n) == 0 && line[n] == ':') {
+            const char *v = line + n + 1;
+            while (*v == ' ' || *v == '\t') v++;
+            const char *e = strstr(v, "\r\n");
+            *len = e ? (size_t)(e - v) : strlen(v);
+            return v;
         }
-        free(state);
-        printf("[*] HTTP client disconnected (error: %d)\n", err);
     }
+    return NULL;
 }
 
-// HTTP receive callback
-static err_t http_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err) {
-    if (p == NULL) {
-        if (current_file_state) {
-            if (current_file_state->sending_file) {
-                f_close(&current_file_state->file);
+// One "bytes=" range against a file of `size` bytes. Returns 1 with
+// [*first, *last] set, 0 to send the whole file (absent, malformed or
+// several ranges, which HTTP allows), or -1 if it is unsatisfiable (416).
+static int http_parse_range(const char *v, size_t len, FSIZE_t size, FSIZE_t *first, FSIZE_t *last) {
+    char spec[48];
+    if (len <= 6 || len - 6 >= sizeof(spec) || strncasecmp(v, "bytes=", 6) != 0) {
+        return 0;
+    }
+    memcpy(spec, v + 6, len - 6);
+    spec[len - 6] = '\0';
+    char *dash = strchr(spec, '-');
+    if (!dash || strchr(spec, ',')) {
+        return 0;
+    }
+    char *e;
+    if (dash == spec) {
+        // Suffix range: the last N bytes
+        unsigned long n = strtoul(dash + 1, &e, 10);
+        if (e == dash + 1 || *e) return 0;
+        if (n == 0 || size == 0) return -1;
+        *first = (n >= size) ? 0 : size - n;
+        *last = size - 1;
+        return 1;
+    }
+    unsigned long a = strtoul(spec, &e, 10);
+    if (e != dash) return 0;
+    unsigned long b = (unsigned long)size - 1;
+    if (dash[1]) {
+        b = strtoul(dash + 1, &e, 10);
+        if (*e || b < a) return 0;
+    }
+    if (a >= size) return -1;
+    *first = a;
+    *last = (b >= size) ? size - 1 : b;
+    return 1;
+}
+
+// Give conn->file a cluster map so f_lseek() does not follow the FAT chain:
+// copied from the cache when this file was resumed before, else built (one
+// chain walk) and cached. A file too fragmented for HTTP_CLMT_LEN seeks the
+// normal way.
+static void http_conn_linkmap(http_conn_t *conn) {
+    FIL *f = &conn->file;
+    for (int i = 0; i < HTTP_LINKMAPS; i++) {
+        http_linkmap_t *m = &http_linkmaps[i];
+        if (m->size == f_size(f) && m->sclust == f->obj.sclust && strcmp(m->name, conn->name) == 0) {
+            memcpy(conn->clmt, m->clmt, sizeof(conn->clmt));
+            f->cltbl = conn->clmt;
+            return;
+        }
+    }
+    conn->clmt[0] = HTTP_CLMT_LEN;
+    f->cltbl = conn->clmt;
+    if (f_lseek(f, CREATE_LINKMAP) != FR_OK) {
+        f->cltbl = NULL;
+        return;
+    }
+    http_linkmap_t *m = &http_linkmaps[http_linkmap_next];
+    http_linkmap_next = (http_linkmap_next + 1) % HTTP_LINKMAPS;
+    snprintf(m->name, sizeof(m->name), "%s", conn->name);
+    m->size = f_size(f);
+    m->sclust = f->obj.sclust;
+    memcpy(m->clmt, conn->clmt, sizeof(m->clmt));
+}
+
+// Does the comma-separated header value contain token (case-insensitive)?
+// Parameters after ';' are not looked at.
+static bool http_has_token(const char *v, size_t len, const char *token) {
+    size_t n = strlen(token);
+    for (size_t i = 0; i + n <= len; i++) {
+        if (strncasecmp(v + i, token, n) == 0 && (i == 0 || v[i - 1] == ' ' || v[i - 1] == ',') &&
+            (i + n == len || v[i + n] == ' ' || v[i + n] == ',' || v[i + n] == ';')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Value of key in the request target's query string, %xx and '+' decoded.
+// Returns its length, -1 if the key is missing; a value of len or more is
+// cut short in out, so callers tell "too long" from "missing".
+static int http_query_param(const char *request, const char *key, char *out, size_t len) {
+    const char *q = strchr(request, '?');
+    const char *end = strchr(request, ' ');
+    end = end ? strchr(end + 1, ' ') : NULL;
+    out[0] = '\0';
+    if (!q || !end || q > end) {
+        return -1;
+    }
+    size_t klen = strlen(key);
+    for (const char *p = q + 1; p < end; p++) {
+        const char *amp = memchr(p, '&', (size_t)(end - p));
+        const char *stop = amp ? amp : end;
+        if ((size_t)(stop - p) > klen && p[klen] == '=' && strncmp(p, key, klen) == 0) {
+            size_t j = 0;
+            for (p += klen + 1; p < stop; p++) {
+                char c = *p;
+                if (c == '%' && stop - p > 2) {
+                    char hex[3] = {p[1], p[2], 0};
+                    c = (char)strtol(hex, NULL, 16);
+                    p += 2;
+                } else if (c == '+') {
+                    c = ' ';
+                }
+                if (j + 1 < len) {
+                    out[j] = c;
+                    out[j + 1] = '\0';
+                }
+                j++;
             }
-            free(current_file_state);
-            current_file_state = NULL;
+            return (int)j;
         }
-        tcp_close(pcb);
-        return ERR_OK;
+        p = stop;
     }
+    return -1;
+}
+
+// Let the client send the next window's worth
+static void http_upload_recved(http_session_t *s) {
+    if (http_upload.unacked) {
+        tcp_recved(s->pcb, (u16_t)http_upload.unacked);
+        http_upload.unacked = 0;
+    }
+}
+
+// A bad or failed upload: answer and close, as the rest of the body is not
+// wanted. Anything written so far is dropped.
+static void http_upload_refuse(http_session_t *s, const char *status, const char *error) {
+    char json[96];
+    int len = snprintf(json, sizeof(json), "{\"error\":\"%s\"}", error);
+    printf("[!] Upload refused: %s (%s)\n", error, status);
+    if (s->upload) {
+        http_upload_recved(s);
+        http_upload_discard();
+    }
+    s->keep_alive = false;
+    send_http_json(s, status, strncmp(status, "503", 3) == 0 ? "Retry-After: 5\r\n" : "", json, (size_t)len);
+    http_session_close(s);
+}
+
+// PUT or POST /upload?name=DIR/FILE[&crc32=HEX][&restore=1] with a
+// Content-Length body. Checks everything that can be checked before the body
+// arrives, so a refusal costs the client one round trip, not the upload.
+static void http_upload_start(http_session_t *s, const char *request) {
+    http_upload_t *u = &http_upload;
+    char name[64], crc[12], restore[4];
+    size_t len;
+    int crc_len = http_query_param(request, "crc32", crc, sizeof(crc));
+    bool has_crc = crc_len >= 0;
+    unsigned long crc_want = has_crc ? strtoul(crc, NULL, 16) : 0;
+    bool want_restore = http_query_param(request, "restore", restore, sizeof(restore)) == 1 && restore[0] == '1';
+    int name_len = http_query_param(request, "name", name, sizeof(name));
+    const char *slash;
+
+    if (name_len < 1 || name_len >= (int)sizeof(name) || name[0] == '/' ||
+        strstr(name, "..") || strchr(name, '\\') || strcasecmp(name, HTTP_UPLOAD_TMP) == 0) {
+        http_upload_refuse(s, "400 Bad Request", "name= missing or not a plain path");
+        return;
+    }
+    if (!http_header(request, "Content-Length", &len)) {
+        http_upload_refuse(s, "411 Length Required", "Content-Length required");
+        return;
+    }
+    // A crc32= that is there but unusable must not turn into "unchecked"
+    if (has_crc && (crc_len < 1 || crc_len > 8 || (int)strspn(crc, "0123456789abcdefABCDEF") != crc_len)) {
+        http_upload_refuse(s, "400 Bad Request", "crc32= takes 1-8 hex digits");
+        return;
+    }
+    slash = strrchr(name, '/');
+    if (want_restore && (!slash || slash == name || !slash[1])) {
+        http_upload_refuse(s, "400 Bad Request", "restore=1 needs name=DIR/FILE");
+        return;
+    }
+    if (want_restore && s->body_left > flash_capacity_bytes()) {
+        http_upload_refuse(s, "413 Content Too Large", "image larger than the flash chip");
+        return;
+    }
+    if (!http_get_sd_mounted()) {
+        http_upload_refuse(s, "503 Service Unavailable", "SD card not mounted");
+        return;
+    }
+    if (http_busy) {
+        http_upload_refuse(s, "503 Service Unavailable", "benchmark running");
+        return;
+    }
+    if (u->session) {
+        http_upload_refuse(s, "503 Service Unavailable", "another upload is running");
+        return;
+    }
+    for (int i = 0; i < HTTP_MAX_CONNS; i++) {
+        // No FF_FS_LOCK: the download would read a file being replaced
+        if (http_conns[i].pcb && http_conns[i].sending_file && strcasecmp(http_conns[i].name, name) == 0) {
+            http_upload_refuse(s, "409 Conflict", "file is being downloaded");
+            return;
+        }
+    }
+    u->block = http_block_alloc();
+    if (!u->block) {
+        http_upload_refuse(s, "503 Service Unavailable", "all buffers busy");
+        return;
+    }
+    if (f_open(&u->file, HTTP_UPLOAD_TMP, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) {
+        http_block_free(u->block);
+        http_upload_refuse(s, "500 Internal Server Error", "cannot create " HTTP_UPLOAD_TMP);
+        return;
+    }
+
+    u->session = s;
+    s->upload = true;
+    snprintf(u->name, sizeof(u->name), "%s", name);
+    u->fill = 0;
+    u->unacked = 0;
+    u->size = s->body_left;
+    u->done = 0;
+    u->crc = 0;
+    u->crc_want = (uint32_t)crc_want;
+    u->check_crc = has_crc;
+    u->restore = want_restore;
+    u->started_us = time_us_64();
+    u->write_us = 0;
+    u->last_reported_bytes = 0;
+
+    char size_str[32];
+    format_size(size_str, sizeof(size_str), u->size);
+    printf("[*] Upload %s: %s%s%s\n", name, size_str, has_crc ? ", CRC-32 checked" : "",
+           want_restore ? ", then restore" : "");
+    const char *expect = http_header(request, "Expect", &len);
+    if (expect && s->http11 && http_has_token(expect, len, "100-continue")) {
+        tcp_write(s->pcb, "HTTP/1.1 100 Continue\r\n\r\n", 25, TCP_WRITE_FLAG_COPY);
+        tcp_output(s->pcb);
+    }
+}
+
+// Whole body written: close the file, check it, put it in place, answer
+static void http_upload_finish(http_session_t *s) {
+    http_upload_t *u = &http_upload;
+    FRESULT fr = f_close(&u->file);
+    uint64_t now = time_us_64();
+    if (fr != FR_OK) {
+        http_upload_refuse(s, "500 Internal Server Error", "SD write failed");
+        return;
+    }
+    if (u->check_crc && u->crc != u->crc_want) {
+        printf("[!] Upload %s: CRC-32 %08lx, client said %08lx\n", u->name, (unsigned long)u->crc,
+               (unsigned long)u->crc_want);
+        http_upload_refuse(s, "422 Unprocessable Content", "CRC-32 mismatch; file not replaced");
+        return;
+    }
+    f_unlink(u->name);
+    fr = f_rename(HTTP_UPLOAD_TMP, u->name);
+    const char *slash = strrchr(u->name, '/');
+    if (fr == FR_NO_PATH && slash) {
+        char dir[64];
+        snprintf(dir, sizeof(dir), "%.*s", (int)(slash - u->name), u->name);
+        f_mkdir(dir);
+        fr = f_rename(HTTP_UPLOAD_TMP, u->name);
+    }
+    if (fr != FR_OK) {
+        http_upload_refuse(s, "500 Internal Server Error", "rename failed");
+        return;
+    }
+    http_upload_recved(s);
+
+    // Anything derived from the old file is stale
+    for (int i = 0; i < HTTP_LINKMAPS; i++) {
+        if (strcmp(http_linkmaps[i].name, u->name) == 0) {
+            http_linkmaps[i].name[0] = '\0';
+        }
+    }
+    if (strcasecmp(u->name, "RESULTS.CSV") == 0) {
+        sd_results_changed();
+    }
+    if (http_file_list_needs_refresh_ptr) {
+        *http_file_list_needs_refresh_ptr = true;
+    }
+
+    double secs = (now - u->started_us) / 1e6;
+    double kbps = secs > 0 ? u->done / 1024.0 / secs : 0;
+    char size_str[32];
+    format_size(size_str, sizeof(size_str), u->done);
+    printf("[+] Upload %s: %s in %.2f s (%.1f KB/s, SD writes %.2f s), CRC-32 %08lx%s\n", u->name, size_str,
+           secs, kbps, u->write_us / 1e6, (unsigned long)u->crc, u->check_crc ? " ok" : "");
+
+    // Restore now rather than from the menu: the client sees the outcome.
+    // The network waits meanwhile (lwIP is only polled from here).
+    int restored = -1;
+    double restore_s = 0;
+    if (u->restore) {
+        char dir[64];
+        snprintf(dir, sizeof(dir), "%.*s", (int)(slash - u->name), u->name);
+        uint64_t t0 = time_us_64();
+        restored = sd_restore_flash_safe(dir, slash + 1) ? 1 : 0;
+        restore_s = (time_us_64() - t0) / 1e6;
+        printf("[%c] Restore from %s %s in %.2f s\n", restored ? '+' : '!', u->name,
+               restored ? "done" : "failed", restore_s);
+        flash_profile_invalidate();
+    }
+
+    char json[256];
+    int len = snprintf(json, sizeof(json),
+                       "{\"name\":\"%s\",\"bytes\":%lu,\"crc32\":\"%08lx\",\"crc_checked\":%s,"
+                       "\"seconds\":%.3f,\"KBps\":%.1f,\"sd_write_seconds\":%.3f,\"restored\":%s,"
+                       "\"restore_seconds\":%.3f}",
+                       u->name, (unsigned long)u->done, (unsigned long)u->crc, u->check_crc ? "true" : "false",
+                       secs, kbps, u->write_us / 1e6, restored < 0 ? "null" : restored ? "true" : "false",
+                       restore_s);
+    http_upload_discard();  // the file is renamed: only the block and the slot go
+    send_http_json(s, restored == 0 ? "500 Internal Server Error" : "201 Created", "", json, (size_t)len);
+}
+
+// Move what has arrived of the upload body into the block, and the block to
+// the card once it is full or the body is complete. False when it has to
+// wait for more data.
+static bool http_upload_feed(http_session_t *s) {
+    http_upload_t *u = &http_upload;
+    if (s->rx && s->body_left) {
+        u16_t n = s->rx->tot_len;
+        if (n > s->body_left) n = (u16_t)s->body_left;
+        if (n > HTTP_BLOCK_SIZE - u->fill) n = HTTP_BLOCK_SIZE - u->fill;
+        pbuf_copy_partial(s->rx, u->block + u->fill, n, 0);
+        s->rx = pbuf_free_header(s->rx, n);
+        u->crc = gzip_crc32(u->crc, u->block + u->fill, n);
+        u->fill += n;
+        u->unacked += n;
+        s->body_left -= n;
+    } else if (s->body_left) {
+        return false;
+    }
+    if (u->fill < HTTP_BLOCK_SIZE && s->body_left) {
+        return true;
+    }
+
+    UINT bw = 0;
+    uint64_t t0 = time_us_64();
+    FRESULT fr = u->fill ? f_write(&u->file, u->block, u->fill, &bw) : FR_OK;
+    u->write_us += time_us_64() - t0;
+    if (fr != FR_OK || bw < u->fill) {
+        http_upload_refuse(s, fr == FR_OK ? "507 Insufficient Storage" : "500 Internal Server Error",
+                           fr == FR_OK ? "SD card full" : "SD write failed");
+        return true;
+    }
+    u->done += u->fill;
+    u->fill = 0;
+    if (!s->body_left) {
+        http_upload_finish(s);
+        return true;
+    }
+    // Whole sectors go straight to the card: these bytes are committed
+    http_upload_recved(s);
+    s->active_ms = to_ms_since_boot(get_absolute_time());
+    if (u->done - u->last_reported_bytes >= u->size / 10 && u->done - u->last_reported_bytes >= 51200) {
+        double secs = (time_us_64() - u->started_us) / 1e6;
+        printf("[*] Upload progress: %3lu%% (%lu KB, %.1f KB/s)        \r",
+               (unsigned long)((uint64_t)u->done * 100 / u->size), (unsigned long)(u->done / 1024),
+               secs > 0 ? u->done / 1024.0 / secs : 0);
+        fflush(stdout);
+        u->last_reported_bytes = u->done;
+    }
+    return true;
+}
+
+// /live: the latest rows and per-series statistics, kept current from /events
+static const char http_live_page[] =
+    "<!DOCTYPE html><html><head><meta charset='utf-8'>"
+    "<title>IS16 Live Results</title>"
+    "<style>"
+    "body{font-family:Arial;margin:20px;background:#B0E0E6;color:#000000;}"
+    ".box{background:#E0F7FA;padding:20px;border-radius:10px;margin:20px 0;border:1px solid #B0D4E1;}"
+    "table{width:100%;border-collapse:collapse;}"
+    "th,td{padding:6px 10px;text-align:left;border-bottom:1px solid #B0D4E1;}"
+    "th{background:#81C7D4;}"
+    "</style></head><body>"
+    "<h1>Live Benchmark Results</h1>"
+    "<p>Stream: <b id='st'>connecting</b> | <a href='/'>Files</a></p>"
+    "<div class='box'><h2>Series</h2><table id='se'><tr><th>Series</th><th>Size</th><th>Runs</th>"
+    "<th>Mean &micro;s</th><th>Median &micro;s</th><th>Min</th><th>Max</th><th>CI</th><th>State</th></tr></table></div>"
+    "<div class='box'><h2>Latest Rows</h2><table id='rs'><tr><th>Time</th><th>Operation</th><th>Size</th>"
+    "<th>&micro;s</th><th>MB/s</th><th>Run</th><th>&deg;C</th><th>Notes</th></tr></table></div>"
+    "<script>"
+    "var S={},es=new EventSource('/events');"
+    "function row(t,i,c){var r=t.insertRow(i);c.forEach(function(v){r.insertCell().textContent=v});return r}"
+    "es.onopen=function(){st.textContent='live'};"
+    "es.onerror=function(){st.textContent='reconnecting'};"
+    "es.addEventListener('dropped',function(e){st.textContent='live ('+JSON.parse(e.data).events+' missed)'});"
+    "es.addEventListener('series',function(e){var d=JSON.parse(e.data),k=d.op+' '+d.label;"
+    "if(S[k])se.deleteRow(S[k].rowIndex);"
+    "S[k]=row(se,1,[k,d.size,d.n,d.mean_us,d.p50_us,d.min_us,d.max_us,"
+    "d.rel==null?'':'\u00b1'+(d.rel*100).toFixed(2)+'%',d.state])});"
+    "es.addEventListener('result',function(e){var d=JSON.parse(e.data);"
+    "row(rs,1,[d.timestamp,d.operation,d.block_size,d.elapsed_us,d.throughput_MBps,d.run,d.temp_C,d.notes]);"
+    "if(rs.rows.length>21)rs.deleteRow(21)});"
+    "</script></body></html>";
+
+// GET /events: a text/event-stream response that stays open; messages from
+// http_events_publish() follow as they come. A reconnecting EventSource
+// sends Last-Event-ID and picks up after it if that is still kept.
+static void http_events_open(http_session_t *s, const char *request) {
+    int open = 0;
+    for (int i = 0; i < HTTP_MAX_SESSIONS; i++) {
+        open += http_sessions[i].pcb && http_sessions[i].events;
+    }
+    if (open >= HTTP_EVENT_CLIENTS) {
+        printf("[!] /events refused: %d streams open\n", open);
+        send_http_error(s, "503 Service Unavailable", "Retry-After: 5\r\n", "");
+        return;
+    }
+    size_t len;
+    const char *v = http_header(request, "Last-Event-ID", &len);
+    uint32_t next = http_ev_seq;
+    if (v) {
+        uint32_t want = (uint32_t)strtoul(v, NULL, 10) + 1;
+        if (http_ev_seq - want <= HTTP_EVENTS) {
+            next = want;
+        }
+    }
+    static const char head[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/event-stream\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Connection: close\r\n"
+        "\r\n"
+        "retry: 2000\n\n";
+    if (tcp_write(s->pcb, head, sizeof(head) - 1, TCP_WRITE_FLAG_COPY) != ERR_OK) {
+        printf("[!] /events dropped: lwIP out of memory\n");
+        http_session_abort(s);
+        return;
+    }
+    s->keep_alive = false;
+    s->events = true;
+    s->ev_next = next;
+    printf("[+] /events #%d: streaming from message %lu\n", http_session_index(s), (unsigned long)next);
+    http_events_send(s);
+    tcp_output(s->pcb);
+}
+
+// Answer one request (head only, NUL-terminated). A download leaves s->dl
+// set and goes out through the pump; anything else is written here.
+static void http_handle_request(http_session_t *s, const char *request) {
+    http_conn_t *conn = NULL;
     
-    char request[256] = {0};
-    size_t copy_len = (p->tot_len < 255) ? p->tot_len : 255;
-    pbuf_copy_partial(p, request, copy_len, 0);
-    
-    printf("[*] HTTP Request: ");
-    char *end = strchr(request, '\r');
-    if (end) *end = '\0';
-    printf("%s\n", request);
+    const char *end = strchr(request, '\r');
+    printf("[*] HTTP Request #%d.%u: %.*s\n", http_session_index(s), s->requests,
+           end ? (int)(end - request) : (int)strlen(request), request);
     
     // Check for file download requests
-    char *file_param = strstr(request, "GET /file?name=");
+    const char *file_param = strncmp(request, "GET /file?name=", 15) == 0 ? request : NULL;
     if (file_param) {
         char filename[64] = {0};
-        char *name_start = file_param + strlen("GET /file?name=");
-        char *name_end = strchr(name_start, ' ');
+        const char *name_start = file_param + strlen("GET /file?name=");
+        const char *name_end = strchr(name_start, ' ');
         if (!name_end) name_end = strchr(name_start, '\r');
         if (!name_end) name_end = strchr(name_start, '\n');
         if (!name_end) name_end = strchr(name_start, '&');
@@ -254,33 +1352,76 @@ static err_t http_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err
                     }
                 }
                 
-                // Open file for streaming
-                if (http_get_sd_mounted() && sd_file_exists(decoded)) {
-                    http_server_t *state = (http_server_t *)malloc(sizeof(http_server_t));
-                    if (!state) {
-                        const char *error = "HTTP/1.1 500 Internal Server Error\r\n\r\nOut of memory\r\n";
-                        tcp_write(pcb, error, strlen(error), TCP_WRITE_FLAG_COPY);
-                        tcp_output(pcb);
-                        tcp_recved(pcb, p->tot_len);
-                        pbuf_free(p);
-                        return ERR_OK;
-                    }
+                // Open file for streaming; only downloads outlive this
+                // callback, so only they take a slot
+                bool found = http_get_sd_mounted() && sd_file_exists(decoded);
+                if (found) {
+                    conn = http_conn_alloc(s);
+                }
+                if (found && !conn) {
+                    printf("[!] Download refused: all %d download slots busy\n", HTTP_MAX_CONNS);
+                    send_http_error(s, "503 Service Unavailable", "Retry-After: 1\r\n", "");
+                } else if (found) {
+                    FRESULT fr = f_open(&conn->file, decoded, FA_OPEN_EXISTING | FA_READ);
+                    FSIZE_t size = f_size(&conn->file);
+                    FSIZE_t first = 0, last = size ? size - 1 : 0;
+                    int range = 0;
+                    char etag[32];
+                    snprintf(conn->name, sizeof(conn->name), "%s", decoded);
+                    // No RTC: the start cluster stands in for a modification time
+                    snprintf(etag, sizeof(etag), "\"%lx-%lx\"", (unsigned long)size,
+                             (unsigned long)conn->file.obj.sclust);
                     
-                    memset(state, 0, sizeof(http_server_t));
-                    state->client_pcb = pcb;
-                    state->sending_file = false;
-                    state->headers_sent = false;
-                    state->bytes_sent = 0;
+                    // Range is honoured unless If-Range names another version
+                    size_t vlen, ilen;
+                    const char *v = (fr == FR_OK) ? http_header(request, "Range", &vlen) : NULL;
+                    const char *ae = http_header(request, "Accept-Encoding", &ilen);
+                    bool gzip = ae && http_has_token(ae, ilen, "gzip") && !http_has_token(ae, ilen, "gzip;q=0");
+                    if (v) {
+                        const char *ir = http_header(request, "If-Range", &ilen);
+                        if (!ir || (ilen == strlen(etag) && memcmp(ir, etag, ilen) == 0)) {
+                            range = http_parse_range(v, vlen, size, &first, &last);
+                        }
+                    }
+                    if (range > 0 && first > 0) {
+                        uint64_t t0 = time_us_64();
+                        http_conn_linkmap(conn);
+                        fr = f_lseek(&conn->file, first);
+                        printf("[*] Resuming %s at byte %lu (seek %lu us, %s)\n", decoded,
+                               (unsigned long)first, (unsigned long)(time_us_64() - t0),
+                               conn->file.cltbl ? "cluster map" : "FAT chain");
+                    }
                     
-                    FRESULT fr = f_open(&state->file, decoded, FA_OPEN_EXISTING | FA_READ);
-                    if (fr == FR_OK) {
-                        f_lseek(&state->file, 0);
-                        state->total_size = f_size(&state->file);
-                        state->sending_file = true;
-                        current_file_state = state;
+                    if (fr == FR_OK && range < 0) {
+                        char content_range[48];
+                        snprintf(content_range, sizeof(content_range),
+                                 "Content-Range: bytes */%lu\r\n", (unsigned long)size);
+                        f_close(&conn->file);
+                        http_conn_release(conn);
+                        send_http_error(s, "416 Range Not Satisfiable", content_range, "");
+                    } else if (fr == FR_OK) {
+                        conn->total_size = (uint32_t)(size ? last - first + 1 : 0);
+                        conn->bytes_read = 0;
+                        conn->bytes_sent = 0;
+                        conn->last_reported_percent = 0;
+                        conn->last_reported_bytes = 0;
+                        conn->started_ms = to_ms_since_boot(get_absolute_time());
+                        conn->sending_file = true;
+                        conn->gz_bytes = 0;
                         
                         printf("[*] File opened: %s, size=%lu bytes\n", 
-                               decoded, (unsigned long)state->total_size);
+                               decoded, (unsigned long)size);
+                        
+                        // gzip for whole files only (a range is of the stored
+                        // bytes), framed as chunks since the length is not
+                        // known ahead, so HTTP/1.0 gets it plain
+                        if (gzip && !v && s->http11 && size >= HTTP_GZIP_MIN) {
+                            conn->gz = http_gzip_alloc(conn);
+                            if (!conn->gz) {
+                                printf("[*] All %d gzip encoders busy: %s goes uncompressed\n",
+                                       HTTP_GZIP_STREAMS, decoded);
+                            }
+                        }
                         
                         const char *content_type = "application/octet-stream";
                         if (strstr(decoded, ".csv") || strstr(decoded, ".CSV")) {
@@ -289,48 +1430,93 @@ static err_t http_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err
                             content_type = "text/plain";
                         }
                         
-                        char headers[512];
-                        int header_len = snprintf(headers, sizeof(headers),
-                            "HTTP/1.1 200 OK\r\n"
-                            "Content-Type: %s\r\n"
-                            "Content-Disposition: attachment; filename=\"%s\"\r\n"
-                            "Content-Length: %lu\r\n"
-                            "Connection: close\r\n"
-                            "\r\n",
-                            content_type, decoded, (unsigned long)state->total_size);
-                        
-                        tcp_write(pcb, headers, header_len, TCP_WRITE_FLAG_COPY);
-                        tcp_output(pcb);
-                        state->headers_sent = true;
-                        
-                        tcp_sent(pcb, http_server_sent);
-                        tcp_err(pcb, http_server_err);
-                        tcp_arg(pcb, state);
+                        // The header goes out through the pump ahead of the body
+                        char status[96] = "HTTP/1.1 200 OK\r\n";
+                        char connection[64];
+                        http_connection_header(s, connection, sizeof(connection));
+                        if (range > 0) {
+                            snprintf(status, sizeof(status),
+                                     "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes %lu-%lu/%lu\r\n",
+                                     (unsigned long)first, (unsigned long)last, (unsigned long)size);
+                        }
+                        int header_len;
+                        if (conn->gz) {
+                            // Another representation, so another ETag
+                            header_len = snprintf(conn->header, sizeof(conn->header),
+                                "%s"
+                                "Content-Type: %s\r\n"
+                                "Content-Disposition: attachment; filename=\"%s\"\r\n"
+                                "Content-Encoding: gzip\r\n"
+                                "Transfer-Encoding: chunked\r\n"
+                                "Vary: Accept-Encoding\r\n"
+                                "ETag: %.*s-gz\"\r\n"
+                                "%s"
+                                "\r\n",
+                                status, content_type, decoded, (int)strlen(etag) - 1, etag, connection);
+                        } else {
+                            header_len = snprintf(conn->header, sizeof(conn->header),
+                                "%s"
+                                "Content-Type: %s\r\n"
+                                "Content-Disposition: attachment; filename=\"%s\"\r\n"
+                                "Content-Length: %lu\r\n"
+                                "Accept-Ranges: bytes\r\n"
+                                "Vary: Accept-Encoding\r\n"
+                                "ETag: %s\r\n"
+                                "%s"
+                                "\r\n",
+                                status, content_type, decoded, (unsigned long)conn->total_size, etag,
+                                connection);
+                        }
                         
-                        http_send_file_chunk(pcb, state);
+                        conn->header_len = conn->header_left = (uint16_t)header_len;
+                        conn->header_unacked = 0;
+                        s->dl = conn;
                         
-                        printf("\n[+] Started file transfer: %s\n", decoded);
-                        printf("[*] Download progress: 0%% (0 / %lu bytes)\r", (unsigned long)state->total_size);
+                        printf("\n[+] Started file transfer #%d: %s%s\n", http_conn_index(conn), decoded,
+                               conn->gz ? " (gzip)" : "");
+                        printf("[*] Download #%d progress: 0%% (0 / %lu bytes)\r",
+                               http_conn_index(conn), (unsigned long)conn->total_size);
                     } else {
-                        free(state);
-                        const char *error = "HTTP/1.1 500 Internal Server Error\r\n\r\nFailed to open file\r\n";
-                        tcp_write(pcb, error, strlen(error), TCP_WRITE_FLAG_COPY);
-                        tcp_output(pcb);
+                        if (conn->file.obj.fs) {
+                            f_close(&conn->file);
+                        }
+                        http_conn_release(conn);
+                        send_http_error(s, "500 Internal Server Error", "", "Failed to open file\r\n");
                     }
                 } else {
-                    const char *error = "HTTP/1.1 404 Not Found\r\n\r\nFile not found\r\n";
-                    tcp_write(pcb, error, strlen(error), TCP_WRITE_FLAG_COPY);
-                    tcp_output(pcb);
+                    send_http_error(s, "404 Not Found", "", "File not found\r\n");
                 }
             } else {
-                const char *error = "HTTP/1.1 400 Bad Request\r\n\r\nFilename too long\r\n";
-                tcp_write(pcb, error, strlen(error), TCP_WRITE_FLAG_COPY);
-                tcp_output(pcb);
+                send_http_error(s, "400 Bad Request", "", "Filename too long\r\n");
             }
         } else {
-            const char *error = "HTTP/1.1 400 Bad Request\r\n\r\nInvalid request format\r\n";
-            tcp_write(pcb, error, strlen(error), TCP_WRITE_FLAG_COPY);
-            tcp_output(pcb);
+            s->keep_alive = false;
+            send_http_error(s, "400 Bad Request", "", "Invalid request format\r\n");
+        }
+    } else if (strncmp(request, "GET /events", 11) == 0 && (request[11] == ' ' || request[11] == '?')) {
+        http_events_open(s, request);
+    } else if (strncmp(request, "PUT /upload?", 12) == 0 || strncmp(request, "POST /upload?", 13) == 0) {
+        http_upload_start(s, request);
+    } else if (strncmp(request, "GET /api/", 9) == 0) {
+        http_api_reply_t reply;
+        uint64_t t0 = time_us_64();
+        http_api_answer(request + 4, strcspn(request + 4, " \r\n"), http_busy, &reply);
+        printf("[*] %.*s: %s, %u bytes, %s, %.1f ms\n", (int)strcspn(request + 4, " \r\n"), request + 4,
+               reply.status, (unsigned)reply.len, reply.cached ? "cached" : "computed",
+               (time_us_64() - t0) / 1000.0);
+        const char *extra = reply.cached ? "X-Cache: hit\r\n" :
+                            strncmp(reply.status, "503", 3) == 0 ? "X-Cache: miss\r\nRetry-After: 5\r\n" :
+                            "X-Cache: miss\r\n";
+        if (send_http_json(s, reply.status, extra, reply.json, reply.len) != ERR_OK) {
+            printf("[!] API answer dropped: lwIP out of memory\n");
+            http_session_abort(s);
+            return;
+        }
+    } else if (strncmp(request, "GET /live ", 10) == 0) {
+        if (send_http_response(s, "text/html", http_live_page, sizeof(http_live_page) - 1, NULL) != ERR_OK) {
+            printf("[!] Live page dropped: lwIP out of memory\n");
+            http_session_abort(s);
+            return;
         }
     } else {
         // Send HTML page with file list
@@ -439,28 +1625,123 @@ static err_t http_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err
             "<p style='color:#000000;'>Connected to: %s<br>"
             "IP: 192.168.4.1<br>"
             "Press GP20 on device to refresh file list<br>"
+            "<a href='/live'>Live benchmark results</a><br>"
+            "<a href='/api/report'>Report (JSON)</a> &middot; "
+            "<a href='/api/stats?op=erase'>Erase statistics (JSON)</a><br>"
             "Page auto-refreshes every 5 seconds</p>"
             "</div>"
             "</body></html>",
             AP_SSID);
         
-        send_http_response(pcb, "text/html", html, html_pos, NULL);
+        if (send_http_response(s, "text/html", html, html_pos, NULL) != ERR_OK) {
+            // A cut-off page would look complete to the browser; reset instead
+            printf("[!] HTML page dropped: lwIP out of memory\n");
+            http_session_abort(s);
+            return;
+        }
         printf("[+] Sent HTML page with %d files\n", http_file_count_ptr ? *http_file_count_ptr : 0);
     }
-    
-    tcp_recved(pcb, p->tot_len);
-    pbuf_free(p);
-    
-    if (!current_file_state || !current_file_state->sending_file) {
-        tcp_close(pcb);
+}
+
+// Answer the requests waiting in s->rx, in order, until one has to wait:
+// its head is incomplete, a download is running, or it needs room that the
+// previous response still holds. Returns true if it started a download.
+static bool http_session_run(http_session_t *s) {
+    bool started = false, blocked = false;
+    while (s->pcb && !s->dl && !s->events) {
+        if (s->upload) {
+            if (!http_upload_feed(s)) {
+                break;
+            }
+            if (s->pcb && !s->upload && !s->keep_alive) {
+                http_session_close(s);
+            }
+            continue;
+        }
+        if (s->body_left && s->rx) {
+            // Only uploads use bodies; drop others so the next request lines up
+            u16_t n = s->rx->tot_len < s->body_left ? s->rx->tot_len : (u16_t)s->body_left;
+            s->rx = pbuf_free_header(s->rx, n);
+            tcp_recved(s->pcb, n);
+            s->body_left -= n;
+            continue;
+        }
+        if (!s->rx || s->body_left) {
+            break;
+        }
+        u16_t head_end = pbuf_memfind(s->rx, "\r\n\r\n", 4, 0);
+        if (head_end == 0xFFFF) {
+            if (s->rx->tot_len >= HTTP_HEADER_LIMIT) {
+                s->keep_alive = false;
+                send_http_error(s, "431 Request Header Fields Too Large", "", "");
+                http_session_close(s);
+            }
+            break;
+        }
+        u16_t head_len = head_end + 4;
+        char request[HTTP_REQUEST_MAX];
+        u16_t copy_len = head_len < sizeof(request) - 1 ? head_len : sizeof(request) - 1;
+        pbuf_copy_partial(s->rx, request, copy_len, 0);
+        request[copy_len] = '\0';
+        
+        // Each response waits until the one before is acked: a page is
+        // written whole into lwIP's heap, and a download tells its acks
+        // from the tcp_sent() count
+        if (tcp_sndbuf(s->pcb) < TCP_SND_BUF) {
+            blocked = true;
+            break;
+        }
+        s->rx = pbuf_free_header(s->rx, head_len);
+        tcp_recved(s->pcb, head_len);
+        s->requests++;
+        s->active_ms = to_ms_since_boot(get_absolute_time());
+        
+        // HTTP/1.1 stays open unless told otherwise, HTTP/1.0 only if asked
+        size_t len;
+        const char *v = http_header(request, "Connection", &len);
+        const char *eol = strstr(request, "\r\n");
+        s->http11 = eol && eol - request >= 8 && strncmp(eol - 8, "HTTP/1.1", 8) == 0;
+        s->keep_alive = !s->peer_closed &&
+                        (s->http11 ? !(v && http_has_token(v, len, "close")) : (v && http_has_token(v, len, "keep-alive")));
+        v = http_header(request, "Content-Length", &len);
+        s->body_left = v ? strtoul(v, NULL, 10) : 0;
+        if (http_header(request, "Transfer-Encoding", &len)) {
+            // No way to find the next request after a chunked body
+            s->keep_alive = false;
+            send_http_error(s, "501 Not Implemented", "", "Chunked bodies are not supported\r\n");
+        } else {
+            http_handle_request(s, request);
+        }
+        if (s->dl) {
+            started = true;
+        } else if (s->pcb && !s->keep_alive && !s->events && !s->upload) {
+            http_session_close(s);
+        }
     }
-    
-    return ERR_OK;
+    // The client has finished sending: close once everything is answered
+    if (s->pcb && !s->dl && !blocked && s->peer_closed) {
+        http_session_close(s);
+    }
+    return started;
 }
 
-// HTTP error callback (for accept)
-static void http_err(void *arg, err_t err) {
-    printf("[!] HTTP connection error: %d\n", err);
+// HTTP receive callback: queue the bytes, answer whatever is complete
+static err_t http_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err) {
+    http_session_t *s = (http_session_t *)arg;
+    
+    if (err != ERR_OK) {
+        // lwIP only reports errors here with no usable data; drop it
+        if (p) pbuf_free(p);
+        return err;
+    }
+    if (p == NULL) {
+        s->peer_closed = true;
+    } else if (s->rx) {
+        pbuf_cat(s->rx, p);
+    } else {
+        s->rx = p;
+    }
+    return http_service(pcb);
 }
 
 // HTTP accept callback
@@ -469,10 +1750,19 @@ static err_t http_accept(void *arg, struct tcp_pcb *client_pcb, err_t err) {
         return ERR_VAL;
     }
     
-    printf("[+] HTTP client connected\n");
+    http_session_t *s = http_session_alloc(client_pcb);
+    if (!s) {
+        // Every connection is mid-request; lwIP resets this one
+        printf("[!] HTTP client refused: all %d connections busy\n", HTTP_MAX_SESSIONS);
+        return ERR_MEM;
+    }
+    printf("[+] HTTP client connected (#%d)\n", http_session_index(s));
     
+    tcp_arg(client_pcb, s);
     tcp_recv(client_pcb, http_recv);
-    tcp_err(client_pcb, http_err);
+    tcp_sent(client_pcb, http_server_sent);
+    tcp_poll(client_pcb, http_server_poll, 1);
+    tcp_err(client_pcb, http_server_err);
     
     return ERR_OK;
 }
@@ -503,6 +1793,109 @@ bool http_server_init(void) {
     return true;
 }
 
+// Reset every connection and stop listening (before cyw43_arch_deinit())
+void http_server_stop(void) {
+    if (!http_server) {
+        return;
+    }
+    for (int i = 0; i < HTTP_MAX_SESSIONS; i++) {
+        if (http_sessions[i].pcb) {
+            http_session_abort(&http_sessions[i]);
+        }
+    }
+    tcp_arg(http_server, NULL);
+    tcp_close(http_server);
+    http_server = NULL;
+    printf("[*] HTTP server stopped\n");
+}
+
+void http_server_service(void) {
+    if (http_server) {
+        cyw43_arch_poll();
+    }
+}
+
+void http_server_service_busy(void) {
+    if (http_server) {
+        http_busy = true;
+        cyw43_arch_poll();
+        http_busy = false;
+    }
+}
+
+bool http_events_wanted(void) {
+    return http_server != NULL;
+}
+
+// Keep one message and hand it to every subscriber that has room
+void http_events_publish(const char *event, const char *json) {
+    if (!http_server) {
+        return;
+    }
+    char *t = http_ev_text[http_ev_seq % HTTP_EVENTS];
+    int len = snprintf(t, HTTP_EVENT_MAX, "id: %lu\nevent: %s\ndata: %s\n\n",
+                       (unsigned long)http_ev_seq, event, json);
+    if (len <= 0 || len >= HTTP_EVENT_MAX) {
+        printf("[!] /events: %s message of %d bytes dropped (HTTP_EVENT_MAX %d)\n", event, len, HTTP_EVENT_MAX);
+        return;
+    }
+    http_ev_len[http_ev_seq % HTTP_EVENTS] = (uint16_t)len;
+    http_ev_seq++;
+    cyw43_arch_lwip_begin();
+    for (int i = 0; i < HTTP_MAX_SESSIONS; i++) {
+        if (http_sessions[i].pcb && http_sessions[i].events) {
+            http_events_send(&http_sessions[i]);
+        }
+    }
+    cyw43_arch_lwip_end();
+}
+
+// One RESULTS.CSV row as JSON keyed by the header's column names; numeric
+// columns stay numbers when they parse as one. Returns the length, or 0 if
+// it does not fit.
+static size_t http_row_json(const char *row, size_t row_len, char *out, size_t len) {
+    static const char *const names[] = {
+        "jedec_id", "operation", "block_size", "address", "elapsed_us", "throughput_MBps",
+        "run", "temp_C", "voltage_V", "pattern", "timestamp", "notes"};
+    const unsigned numeric = 1u << 2 | 1u << 4 | 1u << 5 | 1u << 6 | 1u << 7 | 1u << 8;
+    const int n_names = (int)(sizeof(names) / sizeof(names[0]));
+    size_t o = 0;
+    const char *f = row, *end = row + row_len;
+    out[o++] = '{';
+    for (int c = 0; c < n_names && f <= end; c++) {
+        // The last column takes the rest of the line, commas and all
+        const char *e = f;
+        while (e < end && (*e != ',' || c == n_names - 1)) e++;
+        int w = snprintf(out + o, len - o, "%s\"%s\":", c ? "," : "", names[c]);
+        if (w < 0 || (size_t)w >= len - o) return 0;
+        o += (size_t)w;
+        size_t v = http_json_value(out + o, len - o, f, (size_t)(e - f), numeric >> c & 1);
+        if (!v) return 0;
+        o += v;
+        f = e + 1;
+    }
+    if (o + 2 > len) return 0;
+    out[o++] = '}';
+    out[o] = '\0';
+    return o;
+}
+
+// Rows as sd_append_to_file() writes them (one or more, CRLF-separated)
+void http_events_result(const char *rows) {
+    if (!http_server) {
+        return;
+    }
+    while (*rows) {
+        size_t n = strcspn(rows, "\r\n");
+        char json[HTTP_EVENT_MAX - 48];
+        if (n && http_row_json(rows, n, json, sizeof(json))) {
+            http_events_publish("result", json);
+        }
+        rows += n;
+        rows += strspn(rows, "\r\n");
+    }
+}
+
 // Set file list pointers (called from main.c)
 void http_server_set_file_list(sd_file_info_t *files, int *file_count, bool *needs_refresh) {
     http_file_list = files;
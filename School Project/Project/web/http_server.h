@@ -4,8 +4,32 @@
 #include "sd_card.h"
 #include <stdbool.h>
 
+// Stream results to /events while benchmarks run (1), or only serve files (0)
+#ifndef HTTP_EVENTS_LIVE
+#define HTTP_EVENTS_LIVE 1
+#endif
+#ifndef HTTP_EVENTS_SERIES_MS
+#define HTTP_EVENTS_SERIES_MS 1000 // series statistics at most this often while it runs
+#endif
+
 // HTTP server functions
 bool http_server_init(void);
+void http_server_stop(void);
 void http_server_set_file_list(sd_file_info_t *files, int *file_count, bool *needs_refresh);
 
+// Let the radio and lwIP run. lwIP is polled (no background interrupt), so
+// network work only happens here: benchmarks call it between timed
+// sections. A flag test while the server is not running.
+void http_server_service(void);
+// The same from inside a suite (deep stack, files being appended): requests
+// that would run the report engine get 503 + Retry-After instead
+void http_server_service_busy(void);
+
+// Live results as Server-Sent Events (GET /events, shown by /live).
+// Messages are kept while the server runs, so a subscriber that reconnects
+// with Last-Event-ID misses nothing recent.
+bool http_events_wanted(void);
+void http_events_publish(const char *event, const char *json); // one-line JSON
+void http_events_result(const char *rows); // RESULTS.CSV rows, as "result" events
+
 #endif // HTTP_SERVER_H